@@ -29,6 +29,8 @@ complete -c fwupdmgr -l no-history -d 'Do not write to the history database'
 complete -c fwupdmgr -l show-all-devices -d 'Show devices that are not updatable'
 complete -c fwupdmgr -l disable-ssl-strict -d 'Ignore SSL strict checks when downloading files'
 complete -c fwupdmgr -l filter -d 'Filter with a set of device flags'
+complete -c fwupdmgr -l since -x -d 'Only show history since a date'
+complete -c fwupdmgr -l limit -x -d 'Only show this many history entries'
 
 # complete subcommands
 complete -c fwupdmgr -n '__fish_use_subcommand' -x -a activate -d 'Activate devices'
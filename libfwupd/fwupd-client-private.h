@@ -0,0 +1,18 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#pragma once
+
+#include "fwupd-client.h"
+
+G_BEGIN_DECLS
+
+void		 fwupd_client_process_signal		(FwupdClient	*client,
+							 const gchar	*sender_name,
+							 const gchar	*signal_name,
+							 GVariant	*parameters);
+
+G_END_DECLS
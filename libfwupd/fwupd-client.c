@@ -19,9 +19,11 @@
 #include <sys/types.h>
 
 #include "fwupd-client.h"
+#include "fwupd-client-private.h"
 #include "fwupd-common-private.h"
 #include "fwupd-deprecated.h"
 #include "fwupd-enums.h"
+#include "fwupd-enums-private.h"
 #include "fwupd-error.h"
 #include "fwupd-device-private.h"
 #include "fwupd-security-attr-private.h"
@@ -52,8 +54,16 @@ typedef struct {
 	GDBusProxy			*proxy;
 	SoupSession			*soup_session;
 	gchar				*user_agent;
+	GHashTable			*devices;	/* device-id:FwupdClientDevice */
+	GHashTable			*devices_refresh;	/* device-id */
 } FwupdClientPrivate;
 
+/* the last serialized device, so that deltas can be applied */
+typedef struct {
+	GVariant			*value;
+	guint64				 seq;
+} FwupdClientDevice;
+
 enum {
 	SIGNAL_CHANGED,
 	SIGNAL_STATUS_CHANGED,
@@ -242,12 +252,174 @@ fwupd_client_properties_changed_cb (GDBusProxy *proxy,
 }
 
 static void
-fwupd_client_signal_cb (GDBusProxy *proxy,
-			const gchar *sender_name,
-			const gchar *signal_name,
-			GVariant *parameters,
-			FwupdClient *client)
+fwupd_client_device_free (FwupdClientDevice *item)
+{
+	g_variant_unref (item->value);
+	g_free (item);
+}
+
+static void
+fwupd_client_device_cache_add (FwupdClient *client, GVariant *value, guint64 seq)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	FwupdClientDevice *item;
+	const gchar *device_id = NULL;
+
+	if (!g_variant_lookup (value, FWUPD_RESULT_KEY_DEVICE_ID, "&s", &device_id))
+		return;
+	item = g_new0 (FwupdClientDevice, 1);
+	item->value = g_variant_ref_sink (value);
+	item->seq = seq;
+	g_hash_table_insert (priv->devices, g_strdup (device_id), item);
+}
+
+/* drops the keys that are only sent to trusted clients */
+static GVariant *
+fwupd_client_device_filter_trusted (GVariant *removed)
+{
+	GVariantBuilder builder;
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("as"));
+	for (gsize i = 0; i < g_variant_n_children (removed); i++) {
+		const gchar *key = NULL;
+		g_variant_get_child (removed, i, "&s", &key);
+		if (g_strcmp0 (key, FWUPD_RESULT_KEY_SERIAL) == 0 ||
+		    g_strcmp0 (key, FWUPD_RESULT_KEY_INSTANCE_IDS) == 0)
+			continue;
+		g_variant_builder_add (&builder, "s", key);
+	}
+	return g_variant_ref_sink (g_variant_builder_end (&builder));
+}
+
+typedef struct {
+	FwupdClient			*client;
+	gchar				*device_id;
+} FwupdClientRefreshHelper;
+
+static void
+fwupd_client_device_refresh_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	FwupdClientRefreshHelper *helper = (FwupdClientRefreshHelper *) user_data;
+	FwupdClientPrivate *priv = GET_PRIVATE (helper->client);
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GVariant) untuple = NULL;
+	g_autoptr(GVariant) val = NULL;
+
+	g_hash_table_remove (priv->devices_refresh, helper->device_id);
+	val = g_dbus_proxy_call_finish (G_DBUS_PROXY (source), res, &error);
+	if (val == NULL) {
+		g_debug ("failed to refresh %s: %s", helper->device_id, error->message);
+		goto out;
+	}
+	untuple = g_variant_get_child_value (val, 0);
+	for (gsize i = 0; i < g_variant_n_children (untuple); i++) {
+		const gchar *device_id = NULL;
+		g_autoptr(FwupdDevice) dev = NULL;
+		g_autoptr(GVariant) value = g_variant_get_child_value (untuple, i);
+		if (!g_variant_lookup (value, FWUPD_RESULT_KEY_DEVICE_ID, "&s", &device_id))
+			continue;
+		if (g_strcmp0 (device_id, helper->device_id) != 0)
+			continue;
+		fwupd_client_device_cache_add (helper->client, value, 0);
+		dev = fwupd_device_from_variant (value);
+		if (dev == NULL)
+			break;
+		g_debug ("Emitting ::device-changed(%s) from refresh", device_id);
+		g_signal_emit (helper->client, signals[SIGNAL_DEVICE_CHANGED], 0, dev);
+		break;
+	}
+out:
+	g_object_unref (helper->client);
+	g_free (helper->device_id);
+	g_free (helper);
+}
+
+/* the cached device cannot be used, so get it again, with any details that
+ * are only sent to trusted clients */
+static void
+fwupd_client_device_refresh (FwupdClient *client, const gchar *device_id)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	FwupdClientRefreshHelper *helper;
+
+	g_hash_table_remove (priv->devices, device_id);
+	if (priv->proxy == NULL)
+		return;
+	if (!g_signal_has_handler_pending (client, signals[SIGNAL_DEVICE_CHANGED], 0, TRUE))
+		return;
+	if (g_hash_table_contains (priv->devices_refresh, device_id))
+		return;
+	g_hash_table_add (priv->devices_refresh, g_strdup (device_id));
+	helper = g_new0 (FwupdClientRefreshHelper, 1);
+	helper->client = g_object_ref (client);
+	helper->device_id = g_strdup (device_id);
+	g_dbus_proxy_call (priv->proxy,
+			   "GetDevices",
+			   NULL,
+			   G_DBUS_CALL_FLAGS_NONE,
+			   -1,
+			   NULL,
+			   fwupd_client_device_refresh_cb,
+			   helper);
+}
+
+static void
+fwupd_client_device_changed_delta (FwupdClient *client, GVariant *parameters)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	FwupdClientDevice *item;
+	const gchar *device_id = NULL;
+	guint64 seq = 0;
+	g_autoptr(FwupdDevice) dev = NULL;
+	g_autoptr(GVariant) changed = NULL;
+	g_autoptr(GVariant) removed = NULL;
+	g_autoptr(GVariant) value = NULL;
+
+	g_variant_get (parameters, "(&st@a{sv}@as)",
+		       &device_id, &seq, &changed, &removed);
+	item = g_hash_table_lookup (priv->devices, device_id);
+	if (item == NULL) {
+		g_debug ("delta for unknown device %s", device_id);
+		fwupd_client_device_refresh (client, device_id);
+		return;
+	}
+
+	/* a sequence of zero is from GetDevices or DeviceChanged */
+	if (item->seq != 0 && seq != item->seq + 1) {
+		g_debug ("missed delta for %s, expected %" G_GUINT64_FORMAT
+			 " got %" G_GUINT64_FORMAT,
+			 device_id, item->seq + 1, seq);
+		fwupd_client_device_refresh (client, device_id);
+		return;
+	}
+	value = g_variant_ref_sink (fwupd_device_variant_apply (item->value, changed, removed));
+	fwupd_client_device_cache_add (client, value, seq);
+	dev = fwupd_device_from_variant (value);
+	if (dev == NULL)
+		return;
+	g_debug ("Emitting ::device-changed(%s) from delta %" G_GUINT64_FORMAT,
+		 fwupd_device_get_id (dev), seq);
+	g_signal_emit (client, signals[SIGNAL_DEVICE_CHANGED], 0, dev);
+}
+
+/**
+ * fwupd_client_process_signal:
+ * @client: A #FwupdClient
+ * @sender_name: (nullable): the sender of the signal
+ * @signal_name: the D-Bus signal name, e.g. `DeviceChanged`
+ * @parameters: a #GVariant
+ *
+ * Updates the device cache and emits the GObject signal for a D-Bus signal
+ * from the daemon.
+ *
+ * Since: 1.5.0
+ **/
+void
+fwupd_client_process_signal (FwupdClient *client,
+			     const gchar *sender_name,
+			     const gchar *signal_name,
+			     GVariant *parameters)
 {
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
 	g_autoptr(FwupdDevice) dev = NULL;
 	if (g_strcmp0 (signal_name, "Changed") == 0) {
 		g_debug ("Emitting ::changed()");
@@ -256,6 +428,10 @@ fwupd_client_signal_cb (GDBusProxy *proxy,
 	}
 	if (g_strcmp0 (signal_name, "DeviceAdded") == 0) {
 		dev = fwupd_device_from_variant (parameters);
+		if (dev != NULL) {
+			g_autoptr(GVariant) value = g_variant_get_child_value (parameters, 0);
+			fwupd_client_device_cache_add (client, value, 0);
+		}
 		g_debug ("Emitting ::device-added(%s)",
 			 fwupd_device_get_id (dev));
 		g_signal_emit (client, signals[SIGNAL_DEVICE_ADDED], 0, dev);
@@ -263,13 +439,53 @@ fwupd_client_signal_cb (GDBusProxy *proxy,
 	}
 	if (g_strcmp0 (signal_name, "DeviceRemoved") == 0) {
 		dev = fwupd_device_from_variant (parameters);
+		if (dev != NULL)
+			g_hash_table_remove (priv->devices, fwupd_device_get_id (dev));
 		g_signal_emit (client, signals[SIGNAL_DEVICE_REMOVED], 0, dev);
 		g_debug ("Emitting ::device-removed(%s)",
 			 fwupd_device_get_id (dev));
 		return;
 	}
+	if (g_strcmp0 (signal_name, "DeviceChangedDelta") == 0) {
+		fwupd_client_device_changed_delta (client, parameters);
+		return;
+	}
 	if (g_strcmp0 (signal_name, "DeviceChanged") == 0) {
+		FwupdClientDevice *item;
+		g_autoptr(GVariant) value = g_variant_get_child_value (parameters, 0);
 		dev = fwupd_device_from_variant (parameters);
+		if (dev == NULL)
+			return;
+
+		/* the deltas applied since are newer than this */
+		item = g_hash_table_lookup (priv->devices, fwupd_device_get_id (dev));
+		if (item != NULL && item->seq != 0) {
+			g_debug ("ignoring DeviceChanged(%s) as deltas are current",
+				 fwupd_device_get_id (dev));
+			return;
+		}
+
+		/* the signal is sent to everyone, so keep any details that
+		 * were only given to this client by GetDevices */
+		if (item != NULL) {
+			g_autoptr(GVariant) changed = NULL;
+			g_autoptr(GVariant) removed = NULL;
+			g_autoptr(GVariant) removed_untrusted = NULL;
+			fwupd_device_variant_diff (item->value, value, &changed, &removed);
+			removed_untrusted = fwupd_client_device_filter_trusted (removed);
+			if (g_variant_n_children (changed) == 0 &&
+			    g_variant_n_children (removed_untrusted) == 0)
+				return;
+			g_clear_pointer (&value, g_variant_unref);
+			g_clear_object (&dev);
+			value = g_variant_ref_sink (fwupd_device_variant_apply (item->value,
+										changed,
+										removed_untrusted));
+			dev = fwupd_device_from_variant (value);
+			if (dev == NULL)
+				return;
+		}
+		fwupd_client_device_cache_add (client, value, 0);
 		g_signal_emit (client, signals[SIGNAL_DEVICE_CHANGED], 0, dev);
 		g_debug ("Emitting ::device-changed(%s)",
 			 fwupd_device_get_id (dev));
@@ -278,6 +494,16 @@ fwupd_client_signal_cb (GDBusProxy *proxy,
 	g_debug ("Unknown signal name '%s' from %s", signal_name, sender_name);
 }
 
+static void
+fwupd_client_signal_cb (GDBusProxy *proxy,
+			const gchar *sender_name,
+			const gchar *signal_name,
+			GVariant *parameters,
+			FwupdClient *client)
+{
+	fwupd_client_process_signal (client, sender_name, signal_name, parameters);
+}
+
 /**
  * fwupd_client_ensure_networking:
  * @client: A #FwupdClient
@@ -610,6 +836,15 @@ fwupd_client_get_devices (FwupdClient *client, GCancellable *cancellable, GError
 			fwupd_client_fixup_dbus_error (*error);
 		return NULL;
 	}
+
+	/* keep the serialized devices so that deltas can be applied */
+	if (g_variant_is_of_type (val, G_VARIANT_TYPE ("(aa{sv})"))) {
+		g_autoptr(GVariant) untuple = g_variant_get_child_value (val, 0);
+		for (gsize i = 0; i < g_variant_n_children (untuple); i++) {
+			g_autoptr(GVariant) value = g_variant_get_child_value (untuple, i);
+			fwupd_client_device_cache_add (client, value, 0);
+		}
+	}
 	return fwupd_device_array_from_variant (val);
 }
 
@@ -655,6 +890,98 @@ fwupd_client_get_history (FwupdClient *client, GCancellable *cancellable, GError
 	return fwupd_device_array_from_variant (val);
 }
 
+/**
+ * fwupd_client_get_history_filtered:
+ * @client: A #FwupdClient
+ * @device_id: (nullable): a device ID, or %NULL for any
+ * @plugin: (nullable): a plugin name, or %NULL for any
+ * @since: the earliest modification time in seconds since the epoch, or 0
+ * @until: the latest modification time in seconds since the epoch, or 0
+ * @update_state: a #FwupdUpdateState, or %FWUPD_UPDATE_STATE_UNKNOWN for any
+ * @limit: the maximum number of devices to return, or 0 for no limit
+ * @offset: the number of matching devices to skip
+ * @cancellable: the #GCancellable, or %NULL
+ * @error: the #GError, or %NULL
+ *
+ * Gets the history that matches all of the filters, with the filtering
+ * done by the daemon. The @limit and @offset count back from the most
+ * recently modified device, and the results are returned oldest first.
+ *
+ * Returns: (element-type FwupdDevice) (transfer container): results
+ *
+ * Since: 1.5.0
+ **/
+GPtrArray *
+fwupd_client_get_history_filtered (FwupdClient *client,
+				   const gchar *device_id,
+				   const gchar *plugin,
+				   guint64 since,
+				   guint64 until,
+				   FwupdUpdateState update_state,
+				   guint limit,
+				   guint offset,
+				   GCancellable *cancellable,
+				   GError **error)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	GVariantBuilder builder;
+	g_autoptr(GVariant) val = NULL;
+
+	g_return_val_if_fail (FWUPD_IS_CLIENT (client), NULL);
+	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	/* connect */
+	if (!fwupd_client_connect (client, cancellable, error))
+		return NULL;
+
+	/* only send the filters that are set */
+	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+	if (device_id != NULL) {
+		g_variant_builder_add (&builder, "{sv}",
+				       "device-id", g_variant_new_string (device_id));
+	}
+	if (plugin != NULL) {
+		g_variant_builder_add (&builder, "{sv}",
+				       "plugin", g_variant_new_string (plugin));
+	}
+	if (since > 0) {
+		g_variant_builder_add (&builder, "{sv}",
+				       "since", g_variant_new_uint64 (since));
+	}
+	if (until > 0) {
+		g_variant_builder_add (&builder, "{sv}",
+				       "until", g_variant_new_uint64 (until));
+	}
+	if (update_state != FWUPD_UPDATE_STATE_UNKNOWN) {
+		g_variant_builder_add (&builder, "{sv}",
+				       "update-state", g_variant_new_uint32 (update_state));
+	}
+	if (limit > 0) {
+		g_variant_builder_add (&builder, "{sv}",
+				       "limit", g_variant_new_uint32 (limit));
+	}
+	if (offset > 0) {
+		g_variant_builder_add (&builder, "{sv}",
+				       "offset", g_variant_new_uint32 (offset));
+	}
+
+	/* call into daemon */
+	val = g_dbus_proxy_call_sync (priv->proxy,
+				      "GetHistoryFiltered",
+				      g_variant_new ("(a{sv})", &builder),
+				      G_DBUS_CALL_FLAGS_NONE,
+				      -1,
+				      cancellable,
+				      error);
+	if (val == NULL) {
+		if (error != NULL)
+			fwupd_client_fixup_dbus_error (*error);
+		return NULL;
+	}
+	return fwupd_device_array_from_variant (val);
+}
+
 /**
  * fwupd_client_get_device_by_id:
  * @client: A #FwupdClient
@@ -888,6 +1215,113 @@ fwupd_client_get_upgrades (FwupdClient *client, const gchar *device_id,
 	return fwupd_release_array_from_variant (val);
 }
 
+static GHashTable *
+fwupd_client_upgrades_hash_from_variant (GVariant *value)
+{
+	GHashTable *hash;
+	gsize sz;
+	g_autoptr(GVariant) untuple = NULL;
+
+	hash = g_hash_table_new_full (g_str_hash, g_str_equal,
+				      g_free, (GDestroyNotify) g_ptr_array_unref);
+	untuple = g_variant_get_child_value (value, 0);
+	sz = g_variant_n_children (untuple);
+	for (guint i = 0; i < sz; i++) {
+		GPtrArray *releases;
+		gsize releases_sz;
+		const gchar *device_id = NULL;
+		g_autoptr(GVariant) data = NULL;
+		g_autoptr(GVariant) rels = NULL;
+
+		data = g_variant_get_child_value (untuple, i);
+		g_variant_get (data, "{&s@aa{sv}}", &device_id, &rels);
+		releases = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+		releases_sz = g_variant_n_children (rels);
+		for (guint j = 0; j < releases_sz; j++) {
+			FwupdRelease *rel;
+			g_autoptr(GVariant) rel_data = g_variant_get_child_value (rels, j);
+			rel = fwupd_release_from_variant (rel_data);
+			if (rel == NULL)
+				continue;
+			g_ptr_array_add (releases, rel);
+		}
+		g_hash_table_insert (hash, g_strdup (device_id), releases);
+	}
+	return hash;
+}
+
+static GHashTable *
+fwupd_client_reasons_hash_from_variant (GVariant *value)
+{
+	GHashTable *hash;
+	gsize sz;
+	g_autoptr(GVariant) untuple = NULL;
+
+	hash = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	untuple = g_variant_get_child_value (value, 1);
+	sz = g_variant_n_children (untuple);
+	for (guint i = 0; i < sz; i++) {
+		const gchar *device_id = NULL;
+		const gchar *reason = NULL;
+		g_autoptr(GVariant) data = g_variant_get_child_value (untuple, i);
+		g_variant_get (data, "{&s&s}", &device_id, &reason);
+		g_hash_table_insert (hash, g_strdup (device_id), g_strdup (reason));
+	}
+	return hash;
+}
+
+/**
+ * fwupd_client_get_upgrades_all:
+ * @client: A #FwupdClient
+ * @reasons: (out) (optional) (element-type utf8 utf8): device-id:message
+ * @cancellable: the #GCancellable, or %NULL
+ * @error: the #GError, or %NULL
+ *
+ * Gets all the upgrades for all the devices in one request, which is much
+ * faster than calling fwupd_client_get_upgrades() for each device.
+ *
+ * Devices without any upgrades are not included, and the reason why is
+ * added to @reasons instead.
+ *
+ * Returns: (element-type utf8 GPtrArray) (transfer container): device-id:releases
+ *
+ * Since: 1.5.0
+ **/
+GHashTable *
+fwupd_client_get_upgrades_all (FwupdClient *client,
+			       GHashTable **reasons,
+			       GCancellable *cancellable,
+			       GError **error)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	g_autoptr(GVariant) val = NULL;
+
+	g_return_val_if_fail (FWUPD_IS_CLIENT (client), NULL);
+	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	/* connect */
+	if (!fwupd_client_connect (client, cancellable, error))
+		return NULL;
+
+	/* call into daemon */
+	val = g_dbus_proxy_call_sync (priv->proxy,
+				      "GetUpgradesAll",
+				      NULL,
+				      G_DBUS_CALL_FLAGS_NONE,
+				      -1,
+				      cancellable,
+				      error);
+	if (val == NULL) {
+		if (error != NULL)
+			fwupd_client_fixup_dbus_error (*error);
+		return NULL;
+	}
+	if (reasons != NULL)
+		*reasons = fwupd_client_reasons_hash_from_variant (val);
+	return fwupd_client_upgrades_hash_from_variant (val);
+}
+
 static void
 fwupd_client_proxy_call_cb (GObject *source, GAsyncResult *res, gpointer user_data)
 {
@@ -2928,6 +3362,10 @@ fwupd_client_class_init (FwupdClientClass *klass)
 static void
 fwupd_client_init (FwupdClient *client)
 {
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	priv->devices = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+					       (GDestroyNotify) fwupd_client_device_free);
+	priv->devices_refresh = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 }
 
 static void
@@ -2938,6 +3376,8 @@ fwupd_client_finalize (GObject *object)
 
 	g_free (priv->user_agent);
 	g_free (priv->daemon_version);
+	g_hash_table_unref (priv->devices);
+	g_hash_table_unref (priv->devices_refresh);
 	g_free (priv->host_product);
 	g_free (priv->host_machine_id);
 	g_free (priv->host_security_id);
@@ -76,6 +76,16 @@ GPtrArray	*fwupd_client_get_devices		(FwupdClient	*client,
 GPtrArray	*fwupd_client_get_history		(FwupdClient	*client,
 							 GCancellable	*cancellable,
 							 GError		**error);
+GPtrArray	*fwupd_client_get_history_filtered	(FwupdClient	*client,
+							 const gchar	*device_id,
+							 const gchar	*plugin,
+							 guint64	 since,
+							 guint64	 until,
+							 FwupdUpdateState update_state,
+							 guint		 limit,
+							 guint		 offset,
+							 GCancellable	*cancellable,
+							 GError		**error);
 GPtrArray	*fwupd_client_get_releases		(FwupdClient	*client,
 							 const gchar	*device_id,
 							 GCancellable	*cancellable,
@@ -88,6 +98,10 @@ GPtrArray	*fwupd_client_get_upgrades		(FwupdClient	*client,
 							 const gchar	*device_id,
 							 GCancellable	*cancellable,
 							 GError		**error);
+GHashTable	*fwupd_client_get_upgrades_all		(FwupdClient	*client,
+							 GHashTable	**reasons,
+							 GCancellable	*cancellable,
+							 GError		**error);
 GPtrArray	*fwupd_client_get_details		(FwupdClient	*client,
 							 const gchar	*filename,
 							 GCancellable	*cancellable,
@@ -16,6 +16,15 @@ G_BEGIN_DECLS
 GVariant	*fwupd_device_to_variant		(FwupdDevice	*device);
 GVariant	*fwupd_device_to_variant_full		(FwupdDevice	*device,
 							 FwupdDeviceFlags flags);
+GVariant	*fwupd_device_to_variant_cached		(FwupdDevice	*device,
+							 FwupdDeviceFlags flags);
+gboolean	 fwupd_device_variant_diff		(GVariant	*value_old,
+							 GVariant	*value_new,
+							 GVariant	**changed,
+							 GVariant	**removed);
+GVariant	*fwupd_device_variant_apply		(GVariant	*value,
+							 GVariant	*changed,
+							 GVariant	*removed);
 void		 fwupd_device_incorporate		(FwupdDevice	*self,
 							 FwupdDevice	*donor);
 void		 fwupd_device_to_json			(FwupdDevice *device,
@@ -63,6 +63,10 @@ typedef struct {
 	FwupdStatus			 status;
 	GPtrArray			*releases;
 	FwupdDevice			*parent;
+	guint				 generation;
+	guint				 variant_generation;
+	GVariant			*variant;		/* untrusted */
+	GVariant			*variant_trusted;
 } FwupdDevicePrivate;
 
 enum {
@@ -77,6 +81,14 @@ enum {
 G_DEFINE_TYPE_WITH_PRIVATE (FwupdDevice, fwupd_device, G_TYPE_OBJECT)
 #define GET_PRIVATE(o) (fwupd_device_get_instance_private (o))
 
+/* any cached GVariant is rebuilt the next time it is requested */
+static void
+fwupd_device_invalidate (FwupdDevice *device)
+{
+	FwupdDevicePrivate *priv = GET_PRIVATE (device);
+	priv->generation++;
+}
+
 /**
  * fwupd_device_get_checksums:
  * @device: A #FwupdDevice
@@ -116,6 +128,7 @@ fwupd_device_add_checksum (FwupdDevice *device, const gchar *checksum)
 			return;
 	}
 	g_ptr_array_add (priv->checksums, g_strdup (checksum));
+	fwupd_device_invalidate (device);
 }
 
 /**
@@ -170,6 +183,7 @@ fwupd_device_set_summary (FwupdDevice *device, const gchar *summary)
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	g_free (priv->summary);
 	priv->summary = g_strdup (summary);
+	fwupd_device_invalidate (device);
 }
 
 /**
@@ -206,6 +220,7 @@ fwupd_device_set_serial (FwupdDevice *device, const gchar *serial)
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	g_free (priv->serial);
 	priv->serial = g_strdup (serial);
+	fwupd_device_invalidate (device);
 }
 
 /**
@@ -242,6 +257,7 @@ fwupd_device_set_id (FwupdDevice *device, const gchar *id)
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	g_free (priv->id);
 	priv->id = g_strdup (id);
+	fwupd_device_invalidate (device);
 }
 
 /**
@@ -278,6 +294,7 @@ fwupd_device_set_parent_id (FwupdDevice *device, const gchar *parent_id)
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	g_free (priv->parent_id);
 	priv->parent_id = g_strdup (parent_id);
+	fwupd_device_invalidate (device);
 }
 
 /**
@@ -378,6 +395,7 @@ fwupd_device_add_guid (FwupdDevice *device, const gchar *guid)
 	if (fwupd_device_has_guid (device, guid))
 		return;
 	g_ptr_array_add (priv->guids, g_strdup (guid));
+	fwupd_device_invalidate (device);
 }
 
 /**
@@ -461,6 +479,7 @@ fwupd_device_add_instance_id (FwupdDevice *device, const gchar *instance_id)
 	if (fwupd_device_has_instance_id (device, instance_id))
 		return;
 	g_ptr_array_add (priv->instance_ids, g_strdup (instance_id));
+	fwupd_device_invalidate (device);
 }
 
 /**
@@ -513,6 +532,7 @@ fwupd_device_add_icon (FwupdDevice *device, const gchar *icon)
 	if (fwupd_device_has_icon (device, icon))
 		return;
 	g_ptr_array_add (priv->icons, g_strdup (icon));
+	fwupd_device_invalidate (device);
 }
 
 /**
@@ -549,6 +569,7 @@ fwupd_device_set_name (FwupdDevice *device, const gchar *name)
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	g_free (priv->name);
 	priv->name = g_strdup (name);
+	fwupd_device_invalidate (device);
 }
 
 /**
@@ -585,6 +606,7 @@ fwupd_device_set_vendor (FwupdDevice *device, const gchar *vendor)
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	g_free (priv->vendor);
 	priv->vendor = g_strdup (vendor);
+	fwupd_device_invalidate (device);
 }
 
 /**
@@ -621,6 +643,7 @@ fwupd_device_set_vendor_id (FwupdDevice *device, const gchar *vendor_id)
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	g_free (priv->vendor_id);
 	priv->vendor_id = g_strdup (vendor_id);
+	fwupd_device_invalidate (device);
 }
 
 /**
@@ -657,6 +680,7 @@ fwupd_device_set_description (FwupdDevice *device, const gchar *description)
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	g_free (priv->description);
 	priv->description = g_strdup (description);
+	fwupd_device_invalidate (device);
 }
 
 /**
@@ -693,6 +717,7 @@ fwupd_device_set_version (FwupdDevice *device, const gchar *version)
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	g_free (priv->version);
 	priv->version = g_strdup (version);
+	fwupd_device_invalidate (device);
 }
 
 /**
@@ -729,6 +754,7 @@ fwupd_device_set_version_lowest (FwupdDevice *device, const gchar *version_lowes
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	g_free (priv->version_lowest);
 	priv->version_lowest = g_strdup (version_lowest);
+	fwupd_device_invalidate (device);
 }
 
 /**
@@ -764,6 +790,7 @@ fwupd_device_set_version_lowest_raw (FwupdDevice *device, guint64 version_lowest
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	priv->version_lowest_raw = version_lowest_raw;
+	fwupd_device_invalidate (device);
 }
 
 /**
@@ -800,6 +827,7 @@ fwupd_device_set_version_bootloader (FwupdDevice *device, const gchar *version_b
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	g_free (priv->version_bootloader);
 	priv->version_bootloader = g_strdup (version_bootloader);
+	fwupd_device_invalidate (device);
 }
 
 /**
@@ -835,6 +863,7 @@ fwupd_device_set_version_bootloader_raw (FwupdDevice *device, guint64 version_bo
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	priv->version_bootloader_raw = version_bootloader_raw;
+	fwupd_device_invalidate (device);
 }
 
 /**
@@ -870,6 +899,7 @@ fwupd_device_set_flashes_left (FwupdDevice *device, guint32 flashes_left)
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	priv->flashes_left = flashes_left;
+	fwupd_device_invalidate (device);
 }
 
 /**
@@ -905,6 +935,7 @@ fwupd_device_set_install_duration (FwupdDevice *device, guint32 duration)
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	priv->install_duration = duration;
+	fwupd_device_invalidate (device);
 }
 
 /**
@@ -941,6 +972,7 @@ fwupd_device_set_plugin (FwupdDevice *device, const gchar *plugin)
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	g_free (priv->plugin);
 	priv->plugin = g_strdup (plugin);
+	fwupd_device_invalidate (device);
 }
 
 /**
@@ -977,6 +1009,7 @@ fwupd_device_set_protocol (FwupdDevice *device, const gchar *protocol)
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	g_free (priv->protocol);
 	priv->protocol = g_strdup (protocol);
+	fwupd_device_invalidate (device);
 }
 
 /**
@@ -1014,6 +1047,7 @@ fwupd_device_set_flags (FwupdDevice *device, guint64 flags)
 	if (priv->flags == flags)
 		return;
 	priv->flags = flags;
+	fwupd_device_invalidate (device);
 	g_object_notify (G_OBJECT (device), "flags");
 }
 
@@ -1036,6 +1070,7 @@ fwupd_device_add_flag (FwupdDevice *device, FwupdDeviceFlags flag)
 	if ((priv->flags & flag) > 0)
 		return;
 	priv->flags |= flag;
+	fwupd_device_invalidate (device);
 	g_object_notify (G_OBJECT (device), "flags");
 }
 
@@ -1058,6 +1093,7 @@ fwupd_device_remove_flag (FwupdDevice *device, FwupdDeviceFlags flag)
 	if ((priv->flags & flag) == 0)
 		return;
 	priv->flags &= ~flag;
+	fwupd_device_invalidate (device);
 	g_object_notify (G_OBJECT (device), "flags");
 }
 
@@ -1114,6 +1150,7 @@ fwupd_device_set_created (FwupdDevice *device, guint64 created)
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	priv->created = created;
+	fwupd_device_invalidate (device);
 }
 
 /**
@@ -1149,6 +1186,7 @@ fwupd_device_set_modified (FwupdDevice *device, guint64 modified)
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	priv->modified = modified;
+	fwupd_device_invalidate (device);
 }
 
 /**
@@ -1448,6 +1486,143 @@ fwupd_device_to_variant_full (FwupdDevice *device, FwupdDeviceFlags flags)
 	return g_variant_new ("a{sv}", &builder);
 }
 
+/**
+ * fwupd_device_to_variant_cached:
+ * @device: A #FwupdDevice
+ * @flags: #FwupdDeviceFlags for the call
+ *
+ * Gets the same GVariant as fwupd_device_to_variant_full(), reusing the
+ * previous serialization if no property has been set since.
+ *
+ * NOTE: changes made to the #FwupdRelease objects added with
+ * fwupd_device_add_release() are not detected.
+ *
+ * Returns: (transfer full): the non-floating GVariant
+ *
+ * Since: 1.5.0
+ **/
+GVariant *
+fwupd_device_to_variant_cached (FwupdDevice *device, FwupdDeviceFlags flags)
+{
+	FwupdDevicePrivate *priv = GET_PRIVATE (device);
+	GVariant **variant;
+
+	g_return_val_if_fail (FWUPD_IS_DEVICE (device), NULL);
+
+	/* something has changed since the last call */
+	if (priv->variant_generation != priv->generation) {
+		g_clear_pointer (&priv->variant, g_variant_unref);
+		g_clear_pointer (&priv->variant_trusted, g_variant_unref);
+		priv->variant_generation = priv->generation;
+	}
+
+	/* only the trusted flag changes the output */
+	variant = (flags & FWUPD_DEVICE_FLAG_TRUSTED) > 0 ?
+		&priv->variant_trusted : &priv->variant;
+	if (*variant == NULL)
+		*variant = g_variant_ref_sink (fwupd_device_to_variant_full (device, flags));
+	return g_variant_ref (*variant);
+}
+
+/**
+ * fwupd_device_variant_diff:
+ * @value_old: (nullable): a #GVariant of type `a{sv}`
+ * @value_new: a #GVariant of type `a{sv}`
+ * @changed: (out) (optional): the keys that were added or changed, as `a{sv}`
+ * @removed: (out) (optional): the keys that were removed, as `as`
+ *
+ * Compares two serialized devices, for instance so that only the changes
+ * have to be sent to a client that already has @value_old.
+ *
+ * Returns: %TRUE if the devices are different
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fwupd_device_variant_diff (GVariant *value_old,
+			   GVariant *value_new,
+			   GVariant **changed,
+			   GVariant **removed)
+{
+	GVariantBuilder builder_changed;
+	GVariantBuilder builder_removed;
+	GVariantIter iter;
+	GVariant *value;
+	const gchar *key;
+	gboolean ret = FALSE;
+	g_autoptr(GVariantDict) dict_new = g_variant_dict_new (value_new);
+	g_autoptr(GVariantDict) dict_old = g_variant_dict_new (value_old);
+
+	g_return_val_if_fail (value_new != NULL, FALSE);
+
+	g_variant_builder_init (&builder_changed, G_VARIANT_TYPE_VARDICT);
+	g_variant_builder_init (&builder_removed, G_VARIANT_TYPE_STRING_ARRAY);
+	g_variant_iter_init (&iter, value_new);
+	while (g_variant_iter_next (&iter, "{&sv}", &key, &value)) {
+		g_autoptr(GVariant) value_tmp = g_variant_dict_lookup_value (dict_old, key, NULL);
+		if (value_tmp == NULL || !g_variant_equal (value_tmp, value)) {
+			g_variant_builder_add (&builder_changed, "{sv}", key, value);
+			ret = TRUE;
+		}
+		g_variant_unref (value);
+	}
+	if (value_old != NULL) {
+		g_variant_iter_init (&iter, value_old);
+		while (g_variant_iter_next (&iter, "{&sv}", &key, &value)) {
+			if (!g_variant_dict_contains (dict_new, key)) {
+				g_variant_builder_add (&builder_removed, "s", key);
+				ret = TRUE;
+			}
+			g_variant_unref (value);
+		}
+	}
+	if (changed != NULL)
+		*changed = g_variant_ref_sink (g_variant_builder_end (&builder_changed));
+	else
+		g_variant_builder_clear (&builder_changed);
+	if (removed != NULL)
+		*removed = g_variant_ref_sink (g_variant_builder_end (&builder_removed));
+	else
+		g_variant_builder_clear (&builder_removed);
+	return ret;
+}
+
+/**
+ * fwupd_device_variant_apply:
+ * @value: a #GVariant of type `a{sv}`
+ * @changed: the keys to add or replace, as `a{sv}`
+ * @removed: the keys to remove, as `as`
+ *
+ * Applies the changes returned from fwupd_device_variant_diff() to a
+ * serialized device.
+ *
+ * Returns: a new #GVariant of type `a{sv}`
+ *
+ * Since: 1.5.0
+ **/
+GVariant *
+fwupd_device_variant_apply (GVariant *value, GVariant *changed, GVariant *removed)
+{
+	GVariantIter iter;
+	GVariant *value_tmp;
+	const gchar *key;
+	g_autoptr(GVariantDict) dict = g_variant_dict_new (value);
+
+	g_return_val_if_fail (value != NULL, NULL);
+	g_return_val_if_fail (changed != NULL, NULL);
+	g_return_val_if_fail (removed != NULL, NULL);
+
+	g_variant_iter_init (&iter, removed);
+	while (g_variant_iter_next (&iter, "&s", &key))
+		g_variant_dict_remove (dict, key);
+	g_variant_iter_init (&iter, changed);
+	while (g_variant_iter_next (&iter, "{&sv}", &key, &value_tmp)) {
+		g_variant_dict_insert_value (dict, key, value_tmp);
+		g_variant_unref (value_tmp);
+	}
+	return g_variant_dict_end (dict);
+}
+
 /**
  * fwupd_device_to_variant:
  * @device: A #FwupdDevice
@@ -1706,6 +1881,7 @@ fwupd_device_set_update_state (FwupdDevice *device, FwupdUpdateState update_stat
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	priv->update_state = update_state;
+	fwupd_device_invalidate (device);
 }
 
 /**
@@ -1741,6 +1917,7 @@ fwupd_device_set_version_format (FwupdDevice *device, FwupdVersionFormat version
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	priv->version_format = version_format;
+	fwupd_device_invalidate (device);
 }
 
 /**
@@ -1776,6 +1953,7 @@ fwupd_device_set_version_raw (FwupdDevice *device, guint64 version_raw)
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	priv->version_raw = version_raw;
+	fwupd_device_invalidate (device);
 }
 
 /**
@@ -1812,6 +1990,7 @@ fwupd_device_set_update_message (FwupdDevice *device, const gchar *update_messag
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	g_free (priv->update_message);
 	priv->update_message = g_strdup (update_message);
+	fwupd_device_invalidate (device);
 }
 
 /**
@@ -1848,6 +2027,7 @@ fwupd_device_set_update_image (FwupdDevice *device, const gchar *update_image)
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	g_free (priv->update_image);
 	priv->update_image = g_strdup (update_image);
+	fwupd_device_invalidate (device);
 }
 
 /**
@@ -1884,6 +2064,7 @@ fwupd_device_set_update_error (FwupdDevice *device, const gchar *update_error)
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	g_free (priv->update_error);
 	priv->update_error = g_strdup (update_error);
+	fwupd_device_invalidate (device);
 }
 
 /**
@@ -1939,6 +2120,7 @@ fwupd_device_add_release (FwupdDevice *device, FwupdRelease *release)
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	g_ptr_array_add (priv->releases, g_object_ref (release));
+	fwupd_device_invalidate (device);
 }
 /**
  * fwupd_device_get_status:
@@ -1975,6 +2157,7 @@ fwupd_device_set_status (FwupdDevice *self, FwupdStatus status)
 	if (priv->status == status)
 		return;
 	priv->status = status;
+	fwupd_device_invalidate (self);
 	g_object_notify (G_OBJECT (self), "status");
 }
 
@@ -2360,6 +2543,10 @@ fwupd_device_finalize (GObject *object)
 	g_ptr_array_unref (priv->checksums);
 	g_ptr_array_unref (priv->children);
 	g_ptr_array_unref (priv->releases);
+	if (priv->variant != NULL)
+		g_variant_unref (priv->variant);
+	if (priv->variant_trusted != NULL)
+		g_variant_unref (priv->variant_trusted);
 
 	G_OBJECT_CLASS (fwupd_device_parent_class)->finalize (object);
 }
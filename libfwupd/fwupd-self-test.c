@@ -12,6 +12,7 @@
 #endif
 
 #include "fwupd-client.h"
+#include "fwupd-client-private.h"
 #include "fwupd-common.h"
 #include "fwupd-enums.h"
 #include "fwupd-error.h"
@@ -311,9 +312,14 @@ fwupd_device_func (void)
 	g_autofree gchar *data = NULL;
 	g_autofree gchar *str = NULL;
 	g_autoptr(FwupdDevice) dev = NULL;
+	g_autoptr(FwupdDevice) dev2 = NULL;
 	g_autoptr(FwupdRelease) rel = NULL;
 	g_autoptr(GError) error = NULL;
 	g_autoptr(GString) str_ascii = NULL;
+	g_autoptr(GVariant) variant1 = NULL;
+	g_autoptr(GVariant) variant2 = NULL;
+	g_autoptr(GVariant) variant3 = NULL;
+	g_autoptr(GVariant) variant4 = NULL;
 	g_autoptr(JsonBuilder) builder = NULL;
 	g_autoptr(JsonGenerator) json_generator = NULL;
 	g_autoptr(JsonNode) json_root = NULL;
@@ -427,6 +433,161 @@ fwupd_device_func (void)
 		"}", &error);
 	g_assert_no_error (error);
 	g_assert (ret);
+
+	/* serialized variant is reused until something changes */
+	variant1 = fwupd_device_to_variant_cached (dev, FWUPD_DEVICE_FLAG_NONE);
+	variant2 = fwupd_device_to_variant_cached (dev, FWUPD_DEVICE_FLAG_NONE);
+	g_assert (variant1 == variant2);
+	g_assert_false (g_variant_is_floating (variant1));
+	variant3 = fwupd_device_to_variant_cached (dev, FWUPD_DEVICE_FLAG_TRUSTED);
+	g_assert (variant1 != variant3);
+	fwupd_device_set_name (dev, "ColorHug3");
+	variant4 = fwupd_device_to_variant_cached (dev, FWUPD_DEVICE_FLAG_NONE);
+	g_assert (variant1 != variant4);
+	dev2 = fwupd_device_from_variant (variant4);
+	g_assert_cmpstr (fwupd_device_get_name (dev2), ==, "ColorHug3");
+}
+
+static void
+fwupd_device_delta_func (void)
+{
+	g_autoptr(FwupdDevice) dev = fwupd_device_new ();
+	g_autoptr(FwupdDevice) dev2 = NULL;
+	g_autoptr(GVariant) changed = NULL;
+	g_autoptr(GVariant) removed = NULL;
+	g_autoptr(GVariant) value1 = NULL;
+	g_autoptr(GVariant) value2 = NULL;
+	g_autoptr(GVariant) value3 = NULL;
+
+	fwupd_device_set_id (dev, "USB:foo");
+	fwupd_device_set_name (dev, "ColorHug2");
+	fwupd_device_set_update_error (dev, "failed");
+	value1 = fwupd_device_to_variant_cached (dev, FWUPD_DEVICE_FLAG_NONE);
+	g_assert_false (fwupd_device_variant_diff (value1, value1, NULL, NULL));
+
+	/* only the changes are included */
+	fwupd_device_set_status (dev, FWUPD_STATUS_DEVICE_WRITE);
+	fwupd_device_set_update_error (dev, NULL);
+	value2 = fwupd_device_to_variant_cached (dev, FWUPD_DEVICE_FLAG_NONE);
+	g_assert_true (fwupd_device_variant_diff (value1, value2, &changed, &removed));
+	g_assert_cmpint (g_variant_n_children (changed), ==, 1);
+	g_assert_cmpint (g_variant_n_children (removed), ==, 1);
+
+	/* and can be applied to the old device */
+	value3 = g_variant_ref_sink (fwupd_device_variant_apply (value1, changed, removed));
+	g_assert_false (fwupd_device_variant_diff (value2, value3, NULL, NULL));
+	dev2 = fwupd_device_from_variant (value3);
+	g_assert_cmpstr (fwupd_device_get_name (dev2), ==, "ColorHug2");
+	g_assert_cmpstr (fwupd_device_get_update_error (dev2), ==, NULL);
+	g_assert_cmpint (fwupd_device_get_status (dev2), ==, FWUPD_STATUS_DEVICE_WRITE);
+}
+
+static void
+fwupd_client_delta_changed_cb (FwupdClient *client, FwupdDevice *device, gpointer user_data)
+{
+	guint *cnt = (guint *) user_data;
+	(*cnt)++;
+}
+
+static void
+fwupd_client_delta_serial_cb (FwupdClient *client, FwupdDevice *device, gpointer user_data)
+{
+	gchar **serial = (gchar **) user_data;
+	g_free (*serial);
+	*serial = g_strdup (fwupd_device_get_serial (device));
+}
+
+static GVariant *
+fwupd_client_delta_build (FwupdDevice *dev_old, FwupdDevice *dev_new, guint64 seq)
+{
+	g_autoptr(GVariant) changed = NULL;
+	g_autoptr(GVariant) removed = NULL;
+	g_autoptr(GVariant) value_old = fwupd_device_to_variant_cached (dev_old, FWUPD_DEVICE_FLAG_NONE);
+	g_autoptr(GVariant) value_new = fwupd_device_to_variant_cached (dev_new, FWUPD_DEVICE_FLAG_NONE);
+	fwupd_device_variant_diff (value_old, value_new, &changed, &removed);
+	return g_variant_ref_sink (g_variant_new ("(st@a{sv}@as)",
+						  fwupd_device_get_id (dev_new),
+						  seq, changed, removed));
+}
+
+static GVariant *
+fwupd_client_delta_build_full (FwupdDevice *dev)
+{
+	g_autoptr(GVariant) value = fwupd_device_to_variant_cached (dev, FWUPD_DEVICE_FLAG_NONE);
+	return g_variant_ref_sink (g_variant_new_tuple (&value, 1));
+}
+
+static void
+fwupd_client_delta_func (void)
+{
+	GVariant *value_trusted;
+	guint cnt = 0;
+	g_autofree gchar *serial = NULL;
+	g_autoptr(FwupdClient) client = fwupd_client_new ();
+	g_autoptr(FwupdDevice) dev1 = fwupd_device_new ();
+	g_autoptr(FwupdDevice) dev2 = fwupd_device_new ();
+	g_autoptr(FwupdDevice) dev3 = fwupd_device_new ();
+	g_autoptr(GVariant) delta1 = NULL;
+	g_autoptr(GVariant) delta2 = NULL;
+	g_autoptr(GVariant) delta4 = NULL;
+	g_autoptr(GVariant) full1 = NULL;
+	g_autoptr(GVariant) full2 = NULL;
+	g_autoptr(GVariant) full3 = NULL;
+	g_autoptr(GVariant) trusted1 = NULL;
+
+	fwupd_device_set_id (dev1, "USB:foo");
+	fwupd_device_set_name (dev1, "ColorHug2");
+	fwupd_device_set_id (dev2, "USB:foo");
+	fwupd_device_set_name (dev2, "ColorHug2");
+	fwupd_device_set_status (dev2, FWUPD_STATUS_DEVICE_WRITE);
+	fwupd_device_set_id (dev3, "USB:foo");
+	fwupd_device_set_name (dev3, "ColorHug3");
+	fwupd_device_set_status (dev3, FWUPD_STATUS_DEVICE_WRITE);
+	delta1 = fwupd_client_delta_build (dev1, dev2, 1);
+	delta2 = fwupd_client_delta_build (dev2, dev3, 2);
+	delta4 = fwupd_client_delta_build (dev2, dev3, 4);
+	full1 = fwupd_client_delta_build_full (dev1);
+	full2 = fwupd_client_delta_build_full (dev2);
+	full3 = fwupd_client_delta_build_full (dev3);
+	g_signal_connect (client, "device-changed",
+			  G_CALLBACK (fwupd_client_delta_changed_cb), &cnt);
+	g_signal_connect (client, "device-changed",
+			  G_CALLBACK (fwupd_client_delta_serial_cb), &serial);
+
+	/* a delta for a device the client has never seen is ignored, and the
+	 * DeviceChanged that follows it adds the device */
+	fwupd_client_process_signal (client, NULL, "DeviceChangedDelta", delta1);
+	g_assert_cmpint (cnt, ==, 0);
+	fwupd_client_process_signal (client, NULL, "DeviceChanged", full2);
+	g_assert_cmpint (cnt, ==, 1);
+
+	/* the next delta is applied, and a DeviceChanged after it ignored */
+	fwupd_client_process_signal (client, NULL, "DeviceChangedDelta", delta2);
+	g_assert_cmpint (cnt, ==, 2);
+	fwupd_client_process_signal (client, NULL, "DeviceChanged", full3);
+	g_assert_cmpint (cnt, ==, 2);
+
+	/* a missed delta drops the device until the next DeviceChanged */
+	fwupd_client_process_signal (client, NULL, "DeviceRemoved", full3);
+	fwupd_client_process_signal (client, NULL, "DeviceAdded", full1);
+	fwupd_client_process_signal (client, NULL, "DeviceChangedDelta", delta1);
+	g_assert_cmpint (cnt, ==, 3);
+	fwupd_client_process_signal (client, NULL, "DeviceChangedDelta", delta4);
+	g_assert_cmpint (cnt, ==, 3);
+	fwupd_client_process_signal (client, NULL, "DeviceChanged", full3);
+	g_assert_cmpint (cnt, ==, 4);
+
+	/* the details only sent to trusted clients are kept */
+	fwupd_device_set_serial (dev1, "12345678");
+	value_trusted = fwupd_device_to_variant_full (dev1, FWUPD_DEVICE_FLAG_TRUSTED);
+	trusted1 = g_variant_ref_sink (g_variant_new_tuple (&value_trusted, 1));
+	fwupd_client_process_signal (client, NULL, "DeviceRemoved", full3);
+	fwupd_client_process_signal (client, NULL, "DeviceAdded", trusted1);
+	fwupd_client_process_signal (client, NULL, "DeviceChanged", full2);
+	g_assert_cmpint (cnt, ==, 5);
+	g_assert_cmpstr (serial, ==, "12345678");
+	fwupd_client_process_signal (client, NULL, "DeviceChanged", full2);
+	g_assert_cmpint (cnt, ==, 5);
 }
 
 static void
@@ -665,6 +826,8 @@ main (int argc, char **argv)
 	g_test_add_func ("/fwupd/common{guid}", fwupd_common_guid_func);
 	g_test_add_func ("/fwupd/release", fwupd_release_func);
 	g_test_add_func ("/fwupd/device", fwupd_device_func);
+	g_test_add_func ("/fwupd/device{delta}", fwupd_device_delta_func);
+	g_test_add_func ("/fwupd/client{delta}", fwupd_client_delta_func);
 	g_test_add_func ("/fwupd/remote{download}", fwupd_remote_download_func);
 	g_test_add_func ("/fwupd/remote{base-uri}", fwupd_remote_baseuri_func);
 	g_test_add_func ("/fwupd/remote{no-path}", fwupd_remote_nopath_func);
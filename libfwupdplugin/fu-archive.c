@@ -20,19 +20,62 @@
  * @short_description: an in-memory archive decompressor
  */
 
+/* workaround the struct types of libarchive */
+typedef struct archive _archive_read_ctx;
+
+static void
+_archive_read_ctx_free (_archive_read_ctx *arch)
+{
+	archive_read_close (arch);
+	archive_read_free (arch);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(_archive_read_ctx, _archive_read_ctx_free)
+
+typedef struct {
+	guint			 idx;		/* position in the archive */
+	gint64			 size;
+	gssize			 offset;	/* into blob if stored, or -1 */
+	GBytes			*bytes;		/* or %NULL if not decompressed */
+} FuArchiveEntry;
+
 struct _FuArchive {
 	GObject			 parent_instance;
-	GHashTable		*entries;
+	GBytes			*blob;
+	FuArchiveFlags		 flags;
+	GHashTable		*entries;	/* fn : FuArchiveEntry */
+	GPtrArray		*entries_idx;	/* of FuArchiveEntry, or %NULL */
+	GQueue			*cache;		/* of FuArchiveEntry, MRU first */
+	guint64			 cache_size;
+	guint64			 cache_size_max;
+	_archive_read_ctx	*arch;		/* for lazy loading, or %NULL */
+	guint			 arch_idx;	/* of the next header in arch */
 };
 
 G_DEFINE_TYPE (FuArchive, fu_archive, G_TYPE_OBJECT)
 
+static void
+fu_archive_entry_free (FuArchiveEntry *entry)
+{
+	if (entry == NULL)
+		return;
+	if (entry->bytes != NULL)
+		g_bytes_unref (entry->bytes);
+	g_free (entry);
+}
+
 static void
 fu_archive_finalize (GObject *obj)
 {
 	FuArchive *self = FU_ARCHIVE (obj);
 
+	if (self->blob != NULL)
+		g_bytes_unref (self->blob);
+	if (self->arch != NULL)
+		_archive_read_ctx_free (self->arch);
+	g_queue_free (self->cache);
 	g_hash_table_unref (self->entries);
+	g_ptr_array_unref (self->entries_idx);
 	G_OBJECT_CLASS (fu_archive_parent_class)->finalize (obj);
 }
 
@@ -46,8 +89,214 @@ fu_archive_class_init (FuArchiveClass *klass)
 static void
 fu_archive_init (FuArchive *self)
 {
+	self->cache = g_queue_new ();
+	self->cache_size_max = 16 * 1024 * 1024;
 	self->entries = g_hash_table_new_full (g_str_hash, g_str_equal,
-					       g_free, (GDestroyNotify) g_bytes_unref);
+					       g_free, NULL);
+	self->entries_idx = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_archive_entry_free);
+}
+
+/**
+ * fu_archive_set_cache_size_max:
+ * @self: A #FuArchive
+ * @cache_size_max: size in bytes
+ *
+ * Sets the number of bytes of decompressed data to keep when the archive was
+ * created with %FU_ARCHIVE_FLAG_LAZY. The blob returned by the most recent
+ * lookup is always kept, even if it is larger than @cache_size_max.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_archive_set_cache_size_max (FuArchive *self, guint64 cache_size_max)
+{
+	g_return_if_fail (FU_IS_ARCHIVE (self));
+	self->cache_size_max = cache_size_max;
+}
+
+static _archive_read_ctx *
+fu_archive_open (FuArchive *self, GError **error)
+{
+	int r;
+	g_autoptr(_archive_read_ctx) arch = NULL;
+
+	/* decompress anything matching either glob */
+	arch = archive_read_new ();
+	if (arch == NULL) {
+		g_set_error_literal (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_NOT_SUPPORTED,
+				     "libarchive startup failed");
+		return NULL;
+	}
+	archive_read_support_format_all (arch);
+	archive_read_support_filter_all (arch);
+	r = archive_read_open_memory (arch,
+				      (void *) g_bytes_get_data (self->blob, NULL),
+				      (size_t) g_bytes_get_size (self->blob));
+	if (r != 0) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_NOT_SUPPORTED,
+			     "cannot open: %s",
+			     archive_error_string (arch));
+		return NULL;
+	}
+	return g_steal_pointer (&arch);
+}
+
+static gboolean
+fu_archive_read_header (_archive_read_ctx *arch,
+			struct archive_entry **entry,
+			GError **error)
+{
+	int r = archive_read_next_header (arch, entry);
+	if (r == ARCHIVE_EOF) {
+		*entry = NULL;
+		return TRUE;
+	}
+	if (r != ARCHIVE_OK) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_FAILED,
+			     "cannot read header: %s",
+			     archive_error_string (arch));
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static GBytes *
+fu_archive_read_data (_archive_read_ctx *arch, gint64 bufsz, GError **error)
+{
+	gssize rc;
+	g_autofree guint8 *buf = g_malloc (bufsz);
+
+	rc = archive_read_data (arch, buf, (gsize) bufsz);
+	if (rc < 0) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_FAILED,
+			     "cannot read data: %s",
+			     archive_error_string (arch));
+		return NULL;
+	}
+	if (rc != bufsz) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_FAILED,
+			     "read %" G_GSSIZE_FORMAT " of %" G_GINT64_FORMAT,
+			     rc, bufsz);
+		return NULL;
+	}
+	return g_bytes_new_take (g_steal_pointer (&buf), bufsz);
+}
+
+/* tar files with no compression filter store each entry contiguously */
+static gboolean
+fu_archive_is_stored (_archive_read_ctx *arch)
+{
+	if (archive_filter_count (arch) != 1)
+		return FALSE;
+	if (archive_filter_code (arch, 0) != ARCHIVE_FILTER_NONE)
+		return FALSE;
+	return (archive_format (arch) & ARCHIVE_FORMAT_BASE_MASK) == ARCHIVE_FORMAT_TAR;
+}
+
+/* returns the offset of the entry data in the blob, or -1 if not stored */
+static gssize
+fu_archive_get_stored_offset (FuArchive *self, _archive_read_ctx *arch, gint64 bufsz)
+{
+	const guint8 *data = g_bytes_get_data (self->blob, NULL);
+	const void *buf = NULL;
+	size_t bufsz_block = 0;
+	int64_t offset = 0;
+
+	if (bufsz == 0 || !fu_archive_is_stored (arch))
+		return -1;
+	if (archive_read_data_block (arch, &buf, &bufsz_block, &offset) != ARCHIVE_OK)
+		return -1;
+	if (offset != 0 || (gint64) bufsz_block != bufsz)
+		return -1;
+
+	/* libarchive returned a pointer into the memory we gave it */
+	if ((const guint8 *) buf < data ||
+	    (const guint8 *) buf + bufsz > data + g_bytes_get_size (self->blob))
+		return -1;
+	return (const guint8 *) buf - data;
+}
+
+/* only the entry most recently added to the hash table is visible */
+static gboolean
+fu_archive_entry_is_visible (FuArchive *self, const gchar *fn, FuArchiveEntry *entry)
+{
+	return g_hash_table_lookup (self->entries, fn) == entry;
+}
+
+static gchar *
+fu_archive_get_key (FuArchive *self, const gchar *fn)
+{
+	if (self->flags & FU_ARCHIVE_FLAG_IGNORE_PATH)
+		return g_path_get_basename (fn);
+	return g_strdup (fn);
+}
+
+/* decompresses an entry found in the first pass, evicting older entries */
+static gboolean
+fu_archive_entry_load (FuArchive *self, FuArchiveEntry *entry, GError **error)
+{
+	struct archive_entry *arch_entry = NULL;
+	g_autoptr(_archive_read_ctx) arch = NULL;
+
+	/* zero copy */
+	if (entry->offset >= 0) {
+		entry->bytes = g_bytes_new_from_bytes (self->blob,
+						       entry->offset,
+						       entry->size);
+		return TRUE;
+	}
+
+	/* the archive can only be read forwards, so only restart if required */
+	if (self->arch != NULL && self->arch_idx <= entry->idx) {
+		arch = g_steal_pointer (&self->arch);
+	} else {
+		g_clear_pointer (&self->arch, _archive_read_ctx_free);
+		arch = fu_archive_open (self, error);
+		if (arch == NULL)
+			return FALSE;
+		self->arch_idx = 0;
+	}
+
+	/* skip to the entry */
+	for (; self->arch_idx <= entry->idx; self->arch_idx++) {
+		if (!fu_archive_read_header (arch, &arch_entry, error))
+			return FALSE;
+		if (arch_entry == NULL) {
+			g_set_error (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_FAILED,
+				     "archive truncated at entry %u",
+				     self->arch_idx);
+			return FALSE;
+		}
+	}
+	entry->bytes = fu_archive_read_data (arch, entry->size, error);
+	if (entry->bytes == NULL)
+		return FALSE;
+
+	/* keep the position for the next entry */
+	self->arch = g_steal_pointer (&arch);
+
+	/* add to the cache and drop the least recently used */
+	g_queue_push_head (self->cache, entry);
+	self->cache_size += entry->size;
+	while (self->cache_size > self->cache_size_max &&
+	       g_queue_peek_tail (self->cache) != entry) {
+		FuArchiveEntry *entry_old = g_queue_pop_tail (self->cache);
+		self->cache_size -= entry_old->size;
+		g_clear_pointer (&entry_old->bytes, g_bytes_unref);
+	}
+	return TRUE;
 }
 
 /**
@@ -56,7 +305,11 @@ fu_archive_init (FuArchive *self)
  * @fn: A filename
  * @error: A #GError, or %NULL
  *
- * Finds the blob referenced by filename
+ * Finds the blob referenced by filename.
+ *
+ * If the archive was created with %FU_ARCHIVE_FLAG_LAZY then the file is
+ * decompressed on demand and the returned blob is only guaranteed to be valid
+ * until the next call to this function; use g_bytes_ref() to keep it.
  *
  * Returns: (transfer none): a #GBytes, or %NULL if the filename was not found
  *
@@ -65,20 +318,77 @@ fu_archive_init (FuArchive *self)
 GBytes *
 fu_archive_lookup_by_fn (FuArchive *self, const gchar *fn, GError **error)
 {
-	GBytes *fw;
+	FuArchiveEntry *entry;
 
 	g_return_val_if_fail (FU_IS_ARCHIVE (self), NULL);
 	g_return_val_if_fail (fn != NULL, NULL);
 	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
-	fw = g_hash_table_lookup (self->entries, fn);
-	if (fw == NULL) {
+	entry = g_hash_table_lookup (self->entries, fn);
+	if (entry == NULL) {
 		g_set_error (error,
 			     G_IO_ERROR,
 			     G_IO_ERROR_NOT_FOUND,
 			     "no blob for %s", fn);
+		return NULL;
+	}
+
+	/* move to the front of the cache */
+	if (entry->bytes != NULL) {
+		GList *link = g_queue_find (self->cache, entry);
+		if (link != NULL) {
+			g_queue_unlink (self->cache, link);
+			g_queue_push_head_link (self->cache, link);
+		}
+		return entry->bytes;
+	}
+	if (!fu_archive_entry_load (self, entry, error))
+		return NULL;
+	return entry->bytes;
+}
+
+/* one pass through the archive, holding only one uncached entry at a time */
+static gboolean
+fu_archive_iterate_lazy (FuArchive *self,
+			 FuArchiveIterateFunc callback,
+			 gpointer user_data,
+			 GError **error)
+{
+	g_autoptr(_archive_read_ctx) arch = NULL;
+
+	arch = fu_archive_open (self, error);
+	if (arch == NULL)
+		return FALSE;
+	for (guint i = 0; i < self->entries_idx->len; i++) {
+		FuArchiveEntry *entry = g_ptr_array_index (self->entries_idx, i);
+		struct archive_entry *arch_entry = NULL;
+		g_autofree gchar *fn_key = NULL;
+		g_autoptr(GBytes) bytes = NULL;
+
+		if (!fu_archive_read_header (arch, &arch_entry, error))
+			return FALSE;
+		if (arch_entry == NULL)
+			break;
+		if (entry == NULL)
+			continue;
+		fn_key = fu_archive_get_key (self, archive_entry_pathname (arch_entry));
+		if (!fu_archive_entry_is_visible (self, fn_key, entry))
+			continue;
+		if (entry->bytes != NULL) {
+			bytes = g_bytes_ref (entry->bytes);
+		} else if (entry->offset >= 0) {
+			bytes = g_bytes_new_from_bytes (self->blob,
+							entry->offset,
+							entry->size);
+		} else {
+			bytes = fu_archive_read_data (arch, entry->size, error);
+			if (bytes == NULL)
+				return FALSE;
+		}
+		if (!callback (self, fn_key, bytes, user_data, error))
+			return FALSE;
 	}
-	return fw;
+	return TRUE;
 }
 
 /**
@@ -107,79 +417,47 @@ fu_archive_iterate (FuArchive *self,
 	g_return_val_if_fail (FU_IS_ARCHIVE (self), FALSE);
 	g_return_val_if_fail (callback != NULL, FALSE);
 
+	if (self->flags & FU_ARCHIVE_FLAG_LAZY)
+		return fu_archive_iterate_lazy (self, callback, user_data, error);
+
 	g_hash_table_iter_init (&iter, self->entries);
 	while (g_hash_table_iter_next (&iter, &key, &value)) {
-		if (!callback (self, (const gchar *)key, (GBytes *)value, user_data, error))
+		FuArchiveEntry *entry = (FuArchiveEntry *) value;
+		if (!callback (self, (const gchar *)key, entry->bytes, user_data, error))
 			return FALSE;
 	}
 	return TRUE;
 }
 
-/* workaround the struct types of libarchive */
-typedef struct archive _archive_read_ctx;
-
-static void
-_archive_read_ctx_free (_archive_read_ctx *arch)
-{
-	archive_read_close (arch);
-	archive_read_free (arch);
-}
-
-G_DEFINE_AUTOPTR_CLEANUP_FUNC(_archive_read_ctx, _archive_read_ctx_free)
-
 static gboolean
 fu_archive_load (FuArchive *self, GBytes *blob, FuArchiveFlags flags, GError **error)
 {
-	int r;
 	g_autoptr(_archive_read_ctx) arch = NULL;
 
-	/* decompress anything matching either glob */
-	arch = archive_read_new ();
-	if (arch == NULL) {
-		g_set_error_literal (error,
-				     G_IO_ERROR,
-				     G_IO_ERROR_NOT_SUPPORTED,
-				     "libarchive startup failed");
-		return FALSE;
-	}
-	archive_read_support_format_all (arch);
-	archive_read_support_filter_all (arch);
-	r = archive_read_open_memory (arch,
-				      (void *) g_bytes_get_data (blob, NULL),
-				      (size_t) g_bytes_get_size (blob));
-	if (r != 0) {
-		g_set_error (error,
-			     G_IO_ERROR,
-			     G_IO_ERROR_NOT_SUPPORTED,
-			     "cannot open: %s",
-			     archive_error_string (arch));
+	self->blob = g_bytes_ref (blob);
+	self->flags = flags;
+	arch = fu_archive_open (self, error);
+	if (arch == NULL)
 		return FALSE;
-	}
-	while (TRUE) {
+	for (guint idx = 0; ; idx++) {
 		const gchar *fn;
 		gint64 bufsz;
-		gssize rc;
-		struct archive_entry *entry;
+		struct archive_entry *arch_entry = NULL;
 		g_autofree gchar *fn_key = NULL;
-		g_autofree guint8 *buf = NULL;
+		FuArchiveEntry *entry;
 
-		r = archive_read_next_header (arch, &entry);
-		if (r == ARCHIVE_EOF)
-			break;
-		if (r != ARCHIVE_OK) {
-			g_set_error (error,
-				     G_IO_ERROR,
-				     G_IO_ERROR_FAILED,
-				     "cannot read header: %s",
-				     archive_error_string (arch));
+		if (!fu_archive_read_header (arch, &arch_entry, error))
 			return FALSE;
-		}
+		if (arch_entry == NULL)
+			break;
 
 		/* only extract if valid */
-		fn = archive_entry_pathname (entry);
-		if (fn == NULL)
+		fn = archive_entry_pathname (arch_entry);
+		if (fn == NULL) {
+			g_ptr_array_add (self->entries_idx, NULL);
 			continue;
-		bufsz = archive_entry_size (entry);
+		}
+		bufsz = archive_entry_size (arch_entry);
 		if (bufsz > 1024 * 1024 * 1024) {
 			g_set_error_literal (error,
 					     G_IO_ERROR,
@@ -187,33 +465,23 @@ fu_archive_load (FuArchive *self, GBytes *blob, FuArchiveFlags flags, GError **e
 					     "cannot read huge files");
 			return FALSE;
 		}
-		buf = g_malloc (bufsz);
-		rc = archive_read_data (arch, buf, (gsize) bufsz);
-		if (rc < 0) {
-			g_set_error (error,
-				     G_IO_ERROR,
-				     G_IO_ERROR_FAILED,
-				     "cannot read data: %s",
-				     archive_error_string (arch));
-			return FALSE;
-		}
-		if (rc != bufsz) {
-			g_set_error (error,
-				     G_IO_ERROR,
-				     G_IO_ERROR_FAILED,
-				     "read %" G_GSSIZE_FORMAT " of %" G_GINT64_FORMAT,
-				     rc, bufsz);
-			return FALSE;
-		}
-		if (flags & FU_ARCHIVE_FLAG_IGNORE_PATH) {
-			fn_key = g_path_get_basename (fn);
+		entry = g_new0 (FuArchiveEntry, 1);
+		entry->idx = idx;
+		entry->size = bufsz;
+		entry->offset = -1;
+		g_ptr_array_add (self->entries_idx, entry);
+
+		/* just index the name, size and location */
+		if (flags & FU_ARCHIVE_FLAG_LAZY) {
+			entry->offset = fu_archive_get_stored_offset (self, arch, bufsz);
 		} else {
-			fn_key = g_strdup (fn);
+			entry->bytes = fu_archive_read_data (arch, bufsz, error);
+			if (entry->bytes == NULL)
+				return FALSE;
 		}
+		fn_key = fu_archive_get_key (self, fn);
 		g_debug ("adding %s [%" G_GINT64_FORMAT "]", fn_key, bufsz);
-		g_hash_table_insert (self->entries,
-				     g_steal_pointer (&fn_key),
-				     g_bytes_new_take (g_steal_pointer (&buf), bufsz));
+		g_hash_table_insert (self->entries, g_steal_pointer (&fn_key), entry);
 	}
 
 	/* success */
@@ -228,6 +496,9 @@ fu_archive_load (FuArchive *self, GBytes *blob, FuArchiveFlags flags, GError **e
  *
  * Parses @data as an archive and decompresses all files to memory blobs.
  *
+ * If %FU_ARCHIVE_FLAG_LAZY is set then only the names, sizes and locations
+ * of the files are read, and each file is decompressed when required.
+ *
  * Returns: a #FuArchive, or %NULL if the archive was invalid in any way.
  *
  * Since: 1.2.2
@@ -16,12 +16,14 @@ G_DECLARE_FINAL_TYPE (FuArchive, fu_archive, FU, ARCHIVE, GObject)
  * FuArchiveFlags:
  * @FU_ARCHIVE_FLAG_NONE:		No flags set
  * @FU_ARCHIVE_FLAG_IGNORE_PATH:	Ignore any path component
+ * @FU_ARCHIVE_FLAG_LAZY:		Only decompress files when required
  *
  * The flags to use when loading the archive.
  **/
 typedef enum {
 	FU_ARCHIVE_FLAG_NONE		= 0,
 	FU_ARCHIVE_FLAG_IGNORE_PATH	= 1 << 0,
+	FU_ARCHIVE_FLAG_LAZY		= 1 << 1,	/* Since: 1.5.0 */
 	/*< private >*/
 	FU_ARCHIVE_FLAG_LAST
 } FuArchiveFlags;
@@ -44,6 +46,8 @@ typedef gboolean (*FuArchiveIterateFunc)	(FuArchive		*self,
 FuArchive	*fu_archive_new			(GBytes		*data,
 						 FuArchiveFlags	 flags,
 						 GError		**error);
+void		 fu_archive_set_cache_size_max	(FuArchive	*self,
+						 guint64	 cache_size_max);
 GBytes		*fu_archive_lookup_by_fn	(FuArchive	*self,
 						 const gchar	*fn,
 						 GError		**error);
@@ -9,6 +9,7 @@
 #include "config.h"
 
 #include <gio/gio.h>
+#include <glib/gstdio.h>
 #include <libgcab.h>
 
 #include "fu-cabinet.h"
@@ -26,6 +27,7 @@ struct _FuCabinet {
 	XbSilo			*silo;
 	JcatContext		*jcat_context;
 	JcatFile		*jcat_file;
+	gchar			*tmpdir;	/* only set when streaming */
 };
 
 G_DEFINE_TYPE (FuCabinet, fu_cabinet, G_TYPE_OBJECT)
@@ -39,6 +41,12 @@ fu_cabinet_finalize (GObject *obj)
 	if (self->builder != NULL)
 		g_object_unref (self->builder);
 	g_free (self->container_checksum);
+	if (self->tmpdir != NULL) {
+		g_autoptr(GError) error_local = NULL;
+		if (!fu_common_rmtree (self->tmpdir, &error_local))
+			g_debug ("%s", error_local->message);
+		g_free (self->tmpdir);
+	}
 	g_object_unref (self->gcab_cabinet);
 	g_object_unref (self->jcat_context);
 	g_object_unref (self->jcat_file);
@@ -129,18 +137,56 @@ fu_cabinet_get_file_by_name (FuCabinet *self, const gchar *basename)
 	return NULL;
 }
 
+/* payloads were all extracted to the temporary directory when parsing, and
+ * are mapped when first used so that they are backed by the page cache */
+static GBytes *
+fu_cabinet_get_file_bytes (FuCabinet *self, GCabFile *cabfile, GError **error)
+{
+	GBytes *blob;
+	g_autofree gchar *fn = NULL;
+	g_autoptr(GBytes) blob_mapped = NULL;
+	g_autoptr(GMappedFile) mapped_file = NULL;
+
+	/* already in memory */
+	blob = gcab_file_get_bytes (cabfile);
+	if (blob != NULL)
+		return g_bytes_ref (blob);
+	if (self->tmpdir == NULL) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "no GBytes from GCabFile %s",
+			     gcab_file_get_extract_name (cabfile));
+		return NULL;
+	}
+
+	/* the mapping stays valid after the file is unlinked, and is kept on
+	 * the GCabFile in case more than one release uses the same payload */
+	fn = g_build_filename (self->tmpdir,
+			       gcab_file_get_extract_name (cabfile),
+			       NULL);
+	mapped_file = g_mapped_file_new (fn, FALSE, error);
+	if (mapped_file == NULL)
+		return NULL;
+	if (g_unlink (fn) != 0)
+		g_debug ("failed to remove %s", fn);
+	blob_mapped = g_mapped_file_get_bytes (mapped_file);
+	gcab_file_set_bytes (cabfile, blob_mapped);
+	return g_steal_pointer (&blob_mapped);
+}
+
 /* sets the firmware and signature blobs on XbNode */
 static gboolean
 fu_cabinet_parse_release (FuCabinet *self, XbNode *release, GError **error)
 {
 	GCabFile *cabfile;
-	GBytes *blob;
 	const gchar *csum_filename = NULL;
 	g_autofree gchar *basename = NULL;
 	g_autoptr(XbNode) csum_tmp = NULL;
 	g_autoptr(XbNode) metadata_trust = NULL;
 	g_autoptr(XbNode) nsize = NULL;
 	g_autoptr(JcatItem) item = NULL;
+	g_autoptr(GBytes) blob = NULL;
 	g_autoptr(GBytes) release_flags_blob = NULL;
 	FwupdReleaseFlags release_flags = FWUPD_RELEASE_FLAG_NONE;
 
@@ -170,14 +216,9 @@ fu_cabinet_parse_release (FuCabinet *self, XbNode *release, GError **error)
 			     basename);
 		return FALSE;
 	}
-	blob = gcab_file_get_bytes (cabfile);
-	if (blob == NULL) {
-		g_set_error_literal (error,
-				     FWUPD_ERROR,
-				     FWUPD_ERROR_INVALID_FILE,
-				     "no GBytes from GCabFile firmware");
+	blob = fu_cabinet_get_file_bytes (self, cabfile, error);
+	if (blob == NULL)
 		return FALSE;
-	}
 
 	/* set the blob */
 	xb_node_set_data (release, "fwupd::FirmwareBlob", blob);
@@ -241,20 +282,14 @@ fu_cabinet_parse_release (FuCabinet *self, XbNode *release, GError **error)
 		basename_sig = g_strdup_printf ("%s.asc", basename);
 		cabfile = fu_cabinet_get_file_by_name (self, basename_sig);
 		if (cabfile != NULL) {
-			GBytes *data_sig;
+			g_autoptr(GBytes) data_sig = NULL;
 			g_autoptr(JcatResult) jcat_result = NULL;
 			g_autoptr(JcatBlob) jcat_blob = NULL;
 			g_autoptr(GError) error_local = NULL;
 
-			data_sig = gcab_file_get_bytes (cabfile);
-			if (data_sig == NULL) {
-				g_set_error (error,
-					     FWUPD_ERROR,
-					     FWUPD_ERROR_INVALID_FILE,
-					     "no GBytes from GCabFile %s",
-					     basename_sig);
+			data_sig = fu_cabinet_get_file_bytes (self, cabfile, error);
+			if (data_sig == NULL)
 				return FALSE;
-			}
 			jcat_blob = jcat_blob_new (JCAT_BLOB_KIND_GPG, data_sig);
 			jcat_result = jcat_context_verify_blob (self->jcat_context,
 								blob, jcat_blob,
@@ -478,7 +513,7 @@ fu_cabinet_build_silo_folder (FuCabinet *self, GCabFolder *cabfolder, GError **e
 }
 
 static gboolean
-fu_cabinet_build_silo (FuCabinet *self, GBytes *data, GError **error)
+fu_cabinet_build_silo (FuCabinet *self, GError **error)
 {
 	GPtrArray *folders;
 	g_autoptr(XbBuilderFixup) fixup1 = NULL;
@@ -536,9 +571,19 @@ fu_cabinet_build_silo (FuCabinet *self, GBytes *data, GError **error)
 typedef struct {
 	FuCabinet	*self;
 	guint64		 size_total;
+	gboolean	 metadata_only;
 	GError		*error;
 } FuCabinetDecompressHelper;
 
+/* these are needed to build the silo and are always small */
+static gboolean
+fu_cabinet_is_metadata_filename (const gchar *fn)
+{
+	return g_str_has_suffix (fn, ".metainfo.xml") ||
+		g_str_has_suffix (fn, ".jcat") ||
+		g_str_has_suffix (fn, ".asc");
+}
+
 static gboolean
 fu_cabinet_decompress_file_cb (GCabFile *file, gpointer user_data)
 {
@@ -584,22 +629,74 @@ fu_cabinet_decompress_file_cb (GCabFile *file, gpointer user_data)
 	/* ignore the dirname completely */
 	basename = g_path_get_basename (name);
 	gcab_file_set_extract_name (file, basename);
+
+	/* payloads are extracted to disk in a second pass */
+	if (helper->metadata_only && !fu_cabinet_is_metadata_filename (basename))
+		return FALSE;
+	return TRUE;
+}
+
+static gboolean
+fu_cabinet_extract_payload_cb (GCabFile *file, gpointer user_data)
+{
+	return !fu_cabinet_is_metadata_filename (gcab_file_get_extract_name (file));
+}
+
+/* writes every payload to the temporary directory in one pass, so that each
+ * folder is only decompressed once rather than once per payload */
+static gboolean
+fu_cabinet_extract_payloads (FuCabinet *self, GError **error)
+{
+	g_autofree gchar *cachedir = fu_common_get_path (FU_PATH_KIND_CACHEDIR_PKG);
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GFile) path = NULL;
+
+	if (g_mkdir_with_parents (cachedir, 0700) != 0) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INTERNAL,
+			     "failed to create %s",
+			     cachedir);
+		return FALSE;
+	}
+	self->tmpdir = g_build_filename (cachedir, "cabinet-XXXXXX", NULL);
+	if (g_mkdtemp (self->tmpdir) == NULL) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INTERNAL,
+			     "failed to create %s",
+			     self->tmpdir);
+		g_clear_pointer (&self->tmpdir, g_free);
+		return FALSE;
+	}
+	path = g_file_new_for_path (self->tmpdir);
+	if (!gcab_cabinet_extract (self->gcab_cabinet, path,
+				   fu_cabinet_extract_payload_cb, NULL, NULL,
+				   NULL, &error_local)) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     error_local->message);
+		return FALSE;
+	}
 	return TRUE;
 }
 
 static gboolean
-fu_cabinet_decompress (FuCabinet *self, GBytes *data, GError **error)
+fu_cabinet_decompress (FuCabinet *self,
+		       GInputStream *istream,
+		       gboolean metadata_only,
+		       GError **error)
 {
 	FuCabinetDecompressHelper helper = {
 		.self		= self,
 		.size_total	= 0,
+		.metadata_only	= metadata_only,
 		.error		= NULL,
 	};
 	g_autoptr(GError) error_local = NULL;
-	g_autoptr(GInputStream) istream = NULL;
 
 	/* load from a seekable stream */
-	istream = g_memory_input_stream_new_from_bytes (data);
 	if (!gcab_cabinet_load (self->gcab_cabinet, istream, NULL, error))
 		return FALSE;
 
@@ -615,7 +712,7 @@ fu_cabinet_decompress (FuCabinet *self, GBytes *data, GError **error)
 		return FALSE;
 	}
 
-	/* decompress the file to memory */
+	/* decompress the files to memory */
 	if (!gcab_cabinet_extract_simple (self->gcab_cabinet, NULL,
 					  fu_cabinet_decompress_file_cb, &helper,
 					  NULL, &error_local)) {
@@ -636,41 +733,14 @@ fu_cabinet_decompress (FuCabinet *self, GBytes *data, GError **error)
 	return TRUE;
 }
 
-/**
- * fu_cabinet_parse:
- * @self: A #FuCabinet
- * @data: A #GBytes
- * @flags: A #FuCabinetParseFlags, e.g. %FU_CABINET_PARSE_FLAG_NONE
- * @error: A #GError, or %NULL
- *
- * Parses the cabinet archive.
- *
- * Returns: %TRUE for success
- *
- * Since: 1.4.0
- **/
-gboolean
-fu_cabinet_parse (FuCabinet *self,
-		  GBytes *data,
-		  FuCabinetParseFlags flags,
-		  GError **error)
+static gboolean
+fu_cabinet_parse_silo (FuCabinet *self, GError **error)
 {
 	g_autoptr(GError) error_local = NULL;
 	g_autoptr(GPtrArray) components = NULL;
 	g_autoptr(XbQuery) query = NULL;
 
-	g_return_val_if_fail (FU_IS_CABINET (self), FALSE);
-	g_return_val_if_fail (data != NULL, FALSE);
-	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
-	g_return_val_if_fail (self->silo == NULL, FALSE);
-
-	/* decompress */
-	if (!fu_cabinet_decompress (self, data, error))
-		return FALSE;
-
-	/* build xmlb silo */
-	self->container_checksum = g_compute_checksum_for_bytes (G_CHECKSUM_SHA1, data);
-	if (!fu_cabinet_build_silo (self, data, error))
+	if (!fu_cabinet_build_silo (self, error))
 		return FALSE;
 
 	/* sanity check */
@@ -721,6 +791,110 @@ fu_cabinet_parse (FuCabinet *self,
 	return TRUE;
 }
 
+/**
+ * fu_cabinet_parse:
+ * @self: A #FuCabinet
+ * @data: A #GBytes
+ * @flags: A #FuCabinetParseFlags, e.g. %FU_CABINET_PARSE_FLAG_NONE
+ * @error: A #GError, or %NULL
+ *
+ * Parses the cabinet archive.
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 1.4.0
+ **/
+gboolean
+fu_cabinet_parse (FuCabinet *self,
+		  GBytes *data,
+		  FuCabinetParseFlags flags,
+		  GError **error)
+{
+	g_autoptr(GInputStream) istream = NULL;
+
+	g_return_val_if_fail (FU_IS_CABINET (self), FALSE);
+	g_return_val_if_fail (data != NULL, FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+	g_return_val_if_fail (self->silo == NULL, FALSE);
+
+	/* decompress */
+	istream = g_memory_input_stream_new_from_bytes (data);
+	if (!fu_cabinet_decompress (self, istream, FALSE, error))
+		return FALSE;
+
+	/* build xmlb silo */
+	self->container_checksum = g_compute_checksum_for_bytes (G_CHECKSUM_SHA1, data);
+	return fu_cabinet_parse_silo (self, error);
+}
+
+/* reads the stream once to get the container checksum and then rewinds */
+static gboolean
+fu_cabinet_checksum_stream (FuCabinet *self, GInputStream *stream, GError **error)
+{
+	guint64 size_total = 0;
+	g_autofree guint8 *buf = g_malloc (0x8000);
+	g_autoptr(GChecksum) csum = g_checksum_new (G_CHECKSUM_SHA1);
+
+	for (;;) {
+		gssize sz = g_input_stream_read (stream, buf, 0x8000, NULL, error);
+		if (sz < 0)
+			return FALSE;
+		if (sz == 0)
+			break;
+		size_total += sz;
+		if (size_total > self->size_max) {
+			g_autofree gchar *sz_max = g_format_size (self->size_max);
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "archive too large (limit %s)",
+				     sz_max);
+			return FALSE;
+		}
+		g_checksum_update (csum, buf, sz);
+	}
+	self->container_checksum = g_strdup (g_checksum_get_string (csum));
+	return g_seekable_seek (G_SEEKABLE (stream), 0, G_SEEK_SET, NULL, error);
+}
+
+/**
+ * fu_cabinet_parse_stream:
+ * @self: A #FuCabinet
+ * @stream: A seekable #GInputStream
+ * @flags: A #FuCabinetParseFlags, e.g. %FU_CABINET_PARSE_FLAG_NONE
+ * @error: A #GError, or %NULL
+ *
+ * Parses the cabinet archive without loading it all into memory.
+ *
+ * Only the metadata files are decompressed into memory; the firmware payloads
+ * are extracted into a temporary directory in the cache directory and mapped
+ * when each release is processed. The directory is removed when @self is
+ * destroyed.
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_cabinet_parse_stream (FuCabinet *self,
+			 GInputStream *stream,
+			 FuCabinetParseFlags flags,
+			 GError **error)
+{
+	g_return_val_if_fail (FU_IS_CABINET (self), FALSE);
+	g_return_val_if_fail (G_IS_SEEKABLE (stream), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+	g_return_val_if_fail (self->silo == NULL, FALSE);
+
+	if (!fu_cabinet_checksum_stream (self, stream, error))
+		return FALSE;
+	if (!fu_cabinet_decompress (self, stream, TRUE, error))
+		return FALSE;
+	if (!fu_cabinet_extract_payloads (self, error))
+		return FALSE;
+	return fu_cabinet_parse_silo (self, error);
+}
+
 /**
  * fu_cabinet_new:
  *
@@ -6,7 +6,7 @@
 
 #pragma once
 
-#include <glib-object.h>
+#include <gio/gio.h>
 #include <xmlb.h>
 #include <jcat.h>
 
@@ -35,4 +35,8 @@ gboolean	 fu_cabinet_parse		(FuCabinet		*self,
 						 GBytes			*data,
 						 FuCabinetParseFlags	 flags,
 						 GError			**error);
+gboolean	 fu_cabinet_parse_stream	(FuCabinet		*self,
+						 GInputStream		*stream,
+						 FuCabinetParseFlags	 flags,
+						 GError			**error);
 XbSilo		*fu_cabinet_get_silo		(FuCabinet		*self);
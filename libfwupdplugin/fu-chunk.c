@@ -103,6 +103,152 @@ fu_chunk_array_to_string (GPtrArray *chunks)
 	return g_string_free (str, FALSE);
 }
 
+/**
+ * fu_chunk_iter_init: (skip):
+ * @iter: an uninitialized #FuChunkIter
+ * @data: a linear blob of memory, or %NULL
+ * @data_sz: size of @data_sz
+ * @addr_start: the hardware address offset, or 0
+ * @page_sz: the hardware page size, or 0
+ * @packet_sz: the transfer size, or 0
+ *
+ * Initializes an iterator that splits a linear blob of memory into packets in
+ * the same way as fu_chunk_array_new(), but without allocating any memory.
+ *
+ * The @data is not copied and so must remain valid while iterating.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_chunk_iter_init (FuChunkIter *iter,
+		    const guint8 *data,
+		    guint32 data_sz,
+		    guint32 addr_start,
+		    guint32 page_sz,
+		    guint32 packet_sz)
+{
+	g_return_if_fail (iter != NULL);
+	iter->data = data;
+	iter->data_sz = data_sz;
+	iter->addr_start = addr_start;
+	iter->page_sz = page_sz;
+	iter->packet_sz = packet_sz;
+	iter->offset = 0;
+	iter->idx = 0;
+}
+
+/**
+ * fu_chunk_iter_init_bytes: (skip):
+ * @iter: an uninitialized #FuChunkIter
+ * @blob: a #GBytes
+ * @addr_start: the hardware address offset, or 0
+ * @page_sz: the hardware page size, or 0
+ * @packet_sz: the transfer size, or 0
+ *
+ * Initializes an iterator that splits @blob into packets.
+ *
+ * The @blob is not referenced and so must remain valid while iterating.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_chunk_iter_init_bytes (FuChunkIter *iter,
+			  GBytes *blob,
+			  guint32 addr_start,
+			  guint32 page_sz,
+			  guint32 packet_sz)
+{
+	gsize sz = 0;
+	const guint8 *data = g_bytes_get_data (blob, &sz);
+	fu_chunk_iter_init (iter, data, (guint32) sz, addr_start, page_sz, packet_sz);
+}
+
+/**
+ * fu_chunk_iter_next: (skip):
+ * @iter: a #FuChunkIter
+ * @chk: (out caller-allocates): a #FuChunk, typically on the stack
+ *
+ * Gets the next packet, ensuring it does not cross a page boundary and is not
+ * larger than the transfer size.
+ *
+ * Return value: %FALSE if there are no more packets
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_chunk_iter_next (FuChunkIter *iter, FuChunk *chk)
+{
+	guint32 addr;
+	guint32 len;
+
+	g_return_val_if_fail (iter != NULL, FALSE);
+	g_return_val_if_fail (chk != NULL, FALSE);
+
+	if (iter->offset >= iter->data_sz)
+		return FALSE;
+
+	/* never cross a page boundary */
+	addr = iter->addr_start + iter->offset;
+	len = iter->data_sz - iter->offset;
+	if (iter->page_sz > 0) {
+		chk->page = addr / iter->page_sz;
+		chk->address = addr % iter->page_sz;
+		len = MIN (len, iter->page_sz - chk->address);
+	} else {
+		chk->page = 0;
+		chk->address = addr;
+	}
+	if (iter->packet_sz > 0)
+		len = MIN (len, iter->packet_sz);
+
+	chk->idx = iter->idx++;
+	chk->data = iter->data != NULL ? iter->data + iter->offset : NULL;
+	chk->data_sz = len;
+	iter->offset += len;
+	return TRUE;
+}
+
+static guint32
+fu_chunk_iter_count_segment (FuChunkIter *iter, guint32 segment_sz)
+{
+	if (segment_sz == 0)
+		return 0;
+	if (iter->packet_sz == 0)
+		return 1;
+	return (segment_sz + iter->packet_sz - 1) / iter->packet_sz;
+}
+
+/**
+ * fu_chunk_iter_get_count: (skip):
+ * @iter: a #FuChunkIter
+ *
+ * Gets the total number of packets, which is useful for reporting progress.
+ *
+ * Return value: integer
+ *
+ * Since: 1.5.0
+ **/
+guint32
+fu_chunk_iter_get_count (FuChunkIter *iter)
+{
+	guint32 first_sz;
+	guint32 rest_sz;
+
+	g_return_val_if_fail (iter != NULL, 0);
+
+	if (iter->page_sz == 0)
+		return fu_chunk_iter_count_segment (iter, iter->data_sz);
+
+	/* partial first page, then full pages, then a partial last page */
+	first_sz = iter->page_sz - (iter->addr_start % iter->page_sz);
+	if (first_sz >= iter->data_sz)
+		return fu_chunk_iter_count_segment (iter, iter->data_sz);
+	rest_sz = iter->data_sz - first_sz;
+	return fu_chunk_iter_count_segment (iter, first_sz) +
+		(rest_sz / iter->page_sz) * fu_chunk_iter_count_segment (iter, iter->page_sz) +
+		fu_chunk_iter_count_segment (iter, rest_sz % iter->page_sz);
+}
+
 /**
  * fu_chunk_array_new: (skip):
  * @data: a linear blob of memory, or %NULL
@@ -114,6 +260,8 @@ fu_chunk_array_to_string (GPtrArray *chunks)
  * Chunks a linear blob of memory into packets, ensuring each packet does not
  * cross a package boundary and is less that a specific transfer size.
  *
+ * Consider using fu_chunk_iter_init() instead, which does not allocate.
+ *
  * Return value: (transfer container) (element-type FuChunk): array of packets
  *
  * Since: 1.1.2
@@ -125,64 +273,21 @@ fu_chunk_array_new (const guint8 *data,
 		    guint32 page_sz,
 		    guint32 packet_sz)
 {
+	FuChunk chk;
+	FuChunkIter iter;
 	GPtrArray *segments = NULL;
-	guint32 page_old = G_MAXUINT32;
-	guint32 idx;
-	guint32 last_flush = 0;
 
 	g_return_val_if_fail (data_sz > 0, NULL);
 
-	segments = g_ptr_array_new_with_free_func (g_free);
-	for (idx = 1; idx < data_sz; idx++) {
-		guint32 page = 0;
-		if (page_sz > 0)
-			page = (addr_start + idx) / page_sz;
-		if (page_old == G_MAXUINT32) {
-			page_old = page;
-		} else if (page != page_old) {
-			const guint8 *data_offset = data != NULL ? data + last_flush : 0x0;
-			guint32 address_offset = addr_start + last_flush;
-			if (page_sz > 0)
-				address_offset %= page_sz;
-			g_ptr_array_add (segments,
-					 fu_chunk_new (segments->len,
-						       page_old,
-						       address_offset,
-						       data_offset,
-						       idx - last_flush));
-			last_flush = idx;
-			page_old = page;
-			continue;
-		}
-		if (packet_sz > 0 && idx - last_flush >= packet_sz) {
-			const guint8 *data_offset = data != NULL ? data + last_flush : 0x0;
-			guint32 address_offset = addr_start + last_flush;
-			if (page_sz > 0)
-				address_offset %= page_sz;
-			g_ptr_array_add (segments,
-					 fu_chunk_new (segments->len,
-						       page,
-						       address_offset,
-						       data_offset,
-						       idx - last_flush));
-			last_flush = idx;
-			continue;
-		}
-	}
-	if (last_flush != idx) {
-		const guint8 *data_offset = data != NULL ? data + last_flush : 0x0;
-		guint32 address_offset = addr_start + last_flush;
-		guint32 page = 0;
-		if (page_sz > 0) {
-			address_offset %= page_sz;
-			page = (addr_start + (idx - 1)) / page_sz;
-		}
+	fu_chunk_iter_init (&iter, data, data_sz, addr_start, page_sz, packet_sz);
+	segments = g_ptr_array_new_full (fu_chunk_iter_get_count (&iter), g_free);
+	while (fu_chunk_iter_next (&iter, &chk)) {
 		g_ptr_array_add (segments,
-				 fu_chunk_new (segments->len,
-					       page,
-					       address_offset,
-					       data_offset,
-					       data_sz - last_flush));
+				 fu_chunk_new (chk.idx,
+					       chk.page,
+					       chk.address,
+					       chk.data,
+					       chk.data_sz));
 	}
 	return segments;
 }
@@ -212,3 +317,55 @@ fu_chunk_array_new_from_bytes (GBytes *blob,
 	return fu_chunk_array_new (data, (guint32) sz,
 				   addr_start, page_sz, packet_sz);
 }
+
+/**
+ * fu_chunk_array_new_changed: (skip):
+ * @data: the new contents
+ * @data_sz: size of @data
+ * @data_old: (nullable): the existing contents, typically read back from the device
+ * @data_old_sz: size of @data_old
+ * @addr_start: the hardware address offset, or 0
+ * @page_sz: the hardware erase size, e.g. 0x1000
+ *
+ * Chunks a linear blob of memory into pages, and returns only the pages where
+ * the contents are different from @data_old. Any data past the end of
+ * @data_old is treated as changed.
+ *
+ * This allows plugins to only erase and program the parts of the flash that
+ * are different, which is much faster for small firmware changes.
+ *
+ * Return value: (transfer container) (element-type FuChunk): array of pages
+ *
+ * Since: 1.5.0
+ **/
+GPtrArray *
+fu_chunk_array_new_changed (const guint8 *data,
+			    guint32 data_sz,
+			    const guint8 *data_old,
+			    guint32 data_old_sz,
+			    guint32 addr_start,
+			    guint32 page_sz)
+{
+	FuChunk chk;
+	FuChunkIter iter;
+	GPtrArray *segments = g_ptr_array_new_with_free_func (g_free);
+
+	g_return_val_if_fail (data != NULL, NULL);
+	g_return_val_if_fail (page_sz > 0, NULL);
+
+	fu_chunk_iter_init (&iter, data, data_sz, addr_start, page_sz, 0x0);
+	while (fu_chunk_iter_next (&iter, &chk)) {
+		guint32 offset = (guint32) (chk.data - data);
+		if (data_old != NULL &&
+		    offset + chk.data_sz <= data_old_sz &&
+		    memcmp (chk.data, data_old + offset, chk.data_sz) == 0)
+			continue;
+		g_ptr_array_add (segments,
+				 fu_chunk_new (chk.idx,
+					       chk.page,
+					       chk.address,
+					       chk.data,
+					       chk.data_sz));
+	}
+	return segments;
+}
@@ -565,11 +565,12 @@ fu_common_firmware_builder (GBytes *bytes,
 typedef struct {
 	FuOutputHandler		 handler_cb;
 	gpointer		 handler_user_data;
+	GMainContext		*context;
 	GMainLoop		*loop;
 	GSource			*source;
 	GInputStream		*stream;
 	GCancellable		*cancellable;
-	guint			 timeout_id;
+	GSource			*timeout_source;
 } FuCommonSpawnHelper;
 
 static void fu_common_spawn_create_pollable_source (FuCommonSpawnHelper *helper);
@@ -624,7 +625,7 @@ fu_common_spawn_create_pollable_source (FuCommonSpawnHelper *helper)
 		g_source_destroy (helper->source);
 	helper->source = g_pollable_input_stream_create_source (G_POLLABLE_INPUT_STREAM (helper->stream),
 								helper->cancellable);
-	g_source_attach (helper->source, NULL);
+	g_source_attach (helper->source, helper->context);
 	g_source_set_callback (helper->source, (GSourceFunc) fu_common_spawn_source_pollable_cb, helper, NULL);
 }
 
@@ -638,8 +639,12 @@ fu_common_spawn_helper_free (FuCommonSpawnHelper *helper)
 		g_source_destroy (helper->source);
 	if (helper->loop != NULL)
 		g_main_loop_unref (helper->loop);
-	if (helper->timeout_id != 0)
-		g_source_remove (helper->timeout_id);
+	if (helper->timeout_source != NULL) {
+		g_source_destroy (helper->timeout_source);
+		g_source_unref (helper->timeout_source);
+	}
+	if (helper->context != NULL)
+		g_main_context_unref (helper->context);
 	g_free (helper);
 }
 
@@ -654,7 +659,6 @@ fu_common_spawn_timeout_cb (gpointer user_data)
 	FuCommonSpawnHelper *helper = (FuCommonSpawnHelper *) user_data;
 	g_cancellable_cancel (helper->cancellable);
 	g_main_loop_quit (helper->loop);
-	helper->timeout_id = 0;
 	return G_SOURCE_REMOVE;
 }
 
@@ -677,6 +681,9 @@ fu_common_spawn_cancelled_cb (GCancellable *cancellable, FuCommonSpawnHelper *he
  * Runs a subprocess and waits for it to exit. Any output on standard out or
  * standard error will be forwarded to @handler_cb as whole lines.
  *
+ * The wait is done on the thread-default main context so that this can be
+ * safely called from a device write running in a worker thread.
+ *
  * Returns: %TRUE for success
  *
  * Since: 0.9.7
@@ -705,7 +712,8 @@ fu_common_spawn_sync (const gchar * const * argv,
 	helper = g_new0 (FuCommonSpawnHelper, 1);
 	helper->handler_cb = handler_cb;
 	helper->handler_user_data = handler_user_data;
-	helper->loop = g_main_loop_new (NULL, FALSE);
+	helper->context = g_main_context_ref_thread_default ();
+	helper->loop = g_main_loop_new (helper->context, FALSE);
 	helper->stream = g_subprocess_get_stdout_pipe (subprocess);
 
 	/* always create a cancellable, and connect up the parent */
@@ -718,9 +726,11 @@ fu_common_spawn_sync (const gchar * const * argv,
 
 	/* allow timeout */
 	if (timeout_ms > 0) {
-		helper->timeout_id = g_timeout_add (timeout_ms,
-						    fu_common_spawn_timeout_cb,
-						    helper);
+		helper->timeout_source = g_timeout_source_new (timeout_ms);
+		g_source_set_callback (helper->timeout_source,
+				       fu_common_spawn_timeout_cb,
+				       helper, NULL);
+		g_source_attach (helper->timeout_source, helper->context);
 	}
 	fu_common_spawn_create_pollable_source (helper);
 	g_main_loop_run (helper->loop);
@@ -1036,6 +1046,12 @@ fu_common_get_path (FuPathKind path_kind)
 		if (tmp != NULL)
 			return g_strdup (tmp);
 		return g_strdup ("/proc");
+	/* /sys */
+	case FU_PATH_KIND_SYSFSDIR:
+		tmp = g_getenv ("FWUPD_SYSFSDIR");
+		if (tmp != NULL)
+			return g_strdup (tmp);
+		return g_strdup ("/sys");
 	/* /sys/firmware */
 	case FU_PATH_KIND_SYSFSDIR_FW:
 		tmp = g_getenv ("FWUPD_SYSFSFWDIR");
@@ -59,6 +59,7 @@ typedef guint FuEndianType;
  * @FU_PATH_KIND_SYSFSDIR_SECURITY:	The sysfs security location (IE /sys/kernel/security)
  * @FU_PATH_KIND_EFIDBXDIR:		The location of the EFI dbx files
  * @FU_PATH_KIND_ACPI_TABLES:		The location of the ACPI tables
+ * @FU_PATH_KIND_SYSFSDIR:		The sysfs base location (IE /sys)
  *
  * Path types to use when dynamically determining a path at runtime
  **/
@@ -80,6 +81,7 @@ typedef enum {
 	FU_PATH_KIND_SYSFSDIR_SECURITY,
 	FU_PATH_KIND_EFIDBXDIR,
 	FU_PATH_KIND_ACPI_TABLES,
+	FU_PATH_KIND_SYSFSDIR,
 	/*< private >*/
 	FU_PATH_KIND_LAST
 } FuPathKind;
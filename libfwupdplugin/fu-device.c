@@ -61,6 +61,10 @@ typedef struct {
 	GPtrArray			*possible_plugins;
 	GPtrArray			*retry_recs;	/* of FuDeviceRetryRecovery */
 	guint				 retry_delay;
+	GCancellable			*cancellable;	/* (nullable): only set in the write thread */
+	gint				 write_in_progress; /* atomic */
+	gint64				 wait_total;	/* us */
+	guint				 wait_count;
 } FuDevicePrivate;
 
 typedef struct {
@@ -77,12 +81,75 @@ enum {
 	PROP_QUIRKS,
 	PROP_PARENT,
 	PROP_PROXY,
+	PROP_ID,
+	PROP_EQUIVALENT_ID,
+	PROP_GUIDS,
 	PROP_LAST
 };
 
+typedef struct {
+	GBytes				*fw;
+	FwupdInstallFlags		 flags;
+} FuDeviceWriteHelper;
+
+typedef struct {
+	GObject				*object;
+	GParamSpec			**pspecs;
+	guint				 n_pspecs;
+} FuDeviceNotifyHelper;
+
+typedef void (*FuDeviceSetFunc)		(FuDevice	*self,
+					 guint64	 value);
+
+typedef struct {
+	FuDevice			*self;
+	FuDeviceSetFunc			 func;
+	guint64				 value;
+} FuDeviceSetHelper;
+
 G_DEFINE_TYPE_WITH_PRIVATE (FuDevice, fu_device, FWUPD_TYPE_DEVICE)
 #define GET_PRIVATE(o) (fu_device_get_instance_private (o))
 
+/* the GMainContext of the caller when running in a write thread */
+static GPrivate fu_device_write_context = G_PRIVATE_INIT (NULL);
+
+static void
+fu_device_set_helper_free (FuDeviceSetHelper *helper)
+{
+	g_object_unref (helper->self);
+	g_free (helper);
+}
+
+static gboolean
+fu_device_set_helper_cb (gpointer user_data)
+{
+	FuDeviceSetHelper *helper = (FuDeviceSetHelper *) user_data;
+	helper->func (helper->self, helper->value);
+	return G_SOURCE_REMOVE;
+}
+
+/* the FwupdDevice fields are not thread safe, so when called from a write
+ * thread the setter is run in the context of the caller instead */
+static gboolean
+fu_device_set_in_write_context (FuDevice *self, FuDeviceSetFunc func, guint64 value)
+{
+	GMainContext *context = g_private_get (&fu_device_write_context);
+	FuDeviceSetHelper *helper;
+
+	if (context == NULL)
+		return FALSE;
+	helper = g_new0 (FuDeviceSetHelper, 1);
+	helper->self = g_object_ref (self);
+	helper->func = func;
+	helper->value = value;
+	g_main_context_invoke_full (context,
+				    G_PRIORITY_DEFAULT,
+				    fu_device_set_helper_cb,
+				    helper,
+				    (GDestroyNotify) fu_device_set_helper_free);
+	return TRUE;
+}
+
 static void
 fu_device_get_property (GObject *object, guint prop_id,
 			GValue *value, GParamSpec *pspec)
@@ -108,6 +175,15 @@ fu_device_get_property (GObject *object, guint prop_id,
 	case PROP_PROXY:
 		g_value_set_object (value, priv->proxy);
 		break;
+	case PROP_ID:
+		g_value_set_string (value, fu_device_get_id (self));
+		break;
+	case PROP_EQUIVALENT_ID:
+		g_value_set_string (value, priv->equivalent_id);
+		break;
+	case PROP_GUIDS:
+		g_value_set_boxed (value, fu_device_get_guids (self));
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -138,6 +214,12 @@ fu_device_set_property (GObject *object, guint prop_id,
 	case PROP_PROXY:
 		fu_device_set_proxy (self, g_value_get_object (value));
 		break;
+	case PROP_ID:
+		fu_device_set_id (self, g_value_get_string (value));
+		break;
+	case PROP_EQUIVALENT_ID:
+		fu_device_set_equivalent_id (self, g_value_get_string (value));
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -320,6 +402,78 @@ fu_device_retry (FuDevice *self,
 	return TRUE;
 }
 
+/**
+ * fu_device_wait_for:
+ * @self: A #FuDevice
+ * @func: (scope call): A function to check the device
+ * @delay: initial delay between checks in ms
+ * @delay_max: maximum delay between checks in ms
+ * @timeout: time to wait in ms
+ * @user_data: (nullable): a helper to pass to @func
+ * @error: A #GError
+ *
+ * Calls @func until it sets @done to %TRUE, or @timeout has passed. If @func
+ * returns %FALSE the wait is aborted and the error is returned.
+ *
+ * The delay between checks starts at @delay and doubles each time, up to
+ * @delay_max.
+ *
+ * Returns: %TRUE if the device became ready
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_device_wait_for (FuDevice *self,
+		    FuDeviceWaitFunc func,
+		    guint delay,
+		    guint delay_max,
+		    guint timeout,
+		    gpointer user_data,
+		    GError **error)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	guint checks = 0;
+	guint delay_next = delay;
+	gint64 elapsed;
+	gint64 start_time = g_get_monotonic_time ();
+
+	g_return_val_if_fail (FU_IS_DEVICE (self), FALSE);
+	g_return_val_if_fail (func != NULL, FALSE);
+	g_return_val_if_fail (delay > 0, FALSE);
+	g_return_val_if_fail (delay_max >= delay, FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	for (;;) {
+		gboolean done = FALSE;
+
+		checks++;
+		if (!func (self, &done, user_data, error))
+			return FALSE;
+		elapsed = g_get_monotonic_time () - start_time;
+		if (done)
+			break;
+		if (elapsed >= (gint64) timeout * 1000) {
+			g_set_error (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_TIMED_OUT,
+				     "device not ready after %ums",
+				     (guint) (elapsed / 1000));
+			return FALSE;
+		}
+
+		/* do not sleep past the deadline */
+		g_usleep ((gulong) MIN (delay_next, timeout - elapsed / 1000) * 1000);
+		delay_next = MIN (delay_next * 2, delay_max);
+	}
+
+	/* record the actual time taken */
+	priv->wait_total += elapsed;
+	priv->wait_count++;
+	g_debug ("%s ready after %ums and %u checks",
+		 fu_device_get_id (self), (guint) (elapsed / 1000), checks);
+	return TRUE;
+}
+
 /**
  * fu_device_poll:
  * @self: A #FuDevice
@@ -353,6 +507,10 @@ fu_device_poll_cb (gpointer user_data)
 	FuDevice *self = FU_DEVICE (user_data);
 	FuDevicePrivate *priv = GET_PRIVATE (self);
 	g_autoptr(GError) error_local = NULL;
+
+	/* the hardware is busy being written from another thread */
+	if (g_atomic_int_get (&priv->write_in_progress))
+		return G_SOURCE_CONTINUE;
 	if (!fu_device_poll (self, &error_local)) {
 		g_warning ("disabling polling: %s", error_local->message);
 		priv->poll_id = 0;
@@ -500,6 +658,7 @@ fu_device_set_equivalent_id (FuDevice *self, const gchar *equivalent_id)
 	g_return_if_fail (FU_IS_DEVICE (self));
 	g_free (priv->equivalent_id);
 	priv->equivalent_id = g_strdup (equivalent_id);
+	g_object_notify (G_OBJECT (self), "equivalent-id");
 }
 
 /**
@@ -1224,12 +1383,22 @@ fu_device_get_firmware_size_max (FuDevice *self)
 	return priv->size_max;
 }
 
+/* so that anything indexing the device by GUID knows to look again */
+static void
+fu_device_add_guid_notify (FuDevice *self, const gchar *guid)
+{
+	if (fwupd_device_has_guid (FWUPD_DEVICE (self), guid))
+		return;
+	fwupd_device_add_guid (FWUPD_DEVICE (self), guid);
+	g_object_notify (G_OBJECT (self), "guids");
+}
+
 static void
 fu_device_add_guid_safe (FuDevice *self, const gchar *guid)
 {
 	/* add the device GUID before adding additional GUIDs from quirks
 	 * to ensure the bootloader GUID is listed after the runtime GUID */
-	fwupd_device_add_guid (FWUPD_DEVICE (self), guid);
+	fu_device_add_guid_notify (self, guid);
 	fu_device_add_guid_quirks (self, guid);
 }
 
@@ -1356,12 +1525,12 @@ fu_device_add_counterpart_guid (FuDevice *self, const gchar *guid)
 	/* make valid */
 	if (!fwupd_guid_is_valid (guid)) {
 		g_autofree gchar *tmp = fwupd_guid_hash_string (guid);
-		fwupd_device_add_guid (FWUPD_DEVICE (self), tmp);
+		fu_device_add_guid_notify (self, tmp);
 		return;
 	}
 
 	/* already valid */
-	fwupd_device_add_guid (FWUPD_DEVICE (self), guid);
+	fu_device_add_guid_notify (self, guid);
 }
 
 /**
@@ -1649,6 +1818,7 @@ fu_device_set_id (FuDevice *self, const gchar *id)
 		FuDevice *devtmp = g_ptr_array_index (priv->children, i);
 		fwupd_device_set_parent_id (FWUPD_DEVICE (devtmp), id_hash);
 	}
+	g_object_notify (G_OBJECT (self), "id");
 }
 
 /**
@@ -2004,6 +2174,12 @@ fu_device_get_physical_id (FuDevice *self)
 	return priv->physical_id;
 }
 
+static void
+fu_device_add_flag_cb (FuDevice *self, guint64 value)
+{
+	fu_device_add_flag (self, value);
+}
+
 /**
  * fu_device_add_flag:
  * @self: A #FuDevice
@@ -2011,6 +2187,9 @@ fu_device_get_physical_id (FuDevice *self)
  *
  * Adds a device flag to the device
  *
+ * If called from the `->write_firmware()` vfunc of a threaded write, the flag
+ * is added asynchronously in the context of the caller.
+ *
  * Since: 0.1.0
  **/
 void
@@ -2020,6 +2199,10 @@ fu_device_add_flag (FuDevice *self, FwupdDeviceFlags flag)
 	if (flag == FWUPD_DEVICE_FLAG_NONE)
 		return;
 
+	/* called from a write thread */
+	if (fu_device_set_in_write_context (self, fu_device_add_flag_cb, flag))
+		return;
+
 	/* being both a bootloader and requiring a bootloader is invalid */
 	if (flag & FWUPD_DEVICE_FLAG_NEEDS_BOOTLOADER)
 		fu_device_remove_flag (self, FWUPD_DEVICE_FLAG_IS_BOOTLOADER);
@@ -2034,6 +2217,35 @@ fu_device_add_flag (FuDevice *self, FwupdDeviceFlags flag)
 	fwupd_device_add_flag (FWUPD_DEVICE (self), flag);
 }
 
+static void
+fu_device_remove_flag_cb (FuDevice *self, guint64 value)
+{
+	fu_device_remove_flag (self, value);
+}
+
+/**
+ * fu_device_remove_flag:
+ * @self: A #FuDevice
+ * @flag: A #FwupdDeviceFlags
+ *
+ * Removes a device flag from the device
+ *
+ * If called from the `->write_firmware()` vfunc of a threaded write, the flag
+ * is removed asynchronously in the context of the caller.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_device_remove_flag (FuDevice *self, FwupdDeviceFlags flag)
+{
+	g_return_if_fail (FU_IS_DEVICE (self));
+
+	/* called from a write thread */
+	if (fu_device_set_in_write_context (self, fu_device_remove_flag_cb, flag))
+		return;
+	fwupd_device_remove_flag (FWUPD_DEVICE (self), flag);
+}
+
 static void
 fu_device_set_custom_flag (FuDevice *self, const gchar *hint)
 {
@@ -2188,6 +2400,12 @@ fu_device_get_status (FuDevice *self)
 	return fwupd_device_get_status (FWUPD_DEVICE (self));
 }
 
+static void
+fu_device_set_status_cb (FuDevice *self, guint64 value)
+{
+	fu_device_set_status (self, value);
+}
+
 /**
  * fu_device_set_status:
  * @self: A #FuDevice
@@ -2201,6 +2419,10 @@ void
 fu_device_set_status (FuDevice *self, FwupdStatus status)
 {
 	g_return_if_fail (FU_IS_DEVICE (self));
+
+	/* called from a write thread */
+	if (fu_device_set_in_write_context (self, fu_device_set_status_cb, status))
+		return;
 	fwupd_device_set_status (FWUPD_DEVICE (self), status);
 }
 
@@ -2222,6 +2444,12 @@ fu_device_get_progress (FuDevice *self)
 	return priv->progress;
 }
 
+static void
+fu_device_set_progress_cb (FuDevice *self, guint64 value)
+{
+	fu_device_set_progress (self, value);
+}
+
 /**
  * fu_device_set_progress:
  * @self: A #FuDevice
@@ -2236,6 +2464,10 @@ fu_device_set_progress (FuDevice *self, guint progress)
 {
 	FuDevicePrivate *priv = GET_PRIVATE (self);
 	g_return_if_fail (FU_IS_DEVICE (self));
+
+	/* called from a write thread */
+	if (fu_device_set_in_write_context (self, fu_device_set_progress_cb, progress))
+		return;
 	if (priv->progress == progress)
 		return;
 	priv->progress = progress;
@@ -2303,6 +2535,10 @@ fu_device_add_string (FuDevice *self, guint idt, GString *str)
 		fu_common_string_append_ku (str, idt + 1, "Order", priv->order);
 	if (priv->priority > 0)
 		fu_common_string_append_ku (str, idt + 1, "Priority", priv->priority);
+	if (priv->wait_count > 0) {
+		fu_common_string_append_ku (str, idt + 1, "WaitCount", priv->wait_count);
+		fu_common_string_append_ku (str, idt + 1, "WaitTotal", priv->wait_total / 1000);
+	}
 	if (priv->metadata != NULL) {
 		g_autoptr(GList) keys = g_hash_table_get_keys (priv->metadata);
 		for (GList *l = keys; l != NULL; l = l->next) {
@@ -2451,6 +2687,138 @@ fu_device_write_firmware (FuDevice *self,
 	return klass->write_firmware (self, firmware, flags, error);
 }
 
+static void
+fu_device_write_helper_free (FuDeviceWriteHelper *helper)
+{
+	g_bytes_unref (helper->fw);
+	g_free (helper);
+}
+
+static void
+fu_device_write_firmware_thread_cb (GTask *task,
+				    gpointer source_object,
+				    gpointer task_data,
+				    GCancellable *cancellable)
+{
+	FuDevice *self = FU_DEVICE (source_object);
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	FuDeviceWriteHelper *helper = (FuDeviceWriteHelper *) task_data;
+	gboolean ret;
+	g_autoptr(GError) error = NULL;
+
+	/* property changes are emitted in the context of the caller */
+	g_private_set (&fu_device_write_context, g_task_get_context (task));
+	if (cancellable != NULL)
+		priv->cancellable = g_object_ref (cancellable);
+	if (g_cancellable_set_error_if_cancelled (cancellable, &error))
+		ret = FALSE;
+	else
+		ret = fu_device_write_firmware (self, helper->fw, helper->flags, &error);
+	g_clear_object (&priv->cancellable);
+	g_private_set (&fu_device_write_context, NULL);
+	g_atomic_int_set (&priv->write_in_progress, FALSE);
+	if (!ret) {
+		g_task_return_error (task, g_steal_pointer (&error));
+		return;
+	}
+	g_task_return_boolean (task, TRUE);
+}
+
+/**
+ * fu_device_write_firmware_async:
+ * @self: A #FuDevice
+ * @fw: A #GBytes
+ * @flags: #FwupdInstallFlags, e.g. %FWUPD_INSTALL_FLAG_FORCE
+ * @cancellable: (nullable): A #GCancellable, or %NULL
+ * @callback: the function to run on completion
+ * @user_data: the data to pass to @callback
+ *
+ * Prepares and writes firmware to the device in a worker thread so that the
+ * caller can keep servicing the main loop.
+ *
+ * Calls made from the worker thread to fu_device_set_progress(),
+ * fu_device_set_status(), fu_device_add_flag() and fu_device_remove_flag() are
+ * run in the thread-default context of the caller, so the device state is
+ * only ever changed from one thread. Any other property changes are emitted
+ * in that context too. The subclassed `->write_firmware()` vfunc can use
+ * fu_device_get_cancellable() to stop between chunks when it is safe to do so.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_device_write_firmware_async (FuDevice *self,
+				GBytes *fw,
+				FwupdInstallFlags flags,
+				GCancellable *cancellable,
+				GAsyncReadyCallback callback,
+				gpointer user_data)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	FuDeviceWriteHelper *helper;
+	g_autoptr(GTask) task = NULL;
+
+	g_return_if_fail (FU_IS_DEVICE (self));
+	g_return_if_fail (fw != NULL);
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+	task = g_task_new (self, cancellable, callback, user_data);
+	if (!g_atomic_int_compare_and_exchange (&priv->write_in_progress, FALSE, TRUE)) {
+		g_task_return_new_error (task,
+					 FWUPD_ERROR,
+					 FWUPD_ERROR_ALREADY_PENDING,
+					 "firmware is already being written to %s",
+					 fu_device_get_id (self));
+		return;
+	}
+	helper = g_new0 (FuDeviceWriteHelper, 1);
+	helper->fw = g_bytes_ref (fw);
+	helper->flags = flags;
+	g_task_set_task_data (task, helper, (GDestroyNotify) fu_device_write_helper_free);
+	g_task_set_return_on_cancel (task, FALSE);
+	g_task_run_in_thread (task, fu_device_write_firmware_thread_cb);
+}
+
+/**
+ * fu_device_write_firmware_finish:
+ * @self: A #FuDevice
+ * @res: A #GAsyncResult
+ * @error: A #GError
+ *
+ * Gets the result of fu_device_write_firmware_async().
+ *
+ * Returns: %TRUE on success
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_device_write_firmware_finish (FuDevice *self, GAsyncResult *res, GError **error)
+{
+	g_return_val_if_fail (FU_IS_DEVICE (self), FALSE);
+	g_return_val_if_fail (g_task_is_valid (res, self), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+	return g_task_propagate_boolean (G_TASK (res), error);
+}
+
+/**
+ * fu_device_get_cancellable:
+ * @self: A #FuDevice
+ *
+ * Gets the cancellable passed to fu_device_write_firmware_async(). This is
+ * only set when called from the `->write_firmware()` vfunc in the worker
+ * thread.
+ *
+ * Returns: (transfer none) (nullable): a #GCancellable, or %NULL
+ *
+ * Since: 1.5.0
+ **/
+GCancellable *
+fu_device_get_cancellable (FuDevice *self)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	g_return_val_if_fail (FU_IS_DEVICE (self), NULL);
+	return priv->cancellable;
+}
+
 /**
  * fu_device_prepare_firmware:
  * @self: A #FuDevice
@@ -2900,7 +3268,7 @@ fu_device_convert_instance_ids (FuDevice *self)
 	for (guint i = 0; i < instance_ids->len; i++) {
 		const gchar *instance_id = g_ptr_array_index (instance_ids, i);
 		g_autofree gchar *guid = fwupd_guid_hash_string (instance_id);
-		fwupd_device_add_guid (FWUPD_DEVICE (self), guid);
+		fu_device_add_guid_notify (self, guid);
 	}
 
 	/* convert all children too */
@@ -3173,12 +3541,61 @@ fu_device_incorporate_from_component (FuDevice *self, XbNode *component)
 		fwupd_device_set_update_image (FWUPD_DEVICE (self), tmp);
 }
 
+static void
+fu_device_notify_helper_free (FuDeviceNotifyHelper *helper)
+{
+	for (guint i = 0; i < helper->n_pspecs; i++)
+		g_param_spec_unref (helper->pspecs[i]);
+	g_free (helper->pspecs);
+	g_object_unref (helper->object);
+	g_free (helper);
+}
+
+static gboolean
+fu_device_dispatch_properties_changed_cb (gpointer user_data)
+{
+	FuDeviceNotifyHelper *helper = (FuDeviceNotifyHelper *) user_data;
+	G_OBJECT_CLASS (fu_device_parent_class)->dispatch_properties_changed (helper->object,
+									      helper->n_pspecs,
+									      helper->pspecs);
+	return G_SOURCE_REMOVE;
+}
+
+static void
+fu_device_dispatch_properties_changed (GObject *object, guint n_pspecs, GParamSpec **pspecs)
+{
+	GMainContext *context = g_private_get (&fu_device_write_context);
+	FuDeviceNotifyHelper *helper;
+
+	/* not in a write thread */
+	if (context == NULL) {
+		G_OBJECT_CLASS (fu_device_parent_class)->dispatch_properties_changed (object,
+										      n_pspecs,
+										      pspecs);
+		return;
+	}
+
+	/* the signal handlers are not thread safe */
+	helper = g_new0 (FuDeviceNotifyHelper, 1);
+	helper->object = g_object_ref (object);
+	helper->n_pspecs = n_pspecs;
+	helper->pspecs = g_new0 (GParamSpec *, n_pspecs);
+	for (guint i = 0; i < n_pspecs; i++)
+		helper->pspecs[i] = g_param_spec_ref (pspecs[i]);
+	g_main_context_invoke_full (context,
+				    G_PRIORITY_DEFAULT,
+				    fu_device_dispatch_properties_changed_cb,
+				    helper,
+				    (GDestroyNotify) fu_device_notify_helper_free);
+}
+
 static void
 fu_device_class_init (FuDeviceClass *klass)
 {
 	GObjectClass *object_class = G_OBJECT_CLASS (klass);
 	GParamSpec *pspec;
 	object_class->finalize = fu_device_finalize;
+	object_class->dispatch_properties_changed = fu_device_dispatch_properties_changed;
 	object_class->get_property = fu_device_get_property;
 	object_class->set_property = fu_device_set_property;
 
@@ -3192,6 +3609,22 @@ fu_device_class_init (FuDeviceClass *klass)
 				     G_PARAM_STATIC_NAME);
 	g_object_class_install_property (object_class, PROP_LOGICAL_ID, pspec);
 
+	pspec = g_param_spec_string ("id", NULL, NULL, NULL,
+				     G_PARAM_READWRITE |
+				     G_PARAM_STATIC_NAME);
+	g_object_class_install_property (object_class, PROP_ID, pspec);
+
+	pspec = g_param_spec_string ("equivalent-id", NULL, NULL, NULL,
+				     G_PARAM_READWRITE |
+				     G_PARAM_STATIC_NAME);
+	g_object_class_install_property (object_class, PROP_EQUIVALENT_ID, pspec);
+
+	pspec = g_param_spec_boxed ("guids", NULL, NULL,
+				    G_TYPE_PTR_ARRAY,
+				    G_PARAM_READABLE |
+				    G_PARAM_STATIC_NAME);
+	g_object_class_install_property (object_class, PROP_GUIDS, pspec);
+
 	pspec = g_param_spec_uint ("progress", NULL, NULL,
 				   0, 100, 0,
 				   G_PARAM_READWRITE |
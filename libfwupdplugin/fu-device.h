@@ -107,11 +107,14 @@ typedef enum {
 typedef gboolean (*FuDeviceRetryFunc)			(FuDevice	*device,
 							 gpointer	 user_data,
 							 GError		**error);
+typedef gboolean (*FuDeviceWaitFunc)			(FuDevice	*device,
+							 gboolean	*done,
+							 gpointer	 user_data,
+							 GError		**error);
 
 FuDevice	*fu_device_new				(void);
 
 /* helpful casting macros */
-#define fu_device_remove_flag(d,v)		fwupd_device_remove_flag(FWUPD_DEVICE(d),v)
 #define fu_device_has_flag(d,v)			fwupd_device_has_flag(FWUPD_DEVICE(d),v)
 #define fu_device_has_instance_id(d,v)		fwupd_device_has_instance_id(FWUPD_DEVICE(d),v)
 #define fu_device_add_checksum(d,v)		fwupd_device_add_checksum(FWUPD_DEVICE(d),v)
@@ -236,6 +239,8 @@ void		 fu_device_set_priority			(FuDevice	*self,
 							 guint		 priority);
 void		 fu_device_add_flag			(FuDevice	*self,
 							 FwupdDeviceFlags flag);
+void		 fu_device_remove_flag			(FuDevice	*self,
+							 FwupdDeviceFlags flag);
 const gchar	*fu_device_get_custom_flags		(FuDevice	*self);
 gboolean	 fu_device_has_custom_flag		(FuDevice	*self,
 							 const gchar	*hint);
@@ -271,6 +276,16 @@ gboolean	 fu_device_write_firmware		(FuDevice	*self,
 							 GBytes		*fw,
 							 FwupdInstallFlags flags,
 							 GError		**error);
+void		 fu_device_write_firmware_async		(FuDevice	*self,
+							 GBytes		*fw,
+							 FwupdInstallFlags flags,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 user_data);
+gboolean	 fu_device_write_firmware_finish	(FuDevice	*self,
+							 GAsyncResult	*res,
+							 GError		**error);
+GCancellable	*fu_device_get_cancellable		(FuDevice	*self);
 FuFirmware	*fu_device_prepare_firmware		(FuDevice	*self,
 							 GBytes		*fw,
 							 FwupdInstallFlags flags,
@@ -322,5 +337,12 @@ gboolean	 fu_device_retry			(FuDevice	*self,
 							 guint		 count,
 							 gpointer	 user_data,
 							 GError		**error);
+gboolean	 fu_device_wait_for			(FuDevice	*self,
+							 FuDeviceWaitFunc func,
+							 guint		 delay,
+							 guint		 delay_max,
+							 guint		 timeout,
+							 gpointer	 user_data,
+							 GError		**error);
 GHashTable	*fu_device_report_metadata_pre		(FuDevice	*self);
 GHashTable	*fu_device_report_metadata_post		(FuDevice	*self);
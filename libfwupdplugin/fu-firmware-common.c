@@ -12,6 +12,33 @@
 
 #include "fu-firmware-common.h"
 
+/* each hex digit is stored as value + 1 so that zero means invalid */
+static const guint8 fu_firmware_hex_table[256] = {
+	['0'] = 0x1, ['1'] = 0x2, ['2'] = 0x3, ['3'] = 0x4, ['4'] = 0x5,
+	['5'] = 0x6, ['6'] = 0x7, ['7'] = 0x8, ['8'] = 0x9, ['9'] = 0xa,
+	['a'] = 0xb, ['b'] = 0xc, ['c'] = 0xd, ['d'] = 0xe, ['e'] = 0xf, ['f'] = 0x10,
+	['A'] = 0xb, ['B'] = 0xc, ['C'] = 0xd, ['D'] = 0xe, ['E'] = 0xf, ['F'] = 0x10,
+};
+
+/* anything other than hex digits, e.g. whitespace, a sign or a 0x prefix, is
+ * rare and so is handed to g_ascii_strtoull() to get exactly the same result */
+static guint32
+fu_firmware_strparse_hex (const gchar *data, guint len)
+{
+	gchar buffer[9];
+	guint32 val = 0;
+	for (guint i = 0; i < len; i++) {
+		guint8 tmp = fu_firmware_hex_table[(guint8) data[i]];
+		if (tmp == 0) {
+			memcpy (buffer, data, len);
+			buffer[len] = '\0';
+			return (guint32) g_ascii_strtoull (buffer, NULL, 16);
+		}
+		val = (val << 4) | (tmp - 1);
+	}
+	return val;
+}
+
 /**
  * fu_firmware_strparse_uint4:
  * @data: a string
@@ -28,10 +55,7 @@
 guint8
 fu_firmware_strparse_uint4 (const gchar *data)
 {
-	gchar buffer[2];
-	memcpy (buffer, data, 1);
-	buffer[1] = '\0';
-	return (guint8) g_ascii_strtoull (buffer, NULL, 16);
+	return (guint8) fu_firmware_strparse_hex (data, 1);
 }
 
 /**
@@ -50,10 +74,7 @@ fu_firmware_strparse_uint4 (const gchar *data)
 guint8
 fu_firmware_strparse_uint8 (const gchar *data)
 {
-	gchar buffer[3];
-	memcpy (buffer, data, 2);
-	buffer[2] = '\0';
-	return (guint8) g_ascii_strtoull (buffer, NULL, 16);
+	return (guint8) fu_firmware_strparse_hex (data, 2);
 }
 
 /**
@@ -72,10 +93,7 @@ fu_firmware_strparse_uint8 (const gchar *data)
 guint16
 fu_firmware_strparse_uint16 (const gchar *data)
 {
-	gchar buffer[5];
-	memcpy (buffer, data, 4);
-	buffer[4] = '\0';
-	return (guint16) g_ascii_strtoull (buffer, NULL, 16);
+	return (guint16) fu_firmware_strparse_hex (data, 4);
 }
 
 /**
@@ -94,10 +112,7 @@ fu_firmware_strparse_uint16 (const gchar *data)
 guint32
 fu_firmware_strparse_uint24 (const gchar *data)
 {
-	gchar buffer[7];
-	memcpy (buffer, data, 6);
-	buffer[6] = '\0';
-	return (guint32) g_ascii_strtoull (buffer, NULL, 16);
+	return (guint32) fu_firmware_strparse_hex (data, 6);
 }
 
 /**
@@ -116,8 +131,5 @@ fu_firmware_strparse_uint24 (const gchar *data)
 guint32
 fu_firmware_strparse_uint32 (const gchar *data)
 {
-	gchar buffer[9];
-	memcpy (buffer, data, 8);
-	buffer[8] = '\0';
-	return (guint32) g_ascii_strtoull (buffer, NULL, 16);
+	return (guint32) fu_firmware_strparse_hex (data, 8);
 }
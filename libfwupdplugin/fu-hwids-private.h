@@ -0,0 +1,14 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#pragma once
+
+#include "fu-hwids.h"
+
+GVariant	*fu_hwids_to_variant		(FuHwids	*self);
+gboolean	 fu_hwids_setup_from_variant	(FuHwids	*self,
+						 GVariant	*value,
+						 GError		**error);
@@ -13,7 +13,7 @@
 #include <string.h>
 
 #include "fu-common.h"
-#include "fu-hwids.h"
+#include "fu-hwids-private.h"
 #include "fwupd-common.h"
 #include "fwupd-error.h"
 
@@ -423,6 +423,101 @@ fu_hwids_setup (FuHwids *self, FuSmbios *smbios, GError **error)
 	return TRUE;
 }
 
+static GVariant *
+fu_hwids_hash_to_variant (GHashTable *hash)
+{
+	GHashTableIter iter;
+	GVariantBuilder builder;
+	gpointer key, value;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{ss}"));
+	g_hash_table_iter_init (&iter, hash);
+	while (g_hash_table_iter_next (&iter, &key, &value))
+		g_variant_builder_add (&builder, "{ss}", key, value);
+	return g_variant_builder_end (&builder);
+}
+
+/**
+ * fu_hwids_to_variant:
+ * @self: A #FuHwids
+ *
+ * Serializes the SMBIOS values and the computed hardware GUIDs so that they
+ * can be restored using fu_hwids_setup_from_variant().
+ *
+ * Returns: (transfer full): a #GVariant
+ *
+ * Since: 1.5.0
+ **/
+GVariant *
+fu_hwids_to_variant (FuHwids *self)
+{
+	GVariantBuilder builder;
+
+	g_return_val_if_fail (FU_IS_HWIDS (self), NULL);
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE_STRING_ARRAY);
+	for (guint i = 0; i < self->array_guids->len; i++) {
+		const gchar *guid = g_ptr_array_index (self->array_guids, i);
+		g_variant_builder_add (&builder, "s", guid);
+	}
+	return g_variant_new ("(@a{ss}@a{ss}as)",
+			      fu_hwids_hash_to_variant (self->hash_dmi_hw),
+			      fu_hwids_hash_to_variant (self->hash_dmi_display),
+			      &builder);
+}
+
+/**
+ * fu_hwids_setup_from_variant:
+ * @self: A #FuHwids
+ * @value: A #GVariant created by fu_hwids_to_variant()
+ * @error: A #GError or %NULL
+ *
+ * Restores the SMBIOS values and hardware GUIDs without computing them again.
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_hwids_setup_from_variant (FuHwids *self, GVariant *value, GError **error)
+{
+	const gchar *key;
+	const gchar *val;
+	g_autoptr(GVariantIter) iter_hw = NULL;
+	g_autoptr(GVariantIter) iter_display = NULL;
+	g_autoptr(GVariantIter) iter_guids = NULL;
+
+	g_return_val_if_fail (FU_IS_HWIDS (self), FALSE);
+	g_return_val_if_fail (value != NULL, FALSE);
+
+	if (!g_variant_is_of_type (value, G_VARIANT_TYPE ("(a{ss}a{ss}as)"))) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "invalid HWID format, got %s",
+			     g_variant_get_type_string (value));
+		return FALSE;
+	}
+	g_variant_get (value, "(a{ss}a{ss}as)", &iter_hw, &iter_display, &iter_guids);
+	while (g_variant_iter_next (iter_hw, "{&s&s}", &key, &val)) {
+		g_hash_table_insert (self->hash_dmi_hw,
+				     g_strdup (key),
+				     g_strdup (val));
+	}
+	while (g_variant_iter_next (iter_display, "{&s&s}", &key, &val)) {
+		g_hash_table_insert (self->hash_dmi_display,
+				     g_strdup (key),
+				     g_strdup (val));
+	}
+	while (g_variant_iter_next (iter_guids, "&s", &val)) {
+		g_hash_table_insert (self->hash_guid,
+				     g_strdup (val),
+				     GUINT_TO_POINTER (1));
+		g_ptr_array_add (self->array_guids, g_strdup (val));
+	}
+	return TRUE;
+}
+
 static void
 fu_hwids_finalize (GObject *object)
 {
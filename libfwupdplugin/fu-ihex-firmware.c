@@ -25,7 +25,8 @@
 
 struct _FuIhexFirmware {
 	FuFirmware		 parent_instance;
-	GPtrArray		*records;
+	GPtrArray		*records;	/* created on demand */
+	GBytes			*fw;
 };
 
 G_DEFINE_TYPE (FuIhexFirmware, fu_ihex_firmware, FU_TYPE_FIRMWARE)
@@ -38,6 +39,45 @@ G_DEFINE_TYPE (FuIhexFirmware, fu_ihex_firmware, FU_TYPE_FIRMWARE)
 #define	DFU_INHX32_RECORD_TYPE_START_LINEAR	0x05
 #define	DFU_INHX32_RECORD_TYPE_SIGNATURE	0xfd
 
+/* returns the next line, or %FALSE when there are no more */
+static gboolean
+fu_ihex_firmware_next_line (const gchar *data,
+			    gsize sz,
+			    gsize *offset,
+			    const gchar **line,
+			    gsize *linesz)
+{
+	const gchar *tmp;
+	gsize len;
+
+	if (*offset >= sz)
+		return FALSE;
+	*line = data + *offset;
+	tmp = memchr (*line, '\n', sz - *offset);
+	len = tmp != NULL ? (gsize) (tmp - *line) : sz - *offset;
+	*offset += len + 1;
+
+	/* ignore anything after a carriage return or EOF marker */
+	for (gsize i = 0; i < len; i++) {
+		if ((*line)[i] == '\r' || (*line)[i] == '\x1a') {
+			len = i;
+			break;
+		}
+	}
+	*linesz = len;
+	return TRUE;
+}
+
+static gsize
+fu_ihex_firmware_get_data_size (const gchar *data, gsize sz)
+{
+	/* like a C string, nothing after a NUL is used */
+	const gchar *tmp = memchr (data, '\0', sz);
+	return tmp != NULL ? (gsize) (tmp - data) : sz;
+}
+
+static void fu_ihex_firmware_ensure_records (FuIhexFirmware *self);
+
 /**
  * fu_ihex_firmware_get_records:
  * @self: A #FuIhexFirmware
@@ -55,6 +95,7 @@ GPtrArray *
 fu_ihex_firmware_get_records (FuIhexFirmware *self)
 {
 	g_return_val_if_fail (FU_IS_IHEX_FIRMWARE (self), NULL);
+	fu_ihex_firmware_ensure_records (self);
 	return self->records;
 }
 
@@ -68,32 +109,34 @@ fu_ihex_firmware_record_free (FuIhexFirmwareRecord *rcd)
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(FuIhexFirmwareRecord, fu_ihex_firmware_record_free)
 
 static FuIhexFirmwareRecord *
-fu_ihex_firmware_record_new (guint ln, const gchar *buf)
+fu_ihex_firmware_record_new (guint ln, const gchar *buf, gsize bufsz)
 {
 	FuIhexFirmwareRecord *rcd = g_new0 (FuIhexFirmwareRecord, 1);
 	rcd->ln = ln;
-	rcd->buf = g_string_new (buf);
+	rcd->buf = g_string_new_len (buf, bufsz);
 	return rcd;
 }
 
-static const gchar *
-fu_ihex_firmware_record_type_to_string (guint8 record_type)
+/* the records are only needed by plugins that write line-by-line */
+static void
+fu_ihex_firmware_ensure_records (FuIhexFirmware *self)
 {
-	if (record_type == DFU_INHX32_RECORD_TYPE_DATA)
-		return "DATA";
-	if (record_type == DFU_INHX32_RECORD_TYPE_EOF)
-		return "EOF";
-	if (record_type == DFU_INHX32_RECORD_TYPE_EXTENDED_SEGMENT)
-		return "EXTENDED_SEGMENT";
-	if (record_type == DFU_INHX32_RECORD_TYPE_START_SEGMENT)
-		return "START_SEGMENT";
-	if (record_type == DFU_INHX32_RECORD_TYPE_EXTENDED_LINEAR)
-		return "EXTENDED_LINEAR";
-	if (record_type == DFU_INHX32_RECORD_TYPE_START_LINEAR)
-		return "ADDR32";
-	if (record_type == DFU_INHX32_RECORD_TYPE_SIGNATURE)
-		return "SIGNATURE";
-	return NULL;
+	const gchar *data;
+	const gchar *line = NULL;
+	gsize linesz = 0;
+	gsize offset = 0;
+	gsize sz = 0;
+
+	if (self->fw == NULL || self->records->len > 0)
+		return;
+	data = g_bytes_get_data (self->fw, &sz);
+	sz = fu_ihex_firmware_get_data_size (data, sz);
+	for (guint ln = 1; fu_ihex_firmware_next_line (data, sz, &offset, &line, &linesz); ln++) {
+		if (linesz == 0)
+			continue;
+		g_ptr_array_add (self->records,
+				 fu_ihex_firmware_record_new (ln, line, linesz));
+	}
 }
 
 static gboolean
@@ -101,18 +144,12 @@ fu_ihex_firmware_tokenize (FuFirmware *firmware, GBytes *fw,
 			   FwupdInstallFlags flags, GError **error)
 {
 	FuIhexFirmware *self = FU_IHEX_FIRMWARE (firmware);
-	gsize sz = 0;
-	const gchar *data = g_bytes_get_data (fw, &sz);
-	g_auto(GStrv) lines = fu_common_strnsplit (data, sz, "\n", -1);
 
-	for (guint ln = 0; lines[ln] != NULL; ln++) {
-		g_autoptr(FuIhexFirmwareRecord) rcd = NULL;
-		g_strdelimit (lines[ln], "\r\x1a", '\0');
-		if (lines[ln][0] == '\0')
-			continue;
-		rcd = fu_ihex_firmware_record_new (ln + 1, lines[ln]);
-		g_ptr_array_add (self->records, g_steal_pointer (&rcd));
-	}
+	/* records are split from this when required */
+	if (self->fw != NULL)
+		g_bytes_unref (self->fw);
+	self->fw = g_bytes_ref (fw);
+	g_ptr_array_set_size (self->records, 0);
 	return TRUE;
 }
 
@@ -124,8 +161,12 @@ fu_ihex_firmware_parse (FuFirmware *firmware,
 			FwupdInstallFlags flags,
 			GError **error)
 {
-	FuIhexFirmware *self = FU_IHEX_FIRMWARE (firmware);
+	const gchar *data;
+	const gchar *line = NULL;
 	gboolean got_eof = FALSE;
+	gsize linesz = 0;
+	gsize offset = 0;
+	gsize sz = 0;
 	guint32 abs_addr = 0x0;
 	guint32 addr_last = 0x0;
 	guint32 img_addr = G_MAXUINT32;
@@ -135,21 +176,21 @@ fu_ihex_firmware_parse (FuFirmware *firmware,
 	g_autoptr(GByteArray) buf = g_byte_array_new ();
 	g_autoptr(GByteArray) buf_signature = g_byte_array_new ();
 
-	/* parse records */
-	for (guint k = 0; k < self->records->len; k++) {
-		FuIhexFirmwareRecord *rcd = g_ptr_array_index (self->records, k);
-		const gchar *line = rcd->buf->str;
+	/* parse each line in place rather than copying it to a record */
+	data = g_bytes_get_data (fw, &sz);
+	sz = fu_ihex_firmware_get_data_size (data, sz);
+	for (guint ln = 1; fu_ihex_firmware_next_line (data, sz, &offset, &line, &linesz); ln++) {
 		guint32 addr;
 		guint8 byte_cnt;
 		guint8 record_type;
 		guint line_end;
 
-		/* ignore comments */
-		if (g_str_has_prefix (line, ";"))
+		/* ignore blank lines */
+		if (linesz == 0)
 			continue;
 
-		/* ignore blank lines */
-		if (rcd->buf->len == 0)
+		/* ignore comments */
+		if (line[0] == ';')
 			continue;
 
 		/* check starting token */
@@ -157,18 +198,18 @@ fu_ihex_firmware_parse (FuFirmware *firmware,
 			g_set_error (error,
 				     FWUPD_ERROR,
 				     FWUPD_ERROR_INVALID_FILE,
-				     "invalid starting token on line %u: %s",
-				     rcd->ln, line);
+				     "invalid starting token on line %u: %.*s",
+				     ln, (gint) linesz, line);
 			return FALSE;
 		}
 
 		/* check there's enough data for the smallest possible record */
-		if (rcd->buf->len < 11) {
+		if (linesz < 11) {
 			g_set_error (error,
 				     FWUPD_ERROR,
 				     FWUPD_ERROR_INVALID_FILE,
 				     "line %u is incomplete, length %u",
-				     rcd->ln, (guint) rcd->buf->len);
+				     ln, (guint) linesz);
 			return FALSE;
 		}
 
@@ -176,27 +217,31 @@ fu_ihex_firmware_parse (FuFirmware *firmware,
 		byte_cnt = fu_firmware_strparse_uint8 (line + 1);
 		addr = fu_firmware_strparse_uint16 (line + 3);
 		record_type = fu_firmware_strparse_uint8 (line + 7);
-		g_debug ("%s:", fu_ihex_firmware_record_type_to_string (record_type));
-		g_debug ("  addr_start:\t0x%04x", addr);
-		g_debug ("  length:\t0x%02x", byte_cnt);
 		addr += seg_addr;
 		addr += abs_addr;
-		g_debug ("  addr:\t0x%08x", addr);
 
 		/* position of checksum */
 		line_end = 9 + byte_cnt * 2;
-		if (line_end > (guint) rcd->buf->len) {
+		if (line_end > (guint) linesz) {
 			g_set_error (error,
 				     FWUPD_ERROR,
 				     FWUPD_ERROR_INVALID_FILE,
 				     "line %u malformed, length: %u",
-				     rcd->ln, line_end);
+				     ln, line_end);
 			return FALSE;
 		}
 
 		/* verify checksum */
 		if ((flags & FWUPD_INSTALL_FLAG_FORCE) == 0) {
 			guint8 checksum = 0;
+			if (line_end + 2 > (guint) linesz) {
+				g_set_error (error,
+					     FWUPD_ERROR,
+					     FWUPD_ERROR_INVALID_FILE,
+					     "line %u has no checksum",
+					     ln);
+				return FALSE;
+			}
 			for (guint i = 1; i < line_end + 2; i += 2) {
 				guint8 data_tmp = fu_firmware_strparse_uint8 (line + i);
 				checksum += data_tmp;
@@ -206,11 +251,33 @@ fu_ihex_firmware_parse (FuFirmware *firmware,
 					     FWUPD_ERROR,
 					     FWUPD_ERROR_INVALID_FILE,
 					     "line %u has invalid checksum (0x%02x)",
-					     rcd->ln, checksum);
+					     ln, checksum);
 				return FALSE;
 			}
 		}
 
+		/* the address records are read without using the byte count */
+		if ((record_type == DFU_INHX32_RECORD_TYPE_EXTENDED_LINEAR ||
+		     record_type == DFU_INHX32_RECORD_TYPE_EXTENDED_SEGMENT) &&
+		    line_end < 9 + 4) {
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "line %u too short for address",
+				     ln);
+			return FALSE;
+		}
+		if ((record_type == DFU_INHX32_RECORD_TYPE_START_LINEAR ||
+		     record_type == DFU_INHX32_RECORD_TYPE_START_SEGMENT) &&
+		    line_end < 9 + 8) {
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "line %u too short for address",
+				     ln);
+			return FALSE;
+		}
+
 		/* process different record types */
 		switch (record_type) {
 		case DFU_INHX32_RECORD_TYPE_DATA:
@@ -226,12 +293,11 @@ fu_ihex_firmware_parse (FuFirmware *firmware,
 					     "invalid address 0x%x, last was 0x%x on line %u",
 					     (guint) addr,
 					     (guint) addr_last,
-					     rcd->ln);
+					     ln);
 				return FALSE;
 			}
 
 			/* parse bytes from line */
-			g_debug ("writing data 0x%08x", (guint32) addr);
 			for (guint i = 9; i < line_end; i += 2) {
 				/* any holes in the hex record */
 				guint32 len_hole = addr - addr_last;
@@ -242,12 +308,12 @@ fu_ihex_firmware_parse (FuFirmware *firmware,
 						     FWUPD_ERROR_INVALID_FILE,
 						     "hole of 0x%x bytes too large to fill on line %u",
 						     (guint) len_hole,
-						     rcd->ln);
+						     ln);
 					return FALSE;
 				}
 				if (addr_last > 0x0 && len_hole > 1) {
 					g_debug ("filling address 0x%08x to 0x%08x on line %u",
-						 addr_last + 1, addr_last + len_hole - 1, rcd->ln);
+						 addr_last + 1, addr_last + len_hole - 1, ln);
 					for (guint j = 1; j < len_hole; j++) {
 						/* although 0xff might be clearer,
 						 * we can't write 0xffff to pic14 */
@@ -273,21 +339,21 @@ fu_ihex_firmware_parse (FuFirmware *firmware,
 			break;
 		case DFU_INHX32_RECORD_TYPE_EXTENDED_LINEAR:
 			abs_addr = fu_firmware_strparse_uint16 (line + 9) << 16;
-			g_debug ("  abs_addr:\t0x%02x on line %u", abs_addr, rcd->ln);
+			g_debug ("  abs_addr:\t0x%02x on line %u", abs_addr, ln);
 			break;
 		case DFU_INHX32_RECORD_TYPE_START_LINEAR:
 			abs_addr = fu_firmware_strparse_uint32 (line + 9);
-			g_debug ("  abs_addr:\t0x%08x on line %u", abs_addr, rcd->ln);
+			g_debug ("  abs_addr:\t0x%08x on line %u", abs_addr, ln);
 			break;
 		case DFU_INHX32_RECORD_TYPE_EXTENDED_SEGMENT:
 			/* segment base address, so ~1Mb addressable */
 			seg_addr = fu_firmware_strparse_uint16 (line + 9) * 16;
-			g_debug ("  seg_addr:\t0x%08x on line %u", seg_addr, rcd->ln);
+			g_debug ("  seg_addr:\t0x%08x on line %u", seg_addr, ln);
 			break;
 		case DFU_INHX32_RECORD_TYPE_START_SEGMENT:
 			/* initial content of the CS:IP registers */
 			seg_addr = fu_firmware_strparse_uint32 (line + 9);
-			g_debug ("  seg_addr:\t0x%02x on line %u", seg_addr, rcd->ln);
+			g_debug ("  seg_addr:\t0x%02x on line %u", seg_addr, ln);
 			break;
 		case DFU_INHX32_RECORD_TYPE_SIGNATURE:
 			for (guint i = 9; i < line_end; i += 2) {
@@ -303,7 +369,7 @@ fu_ihex_firmware_parse (FuFirmware *firmware,
 				     FWUPD_ERROR,
 				     FWUPD_ERROR_INVALID_FILE,
 				     "invalid ihex record type %i on line %u",
-				     record_type, rcd->ln);
+				     record_type, ln);
 			return FALSE;
 		}
 	}
@@ -424,6 +490,8 @@ static void
 fu_ihex_firmware_finalize (GObject *object)
 {
 	FuIhexFirmware *self = FU_IHEX_FIRMWARE (object);
+	if (self->fw != NULL)
+		g_bytes_unref (self->fw);
 	g_ptr_array_unref (self->records);
 	G_OBJECT_CLASS (fu_ihex_firmware_parent_class)->finalize (object);
 }
@@ -0,0 +1,143 @@
+#!/usr/bin/python3
+""" Builds a manifest of what hardware triggers each plugin """
+
+# pylint: disable=invalid-name,wrong-import-position,pointless-string-statement
+
+"""
+SPDX-License-Identifier: LGPL-2.1+
+"""
+
+import os
+import re
+import sys
+import configparser
+
+# plugins implementing any of these have to be loaded at startup as they do
+# work without being handed a device, or act on devices owned by other plugins
+EAGER_VFUNCS = [
+    'fu_plugin_add_security_attrs',
+    'fu_plugin_coldplug',
+    'fu_plugin_coldplug_cleanup',
+    'fu_plugin_coldplug_prepare',
+    'fu_plugin_composite_cleanup',
+    'fu_plugin_composite_prepare',
+    'fu_plugin_device_added',
+    'fu_plugin_device_registered',
+    'fu_plugin_recoldplug',
+    'fu_plugin_startup',
+    'fu_plugin_update_cleanup',
+    'fu_plugin_update_prepare',
+]
+
+
+def usage(return_code):
+    """ print usage and exit with the supplied return code """
+    if return_code == 0:
+        out = sys.stdout
+    else:
+        out = sys.stderr
+    out.write("usage: fu-plugin-manifest.py <MANIFEST> <PLUGINDIR>")
+    sys.exit(return_code)
+
+
+def _add_unique(array, value):
+    if value not in array:
+        array.append(value)
+
+
+def _parse_quirks(fn, triggers):
+    """ find the device instance IDs and GUIDs that reference a plugin """
+    group = None
+    with open(fn, 'r') as f:
+        for line in f.read().split('\n'):
+            line = line.strip()
+            if not line or line.startswith('#'):
+                continue
+            if line.startswith('[') and line.endswith(']'):
+                group = line[1:-1]
+                continue
+            if group is None or '=' not in line:
+                continue
+            key, value = [tmp.strip() for tmp in line.split('=', 1)]
+            if key != 'Plugin':
+                continue
+            for name in value.split(','):
+                _add_unique(triggers.setdefault(name, []), group)
+
+
+def _parse_plugin(dirname, name, plugin):
+    """ scan the plugin sources for the vfuncs, rules and subsystems """
+    for fn in sorted(os.listdir(dirname)):
+        if not fn.endswith('.c'):
+            continue
+
+        # the test plugins share a directory
+        if fn.startswith('fu-plugin-') and fn != 'fu-plugin-%s.c' % name.replace('_', '-'):
+            continue
+        with open(os.path.join(dirname, fn), 'r') as f:
+            data = f.read()
+        for vfunc in re.findall(r'^(fu_plugin_\w+)\s*\(', data, re.MULTILINE):
+            if vfunc in EAGER_VFUNCS:
+                _add_unique(plugin['eager'], vfunc)
+        for subsystem in re.findall(r'fu_plugin_add_udev_subsystem\s*\(\s*plugin\s*,\s*"([^"]+)"', data):
+            _add_unique(plugin['UdevSubsystems'], subsystem)
+        for hwid in re.findall(r'fu_plugin_check_hwid\s*\(\s*plugin\s*,\s*"([^"]+)"', data):
+            _add_unique(plugin['Hwids'], hwid)
+        for kind, dep in re.findall(r'fu_plugin_add_rule\s*\(\s*plugin\s*,\s*FU_PLUGIN_RULE_(\w+)\s*,\s*"([^"]+)"', data):
+            _add_unique(plugin['Rules'], '%s:%s' % (kind.lower().replace('_', '-'), dep))
+        if re.search(r'fu_plugin_add_firmware_gtype\s*\(', data):
+            _add_unique(plugin['eager'], 'fu_plugin_add_firmware_gtype')
+
+
+if __name__ == '__main__':
+    if {'-?', '--help', '--usage'}.intersection(set(sys.argv)):
+        usage(0)
+    if len(sys.argv) != 3:
+        usage(1)
+
+    plugins = {}
+    triggers = {}
+    for subdir in sorted(os.listdir(sys.argv[2])):
+        dirname = os.path.join(sys.argv[2], subdir)
+        if not os.path.isdir(dirname):
+            continue
+        for fn in sorted(os.listdir(dirname)):
+            if fn.endswith('.quirk'):
+                _parse_quirks(os.path.join(dirname, fn), triggers)
+        try:
+            with open(os.path.join(dirname, 'meson.build'), 'r') as f:
+                names = re.findall(r"shared_module\('fu_plugin_(\w+)'", f.read())
+        except FileNotFoundError:
+            continue
+        for name in names:
+            plugin = {'eager': [], 'UdevSubsystems': [], 'Hwids': [], 'Rules': []}
+            _parse_plugin(dirname, name, plugin)
+            plugins[name] = plugin
+
+    # plugins involved in ordering rules have to be present for the depsolve
+    for name in plugins:
+        for rule in plugins[name]['Rules']:
+            dep = rule.split(':', 1)[1]
+            _add_unique(plugins[name]['eager'], 'rule')
+            if dep in plugins:
+                _add_unique(plugins[dep]['eager'], 'rule')
+
+    cfg = configparser.ConfigParser(interpolation=None)
+    cfg.optionxform = str
+    for name in sorted(plugins):
+        plugin = plugins[name]
+        plugin['Quirks'] = triggers.get(name, [])
+        plugin['UsbIds'] = []
+        for group in plugin['Quirks']:
+            match = re.search(r'USB\\VID_([0-9A-F]{4})&PID_([0-9A-F]{4})', group)
+            if match:
+                _add_unique(plugin['UsbIds'], '%s:%s' % (match.group(1).lower(), match.group(2).lower()))
+        cfg[name] = {}
+        cfg[name]['Lazy'] = 'true' if not plugin['eager'] and plugin['Quirks'] else 'false'
+        for key in ['Quirks', 'UsbIds', 'UdevSubsystems', 'Hwids', 'Rules']:
+            if plugin[key]:
+                values = [value.replace('\\', '\\\\') for value in plugin[key]]
+                cfg[name][key] = ';'.join(values) + ';'
+    with open(sys.argv[1], 'w') as f:
+        f.write('# generated by fu-plugin-manifest.py, do not edit\n')
+        cfg.write(f)
@@ -27,10 +27,13 @@ void		 fu_plugin_set_compile_versions		(FuPlugin	*self,
 							 GHashTable	*compile_versions);
 void		 fu_plugin_set_smbios			(FuPlugin	*self,
 							 FuSmbios	*smbios);
+void		 fu_plugin_set_cancellable		(FuPlugin	*self,
+							 GCancellable	*cancellable);
 guint		 fu_plugin_get_order			(FuPlugin	*self);
 void		 fu_plugin_set_order			(FuPlugin	*self,
 							 guint		 order);
 guint		 fu_plugin_get_priority			(FuPlugin	*self);
+gboolean	 fu_plugin_get_coldplug_thread_safe	(FuPlugin	*self);
 void		 fu_plugin_set_priority			(FuPlugin	*self,
 							 guint		 priority);
 void		 fu_plugin_set_name			(FuPlugin	*self,
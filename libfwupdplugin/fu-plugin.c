@@ -40,6 +40,7 @@ typedef struct {
 	gboolean		 enabled;
 	guint			 order;
 	guint			 priority;
+	gboolean		 coldplug_thread_safe;
 	GPtrArray		*rules[FU_PLUGIN_RULE_LAST];
 	gchar			*name;
 	gchar			*build_hash;
@@ -49,6 +50,7 @@ typedef struct {
 	GHashTable		*compile_versions;
 	GPtrArray		*udev_subsystems;
 	FuSmbios		*smbios;
+	GCancellable		*cancellable;		/* (nullable) */
 	GType			 device_gtype;
 	GHashTable		*devices;		/* (nullable): platform_id:GObject */
 	GRWLock			 devices_mutex;
@@ -976,6 +978,23 @@ fu_plugin_set_smbios (FuPlugin *self, FuSmbios *smbios)
 	g_set_object (&priv->smbios, smbios);
 }
 
+/**
+ * fu_plugin_set_cancellable:
+ * @self: A #FuPlugin
+ * @cancellable: (nullable): A #GCancellable, or %NULL
+ *
+ * Sets the cancellable used when writing firmware to devices that have
+ * %FWUPD_DEVICE_FLAG_THREADED_WRITE set.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_plugin_set_cancellable (FuPlugin *self, GCancellable *cancellable)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (self);
+	g_set_object (&priv->cancellable, cancellable);
+}
+
 /**
  * fu_plugin_set_coldplug_delay:
  * @self: A #FuPlugin
@@ -1043,6 +1062,47 @@ fu_plugin_device_activate (FuPlugin *self, FuDevice *device, GError **error)
 	return fu_device_activate (device, error);
 }
 
+typedef struct {
+	GMainLoop	*loop;
+	GError		*error;
+	gboolean	 ret;
+} FuPluginWriteHelper;
+
+static void
+fu_plugin_device_write_firmware_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	FuPluginWriteHelper *helper = (FuPluginWriteHelper *) user_data;
+	helper->ret = fu_device_write_firmware_finish (FU_DEVICE (source), res, &helper->error);
+	g_main_loop_quit (helper->loop);
+}
+
+/* keeps the main loop running while the device is written in a worker thread */
+static gboolean
+fu_plugin_device_write_firmware_threaded (FuPlugin *self,
+					  FuDevice *device,
+					  GBytes *fw,
+					  FwupdInstallFlags flags,
+					  GError **error)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (self);
+	g_autoptr(GMainContext) context = g_main_context_ref_thread_default ();
+	g_autoptr(GMainLoop) loop = g_main_loop_new (context, FALSE);
+	FuPluginWriteHelper helper = {
+		.loop = loop,
+		.error = NULL,
+		.ret = FALSE,
+	};
+	fu_device_write_firmware_async (device, fw, flags, priv->cancellable,
+					fu_plugin_device_write_firmware_cb,
+					&helper);
+	g_main_loop_run (loop);
+	if (!helper.ret) {
+		g_propagate_error (error, helper.error);
+		return FALSE;
+	}
+	return TRUE;
+}
+
 static gboolean
 fu_plugin_device_write_firmware (FuPlugin *self, FuDevice *device,
 				 GBytes *fw, FwupdInstallFlags flags,
@@ -1052,6 +1112,8 @@ fu_plugin_device_write_firmware (FuPlugin *self, FuDevice *device,
 	locker = fu_device_locker_new (device, error);
 	if (locker == NULL)
 		return FALSE;
+	if (fu_device_has_flag (device, FWUPD_DEVICE_FLAG_THREADED_WRITE))
+		return fu_plugin_device_write_firmware_threaded (self, device, fw, flags, error);
 	return fu_device_write_firmware (device, fw, flags, error);
 }
 
@@ -2491,6 +2553,47 @@ fu_plugin_set_priority (FuPlugin *self, guint priority)
 	priv->priority = priority;
 }
 
+/**
+ * fu_plugin_get_coldplug_thread_safe:
+ * @self: a #FuPlugin
+ *
+ * Gets if the plugin can be coldplugged in a worker thread.
+ *
+ * Returns: %TRUE if fu_plugin_set_coldplug_thread_safe() was used
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_plugin_get_coldplug_thread_safe (FuPlugin *self)
+{
+	FuPluginPrivate *priv = fu_plugin_get_instance_private (self);
+	return priv->coldplug_thread_safe;
+}
+
+/**
+ * fu_plugin_set_coldplug_thread_safe:
+ * @self: a #FuPlugin
+ * @coldplug_thread_safe: a boolean
+ *
+ * Allows the daemon to run fu_plugin_coldplug() in a worker thread at the same
+ * time as other plugins when ConcurrentColdplug is enabled.
+ *
+ * Only set this if the coldplug vfunc only uses state owned by the plugin, for
+ * instance a client object created in fu_plugin_startup(). The plugin cache,
+ * the #GUsbContext and any udev objects are shared with the main thread and
+ * must not be used. Emitting signals using functions like
+ * fu_plugin_device_add() is safe.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_plugin_set_coldplug_thread_safe (FuPlugin *self, gboolean coldplug_thread_safe)
+{
+	FuPluginPrivate *priv = fu_plugin_get_instance_private (self);
+	g_return_if_fail (FU_IS_PLUGIN (self));
+	priv->coldplug_thread_safe = coldplug_thread_safe;
+}
+
 /**
  * fu_plugin_add_rule:
  * @self: a #FuPlugin
@@ -2799,6 +2902,8 @@ fu_plugin_finalize (GObject *object)
 		g_ptr_array_unref (priv->udev_subsystems);
 	if (priv->smbios != NULL)
 		g_object_unref (priv->smbios);
+	if (priv->cancellable != NULL)
+		g_object_unref (priv->cancellable);
 	if (priv->runtime_versions != NULL)
 		g_hash_table_unref (priv->runtime_versions);
 	if (priv->compile_versions != NULL)
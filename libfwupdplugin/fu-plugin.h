@@ -112,6 +112,8 @@ void		 fu_plugin_request_recoldplug		(FuPlugin	*self);
 void		 fu_plugin_security_changed		(FuPlugin	*self);
 void		 fu_plugin_set_coldplug_delay		(FuPlugin	*self,
 							 guint		 duration);
+void		 fu_plugin_set_coldplug_thread_safe	(FuPlugin	*self,
+							 gboolean	 coldplug_thread_safe);
 void		 fu_plugin_set_device_gtype		(FuPlugin	*self,
 							 GType		 device_gtype);
 void		 fu_plugin_add_firmware_gtype		(FuPlugin	*self,
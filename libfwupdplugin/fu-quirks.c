@@ -53,10 +53,32 @@ struct _FuQuirks
 	GObject			 parent_instance;
 	FuQuirksLoadFlags	 load_flags;
 	XbSilo			*silo;
+	XbQuery			*query;		/* (nullable): prepared for silo */
+	GHashTable		*cache;		/* group:FuQuirksCacheGroup */
+	GMutex			 mutex;		/* for silo, query and cache */
+	guint			 cache_hits;
+	guint			 cache_misses;
 };
 
+/* all the key-values of the group in the silo, or none if the group is
+ * not in the silo -- the strings are owned by the silo */
+typedef struct {
+	GPtrArray		*keys;		/* in silo order, may have duplicates */
+	GPtrArray		*values;
+	GHashTable		*values_hash;	/* key:value, first value wins */
+} FuQuirksCacheGroup;
+
 G_DEFINE_TYPE (FuQuirks, fu_quirks, G_TYPE_OBJECT)
 
+static void
+fu_quirks_cache_group_free (FuQuirksCacheGroup *cache_group)
+{
+	g_ptr_array_unref (cache_group->keys);
+	g_ptr_array_unref (cache_group->values);
+	g_hash_table_unref (cache_group->values_hash);
+	g_free (cache_group);
+}
+
 static gchar *
 fu_quirks_build_group_key (const gchar *group)
 {
@@ -214,6 +236,10 @@ fu_quirks_check_silo (FuQuirks *self, GError **error)
 	if (self->silo != NULL && xb_silo_is_valid (self->silo))
 		return TRUE;
 
+	/* anything cached refers to the old silo */
+	g_hash_table_remove_all (self->cache);
+	g_clear_object (&self->query);
+
 	/* system datadir */
 	builder = xb_builder_new ();
 	datadir = fu_common_get_path (FU_PATH_KIND_DATADIR_PKG);
@@ -240,6 +266,81 @@ fu_quirks_check_silo (FuQuirks *self, GError **error)
 	return self->silo != NULL;
 }
 
+/* returns all the key-values for the group using a single silo query, with
+ * the result cached until the silo is invalidated -- most lookups are for
+ * groups that do not exist in the silo at all */
+static FuQuirksCacheGroup *
+fu_quirks_lookup_cache_group (FuQuirks *self, const gchar *group)
+{
+	FuQuirksCacheGroup *cache_group;
+	g_autofree gchar *group_key = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) results = NULL;
+
+	/* ensure up to date */
+	if (!fu_quirks_check_silo (self, &error)) {
+		g_warning ("failed to build silo: %s", error->message);
+		return NULL;
+	}
+
+	/* already looked up */
+	cache_group = g_hash_table_lookup (self->cache, group);
+	if (cache_group != NULL) {
+		self->cache_hits++;
+		return cache_group;
+	}
+	self->cache_misses++;
+
+	/* the query is only compiled once for each silo */
+	if (self->query == NULL) {
+		self->query = xb_query_new_full (self->silo,
+						 "quirk/device[@id=?]/value",
+						 XB_QUERY_FLAG_NONE,
+						 &error);
+		if (self->query == NULL) {
+			if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
+				return NULL;
+			if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT))
+				return NULL;
+			g_warning ("failed to build query: %s", error->message);
+			return NULL;
+		}
+	}
+
+	/* query */
+	group_key = fu_quirks_build_group_key (group);
+	if (!xb_query_bind_str (self->query, 0, group_key, &error)) {
+		g_warning ("failed to bind 0: %s", error->message);
+		return NULL;
+	}
+	results = xb_silo_query_full (self->silo, self->query, &error);
+	if (results == NULL &&
+	    !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND) &&
+	    !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT)) {
+		g_warning ("failed to query: %s", error->message);
+		return NULL;
+	}
+
+	/* add to cache, even if there were no results */
+	cache_group = g_new0 (FuQuirksCacheGroup, 1);
+	cache_group->keys = g_ptr_array_new ();
+	cache_group->values = g_ptr_array_new ();
+	cache_group->values_hash = g_hash_table_new (g_str_hash, g_str_equal);
+	for (guint i = 0; results != NULL && i < results->len; i++) {
+		XbNode *n = g_ptr_array_index (results, i);
+		const gchar *key = xb_node_get_attr (n, "key");
+		const gchar *value = xb_node_get_text (n);
+		if (key == NULL)
+			continue;
+		g_ptr_array_add (cache_group->keys, (gpointer) key);
+		g_ptr_array_add (cache_group->values, (gpointer) value);
+		if (!g_hash_table_contains (cache_group->values_hash, key))
+			g_hash_table_insert (cache_group->values_hash, (gpointer) key, (gpointer) value);
+	}
+	g_hash_table_insert (self->cache, g_strdup (group), cache_group);
+	return cache_group;
+}
+
 /**
  * fu_quirks_lookup_by_id:
  * @self: A #FuPlugin
@@ -255,53 +356,18 @@ fu_quirks_check_silo (FuQuirks *self, GError **error)
 const gchar *
 fu_quirks_lookup_by_id (FuQuirks *self, const gchar *group, const gchar *key)
 {
-	g_autofree gchar *group_key = NULL;
-	g_autoptr(GError) error = NULL;
-	g_autoptr(XbNode) n = NULL;
-	g_autoptr(XbQuery) query = NULL;
+	FuQuirksCacheGroup *cache_group;
+	g_autoptr(GMutexLocker) locker = NULL;
 
 	g_return_val_if_fail (FU_IS_QUIRKS (self), NULL);
 	g_return_val_if_fail (group != NULL, NULL);
 	g_return_val_if_fail (key != NULL, NULL);
 
-	/* ensure up to date */
-	if (!fu_quirks_check_silo (self, &error)) {
-		g_warning ("failed to build silo: %s", error->message);
-		return NULL;
-	}
-
-	/* query */
-	group_key = fu_quirks_build_group_key (group);
-	query = xb_query_new_full (self->silo,
-				   "quirk/device[@id=?]/value[@key=?]",
-				   XB_QUERY_FLAG_NONE,
-				   &error);
-	if (query == NULL) {
-		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
-			return NULL;
-		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT))
-			return NULL;
-		g_warning ("failed to build query: %s", error->message);
+	locker = g_mutex_locker_new (&self->mutex);
+	cache_group = fu_quirks_lookup_cache_group (self, group);
+	if (cache_group == NULL)
 		return NULL;
-	}
-	if (!xb_query_bind_str (query, 0, group_key, &error)) {
-		g_warning ("failed to bind 0: %s", error->message);
-		return NULL;
-	}
-	if (!xb_query_bind_str (query, 1, key, &error)) {
-		g_warning ("failed to bind 1: %s", error->message);
-		return NULL;
-	}
-	n = xb_silo_query_first_full (self->silo, query, &error);
-	if (n == NULL) {
-		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
-			return NULL;
-		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT))
-			return NULL;
-		g_warning ("failed to query: %s", error->message);
-		return NULL;
-	}
-	return xb_node_get_text (n);
+	return g_hash_table_lookup (cache_group->values_hash, key);
 }
 
 /**
@@ -321,58 +387,67 @@ gboolean
 fu_quirks_lookup_by_id_iter (FuQuirks *self, const gchar *group,
 			     FuQuirksIter iter_cb, gpointer user_data)
 {
-	g_autofree gchar *group_key = NULL;
-	g_autoptr(GError) error = NULL;
-	g_autoptr(GPtrArray) results = NULL;
-	g_autoptr(XbQuery) query = NULL;
+	FuQuirksCacheGroup *cache_group;
+	g_autoptr(GPtrArray) keys = NULL;
+	g_autoptr(GPtrArray) values = NULL;
 
 	g_return_val_if_fail (FU_IS_QUIRKS (self), FALSE);
 	g_return_val_if_fail (group != NULL, FALSE);
 	g_return_val_if_fail (iter_cb != NULL, FALSE);
 
-	/* ensure up to date */
-	if (!fu_quirks_check_silo (self, &error)) {
-		g_warning ("failed to build silo: %s", error->message);
-		return FALSE;
-	}
-
-	/* query */
-	group_key = fu_quirks_build_group_key (group);
-	query = xb_query_new_full (self->silo,
-				   "quirk/device[@id=?]/value",
-				   XB_QUERY_FLAG_NONE,
-				   &error);
-	if (query == NULL) {
-		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
-			return FALSE;
-		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT))
-			return FALSE;
-		g_warning ("failed to build query: %s", error->message);
-		return FALSE;
-	}
-	if (!xb_query_bind_str (query, 0, group_key, &error)) {
-		g_warning ("failed to bind 0: %s", error->message);
-		return FALSE;
+	/* the callback may look up other quirks, so do not hold the lock */
+	g_mutex_lock (&self->mutex);
+	cache_group = fu_quirks_lookup_cache_group (self, group);
+	if (cache_group != NULL && cache_group->keys->len > 0) {
+		keys = g_ptr_array_ref (cache_group->keys);
+		values = g_ptr_array_ref (cache_group->values);
 	}
-	results = xb_silo_query_full (self->silo, query, &error);
-	if (results == NULL) {
-		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
-			return FALSE;
-		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT))
-			return FALSE;
-		g_warning ("failed to query: %s", error->message);
+	g_mutex_unlock (&self->mutex);
+	if (keys == NULL)
 		return FALSE;
-	}
-	for (guint i = 0; i < results->len; i++) {
-		XbNode *n = g_ptr_array_index (results, i);
+	for (guint i = 0; i < keys->len; i++) {
 		iter_cb (self,
-			 xb_node_get_attr (n, "key"),
-			 xb_node_get_text (n),
+			 g_ptr_array_index (keys, i),
+			 g_ptr_array_index (values, i),
 			 user_data);
 	}
 	return TRUE;
 }
 
+/**
+ * fu_quirks_get_cache_hits:
+ * @self: A #FuQuirks
+ *
+ * Gets the number of lookups that did not require a query of the silo.
+ *
+ * Returns: integer
+ *
+ * Since: 1.5.0
+ **/
+guint
+fu_quirks_get_cache_hits (FuQuirks *self)
+{
+	g_return_val_if_fail (FU_IS_QUIRKS (self), 0);
+	return self->cache_hits;
+}
+
+/**
+ * fu_quirks_get_cache_misses:
+ * @self: A #FuQuirks
+ *
+ * Gets the number of lookups that required a query of the silo.
+ *
+ * Returns: integer
+ *
+ * Since: 1.5.0
+ **/
+guint
+fu_quirks_get_cache_misses (FuQuirks *self)
+{
+	g_return_val_if_fail (FU_IS_QUIRKS (self), 0);
+	return self->cache_misses;
+}
+
 /**
  * fu_quirks_load: (skip)
  * @self: A #FuQuirks
@@ -388,7 +463,9 @@ fu_quirks_lookup_by_id_iter (FuQuirks *self, const gchar *group,
 gboolean
 fu_quirks_load (FuQuirks *self, FuQuirksLoadFlags load_flags, GError **error)
 {
+	g_autoptr(GMutexLocker) locker = NULL;
 	g_return_val_if_fail (FU_IS_QUIRKS (self), FALSE);
+	locker = g_mutex_locker_new (&self->mutex);
 	self->load_flags = load_flags;
 	return fu_quirks_check_silo (self, error);
 }
@@ -403,14 +480,21 @@ fu_quirks_class_init (FuQuirksClass *klass)
 static void
 fu_quirks_init (FuQuirks *self)
 {
+	self->cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+					     (GDestroyNotify) fu_quirks_cache_group_free);
+	g_mutex_init (&self->mutex);
 }
 
 static void
 fu_quirks_finalize (GObject *obj)
 {
 	FuQuirks *self = FU_QUIRKS (obj);
+	g_hash_table_unref (self->cache);
+	if (self->query != NULL)
+		g_object_unref (self->query);
 	if (self->silo != NULL)
 		g_object_unref (self->silo);
+	g_mutex_clear (&self->mutex);
 	G_OBJECT_CLASS (fu_quirks_parent_class)->finalize (obj);
 }
 
@@ -12,7 +12,9 @@
 #include <libgcab.h>
 #include <glib/gstdio.h>
 
+#include "fu-cabinet.h"
 #include "fu-device-private.h"
+#include "fu-hwids-private.h"
 #include "fu-plugin-private.h"
 #include "fu-security-attrs-private.h"
 #include "fu-smbios-private.h"
@@ -107,6 +109,109 @@ fu_archive_cab_func (void)
 	g_assert_null (data_tmp);
 }
 
+static void
+fu_archive_lazy_func (void)
+{
+	GBytes *data_tmp;
+	g_autofree gchar *checksum1 = NULL;
+	g_autofree gchar *checksum2 = NULL;
+	g_autofree gchar *filename = NULL;
+	g_autoptr(FuArchive) archive = NULL;
+	g_autoptr(GBytes) data = NULL;
+	g_autoptr(GError) error = NULL;
+
+	filename = g_build_filename (TESTDATADIR_DST, "colorhug", "colorhug-als-3.0.2.cab", NULL);
+	data = fu_common_get_contents_bytes (filename, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (data);
+
+	archive = fu_archive_new (data, FU_ARCHIVE_FLAG_LAZY, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (archive);
+
+	/* only keep the most recent blob */
+	fu_archive_set_cache_size_max (archive, 1);
+	data_tmp = fu_archive_lookup_by_fn (archive, "firmware.metainfo.xml", &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (data_tmp);
+	checksum1 = g_compute_checksum_for_bytes (G_CHECKSUM_SHA1, data_tmp);
+	g_assert_cmpstr (checksum1, ==, "8611114f51f7151f190de86a5c9259d79ff34216");
+	data_tmp = fu_archive_lookup_by_fn (archive, "firmware.bin", &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (data_tmp);
+	checksum2 = g_compute_checksum_for_bytes (G_CHECKSUM_SHA1, data_tmp);
+	g_assert_cmpstr (checksum2, ==, "7c0ae84b191822bcadbdcbe2f74a011695d783c7");
+
+	/* decompressed again */
+	data_tmp = fu_archive_lookup_by_fn (archive, "firmware.metainfo.xml", &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (data_tmp);
+	g_free (checksum1);
+	checksum1 = g_compute_checksum_for_bytes (G_CHECKSUM_SHA1, data_tmp);
+	g_assert_cmpstr (checksum1, ==, "8611114f51f7151f190de86a5c9259d79ff34216");
+	data_tmp = fu_archive_lookup_by_fn (archive, "firmware.bin", &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (data_tmp);
+	g_free (checksum2);
+	checksum2 = g_compute_checksum_for_bytes (G_CHECKSUM_SHA1, data_tmp);
+	g_assert_cmpstr (checksum2, ==, "7c0ae84b191822bcadbdcbe2f74a011695d783c7");
+
+	data_tmp = fu_archive_lookup_by_fn (archive, "NOTGOINGTOEXIST.xml", &error);
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
+	g_assert_null (data_tmp);
+}
+
+static GBytes *
+_build_tar (const gchar *fn, const gchar *text)
+{
+	gsize textsz = strlen (text);
+	gsize bufsz = 512 + ((textsz + 511) / 512) * 512 + 1024;
+	guint csum = 0;
+	guint8 *buf = g_malloc0 (bufsz);
+
+	/* ustar header, with the checksum field as spaces for the checksum */
+	g_strlcpy ((gchar *) buf, fn, 100);
+	g_snprintf ((gchar *) buf + 100, 8, "%07o", 0644u);
+	g_snprintf ((gchar *) buf + 108, 8, "%07o", 0u);
+	g_snprintf ((gchar *) buf + 116, 8, "%07o", 0u);
+	g_snprintf ((gchar *) buf + 124, 12, "%011o", (guint) textsz);
+	g_snprintf ((gchar *) buf + 136, 12, "%011o", 0u);
+	memset (buf + 148, ' ', 8);
+	buf[156] = '0';
+	memcpy (buf + 257, "ustar\0" "00", 8);
+	for (guint i = 0; i < 512; i++)
+		csum += buf[i];
+	g_snprintf ((gchar *) buf + 148, 8, "%06o", csum);
+	memcpy (buf + 512, text, textsz);
+	return g_bytes_new_take (buf, bufsz);
+}
+
+static void
+fu_archive_lazy_tar_func (void)
+{
+	GBytes *data_tmp;
+	const guint8 *buf;
+	g_autoptr(FuArchive) archive = NULL;
+	g_autoptr(GBytes) data = _build_tar ("dir/firmware.bin", "hello world");
+	g_autoptr(GError) error = NULL;
+
+	archive = fu_archive_new (data,
+				  FU_ARCHIVE_FLAG_IGNORE_PATH |
+				  FU_ARCHIVE_FLAG_LAZY,
+				  &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (archive);
+	data_tmp = fu_archive_lookup_by_fn (archive, "firmware.bin", &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (data_tmp);
+	g_assert_cmpint (g_bytes_get_size (data_tmp), ==, 11);
+
+	/* not copied */
+	buf = g_bytes_get_data (data, NULL);
+	g_assert (g_bytes_get_data (data_tmp, NULL) == buf + 512);
+	g_assert (memcmp (g_bytes_get_data (data_tmp, NULL), "hello world", 11) == 0);
+}
+
 static void
 fu_common_string_append_kv_func (void)
 {
@@ -270,8 +375,12 @@ static void
 fu_hwids_func (void)
 {
 	g_autoptr(FuHwids) hwids = NULL;
+	g_autoptr(FuHwids) hwids2 = NULL;
 	g_autoptr(FuSmbios) smbios = NULL;
+	g_autoptr(FuSmbios) smbios2 = NULL;
 	g_autoptr(GError) error = NULL;
+	g_autoptr(GVariant) value_hwids = NULL;
+	g_autoptr(GVariant) value_smbios = NULL;
 	gboolean ret;
 
 	struct {
@@ -330,6 +439,28 @@ fu_hwids_func (void)
 	}
 	for (guint i = 0; guids[i].key != NULL; i++)
 		g_assert (fu_hwids_has_guid (hwids, guids[i].value));
+
+	/* restore from a snapshot without parsing the tables */
+	value_smbios = g_variant_ref_sink (fu_smbios_to_variant (smbios));
+	value_hwids = g_variant_ref_sink (fu_hwids_to_variant (hwids));
+	smbios2 = fu_smbios_new ();
+	ret = fu_smbios_setup_from_variant (smbios2, value_smbios, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpstr (fu_smbios_get_string (smbios2, FU_SMBIOS_STRUCTURE_TYPE_BIOS, 0x04, NULL), ==,
+			 fu_smbios_get_string (smbios, FU_SMBIOS_STRUCTURE_TYPE_BIOS, 0x04, NULL));
+	hwids2 = fu_hwids_new ();
+	ret = fu_hwids_setup_from_variant (hwids2, value_hwids, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpstr (fu_hwids_get_value (hwids2, FU_HWIDS_KEY_FAMILY), ==,
+			 "ThinkPad T440s");
+	g_assert_cmpint (fu_hwids_get_guids (hwids2)->len, ==, fu_hwids_get_guids (hwids)->len);
+	for (guint i = 0; guids[i].key != NULL; i++)
+		g_assert (fu_hwids_has_guid (hwids2, guids[i].value));
+	ret = fu_hwids_setup_from_variant (hwids2, value_smbios, &error);
+	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_INVALID_FILE);
+	g_assert (!ret);
 }
 
 static void
@@ -375,6 +506,7 @@ fu_plugin_quirks_func (void)
 {
 	const gchar *tmp;
 	gboolean ret;
+	guint cache_misses;
 	g_autoptr(FuQuirks) quirks = fu_quirks_new ();
 	g_autoptr(FuPlugin) plugin = fu_plugin_new ();
 	g_autoptr(GError) error = NULL;
@@ -399,6 +531,15 @@ fu_plugin_quirks_func (void)
 	g_assert_cmpstr (tmp, ==, NULL);
 	tmp = fu_plugin_lookup_quirk_by_id (plugin, "bb9ec3e2-77b3-53bc-a1f1-b05916715627", "Flags");
 	g_assert_cmpstr (tmp, ==, "clever");
+
+	/* the silo is only queried once for each group */
+	cache_misses = fu_quirks_get_cache_misses (quirks);
+	tmp = fu_plugin_lookup_quirk_by_id (plugin, "unfound", "other");
+	g_assert_cmpstr (tmp, ==, NULL);
+	tmp = fu_plugin_lookup_quirk_by_id (plugin, "USB\\VID_0A5C&PID_6412", "Flags");
+	g_assert_cmpstr (tmp, ==, "ignore-runtime");
+	g_assert_cmpint (fu_quirks_get_cache_misses (quirks), ==, cache_misses);
+	g_assert_cmpint (fu_quirks_get_cache_hits (quirks), >=, 2);
 }
 
 static void
@@ -423,7 +564,10 @@ fu_plugin_quirks_performance_func (void)
 			g_assert_cmpstr (tmp, !=, NULL);
 		}
 	}
-	g_print ("lookup=%.3fms ", g_timer_elapsed (timer, NULL) * 1000.f);
+	g_print ("lookup=%.3fms hits=%u misses=%u ",
+		 g_timer_elapsed (timer, NULL) * 1000.f,
+		 fu_quirks_get_cache_hits (quirks),
+		 fu_quirks_get_cache_misses (quirks));
 }
 
 static void
@@ -981,6 +1125,81 @@ fu_common_store_cab_error_wrong_checksum_func (void)
 	g_assert_null (silo);
 }
 
+static void
+fu_common_store_cab_stream_func (void)
+{
+	GBytes *blob_tmp;
+	gboolean ret;
+	const gchar *fn;
+	g_autofree gchar *cachedir = fu_common_get_path (FU_PATH_KIND_CACHEDIR_PKG);
+	g_autofree gchar *csum_container = NULL;
+	g_autoptr(FuCabinet) cabinet = fu_cabinet_new ();
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GDir) dir = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GInputStream) stream = NULL;
+	g_autoptr(GPtrArray) rels = NULL;
+	g_autoptr(XbNode) csum = NULL;
+	g_autoptr(XbSilo) silo = NULL;
+
+	/* two payloads in one folder, and one that is never used */
+	blob = _build_cab (GCAB_COMPRESSION_MSZIP,
+			   "acme.metainfo.xml",
+	"<component type=\"firmware\">\n"
+	"  <id>com.acme.example.firmware</id>\n"
+	"  <releases>\n"
+	"    <release version=\"1.2.4\">\n"
+	"      <checksum filename=\"firmware-new.dfu\" target=\"content\"/>\n"
+	"    </release>\n"
+	"    <release version=\"1.2.3\">\n"
+	"      <size type=\"installed\">5</size>\n"
+	"      <checksum filename=\"firmware.dfu\" target=\"content\" type=\"sha1\">7c211433f02071597741e6ff5a8ea34789abbf43</checksum>\n"
+	"    </release>\n"
+	"  </releases>\n"
+	"</component>",
+			   "firmware.dfu", "world",
+			   "firmware-new.dfu", "hello world",
+			   "unused.bin", "unused",
+			   NULL);
+	stream = g_memory_input_stream_new_from_bytes (blob);
+	fu_cabinet_set_size_max (cabinet, 10240);
+	ret = fu_cabinet_parse_stream (cabinet, stream, FU_CABINET_PARSE_FLAG_NONE, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	silo = fu_cabinet_get_silo (cabinet);
+	g_assert_nonnull (silo);
+
+	/* the payloads were extracted from the right place */
+	rels = xb_silo_query (silo, "components/component/releases/release", 0, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (rels);
+	g_assert_cmpint (rels->len, ==, 2);
+	blob_tmp = xb_node_get_data (g_ptr_array_index (rels, 0), "fwupd::FirmwareBlob");
+	g_assert_nonnull (blob_tmp);
+	g_assert_cmpint (g_bytes_get_size (blob_tmp), ==, 11);
+	g_assert (memcmp (g_bytes_get_data (blob_tmp, NULL), "hello world", 11) == 0);
+	blob_tmp = xb_node_get_data (g_ptr_array_index (rels, 1), "fwupd::FirmwareBlob");
+	g_assert_nonnull (blob_tmp);
+	g_assert_cmpint (g_bytes_get_size (blob_tmp), ==, 5);
+	g_assert (memcmp (g_bytes_get_data (blob_tmp, NULL), "world", 5) == 0);
+
+	/* the incremental checksum matches the one-shot version */
+	csum_container = g_compute_checksum_for_bytes (G_CHECKSUM_SHA1, blob);
+	csum = xb_node_query_first (g_ptr_array_index (rels, 0),
+				    "checksum[@target='container']", &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (csum);
+	g_assert_cmpstr (xb_node_get_text (csum), ==, csum_container);
+
+	/* the extracted payloads are all removed, even if unused */
+	g_clear_object (&cabinet);
+	dir = g_dir_open (cachedir, 0, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (dir);
+	while ((fn = g_dir_read_name (dir)) != NULL)
+		g_assert_false (g_str_has_prefix (fn, "cabinet-"));
+}
+
 static gboolean
 fu_device_poll_cb (FuDevice *device, GError **error)
 {
@@ -1013,6 +1232,140 @@ fu_device_poll_func (void)
 	g_assert_cmpint (fu_device_get_metadata_integer (device, "cnt"), ==, cnt);
 }
 
+#define FU_TYPE_TEST_WRITE_DEVICE (fu_test_write_device_get_type ())
+G_DECLARE_FINAL_TYPE (FuTestWriteDevice, fu_test_write_device, FU, TEST_WRITE_DEVICE, FuDevice)
+
+struct _FuTestWriteDevice {
+	FuDevice		 parent_instance;
+	GThread			*thread_main;
+	gboolean		 wait_for_cancel;
+};
+
+G_DEFINE_TYPE (FuTestWriteDevice, fu_test_write_device, FU_TYPE_DEVICE)
+
+/* runs until the main thread cancels it when the first progress is seen */
+static gboolean
+fu_test_write_device_wait_for_cancel (FuDevice *device, GError **error)
+{
+	fu_device_set_progress (device, 10);
+	for (guint i = 0; i < 5000; i++) {
+		if (g_cancellable_set_error_if_cancelled (fu_device_get_cancellable (device), error))
+			return FALSE;
+		g_usleep (1000);
+	}
+	fu_device_set_progress (device, 100);
+	return TRUE;
+}
+
+static gboolean
+fu_test_write_device_write_firmware (FuDevice *device,
+				     FuFirmware *firmware,
+				     FwupdInstallFlags flags,
+				     GError **error)
+{
+	FuTestWriteDevice *self = FU_TEST_WRITE_DEVICE (device);
+	g_assert (g_thread_self () != self->thread_main);
+	if (self->wait_for_cancel)
+		return fu_test_write_device_wait_for_cancel (device, error);
+	fu_device_set_status (device, FWUPD_STATUS_DEVICE_WRITE);
+	fu_device_set_progress (device, 50);
+	fu_device_set_progress (device, 100);
+	fu_device_add_flag (device, FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG);
+	return TRUE;
+}
+
+static void
+fu_test_write_device_init (FuTestWriteDevice *self)
+{
+	self->thread_main = g_thread_self ();
+}
+
+static void
+fu_test_write_device_class_init (FuTestWriteDeviceClass *klass)
+{
+	FuDeviceClass *klass_device = FU_DEVICE_CLASS (klass);
+	klass_device->write_firmware = fu_test_write_device_write_firmware;
+}
+
+static void
+fu_device_write_firmware_cancel_notify_cb (FuDevice *device, GParamSpec *pspec, gpointer user_data)
+{
+	GCancellable *cancellable = G_CANCELLABLE (user_data);
+	if (fu_device_get_progress (device) == 10)
+		g_cancellable_cancel (cancellable);
+}
+
+static void
+fu_device_write_firmware_notify_cb (FuDevice *device, GParamSpec *pspec, gpointer user_data)
+{
+	guint *cnt = (guint *) user_data;
+	g_assert (g_thread_self () == FU_TEST_WRITE_DEVICE (device)->thread_main);
+	(*cnt)++;
+}
+
+static void
+fu_device_write_firmware_async_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	GError **error = (GError **) user_data;
+	fu_device_write_firmware_finish (FU_DEVICE (source), res, error);
+	fu_test_loop_quit ();
+}
+
+static void
+fu_device_write_firmware_async_func (void)
+{
+	guint cnt = 0;
+	g_autoptr(FuDevice) device = fu_device_new ();
+	g_autoptr(FuTestWriteDevice) device_test = g_object_new (FU_TYPE_TEST_WRITE_DEVICE, NULL);
+	g_autoptr(GBytes) fw = g_bytes_new_static ("hello", 5);
+	g_autoptr(GCancellable) cancellable = g_cancellable_new ();
+	g_autoptr(GError) error = NULL;
+
+	/* not supported */
+	fu_device_write_firmware_async (device, fw, FWUPD_INSTALL_FLAG_NONE, NULL,
+					fu_device_write_firmware_async_cb, &error);
+	fu_test_loop_run_with_timeout (1000);
+	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_NOT_SUPPORTED);
+	g_clear_error (&error);
+
+	/* progress, status and flags are set and emitted in the main thread */
+	g_signal_connect (device_test, "notify::progress",
+			  G_CALLBACK (fu_device_write_firmware_notify_cb), &cnt);
+	fu_device_write_firmware_async (FU_DEVICE (device_test), fw,
+					FWUPD_INSTALL_FLAG_NONE, NULL,
+					fu_device_write_firmware_async_cb, &error);
+	fu_test_loop_run_with_timeout (1000);
+	g_assert_no_error (error);
+	g_assert_cmpint (fu_device_get_progress (FU_DEVICE (device_test)), ==, 100);
+	g_assert_cmpint (fu_device_get_status (FU_DEVICE (device_test)), ==, FWUPD_STATUS_DEVICE_WRITE);
+	g_assert_true (fu_device_has_flag (FU_DEVICE (device_test), FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG));
+	g_assert_cmpint (cnt, ==, 2);
+
+	/* cancelled before starting */
+	g_cancellable_cancel (cancellable);
+	fu_device_write_firmware_async (FU_DEVICE (device_test), fw,
+					FWUPD_INSTALL_FLAG_NONE, cancellable,
+					fu_device_write_firmware_async_cb, &error);
+	fu_test_loop_run_with_timeout (1000);
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+	g_assert_cmpint (cnt, ==, 2);
+	g_clear_error (&error);
+
+	/* cancelled while writing */
+	g_cancellable_reset (cancellable);
+	device_test->wait_for_cancel = TRUE;
+	g_signal_connect (device_test, "notify::progress",
+			  G_CALLBACK (fu_device_write_firmware_cancel_notify_cb),
+			  cancellable);
+	fu_device_write_firmware_async (FU_DEVICE (device_test), fw,
+					FWUPD_INSTALL_FLAG_NONE, cancellable,
+					fu_device_write_firmware_async_cb, &error);
+	fu_test_loop_run_with_timeout (3000);
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+	g_assert_cmpint (fu_device_get_progress (FU_DEVICE (device_test)), ==, 10);
+	g_assert_null (fu_device_get_cancellable (FU_DEVICE (device_test)));
+}
+
 static void
 fu_device_flags_func (void)
 {
@@ -1148,6 +1501,129 @@ fu_chunk_func (void)
 					   "#05: page:02 addr:0004 len:02 ZZ\n");
 }
 
+typedef struct {
+	guint32 idx;
+	guint32 page;
+	guint32 address;
+	guint32 data_sz;
+	guint32 offset;
+} FuChunkIterExpected;
+
+static void
+fu_chunk_iter_check (const guint8 *buf,
+		     guint32 bufsz,
+		     guint32 addr_start,
+		     guint32 page_sz,
+		     guint32 packet_sz,
+		     const FuChunkIterExpected *expected,
+		     guint expected_sz)
+{
+	FuChunk chk;
+	FuChunkIter iter;
+	guint idx = 0;
+
+	fu_chunk_iter_init (&iter, buf, bufsz, addr_start, page_sz, packet_sz);
+	g_assert_cmpint (fu_chunk_iter_get_count (&iter), ==, expected_sz);
+	while (fu_chunk_iter_next (&iter, &chk)) {
+		g_assert_cmpint (idx, <, expected_sz);
+		g_assert_cmpint (chk.idx, ==, expected[idx].idx);
+		g_assert_cmpint (chk.page, ==, expected[idx].page);
+		g_assert_cmpint (chk.address, ==, expected[idx].address);
+		g_assert_cmpint (chk.data_sz, ==, expected[idx].data_sz);
+		g_assert (chk.data == buf + expected[idx].offset);
+		idx++;
+	}
+	g_assert_cmpint (idx, ==, expected_sz);
+}
+
+static void
+fu_chunk_iter_func (void)
+{
+	const guint8 buf[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+	const FuChunkIterExpected map_nopage[] = {
+		{ 0, 0, 0x00, 5, 0 },
+		{ 1, 0, 0x05, 5, 5 },
+		{ 2, 0, 0x0a, 5, 10 },
+		{ 3, 0, 0x0f, 5, 15 },
+		{ 4, 0, 0x14, 5, 20 },
+		{ 5, 0, 0x19, 5, 25 },
+		{ 6, 0, 0x1e, 5, 30 },
+		{ 7, 0, 0x23, 1, 35 },
+	};
+	const FuChunkIterExpected map_nopacket[] = {
+		{ 0, 0, 0x03, 36, 0 },
+	};
+	const FuChunkIterExpected map_straddle[] = {
+		{ 0, 0, 0x9, 1, 0 },
+		{ 1, 1, 0x0, 4, 1 },
+		{ 2, 1, 0x4, 4, 5 },
+		{ 3, 1, 0x8, 2, 9 },
+		{ 4, 2, 0x0, 4, 11 },
+		{ 5, 2, 0x4, 4, 15 },
+		{ 6, 2, 0x8, 2, 19 },
+		{ 7, 3, 0x0, 4, 21 },
+		{ 8, 3, 0x4, 4, 25 },
+		{ 9, 3, 0x8, 2, 29 },
+		{ 10, 4, 0x0, 4, 31 },
+		{ 11, 4, 0x4, 1, 35 },
+	};
+	const FuChunkIterExpected map_page_only[] = {
+		{ 0, 0, 0x5, 1, 0 },
+		{ 1, 1, 0x0, 6, 1 },
+		{ 2, 2, 0x0, 6, 7 },
+		{ 3, 3, 0x0, 6, 13 },
+		{ 4, 4, 0x0, 6, 19 },
+		{ 5, 5, 0x0, 6, 25 },
+		{ 6, 6, 0x0, 5, 31 },
+	};
+
+	fu_chunk_iter_check (buf, sizeof(buf) - 1, 0x0, 0x0, 0x5,
+			     map_nopage, G_N_ELEMENTS (map_nopage));
+	fu_chunk_iter_check (buf, sizeof(buf) - 1, 0x3, 0x0, 0x0,
+			     map_nopacket, G_N_ELEMENTS (map_nopacket));
+	fu_chunk_iter_check (buf, sizeof(buf) - 1, 0x9, 0xa, 0x4,
+			     map_straddle, G_N_ELEMENTS (map_straddle));
+	fu_chunk_iter_check (buf, sizeof(buf) - 1, 0x5, 0x6, 0x10,
+			     map_page_only, G_N_ELEMENTS (map_page_only));
+}
+
+static void
+fu_chunk_changed_func (void)
+{
+	FuChunk *chk;
+	const guint8 buf_old[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+	const guint8 buf_new[] = "0123456789abcDefghijklmnopqrstuvwxyz0123";
+	g_autoptr(GPtrArray) chunks = NULL;
+	g_autoptr(GPtrArray) chunks_same = NULL;
+	g_autoptr(GPtrArray) chunks_all = NULL;
+
+	/* one page changed, plus the data past the old end */
+	chunks = fu_chunk_array_new_changed (buf_new, sizeof(buf_new) - 1,
+					     buf_old, sizeof(buf_old) - 1,
+					     0x0, 0x8);
+	g_assert_cmpint (chunks->len, ==, 2);
+	chk = g_ptr_array_index (chunks, 0);
+	g_assert_cmpint (chk->idx, ==, 1);
+	g_assert_cmpint (chk->page, ==, 1);
+	g_assert_cmpint (chk->data_sz, ==, 8);
+	g_assert (chk->data == buf_new + 0x8);
+	chk = g_ptr_array_index (chunks, 1);
+	g_assert_cmpint (chk->idx, ==, 4);
+	g_assert_cmpint (chk->page, ==, 4);
+	g_assert_cmpint (chk->data_sz, ==, 8);
+
+	/* nothing changed */
+	chunks_same = fu_chunk_array_new_changed (buf_old, sizeof(buf_old) - 1,
+						  buf_old, sizeof(buf_old) - 1,
+						  0x0, 0x8);
+	g_assert_cmpint (chunks_same->len, ==, 0);
+
+	/* nothing to compare against */
+	chunks_all = fu_chunk_array_new_changed (buf_new, sizeof(buf_new) - 1,
+						 NULL, 0, 0x0, 0x8);
+	g_assert_cmpint (chunks_all->len, ==, 5);
+}
+
 static void
 fu_common_strstrip_func (void)
 {
@@ -1469,6 +1945,141 @@ fu_firmware_ihex_offset_func (void)
 	g_assert_cmpint (g_bytes_get_size (data_verify), ==, 0x4);
 }
 
+static void
+fu_firmware_strparse_func (void)
+{
+	const gchar alphabet[] = "0123456789abcdefABCDEF:;gZxX+- \t\n\v\f\r";
+	const gchar *prefixes[] = { "", "", "", "0x", "0X", " ", "\t", "+", "-",
+				    " 0x", "-0x", "+0X", "0x-", NULL };
+	g_autoptr(GRand) rand = g_rand_new_with_seed (0xdead);
+
+	/* check the lookup table matches g_ascii_strtoull() */
+	for (guint i = 0; i < 100000; i++) {
+		const gchar *prefix = prefixes[g_rand_int_range (rand, 0, G_N_ELEMENTS (prefixes) - 1)];
+		gchar buf[9] = { '\0' };
+		for (guint j = 0; j < 8; j++)
+			buf[j] = alphabet[g_rand_int_range (rand, 0, sizeof(alphabet) - 1)];
+		memcpy (buf, prefix, MIN (strlen (prefix), 8));
+		g_assert_cmpint (fu_firmware_strparse_uint32 (buf), ==,
+				 (guint32) g_ascii_strtoull (buf, NULL, 16));
+		buf[6] = '\0';
+		g_assert_cmpint (fu_firmware_strparse_uint24 (buf), ==,
+				 (guint32) g_ascii_strtoull (buf, NULL, 16));
+		buf[4] = '\0';
+		g_assert_cmpint (fu_firmware_strparse_uint16 (buf), ==,
+				 (guint16) g_ascii_strtoull (buf, NULL, 16));
+		buf[2] = '\0';
+		g_assert_cmpint (fu_firmware_strparse_uint8 (buf), ==,
+				 (guint8) g_ascii_strtoull (buf, NULL, 16));
+		buf[1] = '\0';
+		g_assert_cmpint (fu_firmware_strparse_uint4 (buf), ==,
+				 (guint8) g_ascii_strtoull (buf, NULL, 16));
+	}
+
+	/* the cases that are not plain hex digits */
+	g_assert_cmpint (fu_firmware_strparse_uint8 ("ff"), ==, 0xff);
+	g_assert_cmpint (fu_firmware_strparse_uint8 (" f"), ==, 0xf);
+	g_assert_cmpint (fu_firmware_strparse_uint8 ("-1"), ==, 0xff);
+	g_assert_cmpint (fu_firmware_strparse_uint16 ("0x12"), ==, 0x12);
+	g_assert_cmpint (fu_firmware_strparse_uint16 ("+0x1"), ==, 0x1);
+	g_assert_cmpint (fu_firmware_strparse_uint16 ("12zz"), ==, 0x12);
+	g_assert_cmpint (fu_firmware_strparse_uint32 ("\t-0x0001"), ==, 0xffffffff);
+}
+
+static GBytes *
+_build_ihex (GRand *rand, gsize sz, GBytes **data_out)
+{
+	guint8 *buf = g_malloc (sz);
+	g_autoptr(FuFirmware) firmware = fu_ihex_firmware_new ();
+	g_autoptr(FuFirmwareImage) img = NULL;
+	g_autoptr(GBytes) data = NULL;
+	g_autoptr(GBytes) data_hex = NULL;
+	g_autoptr(GError) error = NULL;
+
+	for (gsize i = 0; i < sz; i++)
+		buf[i] = g_rand_int_range (rand, 0x00, 0x100);
+	data = g_bytes_new_take (buf, sz);
+	img = fu_firmware_image_new (data);
+	fu_firmware_image_set_addr (img, 0x1000);
+	fu_firmware_add_image (firmware, img);
+	data_hex = fu_firmware_write (firmware, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (data_hex);
+	if (data_out != NULL)
+		*data_out = g_steal_pointer (&data);
+	return g_steal_pointer (&data_hex);
+}
+
+static void
+fu_firmware_ihex_fuzz_func (void)
+{
+	g_autoptr(GRand) rand = g_rand_new_with_seed (0xbeef);
+
+	for (guint i = 0; i < 100; i++) {
+		GPtrArray *records;
+		gboolean ret;
+		guint records_expected = 0;
+		g_autofree gchar *str = NULL;
+		g_autoptr(FuFirmware) firmware = fu_ihex_firmware_new ();
+		g_autoptr(GBytes) data = NULL;
+		g_autoptr(GBytes) data_hex = NULL;
+		g_autoptr(GBytes) data_mutated = NULL;
+		g_autoptr(GBytes) data_verify = NULL;
+		g_autoptr(GError) error = NULL;
+		g_auto(GStrv) lines = NULL;
+
+		/* round trip */
+		data_hex = _build_ihex (rand, g_rand_int_range (rand, 1, 0x2000), &data);
+		ret = fu_firmware_parse (firmware, data_hex, FWUPD_INSTALL_FLAG_NONE, &error);
+		g_assert_no_error (error);
+		g_assert (ret);
+		data_verify = fu_firmware_get_image_default_bytes (firmware, &error);
+		g_assert_no_error (error);
+		g_assert_nonnull (data_verify);
+		g_assert (g_bytes_compare (data, data_verify) == 0);
+
+		/* the records are the same as splitting the text */
+		str = g_strndup (g_bytes_get_data (data_hex, NULL), g_bytes_get_size (data_hex));
+		lines = g_strsplit (str, "\n", -1);
+		for (guint j = 0; lines[j] != NULL; j++) {
+			if (lines[j][0] != '\0')
+				records_expected++;
+		}
+		records = fu_ihex_firmware_get_records (FU_IHEX_FIRMWARE (firmware));
+		g_assert_cmpint (records->len, ==, records_expected);
+
+		/* corrupt one character, which must never crash */
+		str[g_rand_int_range (rand, 0, strlen (str))] = g_rand_int_range (rand, 0x01, 0x80);
+		data_mutated = g_bytes_new (str, strlen (str));
+		g_clear_object (&firmware);
+		firmware = fu_ihex_firmware_new ();
+		g_clear_error (&error);
+		if (!fu_firmware_parse (firmware, data_mutated, FWUPD_INSTALL_FLAG_NONE, &error))
+			g_assert_nonnull (error);
+	}
+}
+
+static void
+fu_firmware_ihex_perf_func (void)
+{
+	gdouble elapsed;
+	g_autoptr(GBytes) data_hex = NULL;
+	g_autoptr(GRand) rand = g_rand_new_with_seed (0xcafe);
+
+	data_hex = _build_ihex (rand, 4 * 1024 * 1024, NULL);
+	g_test_timer_start ();
+	for (guint i = 0; i < 10; i++) {
+		gboolean ret;
+		g_autoptr(FuFirmware) firmware = fu_ihex_firmware_new ();
+		g_autoptr(GError) error = NULL;
+		ret = fu_firmware_parse (firmware, data_hex, FWUPD_INSTALL_FLAG_NONE, &error);
+		g_assert_no_error (error);
+		g_assert (ret);
+	}
+	elapsed = g_test_timer_elapsed () / 10;
+	g_test_minimized_result (elapsed, "parsed 4MiB ihex in %.3fs", elapsed);
+}
+
 static void
 fu_firmware_srec_func (void)
 {
@@ -1782,6 +2393,47 @@ fu_device_retry_hardware_func (void)
 	g_assert_cmpint (helper.cnt_failed, ==, 2);
 }
 
+static gboolean
+fu_device_wait_for_3rd_check (FuDevice *device, gboolean *done, gpointer user_data, GError **error)
+{
+	guint *cnt = (guint *) user_data;
+	*done = ++(*cnt) >= 3;
+	return TRUE;
+}
+
+static gboolean
+fu_device_wait_for_never (FuDevice *device, gboolean *done, gpointer user_data, GError **error)
+{
+	guint *cnt = (guint *) user_data;
+	(*cnt)++;
+	*done = FALSE;
+	return TRUE;
+}
+
+static void
+fu_device_wait_for_func (void)
+{
+	gboolean ret;
+	guint cnt = 0;
+	g_autoptr(FuDevice) device = fu_device_new ();
+	g_autoptr(GError) error = NULL;
+
+	/* ready on the third check */
+	ret = fu_device_wait_for (device, fu_device_wait_for_3rd_check, 1, 16, 1000,
+				  &cnt, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_cmpint (cnt, ==, 3);
+
+	/* never ready, and the backoff would only allow 7 checks */
+	cnt = 0;
+	ret = fu_device_wait_for (device, fu_device_wait_for_never, 1, 1, 100,
+				  &cnt, &error);
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT);
+	g_assert_false (ret);
+	g_assert_cmpint (cnt, >, 20);
+}
+
 static void
 fu_security_attrs_hsi_func (void)
 {
@@ -1898,6 +2550,8 @@ main (int argc, char **argv)
 	g_test_add_func ("/fwupd/plugin{quirks-performance}", fu_plugin_quirks_performance_func);
 	g_test_add_func ("/fwupd/plugin{quirks-device}", fu_plugin_quirks_device_func);
 	g_test_add_func ("/fwupd/chunk", fu_chunk_func);
+	g_test_add_func ("/fwupd/chunk{iter}", fu_chunk_iter_func);
+	g_test_add_func ("/fwupd/chunk{changed}", fu_chunk_changed_func);
 	g_test_add_func ("/fwupd/common{string-append-kv}", fu_common_string_append_kv_func);
 	g_test_add_func ("/fwupd/common{version-guess-format}", fu_common_version_guess_format_func);
 	g_test_add_func ("/fwupd/common{version}", fu_common_version_func);
@@ -1912,6 +2566,7 @@ main (int argc, char **argv)
 	g_test_add_func ("/fwupd/common{cab-error-wrong-checksum}", fu_common_store_cab_error_wrong_checksum_func);
 	g_test_add_func ("/fwupd/common{cab-error-missing-file}", fu_common_store_cab_error_missing_file_func);
 	g_test_add_func ("/fwupd/common{cab-error-size}", fu_common_store_cab_error_size_func);
+	g_test_add_func ("/fwupd/common{cab-success-stream}", fu_common_store_cab_stream_func);
 	g_test_add_func ("/fwupd/common{spawn)", fu_common_spawn_func);
 	g_test_add_func ("/fwupd/common{spawn-timeout)", fu_common_spawn_timeout_func);
 	g_test_add_func ("/fwupd/common{firmware-builder}", fu_common_firmware_builder_func);
@@ -1924,11 +2579,17 @@ main (int argc, char **argv)
 	g_test_add_func ("/fwupd/firmware{ihex}", fu_firmware_ihex_func);
 	g_test_add_func ("/fwupd/firmware{ihex-offset}", fu_firmware_ihex_offset_func);
 	g_test_add_func ("/fwupd/firmware{ihex-signed}", fu_firmware_ihex_signed_func);
+	g_test_add_func ("/fwupd/firmware{ihex-fuzz}", fu_firmware_ihex_fuzz_func);
+	if (g_test_perf ())
+		g_test_add_func ("/fwupd/firmware{ihex-perf}", fu_firmware_ihex_perf_func);
+	g_test_add_func ("/fwupd/firmware{strparse}", fu_firmware_strparse_func);
 	g_test_add_func ("/fwupd/firmware{srec-tokenization}", fu_firmware_srec_tokenization_func);
 	g_test_add_func ("/fwupd/firmware{srec}", fu_firmware_srec_func);
 	g_test_add_func ("/fwupd/firmware{dfu}", fu_firmware_dfu_func);
 	g_test_add_func ("/fwupd/archive{invalid}", fu_archive_invalid_func);
 	g_test_add_func ("/fwupd/archive{cab}", fu_archive_cab_func);
+	g_test_add_func ("/fwupd/archive{lazy}", fu_archive_lazy_func);
+	g_test_add_func ("/fwupd/archive{lazy-tar}", fu_archive_lazy_tar_func);
 	g_test_add_func ("/fwupd/device{flags}", fu_device_flags_func);
 	g_test_add_func ("/fwupd/device{parent}", fu_device_parent_func);
 	g_test_add_func ("/fwupd/device{incorporate}", fu_device_incorporate_func);
@@ -1939,8 +2600,10 @@ main (int argc, char **argv)
 	g_test_add_func ("/fwupd/device{metadata}", fu_device_metadata_func);
 	g_test_add_func ("/fwupd/device{open-refcount}", fu_device_open_refcount_func);
 	g_test_add_func ("/fwupd/device{version-format}", fu_device_version_format_func);
+	g_test_add_func ("/fwupd/device{write-firmware-async}", fu_device_write_firmware_async_func);
 	g_test_add_func ("/fwupd/device{retry-success}", fu_device_retry_success_func);
 	g_test_add_func ("/fwupd/device{retry-failed}", fu_device_retry_failed_func);
 	g_test_add_func ("/fwupd/device{retry-hardware}", fu_device_retry_hardware_func);
+	g_test_add_func ("/fwupd/device{wait-for}", fu_device_wait_for_func);
 	return g_test_run ();
 }
@@ -18,3 +18,7 @@ gboolean	 fu_smbios_setup_from_path	(FuSmbios	*self,
 gboolean	 fu_smbios_setup_from_file	(FuSmbios	*self,
 						 const gchar	*filename,
 						 GError		**error);
+GVariant	*fu_smbios_to_variant		(FuSmbios	*self);
+gboolean	 fu_smbios_setup_from_variant	(FuSmbios	*self,
+						 GVariant	*value,
+						 GError		**error);
@@ -359,6 +359,101 @@ fu_smbios_to_string (FuSmbios *self)
 	return g_string_free (str, FALSE);
 }
 
+/**
+ * fu_smbios_to_variant:
+ * @self: A #FuSmbios
+ *
+ * Serializes the parsed SMBIOS structures so that they can be restored using
+ * fu_smbios_setup_from_variant() without reading the tables again.
+ *
+ * Returns: (transfer full): a #GVariant
+ *
+ * Since: 1.5.0
+ **/
+GVariant *
+fu_smbios_to_variant (FuSmbios *self)
+{
+	GVariantBuilder builder;
+
+	g_return_val_if_fail (FU_IS_SMBIOS (self), NULL);
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(yqayas)"));
+	for (guint i = 0; i < self->items->len; i++) {
+		FuSmbiosItem *item = g_ptr_array_index (self->items, i);
+		GVariantBuilder builder_strings;
+		gsize sz = 0;
+		const guint8 *buf = g_bytes_get_data (item->data, &sz);
+
+		g_variant_builder_init (&builder_strings, G_VARIANT_TYPE_STRING_ARRAY);
+		for (guint j = 0; j < item->strings->len; j++) {
+			const gchar *tmp = g_ptr_array_index (item->strings, j);
+			g_variant_builder_add (&builder_strings, "s", tmp);
+		}
+		g_variant_builder_add (&builder, "(yq@ayas)",
+				       item->type,
+				       item->handle,
+				       g_variant_new_fixed_array (G_VARIANT_TYPE_BYTE,
+								  buf, sz, sizeof(guint8)),
+				       &builder_strings);
+	}
+	return g_variant_new ("(su@a(yqayas))",
+			      self->smbios_ver != NULL ? self->smbios_ver : "",
+			      self->structure_table_len,
+			      g_variant_builder_end (&builder));
+}
+
+/**
+ * fu_smbios_setup_from_variant:
+ * @self: A #FuSmbios
+ * @value: A #GVariant created by fu_smbios_to_variant()
+ * @error: A #GError or %NULL
+ *
+ * Restores previously parsed SMBIOS structures.
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_smbios_setup_from_variant (FuSmbios *self, GVariant *value, GError **error)
+{
+	const gchar *smbios_ver = NULL;
+	GVariant *item_data = NULL;
+	guint8 type = 0;
+	guint16 handle = 0;
+	gchar **strings = NULL;
+	g_autoptr(GVariantIter) iter = NULL;
+
+	g_return_val_if_fail (FU_IS_SMBIOS (self), FALSE);
+	g_return_val_if_fail (value != NULL, FALSE);
+
+	if (!g_variant_is_of_type (value, G_VARIANT_TYPE ("(sua(yqayas))"))) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "invalid SMBIOS format, got %s",
+			     g_variant_get_type_string (value));
+		return FALSE;
+	}
+	g_variant_get (value, "(&sua(yqayas))",
+		       &smbios_ver, &self->structure_table_len, &iter);
+	g_free (self->smbios_ver);
+	self->smbios_ver = smbios_ver[0] != '\0' ? g_strdup (smbios_ver) : NULL;
+	while (g_variant_iter_next (iter, "(yq@ay^as)", &type, &handle, &item_data, &strings)) {
+		FuSmbiosItem *item = g_new0 (FuSmbiosItem, 1);
+		item->type = type;
+		item->handle = handle;
+		item->data = g_variant_get_data_as_bytes (item_data);
+		item->strings = g_ptr_array_new_with_free_func (g_free);
+		for (guint i = 0; strings[i] != NULL; i++)
+			g_ptr_array_add (item->strings, strings[i]);
+		g_free (strings);
+		g_variant_unref (item_data);
+		g_ptr_array_add (self->items, item);
+	}
+	return TRUE;
+}
+
 static FuSmbiosItem *
 fu_smbios_get_item_for_type (FuSmbios *self, guint8 type)
 {
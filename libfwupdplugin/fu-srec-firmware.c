@@ -80,31 +80,56 @@ fu_srec_firmware_record_new (guint ln, FuFirmareSrecRecordKind kind, guint32 add
 	return rcd;
 }
 
+/* returns the next line, or %FALSE when there are no more */
+static gboolean
+fu_srec_firmware_next_line (const gchar *data,
+			    gsize sz,
+			    gsize *offset,
+			    const gchar **line,
+			    gsize *linesz)
+{
+	const gchar *tmp;
+	gsize len;
+
+	if (*offset >= sz)
+		return FALSE;
+	*line = data + *offset;
+	tmp = memchr (*line, '\n', sz - *offset);
+	len = tmp != NULL ? (gsize) (tmp - *line) : sz - *offset;
+	*offset += len + 1;
+
+	/* ignore anything after a carriage return */
+	tmp = memchr (*line, '\r', len);
+	*linesz = tmp != NULL ? (gsize) (tmp - *line) : len;
+	return TRUE;
+}
+
 static gboolean
 fu_srec_firmware_tokenize (FuFirmware *firmware, GBytes *fw,
 			   FwupdInstallFlags flags, GError **error)
 {
 	FuSrecFirmware *self = FU_SREC_FIRMWARE (firmware);
 	const gchar *data;
+	const gchar *line = NULL;
+	const gchar *tmp;
 	gboolean got_eof = FALSE;
+	gsize linesz = 0;
+	gsize offset = 0;
 	gsize sz = 0;
-	g_auto(GStrv) lines = NULL;
 
-	/* parse records */
+	/* parse each line in place, where nothing after a NUL is used */
 	data = g_bytes_get_data (fw, &sz);
-	lines = fu_common_strnsplit (data, sz, "\n", -1);
-	for (guint ln = 0; lines[ln] != NULL; ln++) {
+	tmp = memchr (data, '\0', sz);
+	if (tmp != NULL)
+		sz = tmp - data;
+	for (guint ln = 0; fu_srec_firmware_next_line (data, sz, &offset, &line, &linesz); ln++) {
 		FuSrecFirmwareRecord *rcd;
-		const gchar *line = lines[ln];
-		gsize linesz;
 		guint32 rec_addr32;
 		guint8 addrsz = 0;		/* bytes */
 		guint8 rec_count;		/* words */
 		guint8 rec_kind;
 
 		/* ignore blank lines */
-		g_strdelimit (lines[ln], "\r", '\0');
-		linesz = strlen (line);
 		if (linesz == 0)
 			continue;
 
@@ -202,6 +227,16 @@ fu_srec_firmware_tokenize (FuFirmware *firmware, GBytes *fw,
 			return FALSE;
 		}
 
+		/* the address and checksum are included in the count */
+		if (rec_count < addrsz + 1) {
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "count too small for address at line %u",
+				     ln + 1);
+			return FALSE;
+		}
+
 		/* parse address */
 		switch (addrsz) {
 		case 2:
@@ -217,17 +252,13 @@ fu_srec_firmware_tokenize (FuFirmware *firmware, GBytes *fw,
 			g_assert_not_reached ();
 		}
 
-		g_debug ("line %03u S%u addr:0x%04x datalen:0x%02x",
-			 ln + 1, rec_kind, rec_addr32,
-			 (guint) rec_count - addrsz - 1);
-
 		/* data */
 		rcd = fu_srec_firmware_record_new (ln + 1, rec_kind, rec_addr32);
 		if (rec_kind == 1 || rec_kind == 2 || rec_kind == 3) {
-			for (guint8 i = 4 + (addrsz * 2); i <= rec_count * 2; i += 2) {
-				guint8 tmp = fu_firmware_strparse_uint8 (line + i);
-				fu_byte_array_append_uint8 (rcd->buf, tmp);
-			}
+			guint datasz = rec_count > addrsz + 1 ? rec_count - addrsz - 1 : 0;
+			g_byte_array_set_size (rcd->buf, datasz);
+			for (guint i = 0; i < datasz; i++)
+				rcd->buf->data[i] = fu_firmware_strparse_uint8 (line + 4 + (addrsz * 2) + (i * 2));
 		}
 		g_ptr_array_add (self->records, rcd);
 	}
@@ -7,6 +7,8 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include "fu-chunk.h"
 
 #include "fu-ccgx-common.h"
@@ -1230,6 +1232,8 @@ fu_ccgx_hpi_write_firmware (FuDevice *device,
 	CCGxMetaData metadata = { 0x0 };
 	GPtrArray *records = fu_ccgx_firmware_get_records (FU_CCGX_FIRMWARE (firmware));
 	FWMode fw_mode_alt = fu_ccgx_fw_mode_get_alternate (self->fw_mode);
+	guint rows_unchanged = 0;
+	g_autofree guint8 *buf_old = g_malloc0 (self->flash_row_size);
 	g_autoptr(FuDeviceLocker) locker = NULL;
 
 	/* enter flash mode */
@@ -1254,6 +1258,28 @@ fu_ccgx_hpi_write_firmware (FuDevice *device,
 	for (guint i = 0; i < records->len; i++) {
 		FuCcgxFirmwareRecord *rcd = g_ptr_array_index (records, i);
 
+		/* the metadata of the alternate image is already invalid */
+		if (g_cancellable_set_error_if_cancelled (fu_device_get_cancellable (device), error))
+			return FALSE;
+
+		/* reading is much quicker than erasing and programming the row,
+		 * and the whole image gets validated at the end */
+		if (g_bytes_get_size (rcd->data) <= self->flash_row_size) {
+			if (!fu_ccgx_hpi_read_flash (self, rcd->row_number,
+						     buf_old, self->flash_row_size,
+						     error)) {
+				g_prefix_error (error, "fw read error @0x%x: ", rcd->row_number);
+				return FALSE;
+			}
+			if (memcmp (buf_old,
+				    g_bytes_get_data (rcd->data, NULL),
+				    g_bytes_get_size (rcd->data)) == 0) {
+				fu_device_set_progress_full (device, (gsize) i, (gsize) records->len - 1);
+				rows_unchanged++;
+				continue;
+			}
+		}
+
 		/* write chunk */
 		if (!fu_ccgx_hpi_write_flash (self, rcd->row_number,
 					      g_bytes_get_data (rcd->data, NULL),
@@ -1267,6 +1293,9 @@ fu_ccgx_hpi_write_firmware (FuDevice *device,
 		fu_device_set_progress_full (device, (gsize) i, (gsize) records->len - 1);
 	}
 
+	if (rows_unchanged > 0)
+		g_debug ("skipped %u of %u unchanged rows", rows_unchanged, records->len);
+
 	/* validate fw */
 	fu_device_set_status (device, FWUPD_STATUS_DEVICE_VERIFY);
 	if (!fu_ccgx_hpi_validate_fw (self, fw_mode_alt, error)) {
@@ -1583,6 +1612,7 @@ fu_ccgx_hpi_device_init (FuCcgxHpiDevice *self)
 	fu_device_add_flag (FU_DEVICE (self), FWUPD_DEVICE_FLAG_REQUIRE_AC);
 	fu_device_add_flag (FU_DEVICE (self), FWUPD_DEVICE_FLAG_DUAL_IMAGE);
 	fu_device_add_flag (FU_DEVICE (self), FWUPD_DEVICE_FLAG_SELF_RECOVERY);
+	fu_device_add_flag (FU_DEVICE (self), FWUPD_DEVICE_FLAG_THREADED_WRITE);
 	fu_device_retry_set_delay (FU_DEVICE (self), HPI_CMD_RETRY_DELAY);
 
 	/* we can recover the I²C link using reset */
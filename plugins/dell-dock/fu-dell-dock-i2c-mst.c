@@ -44,6 +44,7 @@
 #define MST_CMD_READ_FLASH		0x30
 #define MST_CMD_WRITE_MEMORY		0x21
 #define MST_CMD_READ_MEMORY		0x31
+#define MST_RC_COMMAND_POLL_READS	1000
 
 /* Arguments related to flashing */
 #define FLASH_SECTOR_ERASE_4K		0x1000
@@ -254,10 +255,48 @@ fu_dell_dock_mst_enable_remote_control (FuDevice *proxy, GError **error)
 	return TRUE;
 }
 
+typedef struct {
+	guint32		 result;
+	guint		 reads;
+} FuDellDockRcCommandHelper;
+
 static gboolean
-fu_dell_dock_trigger_rc_command (FuDevice *proxy, GError **error)
+fu_dell_dock_trigger_rc_command_cb (FuDevice *proxy,
+				    gboolean *done,
+				    gpointer user_data,
+				    GError **error)
 {
+	FuDellDockRcCommandHelper *helper = (FuDellDockRcCommandHelper *) user_data;
 	const guint8 *result = NULL;
+	g_autoptr(GBytes) bytes = NULL;
+
+	/* give up, which is reported using the unset result */
+	if (helper->reads++ >= MST_RC_COMMAND_POLL_READS) {
+		*done = TRUE;
+		return TRUE;
+	}
+
+	if (!fu_dell_dock_mst_read_register (proxy,
+					     MST_RC_COMMAND_ADDR,
+					     sizeof(guint32), &bytes,
+					     error))
+		return FALSE;
+	result = g_bytes_get_data (bytes, NULL);
+	/* complete */
+	if ((result[2] & 0x80) == 0) {
+		helper->result = result[3];
+		*done = TRUE;
+	}
+	return TRUE;
+}
+
+static gboolean
+fu_dell_dock_trigger_rc_command (FuDevice *proxy, GError **error)
+{
+	FuDellDockRcCommandHelper helper = {
+		.result = 0xffff,
+		.reads = 0,
+	};
 	guint32 tmp;
 
 	/* Trigger the write */
@@ -269,27 +308,15 @@ fu_dell_dock_trigger_rc_command (FuDevice *proxy, GError **error)
 		g_prefix_error (error, "Failed to write MST_RC_TRIGGER_ADDR: ");
 		return FALSE;
 	}
-	/* poll for completion */
-	tmp = 0xffff;
-	for (guint i = 0; i < 1000; i++) {
-		g_autoptr(GBytes) bytes = NULL;
-		if (!fu_dell_dock_mst_read_register (proxy,
-						     MST_RC_COMMAND_ADDR,
-						     sizeof(guint32), &bytes,
-						     error)) {
-			g_prefix_error (error,
-					"Failed to poll MST_RC_COMMAND_ADDR");
-			return FALSE;
-		}
-		result = g_bytes_get_data (bytes, NULL);
-		/* complete */
-		if ((result[2] & 0x80) == 0) {
-			tmp = result[3];
-			break;
-		}
-		g_usleep (2000);
+	/* poll for completion, bounded by the number of reads as each I2C read
+	 * can take much longer than the delay between them */
+	if (!fu_device_wait_for (proxy, fu_dell_dock_trigger_rc_command_cb,
+				 2, 2, G_MAXUINT,
+				 &helper, error)) {
+		g_prefix_error (error, "Failed to poll MST_RC_COMMAND_ADDR: ");
+		return FALSE;
 	}
-	switch (tmp) {
+	switch (helper.result) {
 	/* need to enable remote control */
 	case 4:
 		return fu_dell_dock_mst_enable_remote_control (proxy, error);
@@ -313,7 +340,7 @@ fu_dell_dock_trigger_rc_command (FuDevice *proxy, GError **error)
 	default:
 		g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
 			     "Command timed out or unknown failure: %x",
-			     tmp);
+			     helper.result);
 		return FALSE;
 	}
 }
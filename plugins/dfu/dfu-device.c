@@ -44,6 +44,7 @@
  * * `legacy-protocol`:		Use a legacy protocol version
  * * `detach-for-attach`:	Requires a DFU_REQUEST_DETACH to attach
  * * `absent-sector-size`:	In absence of sector size, assume byte
+ * * `fast-download`:		Only wait for the download timeout while dfuDNBUSY
  *
  * Default value: `none`
  *
@@ -1847,5 +1848,6 @@ dfu_device_init (DfuDevice *device)
 	fu_device_add_icon (FU_DEVICE (device), "drive-harddisk-usb");
 	fu_device_add_flag (FU_DEVICE (device), FWUPD_DEVICE_FLAG_UPDATABLE);
 	fu_device_add_flag (FU_DEVICE (device), FWUPD_DEVICE_FLAG_ADD_COUNTERPART_GUIDS);
+	fu_device_add_flag (FU_DEVICE (device), FWUPD_DEVICE_FLAG_THREADED_WRITE);
 	fu_device_set_remove_delay (FU_DEVICE (device), FU_DEVICE_REMOVE_DELAY_RE_ENUMERATE);
 }
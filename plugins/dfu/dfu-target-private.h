@@ -43,6 +43,8 @@ void		 dfu_target_set_alt_name		(DfuTarget	*target,
 void		 dfu_target_set_device			(DfuTarget	*target,
 							 DfuDevice	*device);
 DfuDevice	*dfu_target_get_device			(DfuTarget	*target);
+gboolean	 dfu_target_check_status_cached		(DfuTarget	*target,
+							 GError		**error);
 gboolean	 dfu_target_check_status		(DfuTarget	*target,
 							 GError		**error);
 DfuSector	*dfu_target_get_sector_for_addr		(DfuTarget	*target,
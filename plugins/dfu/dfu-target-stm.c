@@ -234,6 +234,61 @@ dfu_target_stm_erase_address (DfuTarget *target, guint32 address, GError **error
 	return dfu_target_check_status (target, error);
 }
 
+/* chunks that match the erased flash do not need to be written again */
+static gboolean
+dfu_target_stm_chunk_is_blank (const guint8 *buf, gsize bufsz, guint8 value)
+{
+	for (gsize i = 0; i < bufsz; i++) {
+		if (buf[i] != value)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/* flash erases to 0xff on most parts but to 0x00 on others like the STM32L0,
+ * and they all use the same bootloader VID:PID, so read back the sector */
+static gboolean
+dfu_target_stm_get_erased_value (DfuTarget *target,
+				 DfuSector *sector,
+				 gint *value,
+				 GError **error)
+{
+	DfuDevice *device = dfu_target_get_device (target);
+	gsize bufsz = 0;
+	const guint8 *buf;
+	g_autoptr(GBytes) chunk = NULL;
+	g_autoptr(GError) error_local = NULL;
+
+	/* unknown, so write everything */
+	*value = -1;
+	if (!dfu_sector_has_cap (sector, DFU_SECTOR_CAP_READABLE))
+		return TRUE;
+	if (!dfu_target_stm_set_address (target, dfu_sector_get_address (sector), error))
+		return FALSE;
+	if (!dfu_device_abort (device, error))
+		return FALSE;
+	chunk = dfu_target_upload_chunk (target, 2, 0, &error_local);
+	if (chunk == NULL) {
+		g_debug ("failed to read erased sector: %s", error_local->message);
+		if (!dfu_device_clear_status (device, error))
+			return FALSE;
+		return dfu_device_abort (device, error);
+	}
+
+	/* back to IDLE so that the address can be set for the download */
+	if (!dfu_device_abort (device, error))
+		return FALSE;
+	buf = g_bytes_get_data (chunk, &bufsz);
+	if (bufsz == 0 || !dfu_target_stm_chunk_is_blank (buf, bufsz, buf[0])) {
+		g_debug ("erased sector at 0x%04x is not uniform",
+			 dfu_sector_get_address (sector));
+		return TRUE;
+	}
+	*value = buf[0];
+	g_debug ("erased flash reads as 0x%02x", (guint) buf[0]);
+	return TRUE;
+}
+
 static gboolean
 dfu_target_stm_download_element (DfuTarget *target,
 				 DfuElement *element,
@@ -243,7 +298,11 @@ dfu_target_stm_download_element (DfuTarget *target,
 	DfuDevice *device = dfu_target_get_device (target);
 	DfuSector *sector;
 	GBytes *bytes;
+	const guint8 *buf;
+	gsize bufsz = 0;
+	gint erased_value = -1;
 	guint nr_chunks;
+	guint nr_blank = 0;
 	guint zone_last = G_MAXUINT;
 	guint16 transfer_size = dfu_device_get_transfer_size (device);
 	g_autoptr(GPtrArray) sectors_array = NULL;
@@ -251,6 +310,7 @@ dfu_target_stm_download_element (DfuTarget *target,
 
 	/* round up as we have to transfer incomplete blocks */
 	bytes = dfu_element_get_contents (element);
+	buf = g_bytes_get_data (bytes, &bufsz);
 	nr_chunks = (guint) ceil ((gdouble) g_bytes_get_size (bytes) /
 				  (gdouble) transfer_size);
 	if (nr_chunks == 0) {
@@ -316,6 +376,13 @@ dfu_target_stm_download_element (DfuTarget *target,
 	dfu_target_set_percentage_raw (target, 100);
 	dfu_target_set_action (target, FWUPD_STATUS_IDLE);
 
+	/* find out what the erased sectors contain */
+	if (sectors_array->len > 0) {
+		sector = g_ptr_array_index (sectors_array, 0);
+		if (!dfu_target_stm_get_erased_value (target, sector, &erased_value, error))
+			return FALSE;
+	}
+
 	/* 3rd pass: write data */
 	dfu_target_set_action (target, FWUPD_STATUS_DEVICE_WRITE);
 	for (guint i = 0; i < nr_chunks; i++) {
@@ -324,6 +391,11 @@ dfu_target_stm_download_element (DfuTarget *target,
 		guint32 offset_dev;
 		g_autoptr(GBytes) bytes_tmp = NULL;
 
+		/* the device stays in DFU mode, so this is safe to retry */
+		if (g_cancellable_set_error_if_cancelled (fu_device_get_cancellable (FU_DEVICE (device)),
+							  error))
+			return FALSE;
+
 		/* caclulate the offset into the element data */
 		offset = i * transfer_size;
 		offset_dev = dfu_element_get_address (element) + offset;
@@ -332,6 +404,11 @@ dfu_target_stm_download_element (DfuTarget *target,
 		sector = dfu_target_get_sector_for_addr (target, offset_dev);
 		g_assert (sector != NULL);
 
+		/* we have to write one final zero-sized chunk for EOF */
+		length = g_bytes_get_size (bytes) - offset;
+		if (length > transfer_size)
+			length = transfer_size;
+
 		/* manually set the sector address */
 		if (dfu_sector_get_zone (sector) != zone_last) {
 			g_debug ("setting address to 0x%04x",
@@ -343,10 +420,18 @@ dfu_target_stm_download_element (DfuTarget *target,
 			zone_last = dfu_sector_get_zone (sector);
 		}
 
-		/* we have to write one final zero-sized chunk for EOF */
-		length = g_bytes_get_size (bytes) - offset;
-		if (length > transfer_size)
-			length = transfer_size;
+		/* the block number sets the address, so blank chunks in sectors
+		 * we have just erased can be skipped entirely */
+		if (erased_value >= 0 &&
+		    g_hash_table_contains (sectors_hash, sector) &&
+		    dfu_target_stm_chunk_is_blank (buf + offset, length,
+						   (guint8) erased_value)) {
+			g_debug ("skipping blank chunk at 0x%04x", offset_dev);
+			dfu_target_set_percentage (target, offset, bufsz);
+			nr_blank++;
+			continue;
+		}
+
 		bytes_tmp = g_bytes_new_from_bytes (bytes, offset, length);
 		g_debug ("writing sector at 0x%04x (0x%" G_GSIZE_FORMAT ")",
 			 offset_dev,
@@ -358,8 +443,9 @@ dfu_target_stm_download_element (DfuTarget *target,
 						error))
 			return FALSE;
 
-		/* getting the status moves the state machine to DNLOAD-IDLE */
-		if (!dfu_target_check_status (target, error))
+		/* the chunk download already got the status that moved the
+		 * state machine to DNLOAD-IDLE, so do not ask again */
+		if (!dfu_target_check_status_cached (target, error))
 			return FALSE;
 
 		/* update UI */
@@ -367,6 +453,8 @@ dfu_target_stm_download_element (DfuTarget *target,
 	}
 
 	/* done */
+	if (nr_blank > 0)
+		g_debug ("skipped %u of %u blank chunks", nr_blank, nr_chunks);
 	dfu_target_set_percentage_raw (target, 100);
 	dfu_target_set_action (target, FWUPD_STATUS_IDLE);
 
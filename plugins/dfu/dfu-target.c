@@ -472,26 +472,39 @@ dfu_target_status_to_error_msg (DfuStatus status)
 	return NULL;
 }
 
+/* the device reports how long the host has to wait before asking again,
+ * so use exactly that rather than a fixed delay */
+static gboolean
+dfu_target_wait_for_dnbusy (DfuTarget *target, GError **error)
+{
+	DfuTargetPrivate *priv = GET_PRIVATE (target);
+	while (dfu_device_get_state (priv->device) == DFU_STATE_DFU_DNBUSY) {
+		guint poll_timeout = dfu_device_get_download_timeout (priv->device);
+		g_debug ("waiting %ums for DFU_STATE_DFU_DNBUSY to clear", poll_timeout);
+		if (poll_timeout > 0)
+			g_usleep (poll_timeout * 1000);
+		if (!dfu_device_refresh (priv->device, error))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * dfu_target_check_status_cached:
+ * @target: a #DfuTarget
+ * @error: a #GError, or %NULL
+ *
+ * Checks the status returned by the last DFU_GETSTATUS request without sending
+ * another request to the device.
+ *
+ * Return value: %TRUE if the device is not in an error state
+ **/
 gboolean
-dfu_target_check_status (DfuTarget *target, GError **error)
+dfu_target_check_status_cached (DfuTarget *target, GError **error)
 {
 	DfuTargetPrivate *priv = GET_PRIVATE (target);
 	DfuStatus status;
 
-	/* get the status */
-	if (!dfu_device_refresh (priv->device, error))
-		return FALSE;
-
-	/* wait for dfuDNBUSY to not be set */
-	if (dfu_device_get_version (priv->device) == DFU_VERSION_DFUSE) {
-		while (dfu_device_get_state (priv->device) == DFU_STATE_DFU_DNBUSY) {
-			g_debug ("waiting for DFU_STATE_DFU_DNBUSY to clear");
-			g_usleep (dfu_device_get_download_timeout (priv->device) * 1000);
-			if (!dfu_device_refresh (priv->device, error))
-				return FALSE;
-		}
-	}
-
 	/* not in an error state */
 	if (dfu_device_get_state (priv->device) != DFU_STATE_DFU_ERROR)
 		return TRUE;
@@ -523,6 +536,23 @@ dfu_target_check_status (DfuTarget *target, GError **error)
 	return FALSE;
 }
 
+gboolean
+dfu_target_check_status (DfuTarget *target, GError **error)
+{
+	DfuTargetPrivate *priv = GET_PRIVATE (target);
+
+	/* get the status */
+	if (!dfu_device_refresh (priv->device, error))
+		return FALSE;
+
+	/* wait for dfuDNBUSY to not be set */
+	if (dfu_device_get_version (priv->device) == DFU_VERSION_DFUSE) {
+		if (!dfu_target_wait_for_dnbusy (target, error))
+			return FALSE;
+	}
+	return dfu_target_check_status_cached (target, error);
+}
+
 /**
  * dfu_target_use_alt_setting:
  * @target: a #DfuTarget
@@ -712,8 +742,22 @@ dfu_target_download_chunk (DfuTarget *target, guint16 index, GBytes *bytes, GErr
 		return FALSE;
 	}
 
+	/* the device only reports dfuDNBUSY for as long as it needs, so
+	 * there is no need to sleep for the poll timeout after each chunk */
+	if (fu_device_has_custom_flag (FU_DEVICE (priv->device), "fast-download")) {
+		if (!dfu_device_refresh (priv->device, error))
+			return FALSE;
+		if (!dfu_target_wait_for_dnbusy (target, error))
+			return FALSE;
+		if (g_bytes_get_size (bytes) > 0) {
+			g_assert (actual_length == g_bytes_get_size (bytes));
+			return TRUE;
+		}
+	}
+
 	/* for STM32 devices, the action only occurs when we do GetStatus */
-	if (dfu_device_get_version (priv->device) == DFU_VERSION_DFUSE) {
+	if (dfu_device_get_version (priv->device) == DFU_VERSION_DFUSE &&
+	    !fu_device_has_custom_flag (FU_DEVICE (priv->device), "fast-download")) {
 		if (!dfu_device_refresh (priv->device, error))
 			return FALSE;
 	}
@@ -733,6 +777,8 @@ dfu_target_download_chunk (DfuTarget *target, guint16 index, GBytes *bytes, GErr
 	/* find out if the write was successful */
 	if (!dfu_device_refresh (priv->device, error))
 		return FALSE;
+	if (!dfu_target_wait_for_dnbusy (target, error))
+		return FALSE;
 
 	g_assert (actual_length == g_bytes_get_size (bytes));
 	return TRUE;
@@ -1126,6 +1172,11 @@ dfu_target_download_element_dfu (DfuTarget *target,
 		guint32 offset;
 		g_autoptr(GBytes) bytes_tmp = NULL;
 
+		/* the device stays in DFU mode, so this is safe to retry */
+		if (g_cancellable_set_error_if_cancelled (fu_device_get_cancellable (FU_DEVICE (priv->device)),
+							  error))
+			return FALSE;
+
 		/* caclulate the offset into the element data */
 		offset = i * transfer_size;
 
@@ -759,6 +759,7 @@ static gboolean
 dfu_tool_write_alt (DfuToolPrivate *priv, gchar **values, GError **error)
 {
 	DfuTargetTransferFlags flags = DFU_TARGET_TRANSFER_FLAG_VERIFY;
+	gdouble elapsed;
 	g_autofree gchar *str_debug = NULL;
 	g_autoptr(DfuDevice) device = NULL;
 	g_autoptr(DfuFirmware) firmware = NULL;
@@ -766,6 +767,7 @@ dfu_tool_write_alt (DfuToolPrivate *priv, gchar **values, GError **error)
 	g_autoptr(DfuTarget) target = NULL;
 	g_autoptr(FuDeviceLocker) locker  = NULL;
 	g_autoptr(GFile) file = NULL;
+	g_autoptr(GTimer) timer = g_timer_new ();
 
 	/* check args */
 	if (g_strv_length (values) < 2) {
@@ -865,8 +867,10 @@ dfu_tool_write_alt (DfuToolPrivate *priv, gchar **values, GError **error)
 	}
 
 	/* transfer */
+	g_timer_reset (timer);
 	if (!dfu_target_download (target, image, flags, error))
 		return FALSE;
+	elapsed = g_timer_elapsed (timer, NULL);
 
 	/* do host reset */
 	if (!fu_device_attach (FU_DEVICE (device), error))
@@ -875,8 +879,9 @@ dfu_tool_write_alt (DfuToolPrivate *priv, gchar **values, GError **error)
 		return FALSE;
 
 	/* success */
-	g_print ("%u bytes successfully downloaded to device\n",
-		 dfu_image_get_size (image));
+	g_print ("%u bytes successfully downloaded to device in %.2fs (%.1f KiB/s)\n",
+		 dfu_image_get_size (image), elapsed,
+		 dfu_image_get_size (image) / (1024.f * elapsed));
 	return TRUE;
 }
 
@@ -884,9 +889,11 @@ static gboolean
 dfu_tool_write (DfuToolPrivate *priv, gchar **values, GError **error)
 {
 	FwupdInstallFlags flags = FWUPD_INSTALL_FLAG_NONE;
+	gdouble elapsed;
 	g_autoptr(DfuDevice) device = NULL;
 	g_autoptr(GBytes) fw = NULL;
 	g_autoptr(FuDeviceLocker) locker  = NULL;
+	g_autoptr(GTimer) timer = g_timer_new ();
 
 	/* check args */
 	if (g_strv_length (values) < 1) {
@@ -932,8 +939,10 @@ dfu_tool_write (DfuToolPrivate *priv, gchar **values, GError **error)
 			  G_CALLBACK (fu_tool_action_changed_cb), priv);
 	g_signal_connect (device, "notify::progress",
 			  G_CALLBACK (fu_tool_action_changed_cb), priv);
+	g_timer_reset (timer);
 	if (!fu_device_write_firmware (FU_DEVICE (device), fw, flags, error))
 		return FALSE;
+	elapsed = g_timer_elapsed (timer, NULL);
 
 	/* do host reset */
 	if (!fu_device_attach (FU_DEVICE (device), error))
@@ -945,8 +954,9 @@ dfu_tool_write (DfuToolPrivate *priv, gchar **values, GError **error)
 	}
 
 	/* success */
-	g_print ("%u bytes successfully downloaded to device\n",
-		 (guint) g_bytes_get_size (fw));
+	g_print ("%u bytes successfully downloaded to device in %.2fs (%.1f KiB/s)\n",
+		 (guint) g_bytes_get_size (fw), elapsed,
+		 g_bytes_get_size (fw) / (1024.f * elapsed));
 	return TRUE;
 }
 
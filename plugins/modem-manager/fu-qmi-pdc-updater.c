@@ -124,7 +124,8 @@ fu_qmi_pdc_updater_qmi_device_new_ready (GObject *source, GAsyncResult *res, gpo
 gboolean
 fu_qmi_pdc_updater_open (FuQmiPdcUpdater *self, GError **error)
 {
-	g_autoptr(GMainLoop) mainloop = g_main_loop_new (NULL, FALSE);
+	g_autoptr(GMainContext) context = g_main_context_ref_thread_default ();
+	g_autoptr(GMainLoop) mainloop = g_main_loop_new (context, FALSE);
 	g_autoptr(GFile) qmi_device_file = g_file_new_for_path (self->qmi_port);
 	OpenContext ctx = {
 		.mainloop = mainloop,
@@ -187,7 +188,8 @@ fu_qmi_pdc_updater_qmi_device_release_client_ready (GObject *qmi_device, GAsyncR
 gboolean
 fu_qmi_pdc_updater_close (FuQmiPdcUpdater *self, GError **error)
 {
-	g_autoptr(GMainLoop) mainloop = g_main_loop_new (NULL, FALSE);
+	g_autoptr(GMainContext) context = g_main_context_ref_thread_default ();
+	g_autoptr(GMainLoop) mainloop = g_main_loop_new (context, FALSE);
 	CloseContext ctx = {
 		.mainloop = mainloop,
 		.qmi_device = g_steal_pointer (&self->qmi_device),
@@ -214,6 +216,29 @@ fu_qmi_pdc_updater_close (FuQmiPdcUpdater *self, GError **error)
 
 #define QMI_LOAD_CHUNK_SIZE 0x400
 
+/* the loops run on the thread-default context as the write may be done from
+ * a worker thread, so the timeouts have to be attached to the same context */
+static guint
+fu_qmi_pdc_updater_timeout_add_seconds (GMainLoop *mainloop,
+					guint interval,
+					GSourceFunc func,
+					gpointer user_data)
+{
+	g_autoptr(GSource) source = g_timeout_source_new_seconds (interval);
+	g_source_set_callback (source, func, user_data, NULL);
+	return g_source_attach (source, g_main_loop_get_context (mainloop));
+}
+
+static void
+fu_qmi_pdc_updater_timeout_remove (GMainLoop *mainloop, guint timeout_id)
+{
+	GSource *source;
+	source = g_main_context_find_source_by_id (g_main_loop_get_context (mainloop),
+						   timeout_id);
+	if (source != NULL)
+		g_source_destroy (source);
+}
+
 typedef struct {
 	GMainLoop	*mainloop;
 	QmiClientPdc	*qmi_client;
@@ -261,7 +286,7 @@ fu_qmi_pdc_updater_load_config_indication (QmiClientPdc *client,
 	guint32 remaining_size;
 	guint16 error_code = 0;
 
-	g_source_remove (ctx->timeout_id);
+	fu_qmi_pdc_updater_timeout_remove (ctx->mainloop, ctx->timeout_id);
 	ctx->timeout_id = 0;
 	g_signal_handler_disconnect (ctx->qmi_client, ctx->indication_id);
 	ctx->indication_id = 0;
@@ -336,7 +361,9 @@ fu_qmi_pdc_updater_load_config_ready (GObject *qmi_client, GAsyncResult *res, gp
 
 	/* don't wait forever */
 	g_warn_if_fail (ctx->timeout_id == 0);
-	ctx->timeout_id = g_timeout_add_seconds (5, fu_qmi_pdc_updater_load_config_timeout, ctx);
+	ctx->timeout_id = fu_qmi_pdc_updater_timeout_add_seconds (ctx->mainloop, 5,
+								 fu_qmi_pdc_updater_load_config_timeout,
+								 ctx);
 }
 
 static void
@@ -402,7 +429,8 @@ fu_qmi_pdc_updater_get_checksum (GBytes *blob)
 GArray *
 fu_qmi_pdc_updater_write (FuQmiPdcUpdater *self, const gchar *filename, GBytes *blob, GError **error)
 {
-	g_autoptr(GMainLoop) mainloop = g_main_loop_new (NULL, FALSE);
+	g_autoptr(GMainContext) context = g_main_context_ref_thread_default ();
+	g_autoptr(GMainLoop) mainloop = g_main_loop_new (context, FALSE);
 	g_autoptr(GArray) digest = fu_qmi_pdc_updater_get_checksum (blob);
 	WriteContext ctx = {
 		.mainloop = mainloop,
@@ -467,7 +495,7 @@ fu_qmi_pdc_updater_activate_config_indication (QmiClientPdc *client,
 {
 	guint16 error_code = 0;
 
-	g_source_remove (ctx->timeout_id);
+	fu_qmi_pdc_updater_timeout_remove (ctx->mainloop, ctx->timeout_id);
 	ctx->timeout_id = 0;
 	g_signal_handler_disconnect (ctx->qmi_client, ctx->indication_id);
 	ctx->indication_id = 0;
@@ -527,7 +555,9 @@ fu_qmi_pdc_updater_activate_config_ready (GObject *qmi_client, GAsyncResult *res
 
 	/* don't wait forever */
 	g_warn_if_fail (ctx->timeout_id == 0);
-	ctx->timeout_id = g_timeout_add_seconds (5, fu_qmi_pdc_updater_activate_config_timeout, ctx);
+	ctx->timeout_id = fu_qmi_pdc_updater_timeout_add_seconds (ctx->mainloop, 5,
+								 fu_qmi_pdc_updater_activate_config_timeout,
+								 ctx);
 }
 
 static void
@@ -575,7 +605,7 @@ fu_qmi_pdc_updater_set_selected_config_indication (QmiClientPdc *client,
 {
 	guint16 error_code = 0;
 
-	g_source_remove (ctx->timeout_id);
+	fu_qmi_pdc_updater_timeout_remove (ctx->mainloop, ctx->timeout_id);
 	ctx->timeout_id = 0;
 	g_signal_handler_disconnect (ctx->qmi_client, ctx->indication_id);
 	ctx->indication_id = 0;
@@ -623,7 +653,9 @@ fu_qmi_pdc_updater_set_selected_config_ready (GObject *qmi_client, GAsyncResult
 
 	/* don't wait forever */
 	g_warn_if_fail (ctx->timeout_id == 0);
-	ctx->timeout_id = g_timeout_add_seconds (5, fu_qmi_pdc_updater_set_selected_config_timeout, ctx);
+	ctx->timeout_id = fu_qmi_pdc_updater_timeout_add_seconds (ctx->mainloop, 5,
+								 fu_qmi_pdc_updater_set_selected_config_timeout,
+								 ctx);
 }
 
 static void
@@ -647,7 +679,8 @@ fu_qmi_pdc_updater_set_selected_config (ActivateContext *ctx)
 gboolean
 fu_qmi_pdc_updater_activate (FuQmiPdcUpdater *self, GArray *digest, GError **error)
 {
-	g_autoptr(GMainLoop) mainloop = g_main_loop_new (NULL, FALSE);
+	g_autoptr(GMainContext) context = g_main_context_ref_thread_default ();
+	g_autoptr(GMainLoop) mainloop = g_main_loop_new (context, FALSE);
 	ActivateContext ctx = {
 		.mainloop = mainloop,
 		.qmi_client = self->qmi_client,
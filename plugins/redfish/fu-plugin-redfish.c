@@ -50,6 +50,9 @@ fu_plugin_startup (FuPlugin *plugin, GError **error)
 {
 	FuPluginData *data = fu_plugin_get_data (plugin);
 	gboolean ca_check;
+	g_autofree gchar *cachedir = NULL;
+	g_autofree gchar *max_connections = NULL;
+	g_autofree gchar *redfish_cachedir = NULL;
 	g_autofree gchar *redfish_uri = NULL;
 	g_autoptr(GBytes) smbios_data = NULL;
 
@@ -109,6 +112,26 @@ fu_plugin_startup (FuPlugin *plugin, GError **error)
 
 	ca_check = fu_plugin_get_config_value_boolean (plugin, "CACheck");
 	fu_redfish_client_set_cacheck (data->client, ca_check);
+
+	/* number of inventory members fetched at the same time */
+	max_connections = fu_plugin_get_config_value (plugin, "MaxConnections");
+	if (max_connections != NULL) {
+		guint64 tmp = g_ascii_strtoull (max_connections, NULL, 10);
+		if (tmp == 0 || tmp > G_MAXUINT8) {
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_NOT_SUPPORTED,
+				     "invalid MaxConnections %s",
+				     max_connections);
+			return FALSE;
+		}
+		fu_redfish_client_set_max_connections (data->client, tmp);
+	}
+
+	/* responses are revalidated using the ETag on the next coldplug */
+	cachedir = fu_common_get_path (FU_PATH_KIND_CACHEDIR_PKG);
+	redfish_cachedir = g_build_filename (cachedir, "redfish", NULL);
+	fu_redfish_client_set_cache_dir (data->client, redfish_cachedir);
 	return fu_redfish_client_setup (data->client, smbios_data, error);
 }
 
@@ -118,6 +141,9 @@ fu_plugin_init (FuPlugin *plugin)
 	FuPluginData *data = fu_plugin_alloc_data (plugin, sizeof (FuPluginData));
 	data->client = fu_redfish_client_new ();
 	fu_plugin_set_build_hash (plugin, FU_BUILD_HASH);
+
+	/* the client only uses its own session and main context */
+	fu_plugin_set_coldplug_thread_safe (plugin, TRUE);
 }
 
 void
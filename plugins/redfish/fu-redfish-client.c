@@ -31,9 +31,14 @@ struct _FuRedfishClient
 	gboolean		 auth_created;
 	gboolean		 use_https;
 	gboolean		 cacheck;
+	guint			 max_connections;
+	gchar			*cache_dir;
+	gchar			*expand_query;
 	GPtrArray		*devices;
 };
 
+#define FU_REDFISH_CLIENT_MAX_CONNECTIONS_DEFAULT	4
+
 G_DEFINE_TYPE (FuRedfishClient, fu_redfish_client, G_TYPE_OBJECT)
 
 static void
@@ -58,10 +63,97 @@ fu_redfish_client_set_auth (FuRedfishClient *self, SoupURI *uri,
 	}
 }
 
+/* responses are cached by URI, and revalidated using the ETag */
+static gchar *
+fu_redfish_client_cache_filename (FuRedfishClient *self,
+				  SoupURI *uri,
+				  const gchar *suffix)
+{
+	g_autofree gchar *basename = NULL;
+	g_autofree gchar *checksum = NULL;
+	g_autofree gchar *uri_str = NULL;
+
+	if (self->cache_dir == NULL)
+		return NULL;
+	uri_str = soup_uri_to_string (uri, FALSE);
+	checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, uri_str, -1);
+	basename = g_strdup_printf ("%s.%s", checksum, suffix);
+	return g_build_filename (self->cache_dir, basename, NULL);
+}
+
+static gchar *
+fu_redfish_client_cache_get_etag (FuRedfishClient *self, SoupURI *uri)
+{
+	gchar *etag = NULL;
+	g_autofree gchar *fn_etag = NULL;
+	g_autofree gchar *fn_json = NULL;
+
+	fn_etag = fu_redfish_client_cache_filename (self, uri, "etag");
+	fn_json = fu_redfish_client_cache_filename (self, uri, "json");
+	if (fn_etag == NULL || fn_json == NULL)
+		return NULL;
+	if (!g_file_test (fn_json, G_FILE_TEST_EXISTS))
+		return NULL;
+	if (!g_file_get_contents (fn_etag, &etag, NULL, NULL))
+		return NULL;
+	return etag;
+}
+
 static GBytes *
-fu_redfish_client_fetch_data (FuRedfishClient *self, const gchar *uri_path, GError **error)
+fu_redfish_client_cache_load (FuRedfishClient *self, SoupURI *uri, GError **error)
+{
+	gchar *buf = NULL;
+	gsize bufsz = 0;
+	g_autofree gchar *fn = NULL;
+
+	fn = fu_redfish_client_cache_filename (self, uri, "json");
+	if (fn == NULL) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INTERNAL,
+				     "no cache directory");
+		return NULL;
+	}
+	if (!g_file_get_contents (fn, &buf, &bufsz, error))
+		return NULL;
+	return g_bytes_new_take (buf, bufsz);
+}
+
+static void
+fu_redfish_client_cache_save (FuRedfishClient *self, SoupURI *uri, SoupMessage *msg)
 {
-	guint status_code;
+	const gchar *etag;
+	g_autofree gchar *fn_etag = NULL;
+	g_autofree gchar *fn_json = NULL;
+	g_autoptr(GError) error_local = NULL;
+
+	if (self->cache_dir == NULL)
+		return;
+	etag = soup_message_headers_get_one (msg->response_headers, "ETag");
+	if (etag == NULL)
+		return;
+	if (g_mkdir_with_parents (self->cache_dir, 0700) == -1) {
+		g_debug ("failed to create %s", self->cache_dir);
+		return;
+	}
+	fn_etag = fu_redfish_client_cache_filename (self, uri, "etag");
+	fn_json = fu_redfish_client_cache_filename (self, uri, "json");
+	if (!g_file_set_contents (fn_json,
+				  msg->response_body->data,
+				  msg->response_body->length,
+				  &error_local) ||
+	    !g_file_set_contents (fn_etag, etag, -1, &error_local)) {
+		g_debug ("failed to cache response: %s", error_local->message);
+	}
+}
+
+static SoupMessage *
+fu_redfish_client_new_message (FuRedfishClient *self,
+			       const gchar *uri_path,
+			       const gchar *query,
+			       GError **error)
+{
+	g_autofree gchar *etag = NULL;
 	g_autoptr(SoupMessage) msg = NULL;
 	g_autoptr(SoupURI) uri = NULL;
 
@@ -69,6 +161,7 @@ fu_redfish_client_fetch_data (FuRedfishClient *self, const gchar *uri_path, GErr
 	uri = soup_uri_new (NULL);
 	soup_uri_set_scheme (uri, self->use_https ? "https" : "http");
 	soup_uri_set_path (uri, uri_path);
+	soup_uri_set_query (uri, query);
 	soup_uri_set_host (uri, self->hostname);
 	soup_uri_set_port (uri, self->port);
 	msg = soup_message_new_from_uri (SOUP_METHOD_GET, uri);
@@ -81,19 +174,154 @@ fu_redfish_client_fetch_data (FuRedfishClient *self, const gchar *uri_path, GErr
 		return NULL;
 	}
 	fu_redfish_client_set_auth (self, uri, msg);
-	status_code = soup_session_send_message (self->session, msg);
-	if (status_code != SOUP_STATUS_OK) {
+
+	/* only transfer the body if it changed since last time */
+	etag = fu_redfish_client_cache_get_etag (self, uri);
+	if (etag != NULL) {
+		soup_message_headers_append (msg->request_headers,
+					     "If-None-Match", etag);
+	}
+	return g_steal_pointer (&msg);
+}
+
+static GBytes *
+fu_redfish_client_message_get_bytes (FuRedfishClient *self,
+				     SoupMessage *msg,
+				     GError **error)
+{
+	SoupURI *uri = soup_message_get_uri (msg);
+
+	if (msg->status_code == SOUP_STATUS_NOT_MODIFIED) {
+		g_autofree gchar *tmp = soup_uri_to_string (uri, TRUE);
+		g_debug ("using cached response for %s", tmp);
+		return fu_redfish_client_cache_load (self, uri, error);
+	}
+	if (msg->status_code != SOUP_STATUS_OK) {
 		g_autofree gchar *tmp = soup_uri_to_string (uri, FALSE);
 		g_set_error (error,
 			     FWUPD_ERROR,
 			     FWUPD_ERROR_INVALID_FILE,
 			     "failed to download %s: %s",
-			     tmp, soup_status_get_phrase (status_code));
+			     tmp, soup_status_get_phrase (msg->status_code));
 		return NULL;
 	}
+	fu_redfish_client_cache_save (self, uri, msg);
 	return g_bytes_new (msg->response_body->data, msg->response_body->length);
 }
 
+static GBytes *
+fu_redfish_client_fetch_data_with_query (FuRedfishClient *self,
+					 const gchar *uri_path,
+					 const gchar *query,
+					 GError **error)
+{
+	g_autoptr(SoupMessage) msg = NULL;
+
+	msg = fu_redfish_client_new_message (self, uri_path, query, error);
+	if (msg == NULL)
+		return NULL;
+	soup_session_send_message (self->session, msg);
+	return fu_redfish_client_message_get_bytes (self, msg, error);
+}
+
+static GBytes *
+fu_redfish_client_fetch_data (FuRedfishClient *self, const gchar *uri_path, GError **error)
+{
+	return fu_redfish_client_fetch_data_with_query (self, uri_path, NULL, error);
+}
+
+typedef struct {
+	FuRedfishClient		*self;
+	GPtrArray		*uri_paths;	/* (element-type utf8) */
+	GPtrArray		*blobs;		/* (element-type GBytes) */
+	GMainLoop		*loop;
+	GError			*error;
+	guint			 idx_next;
+	guint			 pending;
+} FuRedfishClientFetchHelper;
+
+static void fu_redfish_client_fetch_queue (FuRedfishClientFetchHelper *helper);
+
+static void
+fu_redfish_client_fetch_cb (SoupSession *session, SoupMessage *msg, gpointer user_data)
+{
+	FuRedfishClientFetchHelper *helper = (FuRedfishClientFetchHelper *) user_data;
+	guint idx = GPOINTER_TO_UINT (g_object_get_data (G_OBJECT (msg), "fu-redfish-idx"));
+	g_autoptr(GError) error_local = NULL;
+	GBytes *blob;
+
+	helper->pending--;
+	blob = fu_redfish_client_message_get_bytes (helper->self, msg, &error_local);
+	if (blob == NULL) {
+		if (helper->error == NULL)
+			helper->error = g_steal_pointer (&error_local);
+	} else {
+		g_ptr_array_index (helper->blobs, idx) = blob;
+	}
+	fu_redfish_client_fetch_queue (helper);
+}
+
+/* keeps up to max_connections requests in flight */
+static void
+fu_redfish_client_fetch_queue (FuRedfishClientFetchHelper *helper)
+{
+	FuRedfishClient *self = helper->self;
+
+	while (helper->error == NULL &&
+	       helper->pending < self->max_connections &&
+	       helper->idx_next < helper->uri_paths->len) {
+		const gchar *uri_path = g_ptr_array_index (helper->uri_paths, helper->idx_next);
+		SoupMessage *msg;
+
+		msg = fu_redfish_client_new_message (self, uri_path, NULL, &helper->error);
+		if (msg == NULL)
+			break;
+		g_object_set_data (G_OBJECT (msg), "fu-redfish-idx",
+				   GUINT_TO_POINTER (helper->idx_next));
+		helper->idx_next++;
+		helper->pending++;
+		soup_session_queue_message (self->session, msg,
+					    fu_redfish_client_fetch_cb, helper);
+	}
+	if (helper->pending == 0)
+		g_main_loop_quit (helper->loop);
+}
+
+/* fetches all the URIs concurrently, returning the blobs in the same order */
+static GPtrArray *
+fu_redfish_client_fetch_data_many (FuRedfishClient *self,
+				   GPtrArray *uri_paths,
+				   GError **error)
+{
+	FuRedfishClientFetchHelper helper = {
+		.self		= self,
+		.uri_paths	= uri_paths,
+		.error		= NULL,
+		.idx_next	= 0,
+		.pending	= 0,
+	};
+	g_autoptr(GMainContext) context = g_main_context_new ();
+	g_autoptr(GMainLoop) loop = g_main_loop_new (context, FALSE);
+	g_autoptr(GPtrArray) blobs = NULL;
+
+	blobs = g_ptr_array_new_with_free_func ((GDestroyNotify) g_bytes_unref);
+	g_ptr_array_set_size (blobs, uri_paths->len);
+	helper.blobs = blobs;
+	helper.loop = loop;
+
+	/* the session dispatches to the thread-default context */
+	g_main_context_push_thread_default (context);
+	fu_redfish_client_fetch_queue (&helper);
+	if (helper.pending > 0)
+		g_main_loop_run (loop);
+	g_main_context_pop_thread_default (context);
+	if (helper.error != NULL) {
+		g_propagate_error (error, helper.error);
+		return NULL;
+	}
+	return g_steal_pointer (&blobs);
+}
+
 static gboolean
 fu_redfish_client_coldplug_member (FuRedfishClient *self,
 				   JsonObject *member,
@@ -148,23 +376,60 @@ fu_redfish_client_coldplug_member (FuRedfishClient *self,
 	return TRUE;
 }
 
+static JsonObject *
+fu_redfish_client_parse_object (JsonParser *parser, GBytes *blob, GError **error)
+{
+	JsonNode *node_root;
+	JsonObject *obj;
+
+	if (!json_parser_load_from_data (parser,
+					 g_bytes_get_data (blob, NULL),
+					 (gssize) g_bytes_get_size (blob),
+					 error)) {
+		g_prefix_error (error, "failed to parse node: ");
+		return NULL;
+	}
+	node_root = json_parser_get_root (parser);
+	if (node_root == NULL) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "no root node");
+		return NULL;
+	}
+	obj = json_node_get_object (node_root);
+	if (obj == NULL) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "no member object");
+		return NULL;
+	}
+	return obj;
+}
+
 static gboolean
 fu_redfish_client_coldplug_collection (FuRedfishClient *self,
 				       JsonObject *collection,
 				       GError **error)
 {
 	JsonArray *members;
-	JsonNode *node_root;
-	JsonObject *member;
+	g_autoptr(GPtrArray) blobs = NULL;
+	g_autoptr(GPtrArray) uri_paths = g_ptr_array_new ();
 
 	members = json_object_get_array_member (collection, "Members");
 	for (guint i = 0; i < json_array_get_length (members); i++) {
-		g_autoptr(JsonParser) parser = json_parser_new ();
-		g_autoptr(GBytes) blob = NULL;
 		JsonObject *member_id;
 		const gchar *member_uri;
 
+		/* already included using $expand */
 		member_id = json_array_get_object_element (members, i);
+		if (json_object_has_member (member_id, "Id")) {
+			if (!fu_redfish_client_coldplug_member (self, member_id, error))
+				return FALSE;
+			continue;
+		}
+
 		member_uri = json_object_get_string_member (member_id, "@odata.id");
 		if (member_uri == NULL) {
 			g_set_error_literal (error,
@@ -173,38 +438,24 @@ fu_redfish_client_coldplug_collection (FuRedfishClient *self,
 					     "no @odata.id string");
 			return FALSE;
 		}
+		g_ptr_array_add (uri_paths, (gpointer) member_uri);
+	}
+	if (uri_paths->len == 0)
+		return TRUE;
 
-		/* try to connect */
-		blob = fu_redfish_client_fetch_data (self, member_uri, error);
-		if (blob == NULL)
-			return FALSE;
+	/* fetch the rest in parallel */
+	blobs = fu_redfish_client_fetch_data_many (self, uri_paths, error);
+	if (blobs == NULL)
+		return FALSE;
+	for (guint i = 0; i < blobs->len; i++) {
+		GBytes *blob = g_ptr_array_index (blobs, i);
+		JsonObject *member;
+		g_autoptr(JsonParser) parser = json_parser_new ();
 
-		/* get the member object */
-		if (!json_parser_load_from_data (parser,
-						 g_bytes_get_data (blob, NULL),
-						 (gssize) g_bytes_get_size (blob),
-						 error)) {
-			g_prefix_error (error, "failed to parse node: ");
-			return FALSE;
-		}
-		node_root = json_parser_get_root (parser);
-		if (node_root == NULL) {
-			g_set_error_literal (error,
-					     FWUPD_ERROR,
-					     FWUPD_ERROR_INVALID_FILE,
-					     "no root node");
+		/* create the device for the member */
+		member = fu_redfish_client_parse_object (parser, blob, error);
+		if (member == NULL)
 			return FALSE;
-		}
-		member = json_node_get_object (node_root);
-		if (member == NULL) {
-			g_set_error_literal (error,
-					     FWUPD_ERROR,
-					     FWUPD_ERROR_INVALID_FILE,
-					     "no member object");
-			return FALSE;
-		}
-
-		/* Create the device for the member */
 		if (!fu_redfish_client_coldplug_member (self, member, error))
 			return FALSE;
 	}
@@ -239,8 +490,11 @@ fu_redfish_client_coldplug_inventory (FuRedfishClient *self,
 		return FALSE;
 	}
 
-	/* try to connect */
-	blob = fu_redfish_client_fetch_data (self, collection_uri, error);
+	/* try to connect, getting all the members in one request if possible */
+	blob = fu_redfish_client_fetch_data_with_query (self,
+							collection_uri,
+							self->expand_query,
+							error);
 	if (blob == NULL)
 		return FALSE;
 
@@ -568,19 +822,237 @@ fu_redfish_client_set_smbios_interfaces (FuRedfishClient *self,
 	return TRUE;
 }
 
+#define FU_REDFISH_CLIENT_UPLOAD_CHUNK_SIZE	0x10000		/* bytes */
+#define FU_REDFISH_CLIENT_TASK_POLL_INTERVAL	1		/* s */
+#define FU_REDFISH_CLIENT_TASK_TIMEOUT		1800		/* s */
+
+typedef struct {
+	FuRedfishClient		*self;
+	FuDevice		*device;
+	GMainLoop		*loop;
+	GError			*error;
+	SoupURI			*task_uri;
+	GTimer			*timer;
+	GSource			*source;
+	gsize			 written;
+	gsize			 total;
+} FuRedfishClientUpdateHelper;
+
+static gboolean fu_redfish_client_task_poll_cb (gpointer user_data);
+
+static void
+fu_redfish_client_update_helper_done (FuRedfishClientUpdateHelper *helper, GError *error)
+{
+	if (error != NULL)
+		helper->error = error;
+	g_main_loop_quit (helper->loop);
+}
+
+static void
+fu_redfish_client_task_schedule (FuRedfishClientUpdateHelper *helper)
+{
+	if (helper->source != NULL) {
+		g_source_destroy (helper->source);
+		g_source_unref (helper->source);
+	}
+	helper->source = g_timeout_source_new_seconds (FU_REDFISH_CLIENT_TASK_POLL_INTERVAL);
+	g_source_set_callback (helper->source, fu_redfish_client_task_poll_cb, helper, NULL);
+	g_source_attach (helper->source, g_main_loop_get_context (helper->loop));
+}
+
+/* returns TRUE if the task has finished, successfully or not */
+static gboolean
+fu_redfish_client_task_parse (FuRedfishClientUpdateHelper *helper,
+			      SoupMessage *msg,
+			      GError **error)
+{
+	JsonObject *obj;
+	const gchar *state;
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(JsonParser) parser = json_parser_new ();
+
+	/* a task monitor might not return the task at all */
+	if (msg->response_body->length == 0)
+		return msg->status_code != SOUP_STATUS_ACCEPTED;
+	blob = g_bytes_new (msg->response_body->data, msg->response_body->length);
+	obj = fu_redfish_client_parse_object (parser, blob, NULL);
+	if (obj == NULL || !json_object_has_member (obj, "TaskState"))
+		return msg->status_code != SOUP_STATUS_ACCEPTED;
+
+	if (json_object_has_member (obj, "PercentComplete")) {
+		gint64 pc = json_object_get_int_member (obj, "PercentComplete");
+		if (pc >= 0 && pc <= 100)
+			fu_device_set_progress (helper->device, (guint) pc);
+	}
+	state = json_object_get_string_member (obj, "TaskState");
+	g_debug ("task state: %s", state);
+	if (g_strcmp0 (state, "Completed") == 0)
+		return TRUE;
+	if (g_strcmp0 (state, "Exception") == 0 ||
+	    g_strcmp0 (state, "Killed") == 0 ||
+	    g_strcmp0 (state, "Cancelled") == 0 ||
+	    g_strcmp0 (state, "Interrupted") == 0) {
+		const gchar *message = NULL;
+		if (json_object_has_member (obj, "Messages")) {
+			JsonArray *messages = json_object_get_array_member (obj, "Messages");
+			if (messages != NULL && json_array_get_length (messages) > 0) {
+				JsonObject *tmp = json_array_get_object_element (messages, 0);
+				if (tmp != NULL && json_object_has_member (tmp, "Message"))
+					message = json_object_get_string_member (tmp, "Message");
+			}
+		}
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_WRITE,
+			     "task %s: %s",
+			     state, message != NULL ? message : "unknown failure");
+		return TRUE;
+	}
+	return FALSE;
+}
+
+static void
+fu_redfish_client_task_cb (SoupSession *session, SoupMessage *msg, gpointer user_data)
+{
+	FuRedfishClientUpdateHelper *helper = (FuRedfishClientUpdateHelper *) user_data;
+	g_autoptr(GError) error_local = NULL;
+
+	if (!SOUP_STATUS_IS_SUCCESSFUL (msg->status_code)) {
+		g_autofree gchar *tmp = soup_uri_to_string (helper->task_uri, FALSE);
+		g_set_error (&error_local,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_WRITE,
+			     "failed to get task %s: %s",
+			     tmp, soup_status_get_phrase (msg->status_code));
+		fu_redfish_client_update_helper_done (helper, g_steal_pointer (&error_local));
+		return;
+	}
+	if (fu_redfish_client_task_parse (helper, msg, &error_local)) {
+		fu_redfish_client_update_helper_done (helper, g_steal_pointer (&error_local));
+		return;
+	}
+	fu_redfish_client_task_schedule (helper);
+}
+
+static gboolean
+fu_redfish_client_task_poll_cb (gpointer user_data)
+{
+	FuRedfishClientUpdateHelper *helper = (FuRedfishClientUpdateHelper *) user_data;
+	FuRedfishClient *self = helper->self;
+	SoupMessage *msg;
+
+	g_source_unref (helper->source);
+	helper->source = NULL;
+	if (g_timer_elapsed (helper->timer, NULL) > FU_REDFISH_CLIENT_TASK_TIMEOUT) {
+		GError *error = NULL;
+		g_set_error (&error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_WRITE,
+			     "task did not complete in %us",
+			     (guint) FU_REDFISH_CLIENT_TASK_TIMEOUT);
+		fu_redfish_client_update_helper_done (helper, error);
+		return G_SOURCE_REMOVE;
+	}
+	msg = soup_message_new_from_uri (SOUP_METHOD_GET, helper->task_uri);
+	fu_redfish_client_set_auth (self, helper->task_uri, msg);
+	soup_session_queue_message (self->session, msg,
+				    fu_redfish_client_task_cb, helper);
+	return G_SOURCE_REMOVE;
+}
+
+static SoupURI *
+fu_redfish_client_get_task_uri (SoupMessage *msg)
+{
+	JsonObject *obj;
+	const gchar *location;
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(JsonParser) parser = json_parser_new ();
+
+	/* the standard way to return the task monitor */
+	location = soup_message_headers_get_one (msg->response_headers, "Location");
+	if (location != NULL)
+		return soup_uri_new_with_base (soup_message_get_uri (msg), location);
+
+	/* some services return the task itself */
+	if (msg->response_body->length == 0)
+		return NULL;
+	blob = g_bytes_new (msg->response_body->data, msg->response_body->length);
+	obj = fu_redfish_client_parse_object (parser, blob, NULL);
+	if (obj == NULL)
+		return NULL;
+	if (json_object_has_member (obj, "TaskMonitor")) {
+		location = json_object_get_string_member (obj, "TaskMonitor");
+	} else if (json_object_has_member (obj, "TaskState")) {
+		location = json_object_get_string_member (obj, "@odata.id");
+	}
+	if (location == NULL)
+		return NULL;
+	return soup_uri_new_with_base (soup_message_get_uri (msg), location);
+}
+
+static void
+fu_redfish_client_upload_cb (SoupSession *session, SoupMessage *msg, gpointer user_data)
+{
+	FuRedfishClientUpdateHelper *helper = (FuRedfishClientUpdateHelper *) user_data;
+
+	if (!SOUP_STATUS_IS_SUCCESSFUL (msg->status_code)) {
+		GError *error = NULL;
+		g_autofree gchar *tmp = soup_uri_to_string (soup_message_get_uri (msg), FALSE);
+		g_set_error (&error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "failed to upload to %s: %s",
+			     tmp, soup_status_get_phrase (msg->status_code));
+		fu_redfish_client_update_helper_done (helper, error);
+		return;
+	}
+
+	/* the BMC applies the update in the background */
+	helper->task_uri = fu_redfish_client_get_task_uri (msg);
+	if (helper->task_uri == NULL) {
+		fu_redfish_client_update_helper_done (helper, NULL);
+		return;
+	}
+	fu_device_set_status (helper->device, FWUPD_STATUS_DEVICE_BUSY);
+	fu_device_set_progress (helper->device, 0);
+	g_timer_start (helper->timer);
+	fu_redfish_client_task_schedule (helper);
+}
+
+static void
+fu_redfish_client_wrote_body_data_cb (SoupMessage *msg, SoupBuffer *chunk, gpointer user_data)
+{
+	FuRedfishClientUpdateHelper *helper = (FuRedfishClientUpdateHelper *) user_data;
+	helper->written += chunk->length;
+	fu_device_set_progress_full (helper->device, helper->written, helper->total);
+}
+
 gboolean
 fu_redfish_client_update (FuRedfishClient *self, FuDevice *device, GBytes *blob_fw,
 			  GError **error)
 {
 	FwupdRelease *release;
+	FuRedfishClientUpdateHelper helper = {
+		.self		= self,
+		.device		= device,
+		.error		= NULL,
+		.task_uri	= NULL,
+		.source		= NULL,
+		.written	= 0,
+	};
+	gsize bufsz = 0;
+	const guint8 *buf = g_bytes_get_data (blob_fw, &bufsz);
+	g_autofree gchar *boundary = NULL;
+	g_autofree gchar *content_type = NULL;
 	g_autofree gchar *filename = NULL;
-
-	guint status_code;
+	g_autofree gchar *header = NULL;
+	g_autofree gchar *trailer = NULL;
+	g_autoptr(GMainContext) context = g_main_context_ref_thread_default ();
+	g_autoptr(GMainLoop) loop = g_main_loop_new (context, FALSE);
+	g_autoptr(GTimer) timer = g_timer_new ();
+	g_autoptr(SoupBuffer) buffer = NULL;
 	g_autoptr(SoupMessage) msg = NULL;
 	g_autoptr(SoupURI) uri = NULL;
-	g_autoptr(SoupMultipart) multipart = NULL;
-	g_autoptr(SoupBuffer) buffer = NULL;
-	g_autofree gchar *uri_str = NULL;
 
 	/* Get the update version */
 	release = fwupd_device_get_release_default (FWUPD_DEVICE (device));
@@ -599,18 +1071,9 @@ fu_redfish_client_update (FuRedfishClient *self, FuDevice *device, GBytes *blob_
 	soup_uri_set_path (uri, self->push_uri_path);
 	soup_uri_set_host (uri, self->hostname);
 	soup_uri_set_port (uri, self->port);
-	uri_str = soup_uri_to_string (uri, FALSE);
-
-	/* Create the multipart request */
-	multipart = soup_multipart_new (SOUP_FORM_MIME_TYPE_MULTIPART);
-	buffer = soup_buffer_new (SOUP_MEMORY_COPY,
-				  g_bytes_get_data (blob_fw, NULL),
-				  g_bytes_get_size (blob_fw));
-	soup_multipart_append_form_file (multipart, filename, filename,
-					 "application/octet-stream",
-					 buffer);
-	msg = soup_form_request_new_from_multipart (uri_str, multipart);
+	msg = soup_message_new_from_uri (SOUP_METHOD_POST, uri);
 	if (msg == NULL) {
+		g_autofree gchar *uri_str = soup_uri_to_string (uri, FALSE);
 		g_set_error (error,
 			     FWUPD_ERROR,
 			     FWUPD_ERROR_INVALID_FILE,
@@ -618,17 +1081,55 @@ fu_redfish_client_update (FuRedfishClient *self, FuDevice *device, GBytes *blob_
 		return FALSE;
 	}
 	fu_redfish_client_set_auth (self, uri, msg);
-	status_code = soup_session_send_message (self->session, msg);
-	if (status_code != SOUP_STATUS_OK) {
-		g_set_error (error,
-			     FWUPD_ERROR,
-			     FWUPD_ERROR_INVALID_FILE,
-			     "failed to upload %s to %s: %s",
-			     filename, uri_str,
-			     soup_status_get_phrase (status_code));
+
+	/* create the multipart request, sending the payload without copying
+	 * it so the progress is updated as each chunk is written */
+	boundary = g_strdup_printf ("fwupd-%08x%08x", g_random_int (), g_random_int ());
+	content_type = g_strdup_printf ("%s; boundary=\"%s\"",
+					SOUP_FORM_MIME_TYPE_MULTIPART, boundary);
+	soup_message_headers_replace (msg->request_headers,
+				      "Content-Type", content_type);
+	header = g_strdup_printf ("--%s\r\n"
+				  "Content-Disposition: form-data; name=\"%s\"; filename=\"%s\"\r\n"
+				  "Content-Type: application/octet-stream\r\n\r\n",
+				  boundary, filename, filename);
+	trailer = g_strdup_printf ("\r\n--%s--\r\n", boundary);
+	soup_message_body_append (msg->request_body, SOUP_MEMORY_COPY,
+				  header, strlen (header));
+	buffer = soup_buffer_new_with_owner (buf, bufsz,
+					     g_bytes_ref (blob_fw),
+					     (GDestroyNotify) g_bytes_unref);
+	for (gsize i = 0; i < bufsz; i += FU_REDFISH_CLIENT_UPLOAD_CHUNK_SIZE) {
+		gsize chunksz = MIN (bufsz - i, FU_REDFISH_CLIENT_UPLOAD_CHUNK_SIZE);
+		g_autoptr(SoupBuffer) chunk = soup_buffer_new_subbuffer (buffer, i, chunksz);
+		soup_message_body_append_buffer (msg->request_body, chunk);
+	}
+	soup_message_body_append (msg->request_body, SOUP_MEMORY_COPY,
+				  trailer, strlen (trailer));
+	helper.total = msg->request_body->length;
+	g_signal_connect (msg, "wrote-body-data",
+			  G_CALLBACK (fu_redfish_client_wrote_body_data_cb),
+			  &helper);
+
+	/* upload, then wait for the task without blocking the main loop */
+	helper.loop = loop;
+	helper.timer = timer;
+	fu_device_set_status (device, FWUPD_STATUS_DEVICE_WRITE);
+	soup_session_queue_message (self->session, g_object_ref (msg),
+				    fu_redfish_client_upload_cb, &helper);
+	g_main_loop_run (loop);
+	g_signal_handlers_disconnect_by_data (msg, &helper);
+	if (helper.source != NULL) {
+		g_source_destroy (helper.source);
+		g_source_unref (helper.source);
+	}
+	if (helper.task_uri != NULL)
+		soup_uri_free (helper.task_uri);
+	if (helper.error != NULL) {
+		g_propagate_prefixed_error (error, helper.error,
+					    "failed to update %s: ", filename);
 		return FALSE;
 	}
-
 	return TRUE;
 }
 
@@ -665,6 +1166,8 @@ fu_redfish_client_setup (FuRedfishClient *self, GBytes *smbios_table, GError **e
 	user_agent = g_strdup_printf ("%s/%s", PACKAGE_NAME, PACKAGE_VERSION);
 	self->session = soup_session_new_with_options (SOUP_SESSION_USER_AGENT, user_agent,
 						       SOUP_SESSION_TIMEOUT, 60,
+						       SOUP_SESSION_MAX_CONNS, self->max_connections,
+						       SOUP_SESSION_MAX_CONNS_PER_HOST, self->max_connections,
 						       NULL);
 	if (self->session == NULL) {
 		g_set_error_literal (error,
@@ -744,6 +1247,28 @@ fu_redfish_client_setup (FuRedfishClient *self, GBytes *smbios_table, GError **e
 	g_debug ("UUID:     %s",
 		 json_object_get_string_member (obj_root, "UUID"));
 
+	/* expand the inventory members inline if supported */
+	if (json_object_has_member (obj_root, "ProtocolFeaturesSupported")) {
+		JsonObject *obj_features = json_object_get_object_member (obj_root, "ProtocolFeaturesSupported");
+		if (obj_features != NULL &&
+		    json_object_has_member (obj_features, "ExpandQuery")) {
+			JsonObject *obj_expand = json_object_get_object_member (obj_features, "ExpandQuery");
+			g_free (self->expand_query);
+			self->expand_query = NULL;
+			if (obj_expand != NULL &&
+			    json_object_has_member (obj_expand, "NoLinks") &&
+			    json_object_get_boolean_member (obj_expand, "NoLinks")) {
+				self->expand_query = g_strdup ("$expand=.");
+			} else if (obj_expand != NULL &&
+				   json_object_has_member (obj_expand, "ExpandAll") &&
+				   json_object_get_boolean_member (obj_expand, "ExpandAll")) {
+				self->expand_query = g_strdup ("$expand=*");
+			}
+		}
+	}
+	if (self->expand_query != NULL)
+		g_debug ("Expand:   %s", self->expand_query);
+
 	if (json_object_has_member (obj_root, "UpdateService"))
 		obj_update_service = json_object_get_object_member (obj_root, "UpdateService");
 	if (obj_update_service == NULL) {
@@ -796,6 +1321,19 @@ fu_redfish_client_set_cacheck (FuRedfishClient *self, gboolean cacheck)
 	self->cacheck = cacheck;
 }
 
+void
+fu_redfish_client_set_max_connections (FuRedfishClient *self, guint max_connections)
+{
+	self->max_connections = max_connections;
+}
+
+void
+fu_redfish_client_set_cache_dir (FuRedfishClient *self, const gchar *cache_dir)
+{
+	g_free (self->cache_dir);
+	self->cache_dir = g_strdup (cache_dir);
+}
+
 void
 fu_redfish_client_set_username (FuRedfishClient *self, const gchar *username)
 {
@@ -821,6 +1359,8 @@ fu_redfish_client_finalize (GObject *object)
 	g_free (self->hostname);
 	g_free (self->username);
 	g_free (self->password);
+	g_free (self->cache_dir);
+	g_free (self->expand_query);
 	g_ptr_array_unref (self->devices);
 	G_OBJECT_CLASS (fu_redfish_client_parent_class)->finalize (object);
 }
@@ -835,6 +1375,7 @@ fu_redfish_client_class_init (FuRedfishClientClass *klass)
 static void
 fu_redfish_client_init (FuRedfishClient *self)
 {
+	self->max_connections = FU_REDFISH_CLIENT_MAX_CONNECTIONS_DEFAULT;
 	self->devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 }
 
@@ -25,6 +25,10 @@ void		 fu_redfish_client_set_https	(FuRedfishClient	*self,
 						 gboolean		 use_https);
 void		 fu_redfish_client_set_cacheck	(FuRedfishClient	*self,
 						 gboolean		 cacheck);
+void		 fu_redfish_client_set_max_connections	(FuRedfishClient	*self,
+							 guint			 max_connections);
+void		 fu_redfish_client_set_cache_dir	(FuRedfishClient	*self,
+							 const gchar		*cache_dir);
 gboolean	 fu_redfish_client_update       (FuRedfishClient	*self,
 						 FuDevice		*device,
 						 GBytes			*blob_fw,
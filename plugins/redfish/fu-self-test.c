@@ -7,11 +7,188 @@
 #include "config.h"
 
 #include <fwupd.h>
+#include <libsoup/soup.h>
+#include <string.h>
 
 #include "fu-plugin-private.h"
 
+#include "fu-redfish-client.h"
 #include "fu-redfish-common.h"
 
+typedef struct {
+	SoupServer		*server;
+	GMainContext		*context;
+	GMainLoop		*loop;
+	GThread			*thread;
+	guint			 port;
+	gboolean		 expand;
+	gint			 cnt_requests;
+	gint			 cnt_not_modified;
+	gint			 cnt_task_polls;
+	gsize			 upload_size;
+} FuTestRedfishServer;
+
+static const gchar *fu_test_redfish_member_ids[] = { "BMC", "BIOS", "NIC", NULL };
+
+static gchar *
+fu_test_redfish_member_json (const gchar *id)
+{
+	g_autofree gchar *guid = fwupd_guid_hash_string (id);
+	return g_strdup_printf ("{\"@odata.id\":\"/redfish/v1/UpdateService/FirmwareInventory/%s\","
+				"\"Id\":\"%s\",\"Name\":\"%s\",\"Version\":\"1.2.3\","
+				"\"SoftwareId\":\"%s\",\"Updateable\":true}",
+				id, id, id, guid);
+}
+
+static void
+fu_test_redfish_server_cb (SoupServer *server,
+			   SoupMessage *msg,
+			   const gchar *path,
+			   GHashTable *query,
+			   SoupClientContext *client,
+			   gpointer user_data)
+{
+	FuTestRedfishServer *self = (FuTestRedfishServer *) user_data;
+	const gchar *prefix = "/redfish/v1/UpdateService/FirmwareInventory/";
+	g_autofree gchar *json = NULL;
+
+	g_atomic_int_inc (&self->cnt_requests);
+	if (g_strcmp0 (path, "/redfish/v1/") == 0) {
+		json = g_strdup_printf ("{\"RedfishVersion\":\"1.6.0\","
+					"\"UUID\":\"92384634-2938-2342-8820-489239905423\","
+					"\"UpdateService\":{\"@odata.id\":\"/redfish/v1/UpdateService\"},"
+					"\"ProtocolFeaturesSupported\":{\"ExpandQuery\":{\"NoLinks\":%s}}}",
+					self->expand ? "true" : "false");
+	} else if (g_strcmp0 (path, "/redfish/v1/UpdateService") == 0) {
+		json = g_strdup ("{\"ServiceEnabled\":true,"
+				 "\"HttpPushUri\":\"/FWUpdate\","
+				 "\"FirmwareInventory\":{\"@odata.id\":\"/redfish/v1/UpdateService/FirmwareInventory\"}}");
+	} else if (g_strcmp0 (path, "/redfish/v1/UpdateService/FirmwareInventory") == 0) {
+		gboolean expand = query != NULL && g_hash_table_contains (query, "$expand");
+		g_autoptr(GString) str = g_string_new ("{\"Members\":[");
+		for (guint i = 0; fu_test_redfish_member_ids[i] != NULL; i++) {
+			if (i > 0)
+				g_string_append (str, ",");
+			if (expand) {
+				g_autofree gchar *tmp = fu_test_redfish_member_json (fu_test_redfish_member_ids[i]);
+				g_string_append (str, tmp);
+			} else {
+				g_string_append_printf (str, "{\"@odata.id\":\"%s%s\"}",
+							prefix, fu_test_redfish_member_ids[i]);
+			}
+		}
+		g_string_append (str, "]}");
+		json = g_string_free (g_steal_pointer (&str), FALSE);
+	} else if (g_strcmp0 (path, "/FWUpdate") == 0) {
+		SoupBuffer *buf = NULL;
+		g_autoptr(SoupMultipart) multipart = NULL;
+
+		multipart = soup_multipart_new_from_message (msg->request_headers,
+							     msg->request_body);
+		if (msg->method != SOUP_METHOD_POST || multipart == NULL ||
+		    !soup_multipart_get_part (multipart, 0, NULL, &buf)) {
+			soup_message_set_status (msg, SOUP_STATUS_BAD_REQUEST);
+			return;
+		}
+		self->upload_size = buf->length;
+		soup_message_headers_replace (msg->response_headers, "Location",
+					      "/redfish/v1/TaskService/TaskMonitors/1");
+		soup_message_set_status (msg, SOUP_STATUS_ACCEPTED);
+		return;
+	} else if (g_strcmp0 (path, "/redfish/v1/TaskService/TaskMonitors/1") == 0) {
+		gint cnt = g_atomic_int_add (&self->cnt_task_polls, 1);
+		json = g_strdup_printf ("{\"@odata.id\":\"/redfish/v1/TaskService/Tasks/1\","
+					"\"TaskState\":\"%s\",\"PercentComplete\":%i}",
+					cnt > 0 ? "Completed" : "Running",
+					cnt > 0 ? 100 : 50);
+	} else if (g_str_has_prefix (path, prefix)) {
+		const gchar *etag_old;
+		g_autofree gchar *etag = NULL;
+
+		/* only the members have an ETag */
+		etag = g_strdup_printf ("\"%s-1\"", path + strlen (prefix));
+		etag_old = soup_message_headers_get_one (msg->request_headers, "If-None-Match");
+		if (g_strcmp0 (etag_old, etag) == 0) {
+			g_atomic_int_inc (&self->cnt_not_modified);
+			soup_message_set_status (msg, SOUP_STATUS_NOT_MODIFIED);
+			return;
+		}
+		soup_message_headers_replace (msg->response_headers, "ETag", etag);
+		json = fu_test_redfish_member_json (path + strlen (prefix));
+	} else {
+		soup_message_set_status (msg, SOUP_STATUS_NOT_FOUND);
+		return;
+	}
+	soup_message_set_status (msg, SOUP_STATUS_OK);
+	soup_message_set_response (msg, "application/json",
+				   SOUP_MEMORY_COPY, json, strlen (json));
+}
+
+/* the client blocks, so the server has to run in a different thread */
+static gpointer
+fu_test_redfish_server_thread_cb (gpointer user_data)
+{
+	FuTestRedfishServer *self = (FuTestRedfishServer *) user_data;
+	g_main_context_push_thread_default (self->context);
+	g_main_loop_run (self->loop);
+	g_main_context_pop_thread_default (self->context);
+	return NULL;
+}
+
+static FuTestRedfishServer *
+fu_test_redfish_server_new (gboolean expand)
+{
+	FuTestRedfishServer *self = g_new0 (FuTestRedfishServer, 1);
+	gboolean ret;
+	g_autoptr(GError) error = NULL;
+	GSList *uris;
+
+	self->expand = expand;
+	self->context = g_main_context_new ();
+	self->loop = g_main_loop_new (self->context, FALSE);
+
+	/* the listening socket uses the thread-default context */
+	g_main_context_push_thread_default (self->context);
+	self->server = soup_server_new (SOUP_SERVER_SERVER_HEADER, "fwupd-self-test", NULL);
+	soup_server_add_handler (self->server, NULL, fu_test_redfish_server_cb, self, NULL);
+	ret = soup_server_listen_local (self->server, 0,
+					SOUP_SERVER_LISTEN_IPV4_ONLY,
+					&error);
+	g_main_context_pop_thread_default (self->context);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	uris = soup_server_get_uris (self->server);
+	g_assert_nonnull (uris);
+	self->port = soup_uri_get_port (uris->data);
+	g_slist_free_full (uris, (GDestroyNotify) soup_uri_free);
+
+	self->thread = g_thread_new ("redfish-server", fu_test_redfish_server_thread_cb, self);
+	return self;
+}
+
+static void
+fu_test_redfish_server_free (FuTestRedfishServer *self)
+{
+	g_main_loop_quit (self->loop);
+	g_thread_join (self->thread);
+	soup_server_disconnect (self->server);
+	g_object_unref (self->server);
+	g_main_loop_unref (self->loop);
+	g_main_context_unref (self->context);
+	g_free (self);
+}
+
+static FuRedfishClient *
+fu_test_redfish_client_new (FuTestRedfishServer *server, const gchar *cache_dir)
+{
+	FuRedfishClient *client = fu_redfish_client_new ();
+	fu_redfish_client_set_hostname (client, "127.0.0.1");
+	fu_redfish_client_set_port (client, server->port);
+	fu_redfish_client_set_max_connections (client, 2);
+	fu_redfish_client_set_cache_dir (client, cache_dir);
+	return client;
+}
+
 static void
 fu_test_redfish_common_func (void)
 {
@@ -26,11 +203,132 @@ fu_test_redfish_common_func (void)
 	g_assert_cmpstr (ipv6, ==, "00010203:04050607:08090a0b:0c0d0e0f");
 }
 
+static void
+fu_test_redfish_client_coldplug_func (void)
+{
+	FuTestRedfishServer *server = fu_test_redfish_server_new (FALSE);
+	GPtrArray *devices;
+	gboolean ret;
+	g_autofree gchar *cache_dir = NULL;
+	g_autoptr(FuRedfishClient) client1 = NULL;
+	g_autoptr(FuRedfishClient) client2 = NULL;
+	g_autoptr(GError) error = NULL;
+
+	cache_dir = g_dir_make_tmp ("fwupd-redfish-XXXXXX", &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (cache_dir);
+
+	/* members are fetched in parallel, but returned in order */
+	client1 = fu_test_redfish_client_new (server, cache_dir);
+	ret = fu_redfish_client_setup (client1, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = fu_redfish_client_coldplug (client1, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	devices = fu_redfish_client_get_devices (client1);
+	g_assert_cmpint (devices->len, ==, 3);
+	for (guint i = 0; i < devices->len; i++) {
+		FuDevice *device = g_ptr_array_index (devices, i);
+		g_assert_cmpstr (fu_device_get_name (device), ==, fu_test_redfish_member_ids[i]);
+		g_assert_cmpstr (fu_device_get_version (device), ==, "1.2.3");
+	}
+	g_assert_cmpint (g_atomic_int_get (&server->cnt_requests), ==, 6);
+	g_assert_cmpint (g_atomic_int_get (&server->cnt_not_modified), ==, 0);
+
+	/* the members are not downloaded again */
+	client2 = fu_test_redfish_client_new (server, cache_dir);
+	ret = fu_redfish_client_setup (client2, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = fu_redfish_client_coldplug (client2, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	devices = fu_redfish_client_get_devices (client2);
+	g_assert_cmpint (devices->len, ==, 3);
+	g_assert_cmpstr (fu_device_get_version (g_ptr_array_index (devices, 2)), ==, "1.2.3");
+	g_assert_cmpint (g_atomic_int_get (&server->cnt_not_modified), ==, 3);
+
+	ret = fu_common_rmtree (cache_dir, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	fu_test_redfish_server_free (server);
+}
+
+static void
+fu_test_redfish_client_expand_func (void)
+{
+	FuTestRedfishServer *server = fu_test_redfish_server_new (TRUE);
+	GPtrArray *devices;
+	gboolean ret;
+	g_autoptr(FuRedfishClient) client = NULL;
+	g_autoptr(GError) error = NULL;
+
+	/* the members are included in the collection */
+	client = fu_test_redfish_client_new (server, NULL);
+	ret = fu_redfish_client_setup (client, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = fu_redfish_client_coldplug (client, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	devices = fu_redfish_client_get_devices (client);
+	g_assert_cmpint (devices->len, ==, 3);
+	g_assert_cmpstr (fu_device_get_name (g_ptr_array_index (devices, 0)), ==, "BMC");
+	g_assert_cmpint (g_atomic_int_get (&server->cnt_requests), ==, 3);
+	fu_test_redfish_server_free (server);
+}
+
+static void
+fu_test_redfish_client_update_progress_cb (FuDevice *device, GParamSpec *pspec, gpointer user_data)
+{
+	guint *cnt = (guint *) user_data;
+	(*cnt)++;
+}
+
+static void
+fu_test_redfish_client_update_func (void)
+{
+	FuTestRedfishServer *server = fu_test_redfish_server_new (FALSE);
+	gboolean ret;
+	guint cnt_progress = 0;
+	g_autoptr(FuDevice) device = fu_device_new ();
+	g_autoptr(FuRedfishClient) client = NULL;
+	g_autoptr(GBytes) blob_fw = NULL;
+	g_autoptr(GError) error = NULL;
+
+	client = fu_test_redfish_client_new (server, NULL);
+	ret = fu_redfish_client_setup (client, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = fu_redfish_client_coldplug (client, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+
+	/* the payload is sent in chunks, then the task monitor is polled */
+	blob_fw = g_bytes_new_take (g_malloc0 (0x40000), 0x40000);
+	fu_device_set_name (device, "BMC");
+	g_signal_connect (device, "notify::progress",
+			  G_CALLBACK (fu_test_redfish_client_update_progress_cb),
+			  &cnt_progress);
+	ret = fu_redfish_client_update (client, device, blob_fw, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_cmpint (server->upload_size, ==, 0x40000);
+	g_assert_cmpint (g_atomic_int_get (&server->cnt_task_polls), ==, 2);
+	g_assert_cmpint (cnt_progress, >, 2);
+	g_assert_cmpint (fu_device_get_progress (device), ==, 100);
+	fu_test_redfish_server_free (server);
+}
+
 int
 main (int argc, char **argv)
 {
 	g_test_init (&argc, &argv, NULL);
 	g_log_set_fatal_mask (NULL, G_LOG_LEVEL_ERROR | G_LOG_LEVEL_CRITICAL);
 	g_test_add_func ("/redfish/common", fu_test_redfish_common_func);
+	g_test_add_func ("/redfish/client{coldplug}", fu_test_redfish_client_coldplug_func);
+	g_test_add_func ("/redfish/client{expand}", fu_test_redfish_client_expand_func);
+	g_test_add_func ("/redfish/client{update}", fu_test_redfish_client_update_func);
 	return g_test_run ();
 }
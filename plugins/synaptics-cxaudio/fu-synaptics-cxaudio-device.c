@@ -110,7 +110,8 @@ fu_synaptics_cxaudio_device_operation (FuSynapticsCxaudioDevice *self,
 	const guint32 idx_write = 0x5;
 	const guint32 payload_max = 0x20;
 	guint32 size = 0x02800;
-	g_autoptr(GPtrArray) chunks = NULL;
+	FuChunk chk;
+	FuChunkIter iter;
 
 	g_return_val_if_fail (bufsz > 0, FALSE);
 	g_return_val_if_fail (buf != NULL, FALSE);
@@ -139,9 +140,8 @@ fu_synaptics_cxaudio_device_operation (FuSynapticsCxaudioDevice *self,
 	}
 
 	/* send to hardware */
-	chunks = fu_chunk_array_new (buf, bufsz, addr, 0x0, payload_max);
-	for (guint i = 0; i < chunks->len; i++) {
-		FuChunk *chunk = g_ptr_array_index (chunks, i);
+	fu_chunk_iter_init (&iter, buf, bufsz, addr, 0x0, payload_max);
+	while (fu_chunk_iter_next (&iter, &chk)) {
 		guint8 inbuf[FU_SYNAPTICS_CXAUDIO_INPUT_REPORT_SIZE] = { 0 };
 		guint8 outbuf[FU_SYNAPTICS_CXAUDIO_OUTPUT_REPORT_SIZE] = { 0 };
 
@@ -149,10 +149,10 @@ fu_synaptics_cxaudio_device_operation (FuSynapticsCxaudioDevice *self,
 		outbuf[0] = FU_SYNAPTICS_CXAUDIO_MEM_WRITEID;
 
 		/* set memory address and payload length (if relevant) */
-		if (chunk->address >= 64 * 1024)
+		if (chk.address >= 64 * 1024)
 			outbuf[1] |= 1 << 4;
-		outbuf[2] = chunk->data_sz;
-		fu_common_write_uint16 (outbuf + 3, chunk->address, G_BIG_ENDIAN);
+		outbuf[2] = chk.data_sz;
+		fu_common_write_uint16 (outbuf + 3, chk.address, G_BIG_ENDIAN);
 
 		/* set memtype */
 		if (mem_kind == FU_SYNAPTICS_CXAUDIO_MEM_KIND_EEPROM)
@@ -162,8 +162,8 @@ fu_synaptics_cxaudio_device_operation (FuSynapticsCxaudioDevice *self,
 		if (operation == FU_SYNAPTICS_CXAUDIO_OPERATION_WRITE) {
 			outbuf[1] |= 1 << 6;
 			if (!fu_memcpy_safe (outbuf, sizeof(outbuf), idx_write, /* dst */
-					     chunk->data, chunk->data_sz, 0x0, /* src */
-					     chunk->data_sz, error))
+					     chk.data, chk.data_sz, 0x0, /* src */
+					     chk.data_sz, error))
 				return FALSE;
 		}
 		if (!fu_synaptics_cxaudio_device_output_report (self, outbuf, sizeof(outbuf), error))
@@ -191,14 +191,14 @@ fu_synaptics_cxaudio_device_operation (FuSynapticsCxaudioDevice *self,
 							  error)) {
 				g_prefix_error (error,
 						"failed to verify on packet %u @0x%x: ",
-						chunk->idx, chunk->address);
+						chk.idx, chk.address);
 				return FALSE;
 			}
 		}
 		if (operation == FU_SYNAPTICS_CXAUDIO_OPERATION_READ) {
-			if (!fu_memcpy_safe ((guint8 *) chunk->data, chunk->data_sz, 0x0, /* dst */
+			if (!fu_memcpy_safe ((guint8 *) chk.data, chk.data_sz, 0x0, /* dst */
 					     inbuf, sizeof(inbuf), idx_read, /* src */
-					     chunk->data_sz, error))
+					     chk.data_sz, error))
 				return FALSE;
 		}
 	}
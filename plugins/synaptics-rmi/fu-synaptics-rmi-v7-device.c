@@ -209,19 +209,19 @@ fu_synaptics_rmi_v7_device_write_blocks (FuSynapticsRmiDevice *self,
 					 GError **error)
 {
 	FuSynapticsRmiFlash *flash = fu_synaptics_rmi_device_get_flash (self);
-	g_autoptr(GPtrArray) chunks = NULL;
+	FuChunk chk;
+	FuChunkIter iter;
 
 	/* write FW blocks */
-	chunks = fu_chunk_array_new (data, datasz,
-				     0x00,	/* start addr */
-				     0x00,	/* page_sz */
-				     flash->block_size);
-	for (guint i = 0; i < chunks->len; i++) {
-		FuChunk *chk = g_ptr_array_index (chunks, i);
+	fu_chunk_iter_init (&iter, data, datasz,
+			    0x00,	/* start addr */
+			    0x00,	/* page_sz */
+			    flash->block_size);
+	while (fu_chunk_iter_next (&iter, &chk)) {
 		g_autoptr(GByteArray) req = g_byte_array_new ();
-		g_byte_array_append (req, chk->data, chk->data_sz);
+		g_byte_array_append (req, chk.data, chk.data_sz);
 		if (!fu_synaptics_rmi_device_write (self, address, req, error)) {
-			g_prefix_error (error, "failed to write block @0x%x:%x ", address, chk->address);
+			g_prefix_error (error, "failed to write block @0x%x:%x ", address, chk.address);
 			return FALSE;
 		}
 	}
@@ -247,9 +247,11 @@ fu_synaptics_rmi_v7_device_write_partition (FuSynapticsRmiDevice *self,
 {
 	FuSynapticsRmiFunction *f34;
 	FuSynapticsRmiFlash *flash = fu_synaptics_rmi_device_get_flash (self);
+	FuChunk chk;
+	FuChunkIter iter;
+	guint32 chunks_cnt;
 	g_autoptr(GByteArray) req_offset = g_byte_array_new ();
 	g_autoptr(GByteArray) req_partition_id = g_byte_array_new ();
-	g_autoptr(GPtrArray) chunks = NULL;
 
 	/* f34 */
 	f34 = fu_synaptics_rmi_device_get_function (self, 0x34, error);
@@ -277,17 +279,17 @@ fu_synaptics_rmi_v7_device_write_partition (FuSynapticsRmiDevice *self,
 	}
 
 	/* write partition */
-	chunks = fu_chunk_array_new_from_bytes (bytes,
-						0x00,	/* start addr */
-						0x00,	/* page_sz */
-						(gsize) flash->payload_length *
-						(gsize) flash->block_size);
-	for (guint i = 0; i < chunks->len; i++) {
-		FuChunk *chk = g_ptr_array_index (chunks, i);
+	fu_chunk_iter_init_bytes (&iter, bytes,
+				  0x00,	/* start addr */
+				  0x00,	/* page_sz */
+				  (guint32) flash->payload_length *
+				  (guint32) flash->block_size);
+	chunks_cnt = fu_chunk_iter_get_count (&iter);
+	while (fu_chunk_iter_next (&iter, &chk)) {
 		g_autoptr(GByteArray) req_trans_sz = g_byte_array_new ();
 		g_autoptr(GByteArray) req_cmd = g_byte_array_new ();
 		fu_byte_array_append_uint16 (req_trans_sz,
-					     chk->data_sz / flash->block_size,
+					     chk.data_sz / flash->block_size,
 					     G_LITTLE_ENDIAN);
 		if (!fu_synaptics_rmi_device_write (self,
 						    f34->data_base + 0x3,
@@ -306,11 +308,11 @@ fu_synaptics_rmi_v7_device_write_partition (FuSynapticsRmiDevice *self,
 		}
 		if (!fu_synaptics_rmi_v7_device_write_blocks (self,
 							      f34->data_base + 0x5,
-							      chk->data,
-							      chk->data_sz,
+							      chk.data,
+							      chk.data_sz,
 							      error))
 			return FALSE;
-		fu_device_set_progress_full (FU_DEVICE (self), (gsize) i, (gsize) chunks->len);
+		fu_device_set_progress_full (FU_DEVICE (self), (gsize) chk.idx, (gsize) chunks_cnt);
 	}
 	return TRUE;
 }
@@ -18,6 +18,11 @@ fu_plugin_init (FuPlugin *plugin)
 {
 	fu_plugin_set_build_hash (plugin, FU_BUILD_HASH);
 	fu_plugin_alloc_data (plugin, sizeof (FuPluginData));
+	if (g_strcmp0 (g_getenv ("FWUPD_PLUGIN_TEST"), "coldplug-concurrent") == 0) {
+		fu_plugin_set_coldplug_thread_safe (plugin, TRUE);
+		if (g_strcmp0 (fu_plugin_get_name (plugin), "test") != 0)
+			fu_plugin_add_rule (plugin, FU_PLUGIN_RULE_RUN_AFTER, "test");
+	}
 	g_debug ("init");
 }
 
@@ -32,6 +37,21 @@ gboolean
 fu_plugin_coldplug (FuPlugin *plugin, GError **error)
 {
 	g_autoptr(FuDevice) device = NULL;
+
+	/* several devices per copy of the plugin, added slowly */
+	if (g_strcmp0 (g_getenv ("FWUPD_PLUGIN_TEST"), "coldplug-concurrent") == 0) {
+		for (guint i = 0; i < 3; i++) {
+			g_autofree gchar *id = NULL;
+			g_autoptr(FuDevice) device_tmp = fu_device_new ();
+			id = g_strdup_printf ("%s-%u", fu_plugin_get_name (plugin), i);
+			fu_device_set_id (device_tmp, id);
+			fu_device_set_name (device_tmp, id);
+			fu_plugin_device_add (plugin, device_tmp);
+			g_usleep (10 * 1000);
+		}
+		return TRUE;
+	}
+
 	device = fu_device_new ();
 	fu_device_set_id (device, "FakeDevice");
 	fu_device_add_guid (device, "b585990a-003e-5270-89d5-3705a17f9a43");
@@ -141,6 +161,13 @@ fu_plugin_test_get_version (GBytes *blob_fw)
 	return fu_common_version_from_uint32 (val, FWUPD_VERSION_FORMAT_TRIPLET);
 }
 
+static void
+fu_plugin_test_spawn_output_cb (const gchar *line, gpointer user_data)
+{
+	FuDevice *device = FU_DEVICE (user_data);
+	fu_device_set_metadata (device, "spawn-output", line);
+}
+
 gboolean
 fu_plugin_update (FuPlugin *plugin,
 		  FuDevice *device,
@@ -157,6 +184,25 @@ fu_plugin_update (FuPlugin *plugin,
 				     "device was not in supported mode");
 		return FALSE;
 	}
+
+	/* for the self tests only, failing just this device */
+	if (fu_device_get_metadata (device, "fail-update") != NULL) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_WRITE,
+				     fu_device_get_metadata (device, "fail-update"));
+		return FALSE;
+	}
+	/* for the self tests only, run a helper process as part of the write */
+	if (fu_device_get_metadata (device, "spawn-update") != NULL) {
+		const gchar *argv[] = { "/bin/sh", "-c",
+					fu_device_get_metadata (device, "spawn-update"),
+					NULL };
+		if (!fu_common_spawn_sync (argv,
+					   fu_plugin_test_spawn_output_cb,
+					   device, 5000, NULL, error))
+			return FALSE;
+	}
 	fu_device_set_status (device, FWUPD_STATUS_DECOMPRESSING);
 	for (guint i = 1; i <= 100; i++) {
 		g_usleep (1000);
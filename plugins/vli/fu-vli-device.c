@@ -173,30 +173,37 @@ fu_vli_device_spi_write_data (FuVliDevice *self, guint32 addr,
 }
 
 static gboolean
-fu_vli_device_spi_wait_finish (FuVliDevice *self, GError **error)
+fu_vli_device_spi_wait_finish_cb (FuDevice *device, gboolean *done, gpointer user_data, GError **error)
 {
+	FuVliDevice *self = FU_VLI_DEVICE (device);
+	guint32 *cnt = (guint32 *) user_data;
 	const guint32 rdy_cnt = 2;
-	guint32 cnt = 0;
+	guint8 status = 0x7f;
 
-	for (guint32 idx = 0; idx < 1000; idx++) {
-		guint8 status = 0x7f;
+	/* must get bit[1:0] == 0 twice in a row for success */
+	if (!fu_vli_device_spi_read_status (self, &status, error))
+		return FALSE;
+	if ((status & 0x03) == 0x00) {
+		if ((*cnt)++ >= rdy_cnt)
+			*done = TRUE;
+	} else {
+		*cnt = 0;
+	}
+	return TRUE;
+}
 
-		/* must get bit[1:0] == 0 twice in a row for success */
-		if (!fu_vli_device_spi_read_status (self, &status, error))
-			return FALSE;
-		if ((status & 0x03) == 0x00) {
-			if (cnt++ >= rdy_cnt)
-				return TRUE;
-		} else {
-			cnt = 0;
-		}
-		g_usleep (500 * 1000);
+static gboolean
+fu_vli_device_spi_wait_finish (FuVliDevice *self, GError **error)
+{
+	guint32 cnt = 0;
+	if (!fu_device_wait_for (FU_DEVICE (self),
+				 fu_vli_device_spi_wait_finish_cb,
+				 10, 160, 500 * 1000,
+				 &cnt, error)) {
+		g_prefix_error (error, "failed to wait for SPI: ");
+		return FALSE;
 	}
-	g_set_error (error,
-		     G_IO_ERROR,
-		     G_IO_ERROR_FAILED,
-		     "failed to wait for SPI");
-	return FALSE;
+	return TRUE;
 }
 
 gboolean
@@ -255,23 +262,25 @@ fu_vli_device_spi_erase_sector (FuVliDevice *self, guint32 addr, GError **error)
 GBytes *
 fu_vli_device_spi_read (FuVliDevice *self, guint32 address, gsize bufsz, GError **error)
 {
+	FuChunk chk;
+	FuChunkIter iter;
+	guint32 chunks_cnt;
 	g_autofree guint8 *buf = g_malloc0 (bufsz);
-	g_autoptr(GPtrArray) chunks = NULL;
 
 	/* get data from hardware */
-	chunks = fu_chunk_array_new (buf, bufsz, address, 0x0, FU_VLI_DEVICE_TXSIZE);
-	for (guint i = 0; i < chunks->len; i++) {
-		FuChunk *chk = g_ptr_array_index (chunks, i);
+	fu_chunk_iter_init (&iter, buf, bufsz, address, 0x0, FU_VLI_DEVICE_TXSIZE);
+	chunks_cnt = fu_chunk_iter_get_count (&iter);
+	while (fu_chunk_iter_next (&iter, &chk)) {
 		if (!fu_vli_device_spi_read_block (self,
-						  chk->address,
-						  (guint8 *) chk->data,
-						  chk->data_sz,
+						  chk.address,
+						  (guint8 *) chk.data,
+						  chk.data_sz,
 						  error)) {
-			g_prefix_error (error, "SPI data read failed @0x%x: ", chk->address);
+			g_prefix_error (error, "SPI data read failed @0x%x: ", chk.address);
 			return NULL;
 		}
 		fu_device_set_progress_full (FU_DEVICE (self),
-					     (gsize) i, (gsize) chunks->len);
+					     (gsize) chk.idx, (gsize) chunks_cnt);
 	}
 	return g_bytes_new_take (g_steal_pointer (&buf), bufsz);
 }
@@ -323,41 +332,115 @@ fu_vli_device_spi_write (FuVliDevice *self,
 			 gsize bufsz,
 			 GError **error)
 {
-	FuChunk *chk;
-	g_autoptr(GPtrArray) chunks = NULL;
+	FuChunk chk;
+	FuChunk chk0;
+	FuChunkIter iter;
+	guint32 chunks_cnt;
 
 	/* write SPI data, then CRC bytes last */
 	g_debug ("writing 0x%x bytes @0x%x", (guint) bufsz, address);
-	chunks = fu_chunk_array_new (buf, bufsz, 0x0, 0x0, FU_VLI_DEVICE_TXSIZE);
-	if (chunks->len > 1) {
-		for (guint i = 1; i < chunks->len; i++) {
-			chk = g_ptr_array_index (chunks, i);
-			if (!fu_vli_device_spi_write_block (self,
-							    chk->address + address,
-							    chk->data,
-							    chk->data_sz,
-							    error)) {
-				g_prefix_error (error, "failed to write block 0x%x: ", chk->idx);
-				return FALSE;
-			}
-			fu_device_set_progress_full (FU_DEVICE (self),
-						     (gsize) i - 1,
-						     (gsize) chunks->len);
+	fu_chunk_iter_init (&iter, buf, bufsz, 0x0, 0x0, FU_VLI_DEVICE_TXSIZE);
+	chunks_cnt = fu_chunk_iter_get_count (&iter);
+	if (!fu_chunk_iter_next (&iter, &chk0)) {
+		g_set_error_literal (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_INVALID_DATA,
+				     "no data to write");
+		return FALSE;
+	}
+	while (fu_chunk_iter_next (&iter, &chk)) {
+		if (!fu_vli_device_spi_write_block (self,
+						    chk.address + address,
+						    chk.data,
+						    chk.data_sz,
+						    error)) {
+			g_prefix_error (error, "failed to write block 0x%x: ", chk.idx);
+			return FALSE;
 		}
+		fu_device_set_progress_full (FU_DEVICE (self),
+					     (gsize) chk.idx - 1,
+					     (gsize) chunks_cnt);
 	}
-	chk = g_ptr_array_index (chunks, 0);
 	if (!fu_vli_device_spi_write_block (self,
-					    chk->address + address,
-					    chk->data,
-					    chk->data_sz,
+					    chk0.address + address,
+					    chk0.data,
+					    chk0.data_sz,
 					    error)) {
 		g_prefix_error (error, "failed to write CRC block: ");
 		return FALSE;
 	}
-	fu_device_set_progress_full (FU_DEVICE (self), (gsize) chunks->len, (gsize) chunks->len);
+	fu_device_set_progress_full (FU_DEVICE (self), (gsize) chunks_cnt, (gsize) chunks_cnt);
 	return TRUE;
 }
 
+/* erases and writes only the sectors that are different to what is already in
+ * the flash; the CRC is in the first block so the first sector is always
+ * rewritten, and written last, so that an interrupted update is detected */
+gboolean
+fu_vli_device_spi_write_changed (FuVliDevice *self,
+				 guint32 address,
+				 const guint8 *buf,
+				 gsize bufsz,
+				 GError **error)
+{
+	FuChunk chk0;
+	FuChunkIter iter;
+	gsize buf_oldsz = 0;
+	const guint8 *buf_old;
+	guint32 chunks_cnt;
+	g_autoptr(GBytes) fw_old = NULL;
+	g_autoptr(GPtrArray) chunks = NULL;
+
+	/* read back what is already there */
+	fw_old = fu_vli_device_spi_read (self, address, bufsz, error);
+	if (fw_old == NULL)
+		return FALSE;
+	buf_old = g_bytes_get_data (fw_old, &buf_oldsz);
+	chunks = fu_chunk_array_new_changed (buf, bufsz, buf_old, buf_oldsz,
+					     address, 0x1000);
+	fu_chunk_iter_init (&iter, buf, bufsz, address, 0x1000, 0x0);
+	chunks_cnt = fu_chunk_iter_get_count (&iter);
+	if (chunks->len == 0) {
+		g_debug ("all 0x%x bytes @0x%x are unchanged", (guint) bufsz, address);
+		return TRUE;
+	}
+	if (!fu_chunk_iter_next (&iter, &chk0)) {
+		g_set_error_literal (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_INVALID_DATA,
+				     "no data to write");
+		return FALSE;
+	}
+	if (((FuChunk *) g_ptr_array_index (chunks, 0))->idx != 0) {
+		g_ptr_array_insert (chunks, 0, fu_chunk_new (chk0.idx, chk0.page,
+							     chk0.address, chk0.data,
+							     chk0.data_sz));
+	}
+	g_debug ("rewriting %u of %u sectors @0x%x",
+		 chunks->len, chunks_cnt, address);
+
+	/* erase */
+	for (guint i = 0; i < chunks->len; i++) {
+		FuChunk *chk = g_ptr_array_index (chunks, i);
+		guint32 addr = (chk->page * 0x1000) + chk->address;
+		if (!fu_vli_device_spi_erase_sector (self, addr, error)) {
+			g_prefix_error (error, "failed to erase FW sector @0x%x: ", addr);
+			return FALSE;
+		}
+		fu_device_set_progress_full (FU_DEVICE (self),
+					     (gsize) i + 1, (gsize) chunks->len);
+	}
+
+	/* write everything apart from the first sector */
+	for (guint i = 1; i < chunks->len; i++) {
+		FuChunk *chk = g_ptr_array_index (chunks, i);
+		guint32 addr = (chk->page * 0x1000) + chk->address;
+		if (!fu_vli_device_spi_write (self, addr, chk->data, chk->data_sz, error))
+			return FALSE;
+	}
+	return fu_vli_device_spi_write (self, address, chk0.data, chk0.data_sz, error);
+}
+
 gboolean
 fu_vli_device_spi_erase_all (FuVliDevice *self, GError **error)
 {
@@ -397,20 +480,24 @@ fu_vli_device_spi_erase_all (FuVliDevice *self, GError **error)
 gboolean
 fu_vli_device_spi_erase (FuVliDevice *self, guint32 addr, gsize sz, GError **error)
 {
-	g_autoptr(GPtrArray) chunks = fu_chunk_array_new (NULL, sz, addr, 0x0, 0x1000);
+	FuChunk chk;
+	FuChunkIter iter;
+	guint32 chunks_cnt;
+
+	fu_chunk_iter_init (&iter, NULL, sz, addr, 0x0, 0x1000);
+	chunks_cnt = fu_chunk_iter_get_count (&iter);
 	g_debug ("erasing 0x%x bytes @0x%x", (guint) sz, addr);
-	for (guint i = 0; i < chunks->len; i++) {
-		FuChunk *chunk = g_ptr_array_index (chunks, i);
+	while (fu_chunk_iter_next (&iter, &chk)) {
 		if (g_getenv ("FWUPD_VLI_USBHUB_VERBOSE") != NULL)
-			g_debug ("erasing @0x%x", chunk->address);
-		if (!fu_vli_device_spi_erase_sector (FU_VLI_DEVICE (self), chunk->address, error)) {
+			g_debug ("erasing @0x%x", chk.address);
+		if (!fu_vli_device_spi_erase_sector (FU_VLI_DEVICE (self), chk.address, error)) {
 			g_prefix_error (error,
 					"failed to erase FW sector @0x%x: ",
-					chunk->address);
+					chk.address);
 			return FALSE;
 		}
 		fu_device_set_progress_full (FU_DEVICE (self),
-					     (gsize) i, (gsize) chunks->len);
+					     (gsize) chk.idx, (gsize) chunks_cnt);
 	}
 	return TRUE;
 }
@@ -419,6 +419,10 @@ fu_vli_pd_device_write_firmware (FuDevice *device,
 	if (!fu_vli_pd_device_write_reg (self, 0x0003, tmp | 0x44, error))
 		return FALSE;
 
+	/* nothing has been erased yet */
+	if (g_cancellable_set_error_if_cancelled (fu_device_get_cancellable (device), error))
+		return FALSE;
+
 	/* erase */
 	fu_device_set_status (FU_DEVICE (self), FWUPD_STATUS_DEVICE_ERASE);
 	if (!fu_vli_device_spi_erase_all (FU_VLI_DEVICE (self), error))
@@ -611,6 +615,7 @@ fu_vli_pd_device_init (FuVliPdDevice *self)
 	fu_device_set_summary (FU_DEVICE (self), "USB PD");
 	fu_device_add_flag (FU_DEVICE (self), FWUPD_DEVICE_FLAG_UPDATABLE);
 	fu_device_add_flag (FU_DEVICE (self), FWUPD_DEVICE_FLAG_CAN_VERIFY_IMAGE);
+	fu_device_add_flag (FU_DEVICE (self), FWUPD_DEVICE_FLAG_THREADED_WRITE);
 	fu_device_set_remove_delay (FU_DEVICE (self), FU_DEVICE_REMOVE_DELAY_RE_ENUMERATE);
 	fu_device_set_version_format (FU_DEVICE (self), FWUPD_VERSION_FORMAT_QUAD);
 	fu_vli_device_set_spi_auto_detect (FU_VLI_DEVICE (self), FALSE);
@@ -444,13 +444,14 @@ fu_vli_pd_parade_device_write_firmware (FuDevice *device,
 {
 	FuVliPdParadeDevice *self = FU_VLI_PD_PARADE_DEVICE (device);
 	FuVliPdDevice *parent = FU_VLI_PD_DEVICE (fu_device_get_parent (device));
+	FuChunk block;
+	FuChunkIter iter;
 	guint8 buf[0x20];
 	guint block_idx_tmp;
+	guint32 blocks_cnt;
 	g_autoptr(FuDeviceLocker) locker = NULL;
 	g_autoptr(GBytes) fw = NULL;
 	g_autoptr(GBytes) fw_verify = NULL;
-	g_autoptr(GPtrArray) blocks = NULL;
-	g_autoptr(GPtrArray) blocks_verify = NULL;
 
 	/* simple image */
 	fw = fu_firmware_get_image_default_bytes (firmware, error);
@@ -474,12 +475,14 @@ fu_vli_pd_parade_device_write_firmware (FuDevice *device,
 		return FALSE;
 	if (!fu_vli_pd_parade_device_wait_ready (self, error))
 		return FALSE;
-	blocks = fu_chunk_array_new_from_bytes (fw, 0x0, 0x0, 0x10000);
-	for (guint i = 1; i < blocks->len; i++) {
-		FuChunk *block = g_ptr_array_index (blocks, i);
-		if (!fu_vli_pd_parade_device_block_erase (self, block->idx, error))
+	fu_chunk_iter_init_bytes (&iter, fw, 0x0, 0x0, 0x10000);
+	blocks_cnt = fu_chunk_iter_get_count (&iter);
+	while (fu_chunk_iter_next (&iter, &block)) {
+		if (block.idx == 0)
+			continue;
+		if (!fu_vli_pd_parade_device_block_erase (self, block.idx, error))
 			return FALSE;
-		fu_device_set_progress_full (FU_DEVICE (self), i, blocks->len);
+		fu_device_set_progress_full (FU_DEVICE (self), block.idx, blocks_cnt);
 	}
 
 	/*  load F/W to SPI ROM */
@@ -493,11 +496,13 @@ fu_vli_pd_parade_device_write_firmware (FuDevice *device,
 
 	/* write blocks */
 	fu_device_set_status (FU_DEVICE (self), FWUPD_STATUS_DEVICE_WRITE);
-	for (guint i = 1; i < blocks->len; i++) {
-		FuChunk *block = g_ptr_array_index (blocks, i);
-		if (!fu_vli_pd_parade_device_block_write (self, block->idx, block->data, error))
+	fu_chunk_iter_init_bytes (&iter, fw, 0x0, 0x0, 0x10000);
+	while (fu_chunk_iter_next (&iter, &block)) {
+		if (block.idx == 0)
+			continue;
+		if (!fu_vli_pd_parade_device_block_write (self, block.idx, block.data, error))
 			return FALSE;
-		fu_device_set_progress_full (FU_DEVICE (self), i, blocks->len);
+		fu_device_set_progress_full (FU_DEVICE (self), block.idx, blocks_cnt);
 	}
 	if (!fu_vli_pd_parade_device_write_disable (self, error))
 		return FALSE;
@@ -505,16 +510,17 @@ fu_vli_pd_parade_device_write_firmware (FuDevice *device,
 	/*  verify SPI ROM */
 	fu_device_set_status (FU_DEVICE (self), FWUPD_STATUS_DEVICE_VERIFY);
 	fw_verify = _g_bytes_new_sized (g_bytes_get_size (fw));
-	blocks_verify = fu_chunk_array_new_from_bytes (fw_verify, 0x0, 0x0, 0x10000);
-	for (guint i = 1; i < blocks_verify->len; i++) {
-		FuChunk *block = g_ptr_array_index (blocks_verify, i);
+	fu_chunk_iter_init_bytes (&iter, fw_verify, 0x0, 0x0, 0x10000);
+	while (fu_chunk_iter_next (&iter, &block)) {
+		if (block.idx == 0)
+			continue;
 		if (!fu_vli_pd_parade_device_block_read (self,
-							 block->idx,
-							 (guint8 *) block->data,
-							 block->data_sz,
+							 block.idx,
+							 (guint8 *) block.data,
+							 block.data_sz,
 							 error))
 			return FALSE;
-		fu_device_set_progress_full (FU_DEVICE (self), i, blocks->len);
+		fu_device_set_progress_full (FU_DEVICE (self), block.idx, blocks_cnt);
 	}
 	if (!fu_common_bytes_compare (fw, fw_verify, error))
 		return FALSE;
@@ -584,9 +590,10 @@ fu_vli_pd_parade_device_read_firmware (FuDevice *device, GError **error)
 {
 	FuVliPdDevice *parent = FU_VLI_PD_DEVICE (fu_device_get_parent (device));
 	FuVliPdParadeDevice *self = FU_VLI_PD_PARADE_DEVICE (device);
+	FuChunk block;
+	FuChunkIter iter;
 	g_autoptr(FuDeviceLocker) locker = NULL;
 	g_autoptr(GBytes) fw = NULL;
-	g_autoptr(GPtrArray) blocks = NULL;
 
 	/* open device */
 	locker = fu_device_locker_new (parent, error);
@@ -600,13 +607,12 @@ fu_vli_pd_parade_device_read_firmware (FuDevice *device, GError **error)
 	/* read */
 	fu_device_set_status (FU_DEVICE (device), FWUPD_STATUS_DEVICE_VERIFY);
 	fw = _g_bytes_new_sized (fu_device_get_firmware_size_max (device));
-	blocks = fu_chunk_array_new_from_bytes (fw, 0x0, 0x0, 0x10000);
-	for (guint i = 0; i < blocks->len; i++) {
-		FuChunk *block = g_ptr_array_index (blocks, i);
+	fu_chunk_iter_init_bytes (&iter, fw, 0x0, 0x0, 0x10000);
+	while (fu_chunk_iter_next (&iter, &block)) {
 		if (!fu_vli_pd_parade_device_block_read (self,
-							 block->idx,
-							 (guint8 *) block->data,
-							 block->data_sz,
+							 block.idx,
+							 (guint8 *) block.data,
+							 block.data_sz,
 							 error))
 			return NULL;
 	}
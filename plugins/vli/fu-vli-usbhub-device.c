@@ -893,18 +893,13 @@ fu_vli_usbhub_device_update_v2 (FuVliUsbhubDevice *self, FuFirmware *firmware, G
 	g_debug ("FW2 @0x%x (length 0x%x, offset 0x%x)",
 		 hd2_fw_addr, hd2_fw_sz, hd2_fw_offset);
 
-	/* make space */
-	fu_device_set_status (FU_DEVICE (self), FWUPD_STATUS_DEVICE_ERASE);
-	if (!fu_vli_device_spi_erase (FU_VLI_DEVICE (self), hd2_fw_addr, hd2_fw_sz, error))
-		return FALSE;
-
-	/* perform the actual write */
+	/* perform the actual write, only erasing the sectors that changed */
 	fu_device_set_status (FU_DEVICE (self), FWUPD_STATUS_DEVICE_WRITE);
-	if (!fu_vli_device_spi_write (FU_VLI_DEVICE (self),
-				      hd2_fw_addr,
-				      buf_fw + hd2_fw_offset,
-				      hd2_fw_sz,
-				      error)) {
+	if (!fu_vli_device_spi_write_changed (FU_VLI_DEVICE (self),
+					      hd2_fw_addr,
+					      buf_fw + hd2_fw_offset,
+					      hd2_fw_sz,
+					      error)) {
 		g_prefix_error (error, "failed to write payload: ");
 		return FALSE;
 	}
@@ -961,6 +956,10 @@ fu_vli_usbhub_device_write_firmware (FuDevice *device,
 {
 	FuVliUsbhubDevice *self = FU_VLI_USBHUB_DEVICE (device);
 
+	/* nothing has been erased yet */
+	if (g_cancellable_set_error_if_cancelled (fu_device_get_cancellable (device), error))
+		return FALSE;
+
 	/* disable powersaving if required */
 	if (self->disable_powersave) {
 		if (!fu_vli_usbhub_device_disable_u1u2 (self, error)) {
@@ -989,6 +988,7 @@ fu_vli_usbhub_device_init (FuVliUsbhubDevice *self)
 {
 	fu_device_add_icon (FU_DEVICE (self), "audio-card");
 	fu_device_set_protocol (FU_DEVICE (self), "com.vli.usbhub");
+	fu_device_add_flag (FU_DEVICE (self), FWUPD_DEVICE_FLAG_THREADED_WRITE);
 	fu_device_set_remove_delay (FU_DEVICE (self), FU_DEVICE_REMOVE_DELAY_RE_ENUMERATE);
 }
 
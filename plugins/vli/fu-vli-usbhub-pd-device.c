@@ -191,19 +191,12 @@ fu_vli_usbhub_pd_device_write_firmware (FuDevice *device,
 	if (locker == NULL)
 		return FALSE;
 
-	/* erase */
-	fu_device_set_status (device, FWUPD_STATUS_DEVICE_ERASE);
-	buf = g_bytes_get_data (fw, &bufsz);
-	if (!fu_vli_device_spi_erase (FU_VLI_DEVICE (parent),
-				      fu_vli_common_device_kind_get_offset (self->device_kind),
-				      bufsz, error))
-		return FALSE;
-
-	/* write */
+	/* erase and write only the sectors that changed */
 	fu_device_set_status (device, FWUPD_STATUS_DEVICE_WRITE);
-	if (!fu_vli_device_spi_write (FU_VLI_DEVICE (parent),
-				      fu_vli_common_device_kind_get_offset (self->device_kind),
-				      buf, bufsz, error))
+	buf = g_bytes_get_data (fw, &bufsz);
+	if (!fu_vli_device_spi_write_changed (FU_VLI_DEVICE (parent),
+					      fu_vli_common_device_kind_get_offset (self->device_kind),
+					      buf, bufsz, error))
 		return FALSE;
 
 	/* success */
@@ -280,6 +280,27 @@ fu_wacom_device_get_feature (FuWacomDevice *self,
 	return TRUE;
 }
 
+typedef struct {
+	FuWacomRawRequest	*req;
+	FuWacomRawResponse	*rsp;
+} FuWacomDeviceCmdHelper;
+
+static gboolean
+fu_wacom_device_cmd_poll_cb (FuDevice *device, gboolean *done, gpointer user_data, GError **error)
+{
+	FuWacomDevice *self = FU_WACOM_DEVICE (device);
+	FuWacomDeviceCmdHelper *helper = (FuWacomDeviceCmdHelper *) user_data;
+
+	if (!fu_wacom_device_get_feature (self, (guint8 *) helper->rsp,
+					  sizeof(*helper->rsp), error))
+		return FALSE;
+	if (!fu_wacom_common_check_reply (helper->req, helper->rsp, error))
+		return FALSE;
+	*done = helper->rsp->resp != FU_WACOM_RAW_RC_IN_PROGRESS &&
+		helper->rsp->resp != FU_WACOM_RAW_RC_BUSY;
+	return TRUE;
+}
+
 gboolean
 fu_wacom_device_cmd (FuWacomDevice *self,
 		     FuWacomRawRequest *req, FuWacomRawResponse *rsp,
@@ -306,17 +327,18 @@ fu_wacom_device_cmd (FuWacomDevice *self,
 	/* wait for the command to complete */
 	if (flags & FU_WACOM_DEVICE_CMD_FLAG_POLL_ON_WAITING &&
 	    rsp->resp != FU_WACOM_RAW_RC_OK) {
-		for (guint i = 0; i < FU_WACOM_RAW_CMD_RETRIES; i++) {
-			if (delay_us > 0)
-				g_usleep (delay_us);
-			if (!fu_wacom_device_get_feature (self, (guint8 *)rsp, sizeof(*rsp), error))
-				return FALSE;
-			if (!fu_wacom_common_check_reply (req, rsp, error))
-				return FALSE;
-			if (rsp->resp != FU_WACOM_RAW_RC_IN_PROGRESS &&
-			    rsp->resp != FU_WACOM_RAW_RC_BUSY)
-				break;
-		}
+		FuWacomDeviceCmdHelper helper = {
+			.req = req,
+			.rsp = rsp,
+		};
+		guint delay_ms = MAX (delay_us / 1000, 16);
+		if (!fu_device_wait_for (FU_DEVICE (self),
+					 fu_wacom_device_cmd_poll_cb,
+					 delay_ms / 16,
+					 delay_ms,
+					 delay_ms * FU_WACOM_RAW_CMD_RETRIES,
+					 &helper, error))
+			return FALSE;
 	}
 	return fu_wacom_common_rc_set_error (rsp, error);
 }
@@ -40,10 +40,11 @@ fu_wac_module_touch_write_firmware (FuDevice *device,
 				    GError **error)
 {
 	FuWacModule *self = FU_WAC_MODULE (device);
+	FuChunk chk;
+	FuChunkIter iter;
 	gsize blocks_total = 0;
 	g_autoptr(FuFirmwareImage) img = NULL;
 	g_autoptr(GBytes) fw = NULL;
-	g_autoptr(GPtrArray) chunks = NULL;
 
 	/* use the correct image from the firmware */
 	img = fu_firmware_get_image_default (firmware, error);
@@ -56,11 +57,11 @@ fu_wac_module_touch_write_firmware (FuDevice *device,
 		return FALSE;
 
 	/* build each data packet */
-	chunks = fu_chunk_array_new_from_bytes (fw,
-						fu_firmware_image_get_addr (img),
-						0x0, /* page_sz */
-						128); /* packet_sz */
-	blocks_total = chunks->len + 2;
+	fu_chunk_iter_init_bytes (&iter, fw,
+				  fu_firmware_image_get_addr (img),
+				  0x0, /* page_sz */
+				  128); /* packet_sz */
+	blocks_total = fu_chunk_iter_get_count (&iter) + 2;
 
 	/* start, which will erase the module */
 	fu_device_set_status (device, FWUPD_STATUS_DEVICE_ERASE);
@@ -72,27 +73,26 @@ fu_wac_module_touch_write_firmware (FuDevice *device,
 
 	/* data */
 	fu_device_set_status (device, FWUPD_STATUS_DEVICE_WRITE);
-	for (guint i = 0; i < chunks->len; i++) {
-		FuChunk *chk = g_ptr_array_index (chunks, i);
+	while (fu_chunk_iter_next (&iter, &chk)) {
 		guint8 buf[128+7] = { 0xff };
 		g_autoptr(GBytes) blob_chunk = NULL;
 
 		/* build G11T data packet */
 		memset (buf, 0xff, sizeof(buf));
 		buf[0] = 0x01; /* writing */
-		buf[1] = chk->idx + 1;
-		fu_common_write_uint32 (&buf[2], chk->address, G_LITTLE_ENDIAN);
+		buf[1] = chk.idx + 1;
+		fu_common_write_uint32 (&buf[2], chk.address, G_LITTLE_ENDIAN);
 		buf[6] = 0x10; /* no idea! */
-		memcpy (&buf[7], chk->data, chk->data_sz);
+		memcpy (&buf[7], chk.data, chk.data_sz);
 		blob_chunk = g_bytes_new (buf, sizeof(buf));
 		if (!fu_wac_module_set_feature (self, FU_WAC_MODULE_COMMAND_DATA,
 						blob_chunk, error)) {
-			g_prefix_error (error, "failed to write block %u: ", chk->idx);
+			g_prefix_error (error, "failed to write block %u: ", chk.idx);
 			return FALSE;
 		}
 
 		/* update progress */
-		fu_device_set_progress_full (device, i + 1, blocks_total);
+		fu_device_set_progress_full (device, chk.idx + 1, blocks_total);
 	}
 
 	/* end */
@@ -35,6 +35,10 @@ struct _FuConfig
 	gchar			*config_file;
 	gboolean		 update_motd;
 	gboolean		 enumerate_all_devices;
+	gboolean		 concurrent_coldplug;
+	gboolean		 lazy_plugins;
+	gboolean		 device_cache;
+	gboolean		 concurrent_installs;
 };
 
 G_DEFINE_TYPE (FuConfig, fu_config, G_TYPE_OBJECT)
@@ -151,6 +155,30 @@ fu_config_reload (FuConfig *self, GError **error)
 		self->enumerate_all_devices = TRUE;
 	}
 
+	/* whether to coldplug independent plugins in worker threads */
+	self->concurrent_coldplug = g_key_file_get_boolean (keyfile,
+							    "fwupd",
+							    "ConcurrentColdplug",
+							    NULL);
+
+	/* whether to only load plugins when matching hardware is found */
+	self->lazy_plugins = g_key_file_get_boolean (keyfile,
+						     "fwupd",
+						     "LazyPlugins",
+						     NULL);
+
+	/* whether to show the devices from the last run while re-enumerating */
+	self->device_cache = g_key_file_get_boolean (keyfile,
+						     "fwupd",
+						     "DeviceCache",
+						     NULL);
+
+	/* whether to install to devices on independent buses at the same time */
+	self->concurrent_installs = g_key_file_get_boolean (keyfile,
+							    "fwupd",
+							    "ConcurrentInstalls",
+							    NULL);
+
 	return TRUE;
 }
 
@@ -262,6 +290,34 @@ fu_config_get_enumerate_all_devices (FuConfig *self)
 	return self->enumerate_all_devices;
 }
 
+gboolean
+fu_config_get_concurrent_coldplug (FuConfig *self)
+{
+	g_return_val_if_fail (FU_IS_CONFIG (self), FALSE);
+	return self->concurrent_coldplug;
+}
+
+gboolean
+fu_config_get_lazy_plugins (FuConfig *self)
+{
+	g_return_val_if_fail (FU_IS_CONFIG (self), FALSE);
+	return self->lazy_plugins;
+}
+
+gboolean
+fu_config_get_device_cache (FuConfig *self)
+{
+	g_return_val_if_fail (FU_IS_CONFIG (self), FALSE);
+	return self->device_cache;
+}
+
+gboolean
+fu_config_get_concurrent_installs (FuConfig *self)
+{
+	g_return_val_if_fail (FU_IS_CONFIG (self), FALSE);
+	return self->concurrent_installs;
+}
+
 static void
 fu_config_class_init (FuConfigClass *klass)
 {
@@ -28,3 +28,7 @@ GPtrArray	*fu_config_get_disabled_plugins		(FuConfig	*self);
 GPtrArray	*fu_config_get_approved_firmware	(FuConfig	*self);
 gboolean	 fu_config_get_update_motd		(FuConfig	*self);
 gboolean	 fu_config_get_enumerate_all_devices	(FuConfig	*self);
+gboolean	 fu_config_get_concurrent_coldplug	(FuConfig	*self);
+gboolean	 fu_config_get_lazy_plugins		(FuConfig	*self);
+gboolean	 fu_config_get_device_cache		(FuConfig	*self);
+gboolean	 fu_config_get_concurrent_installs	(FuConfig	*self);
@@ -0,0 +1,312 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#define G_LOG_DOMAIN				"FuDeviceCache"
+
+#include "config.h"
+
+#include <fwupd.h>
+
+#include "fu-common.h"
+#include "fu-device-cache.h"
+#include "fu-udev-device.h"
+#include "fu-usb-device.h"
+
+/**
+ * SECTION:fu-device-cache
+ * @short_description: a snapshot of the enumerated devices
+ *
+ * Saves the devices found when the daemon last enumerated the hardware so
+ * that they can be shown again straight away when the daemon is next started.
+ *
+ * The snapshot is only valid for the same kernel boot, and only if no uevents
+ * have been emitted since it was written. Devices backed by a sysfs or USB
+ * path that no longer exists are not restored.
+ */
+
+#define FU_DEVICE_CACHE_FORMAT		"(sa(sssa{sv}))"
+
+static void fu_device_cache_finalize	 (GObject *obj);
+
+struct _FuDeviceCache
+{
+	GObject			 parent_instance;
+	gchar			*filename;
+};
+
+G_DEFINE_TYPE (FuDeviceCache, fu_device_cache, G_TYPE_OBJECT)
+
+static gchar *
+fu_device_cache_get_key (GError **error)
+{
+	g_autofree gchar *boot_id = NULL;
+	g_autofree gchar *procfs = fu_common_get_path (FU_PATH_KIND_PROCFS);
+	g_autofree gchar *sysfs = fu_common_get_path (FU_PATH_KIND_SYSFSDIR);
+	g_autofree gchar *seqnum = NULL;
+	g_autofree gchar *fn_boot_id = NULL;
+	g_autofree gchar *fn_seqnum = NULL;
+
+	/* changes on each boot */
+	fn_boot_id = g_build_filename (procfs, "sys", "kernel", "random", "boot_id", NULL);
+	if (!g_file_get_contents (fn_boot_id, &boot_id, NULL, error))
+		return NULL;
+
+	/* changes on every hotplug or device change */
+	fn_seqnum = g_build_filename (sysfs, "kernel", "uevent_seqnum", NULL);
+	if (!g_file_get_contents (fn_seqnum, &seqnum, NULL, error))
+		return NULL;
+	return g_strdup_printf ("%s:%s", g_strstrip (boot_id), g_strstrip (seqnum));
+}
+
+/* the node the device was enumerated from, which is gone once unplugged */
+static gchar *
+fu_device_cache_get_device_path (FuDevice *device)
+{
+	if (FU_IS_UDEV_DEVICE (device))
+		return g_strdup (fu_udev_device_get_sysfs_path (FU_UDEV_DEVICE (device)));
+	if (FU_IS_USB_DEVICE (device)) {
+		GUsbDevice *usb_device = fu_usb_device_get_dev (FU_USB_DEVICE (device));
+		if (usb_device == NULL)
+			return NULL;
+		return g_strdup_printf ("/dev/bus/usb/%03u/%03u",
+					g_usb_device_get_bus (usb_device),
+					g_usb_device_get_address (usb_device));
+	}
+	return NULL;
+}
+
+/**
+ * fu_device_cache_set_filename:
+ * @self: A #FuDeviceCache
+ * @filename: a filename
+ *
+ * Sets the location of the snapshot, which defaults to a file in the package
+ * cache directory.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_device_cache_set_filename (FuDeviceCache *self, const gchar *filename)
+{
+	g_return_if_fail (FU_IS_DEVICE_CACHE (self));
+	g_return_if_fail (filename != NULL);
+	g_free (self->filename);
+	self->filename = g_strdup (filename);
+}
+
+/**
+ * fu_device_cache_save:
+ * @self: A #FuDeviceCache
+ * @devices: (element-type FuDevice): devices
+ * @error: A #GError, or %NULL
+ *
+ * Saves a snapshot of the devices, keyed to the current boot and uevent
+ * sequence number.
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_device_cache_save (FuDeviceCache *self, GPtrArray *devices, GError **error)
+{
+	GVariantBuilder builder;
+	g_autofree gchar *key = NULL;
+	g_autoptr(GVariant) value = NULL;
+
+	g_return_val_if_fail (FU_IS_DEVICE_CACHE (self), FALSE);
+	g_return_val_if_fail (devices != NULL, FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	key = fu_device_cache_get_key (error);
+	if (key == NULL)
+		return FALSE;
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(sssa{sv})"));
+	for (guint i = 0; i < devices->len; i++) {
+		FuDevice *device = g_ptr_array_index (devices, i);
+		const gchar *physical_id = fu_device_get_physical_id (device);
+		const gchar *logical_id = fu_device_get_logical_id (device);
+		g_autofree gchar *path = fu_device_cache_get_device_path (device);
+		g_variant_builder_add (&builder, "(sss@a{sv})",
+				       physical_id != NULL ? physical_id : "",
+				       logical_id != NULL ? logical_id : "",
+				       path != NULL ? path : "",
+				       fwupd_device_to_variant_full (FWUPD_DEVICE (device),
+								     FWUPD_DEVICE_FLAG_TRUSTED));
+	}
+	value = g_variant_ref_sink (g_variant_new (FU_DEVICE_CACHE_FORMAT, key, &builder));
+	if (!fu_common_mkdir_parent (self->filename, error))
+		return FALSE;
+	return g_file_set_contents (self->filename,
+				    g_variant_get_data (value),
+				    g_variant_get_size (value),
+				    error);
+}
+
+static FuDevice *
+fu_device_cache_get_by_id (GPtrArray *devices, const gchar *id)
+{
+	for (guint i = 0; i < devices->len; i++) {
+		FuDevice *device = g_ptr_array_index (devices, i);
+		if (g_strcmp0 (fu_device_get_id (device), id) == 0)
+			return device;
+	}
+	return NULL;
+}
+
+/**
+ * fu_device_cache_load:
+ * @self: A #FuDeviceCache
+ * @error: A #GError, or %NULL
+ *
+ * Loads the devices saved with fu_device_cache_save(), failing if the
+ * hardware may have changed since. Devices whose sysfs or USB path no longer
+ * exists, and their children, are skipped.
+ *
+ * Returns: (transfer container) (element-type FuDevice): devices, or %NULL
+ *
+ * Since: 1.5.0
+ **/
+GPtrArray *
+fu_device_cache_load (FuDeviceCache *self, GError **error)
+{
+	const gchar *key_old = NULL;
+	gboolean removed;
+	gsize bufsz = 0;
+	g_autofree gchar *buf = NULL;
+	g_autofree gchar *key = NULL;
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GPtrArray) devices = NULL;
+	g_autoptr(GVariant) value = NULL;
+	g_autoptr(GVariantIter) iter = NULL;
+
+	g_return_val_if_fail (FU_IS_DEVICE_CACHE (self), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	key = fu_device_cache_get_key (error);
+	if (key == NULL)
+		return NULL;
+	if (!g_file_get_contents (self->filename, &buf, &bufsz, error))
+		return NULL;
+	blob = g_bytes_new_take (g_steal_pointer (&buf), bufsz);
+	value = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (FU_DEVICE_CACHE_FORMAT),
+							      blob, FALSE));
+	if (!g_variant_is_normal_form (value)) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "%s is corrupt", self->filename);
+		return NULL;
+	}
+	g_variant_get (value, "(&sa(sssa{sv}))", &key_old, &iter);
+	if (g_strcmp0 (key, key_old) != 0) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOTHING_TO_DO,
+			     "hardware may have changed, %s != %s",
+			     key_old, key);
+		return NULL;
+	}
+
+	/* create devices with the same ID */
+	devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	while (TRUE) {
+		const gchar *physical_id = NULL;
+		const gchar *logical_id = NULL;
+		const gchar *path = NULL;
+		g_autoptr(FuDevice) device = NULL;
+		g_autoptr(FwupdDevice) donor = NULL;
+		g_autoptr(GVariant) dict = NULL;
+
+		if (!g_variant_iter_next (iter, "(&s&s&s@a{sv})",
+					  &physical_id, &logical_id, &path, &dict))
+			break;
+		donor = fwupd_device_from_variant (dict);
+		if (donor == NULL || fwupd_device_get_id (donor) == NULL) {
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "%s has invalid device", self->filename);
+			return NULL;
+		}
+		device = fu_device_new ();
+		fwupd_device_incorporate (FWUPD_DEVICE (device), donor);
+		if (physical_id[0] != '\0')
+			fu_device_set_physical_id (device, physical_id);
+		if (logical_id[0] != '\0')
+			fu_device_set_logical_id (device, logical_id);
+		if (path[0] != '\0' && !g_file_test (path, G_FILE_TEST_EXISTS)) {
+			g_debug ("not restoring %s as %s has gone",
+				 fu_device_get_id (device), path);
+			continue;
+		}
+		g_ptr_array_add (devices, g_steal_pointer (&device));
+	}
+
+	/* drop any device whose parent has gone, repeating for grandchildren */
+	do {
+		removed = FALSE;
+		for (guint i = 0; i < devices->len; i++) {
+			FuDevice *device = g_ptr_array_index (devices, i);
+			const gchar *parent_id = fwupd_device_get_parent_id (FWUPD_DEVICE (device));
+			if (parent_id == NULL)
+				continue;
+			if (fu_device_cache_get_by_id (devices, parent_id) != NULL)
+				continue;
+			g_debug ("not restoring %s as parent %s has gone",
+				 fu_device_get_id (device), parent_id);
+			g_ptr_array_remove_index (devices, i--);
+			removed = TRUE;
+		}
+	} while (removed);
+
+	/* link up the children */
+	for (guint i = 0; i < devices->len; i++) {
+		FuDevice *device = g_ptr_array_index (devices, i);
+		const gchar *parent_id = fwupd_device_get_parent_id (FWUPD_DEVICE (device));
+		if (parent_id == NULL)
+			continue;
+		fu_device_add_child (fu_device_cache_get_by_id (devices, parent_id), device);
+	}
+	return g_steal_pointer (&devices);
+}
+
+static void
+fu_device_cache_class_init (FuDeviceCacheClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = fu_device_cache_finalize;
+}
+
+static void
+fu_device_cache_init (FuDeviceCache *self)
+{
+	g_autofree gchar *cachedir = fu_common_get_path (FU_PATH_KIND_CACHEDIR_PKG);
+	self->filename = g_build_filename (cachedir, "devices.cache", NULL);
+}
+
+static void
+fu_device_cache_finalize (GObject *obj)
+{
+	FuDeviceCache *self = FU_DEVICE_CACHE (obj);
+	g_free (self->filename);
+	G_OBJECT_CLASS (fu_device_cache_parent_class)->finalize (obj);
+}
+
+/**
+ * fu_device_cache_new:
+ *
+ * Creates a new #FuDeviceCache.
+ *
+ * Returns: (transfer full): a #FuDeviceCache
+ *
+ * Since: 1.5.0
+ **/
+FuDeviceCache *
+fu_device_cache_new (void)
+{
+	return FU_DEVICE_CACHE (g_object_new (FU_TYPE_DEVICE_CACHE, NULL));
+}
@@ -0,0 +1,23 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#pragma once
+
+#include <glib-object.h>
+
+#include "fu-device.h"
+
+#define FU_TYPE_DEVICE_CACHE (fu_device_cache_get_type ())
+G_DECLARE_FINAL_TYPE (FuDeviceCache, fu_device_cache, FU, DEVICE_CACHE, GObject)
+
+FuDeviceCache	*fu_device_cache_new		(void);
+void		 fu_device_cache_set_filename	(FuDeviceCache	*self,
+						 const gchar	*filename);
+gboolean	 fu_device_cache_save		(FuDeviceCache	*self,
+						 GPtrArray	*devices,
+						 GError		**error);
+GPtrArray	*fu_device_cache_load		(FuDeviceCache	*self,
+						 GError		**error);
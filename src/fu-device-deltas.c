@@ -0,0 +1,302 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#define G_LOG_DOMAIN				"FuDeviceDeltas"
+
+#include "config.h"
+
+#include "fwupd-device-private.h"
+
+#include "fu-device-deltas.h"
+
+/**
+ * SECTION:fu-device-deltas
+ * @short_description: changes to send to clients about devices
+ *
+ * This remembers the last device dictionary each client was sent, and works
+ * out which keys have changed or been removed since then.
+ *
+ * Changes that only affect the status are merged for a short time so that a
+ * device quickly going through several states only causes one notification.
+ */
+
+static void fu_device_deltas_finalize	 (GObject *obj);
+
+struct _FuDeviceDeltas
+{
+	GObject			 parent_instance;
+	GHashTable		*states;	/* device-id:FuDeviceDeltasState */
+	GHashTable		*pending;	/* device-id:FuDevice */
+	guint			 pending_id;
+	guint			 timeout_ms;
+};
+
+/* what each client has been told about a device */
+typedef struct {
+	GVariant		*value;
+	guint64			 seq;
+} FuDeviceDeltasState;
+
+enum {
+	SIGNAL_CHANGED_DELTA,
+	SIGNAL_CHANGED,
+	SIGNAL_LAST
+};
+
+static guint signals[SIGNAL_LAST] = { 0 };
+
+/* status-only changes are merged if they happen faster than this */
+#define FU_DEVICE_DELTAS_TIMEOUT_MS		250
+
+G_DEFINE_TYPE (FuDeviceDeltas, fu_device_deltas, G_TYPE_OBJECT)
+
+static void
+fu_device_deltas_state_free (FuDeviceDeltasState *state)
+{
+	if (state->value != NULL)
+		g_variant_unref (state->value);
+	g_free (state);
+}
+
+static FuDeviceDeltasState *
+fu_device_deltas_state_ensure (FuDeviceDeltas *self, FuDevice *device)
+{
+	FuDeviceDeltasState *state;
+	state = g_hash_table_lookup (self->states, fu_device_get_id (device));
+	if (state == NULL) {
+		state = g_new0 (FuDeviceDeltasState, 1);
+		g_hash_table_insert (self->states,
+				     g_strdup (fu_device_get_id (device)),
+				     state);
+	}
+	return state;
+}
+
+static gboolean
+fu_device_deltas_is_status_only (GVariant *changed, GVariant *removed)
+{
+	if (g_variant_n_children (changed) + g_variant_n_children (removed) != 1)
+		return FALSE;
+	if (g_variant_n_children (changed) == 1) {
+		const gchar *key = NULL;
+		g_autoptr(GVariant) value = NULL;
+		g_variant_get_child (changed, 0, "{&sv}", &key, &value);
+		return g_strcmp0 (key, FWUPD_RESULT_KEY_STATUS) == 0;
+	} else {
+		const gchar *key = NULL;
+		g_variant_get_child (removed, 0, "&s", &key);
+		return g_strcmp0 (key, FWUPD_RESULT_KEY_STATUS) == 0;
+	}
+}
+
+static void
+fu_device_deltas_emit (FuDeviceDeltas *self,
+		       FuDevice *device,
+		       FuDeviceDeltasState *state,
+		       GVariant *val,
+		       GVariant *changed,
+		       GVariant *removed)
+{
+	if (state->value != NULL)
+		g_variant_unref (state->value);
+	state->value = g_variant_ref (val);
+	state->seq++;
+
+	/* the first change is sent in full so that clients that only watch
+	 * the signals have something to apply the deltas to */
+	if (state->seq == 1) {
+		g_signal_emit (self, signals[SIGNAL_CHANGED], 0, device, val);
+		return;
+	}
+	g_signal_emit (self, signals[SIGNAL_CHANGED_DELTA], 0,
+		       device, state->seq, changed, removed);
+}
+
+static void
+fu_device_deltas_flush (FuDeviceDeltas *self, FuDevice *device)
+{
+	FuDeviceDeltasState *state = fu_device_deltas_state_ensure (self, device);
+	g_autoptr(GVariant) changed = NULL;
+	g_autoptr(GVariant) removed = NULL;
+	g_autoptr(GVariant) val = NULL;
+
+	val = fwupd_device_to_variant_cached (FWUPD_DEVICE (device),
+					      FWUPD_DEVICE_FLAG_NONE);
+	if (!fwupd_device_variant_diff (state->value, val, &changed, &removed))
+		return;
+	fu_device_deltas_emit (self, device, state, val, changed, removed);
+}
+
+static gboolean
+fu_device_deltas_pending_cb (gpointer user_data)
+{
+	FuDeviceDeltas *self = FU_DEVICE_DELTAS (user_data);
+	g_autoptr(GList) devices = g_hash_table_get_values (self->pending);
+
+	for (GList *l = devices; l != NULL; l = l->next) {
+		FuDevice *device = FU_DEVICE (l->data);
+		fu_device_deltas_flush (self, device);
+	}
+	g_hash_table_remove_all (self->pending);
+	self->pending_id = 0;
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * fu_device_deltas_set_timeout:
+ * @self: A #FuDeviceDeltas
+ * @timeout_ms: time in ms
+ *
+ * Sets how long status-only changes are merged for.
+ **/
+void
+fu_device_deltas_set_timeout (FuDeviceDeltas *self, guint timeout_ms)
+{
+	g_return_if_fail (FU_IS_DEVICE_DELTAS (self));
+	self->timeout_ms = timeout_ms;
+}
+
+/**
+ * fu_device_deltas_add:
+ * @self: A #FuDeviceDeltas
+ * @device: A #FuDevice
+ *
+ * Remembers the device as it was sent to clients when it was added.
+ **/
+void
+fu_device_deltas_add (FuDeviceDeltas *self, FuDevice *device)
+{
+	FuDeviceDeltasState *state;
+
+	g_return_if_fail (FU_IS_DEVICE_DELTAS (self));
+	g_return_if_fail (FU_IS_DEVICE (device));
+
+	state = fu_device_deltas_state_ensure (self, device);
+	if (state->value != NULL)
+		g_variant_unref (state->value);
+	state->value = fwupd_device_to_variant_cached (FWUPD_DEVICE (device),
+						       FWUPD_DEVICE_FLAG_NONE);
+	state->seq = 0;
+}
+
+/**
+ * fu_device_deltas_remove:
+ * @self: A #FuDeviceDeltas
+ * @device: A #FuDevice
+ *
+ * Forgets the device, dropping any change that has not been emitted.
+ **/
+void
+fu_device_deltas_remove (FuDeviceDeltas *self, FuDevice *device)
+{
+	g_return_if_fail (FU_IS_DEVICE_DELTAS (self));
+	g_return_if_fail (FU_IS_DEVICE (device));
+	g_hash_table_remove (self->pending, fu_device_get_id (device));
+	g_hash_table_remove (self->states, fu_device_get_id (device));
+}
+
+/**
+ * fu_device_deltas_changed:
+ * @self: A #FuDeviceDeltas
+ * @device: A #FuDevice
+ *
+ * Emits ::changed for the first change after the device was added, and
+ * ::changed-delta for every change after that, but never both. If only the
+ * status changed then this is done after a delay, and any further status
+ * changes in that time are included.
+ **/
+void
+fu_device_deltas_changed (FuDeviceDeltas *self, FuDevice *device)
+{
+	FuDeviceDeltasState *state;
+	g_autoptr(GVariant) changed = NULL;
+	g_autoptr(GVariant) removed = NULL;
+	g_autoptr(GVariant) val = NULL;
+
+	g_return_if_fail (FU_IS_DEVICE_DELTAS (self));
+	g_return_if_fail (FU_IS_DEVICE (device));
+
+	/* the progress is not part of the device, so often nothing changed */
+	state = fu_device_deltas_state_ensure (self, device);
+	val = fwupd_device_to_variant_cached (FWUPD_DEVICE (device),
+					      FWUPD_DEVICE_FLAG_NONE);
+	if (!fwupd_device_variant_diff (state->value, val, &changed, &removed))
+		return;
+
+	/* wait to see if the status changes again before telling anyone */
+	if (fu_device_deltas_is_status_only (changed, removed)) {
+		g_hash_table_insert (self->pending,
+				     g_strdup (fu_device_get_id (device)),
+				     g_object_ref (device));
+		if (self->pending_id == 0) {
+			self->pending_id = g_timeout_add (self->timeout_ms,
+							  fu_device_deltas_pending_cb,
+							  self);
+		}
+		return;
+	}
+
+	/* this includes any pending status change too */
+	g_hash_table_remove (self->pending, fu_device_get_id (device));
+	fu_device_deltas_emit (self, device, state, val, changed, removed);
+}
+
+static void
+fu_device_deltas_class_init (FuDeviceDeltasClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = fu_device_deltas_finalize;
+
+	signals[SIGNAL_CHANGED_DELTA] =
+		g_signal_new ("changed-delta",
+			      G_TYPE_FROM_CLASS (object_class), G_SIGNAL_RUN_LAST,
+			      0, NULL, NULL, g_cclosure_marshal_generic,
+			      G_TYPE_NONE, 4, FU_TYPE_DEVICE, G_TYPE_UINT64,
+			      G_TYPE_VARIANT, G_TYPE_VARIANT);
+	signals[SIGNAL_CHANGED] =
+		g_signal_new ("changed",
+			      G_TYPE_FROM_CLASS (object_class), G_SIGNAL_RUN_LAST,
+			      0, NULL, NULL, g_cclosure_marshal_generic,
+			      G_TYPE_NONE, 2, FU_TYPE_DEVICE, G_TYPE_VARIANT);
+}
+
+static void
+fu_device_deltas_init (FuDeviceDeltas *self)
+{
+	self->timeout_ms = FU_DEVICE_DELTAS_TIMEOUT_MS;
+	self->states = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+					      (GDestroyNotify) fu_device_deltas_state_free);
+	self->pending = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+					       (GDestroyNotify) g_object_unref);
+}
+
+static void
+fu_device_deltas_finalize (GObject *obj)
+{
+	FuDeviceDeltas *self = FU_DEVICE_DELTAS (obj);
+
+	if (self->pending_id != 0)
+		g_source_remove (self->pending_id);
+	g_hash_table_unref (self->states);
+	g_hash_table_unref (self->pending);
+
+	G_OBJECT_CLASS (fu_device_deltas_parent_class)->finalize (obj);
+}
+
+/**
+ * fu_device_deltas_new:
+ *
+ * Creates a new object to track what clients know about each device.
+ *
+ * Returns: (transfer full): a #FuDeviceDeltas
+ **/
+FuDeviceDeltas *
+fu_device_deltas_new (void)
+{
+	FuDeviceDeltas *self;
+	self = g_object_new (FU_TYPE_DEVICE_DELTAS, NULL);
+	return FU_DEVICE_DELTAS (self);
+}
@@ -0,0 +1,24 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#pragma once
+
+#include <glib-object.h>
+
+#include "fu-device.h"
+
+#define FU_TYPE_DEVICE_DELTAS (fu_device_deltas_get_type ())
+G_DECLARE_FINAL_TYPE (FuDeviceDeltas, fu_device_deltas, FU, DEVICE_DELTAS, GObject)
+
+FuDeviceDeltas	*fu_device_deltas_new		(void);
+void		 fu_device_deltas_set_timeout	(FuDeviceDeltas	*self,
+						 guint		 timeout_ms);
+void		 fu_device_deltas_add		(FuDeviceDeltas	*self,
+						 FuDevice	*device);
+void		 fu_device_deltas_remove	(FuDeviceDeltas	*self,
+						 FuDevice	*device);
+void		 fu_device_deltas_changed	(FuDeviceDeltas	*self,
+						 FuDevice	*device);
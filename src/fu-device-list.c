@@ -33,13 +33,24 @@
 
 static void fu_device_list_finalize	 (GObject *obj);
 
+typedef enum {
+	FU_DEVICE_LIST_INDEX_ID,
+	FU_DEVICE_LIST_INDEX_ID_OLD,
+	FU_DEVICE_LIST_INDEX_GUID,
+	FU_DEVICE_LIST_INDEX_GUID_OLD,
+	FU_DEVICE_LIST_INDEX_CONNECTION,
+	FU_DEVICE_LIST_INDEX_CONNECTION_OLD,
+	FU_DEVICE_LIST_INDEX_LAST
+} FuDeviceListIndex;
+
 struct _FuDeviceList
 {
 	GObject			 parent_instance;
 	GPtrArray		*devices;	/* of FuDeviceItem */
 	GRWLock			 devices_mutex;
-	GMainLoop		*replug_loop;	/* block waiting for replug */
-	guint			 replug_id;	/* timeout the loop */
+	GHashTable		*index[FU_DEVICE_LIST_INDEX_LAST]; /* key:GPtrArray of FuDeviceItem */
+	gint			 index_dirty;	/* atomic */
+	guint64			 seq;
 };
 
 enum {
@@ -56,6 +67,13 @@ typedef struct {
 	FuDevice		*device_old;
 	FuDeviceList		*self;		/* no ref */
 	guint			 remove_id;
+	guint64			 seq;		/* order added to the list */
+	gulong			 notify_id;
+	gulong			 notify_old_id;
+	GMainLoop		*replug_loop;	/* (nullable): block waiting for replug */
+	GThread			*replug_thread;	/* (nullable): no ref, set wait-for-replug */
+	gint			 index_valid;	/* atomic */
+	GPtrArray		*index_keys[FU_DEVICE_LIST_INDEX_LAST]; /* (nullable) */
 } FuDeviceItem;
 
 G_DEFINE_TYPE (FuDeviceList, fu_device_list, G_TYPE_OBJECT)
@@ -142,6 +160,163 @@ fu_device_list_get_active (FuDeviceList *self)
 	return devices;
 }
 
+static gchar *
+fu_device_list_connection_key (const gchar *physical_id, const gchar *logical_id)
+{
+	if (logical_id == NULL)
+		return g_strdup (physical_id);
+	return g_strdup_printf ("%s\n%s", physical_id, logical_id);
+}
+
+static void
+fu_device_list_index_add (FuDeviceList *self,
+			  FuDeviceItem *item,
+			  FuDeviceListIndex idx,
+			  const gchar *key)
+{
+	GPtrArray *items;
+
+	if (key == NULL)
+		return;
+	items = g_hash_table_lookup (self->index[idx], key);
+	if (items == NULL) {
+		items = g_ptr_array_new ();
+		g_hash_table_insert (self->index[idx], g_strdup (key), items);
+	}
+	g_ptr_array_add (items, item);
+
+	/* so the item can be removed from the index without the device */
+	if (item->index_keys[idx] == NULL)
+		item->index_keys[idx] = g_ptr_array_new_with_free_func (g_free);
+	g_ptr_array_add (item->index_keys[idx], g_strdup (key));
+}
+
+/* must be called with the writer lock held */
+static void
+fu_device_list_index_remove_item (FuDeviceList *self, FuDeviceItem *item)
+{
+	for (guint i = 0; i < FU_DEVICE_LIST_INDEX_LAST; i++) {
+		if (item->index_keys[i] == NULL)
+			continue;
+		for (guint j = 0; j < item->index_keys[i]->len; j++) {
+			const gchar *key = g_ptr_array_index (item->index_keys[i], j);
+			GPtrArray *items = g_hash_table_lookup (self->index[i], key);
+			if (items == NULL)
+				continue;
+			g_ptr_array_remove (items, item);
+			if (items->len == 0)
+				g_hash_table_remove (self->index[i], key);
+		}
+		g_clear_pointer (&item->index_keys[i], g_ptr_array_unref);
+	}
+}
+
+static void
+fu_device_list_index_add_device (FuDeviceList *self,
+				 FuDeviceItem *item,
+				 FuDevice *device,
+				 gboolean is_old)
+{
+	GPtrArray *guids = fu_device_get_guids (device);
+	FuDeviceListIndex idx_id = FU_DEVICE_LIST_INDEX_ID;
+	FuDeviceListIndex idx_guid = FU_DEVICE_LIST_INDEX_GUID;
+	FuDeviceListIndex idx_connection = FU_DEVICE_LIST_INDEX_CONNECTION;
+
+	if (is_old) {
+		idx_id = FU_DEVICE_LIST_INDEX_ID_OLD;
+		idx_guid = FU_DEVICE_LIST_INDEX_GUID_OLD;
+		idx_connection = FU_DEVICE_LIST_INDEX_CONNECTION_OLD;
+	}
+	fu_device_list_index_add (self, item, idx_id, fu_device_get_id (device));
+	fu_device_list_index_add (self, item, idx_id, fu_device_get_equivalent_id (device));
+	for (guint i = 0; i < guids->len; i++) {
+		const gchar *guid = g_ptr_array_index (guids, i);
+		fu_device_list_index_add (self, item, idx_guid, guid);
+	}
+	if (fu_device_get_physical_id (device) != NULL) {
+		g_autofree gchar *key = NULL;
+		key = fu_device_list_connection_key (fu_device_get_physical_id (device),
+						     fu_device_get_logical_id (device));
+		fu_device_list_index_add (self, item, idx_connection, key);
+	}
+}
+
+/* must be called with the writer lock held */
+static void
+fu_device_list_index_add_item (FuDeviceList *self, FuDeviceItem *item)
+{
+	fu_device_list_index_remove_item (self, item);
+	g_atomic_int_set (&item->index_valid, TRUE);
+	if (item->device != NULL)
+		fu_device_list_index_add_device (self, item, item->device, FALSE);
+	if (item->device_old != NULL)
+		fu_device_list_index_add_device (self, item, item->device_old, TRUE);
+}
+
+/* called when a device property used as an index key has changed */
+static void
+fu_device_list_item_invalidate (FuDeviceItem *item)
+{
+	g_atomic_int_set (&item->index_valid, FALSE);
+	g_atomic_int_set (&item->self->index_dirty, TRUE);
+}
+
+/* re-index any items where the device has changed since they were indexed */
+static void
+fu_device_list_index_ensure (FuDeviceList *self)
+{
+	if (!g_atomic_int_get (&self->index_dirty))
+		return;
+
+	g_rw_lock_writer_lock (&self->devices_mutex);
+	g_atomic_int_set (&self->index_dirty, FALSE);
+	for (guint i = 0; i < self->devices->len; i++) {
+		FuDeviceItem *item = g_ptr_array_index (self->devices, i);
+		if (!g_atomic_int_get (&item->index_valid))
+			fu_device_list_index_add_item (self, item);
+	}
+	g_rw_lock_writer_unlock (&self->devices_mutex);
+}
+
+/* returns the matching item that was added to the list first, as this is
+ * the same item that would be found when iterating over self->devices */
+static FuDeviceItem *
+fu_device_list_index_lookup (FuDeviceList *self,
+			     FuDeviceListIndex idx,
+			     const gchar *key,
+			     gboolean only_removed,
+			     FuDeviceItem *item_best)
+{
+	GPtrArray *items = g_hash_table_lookup (self->index[idx], key);
+	if (items == NULL)
+		return item_best;
+	for (guint i = 0; i < items->len; i++) {
+		FuDeviceItem *item = g_ptr_array_index (items, i);
+		if (only_removed && item->remove_id == 0)
+			continue;
+		if (item_best == NULL || item->seq < item_best->seq)
+			item_best = item;
+	}
+	return item_best;
+}
+
+static FuDeviceItem *
+fu_device_list_index_lookup_guid (FuDeviceList *self,
+				  FuDeviceListIndex idx,
+				  const gchar *guid,
+				  gboolean only_removed,
+				  FuDeviceItem *item_best)
+{
+	g_autofree gchar *tmp = NULL;
+
+	/* make valid, in the same way as fu_device_has_guid() */
+	if (!fwupd_guid_is_valid (guid)) {
+		tmp = fwupd_guid_hash_string (guid);
+		guid = tmp;
+	}
+	return fu_device_list_index_lookup (self, idx, guid, only_removed, item_best);
+}
+
 static FuDeviceItem *
 fu_device_list_find_by_device (FuDeviceList *self, FuDevice *device)
 {
@@ -163,21 +338,18 @@ fu_device_list_find_by_device (FuDeviceList *self, FuDevice *device)
 static FuDeviceItem *
 fu_device_list_find_by_guid (FuDeviceList *self, const gchar *guid)
 {
-	g_autoptr(GRWLockReaderLocker) locker = g_rw_lock_reader_locker_new (&self->devices_mutex);
+	FuDeviceItem *item;
+	g_autoptr(GRWLockReaderLocker) locker = NULL;
+
+	fu_device_list_index_ensure (self);
+	locker = g_rw_lock_reader_locker_new (&self->devices_mutex);
 	g_return_val_if_fail (locker != NULL, NULL);
-	for (guint i = 0; i < self->devices->len; i++) {
-		FuDeviceItem *item = g_ptr_array_index (self->devices, i);
-		if (fu_device_has_guid (item->device, guid))
-			return item;
-	}
-	for (guint i = 0; i < self->devices->len; i++) {
-		FuDeviceItem *item = g_ptr_array_index (self->devices, i);
-		if (item->device_old == NULL)
-			continue;
-		if (fu_device_has_guid (item->device_old, guid))
-			return item;
-	}
-	return NULL;
+	item = fu_device_list_index_lookup_guid (self, FU_DEVICE_LIST_INDEX_GUID,
+						 guid, FALSE, NULL);
+	if (item != NULL)
+		return item;
+	return fu_device_list_index_lookup_guid (self, FU_DEVICE_LIST_INDEX_GUID_OLD,
+						 guid, FALSE, NULL);
 }
 
 static FuDeviceItem *
@@ -185,46 +357,32 @@ fu_device_list_find_by_connection (FuDeviceList *self,
 				   const gchar *physical_id,
 				   const gchar *logical_id)
 {
+	FuDeviceItem *item;
+	g_autofree gchar *key = NULL;
 	g_autoptr(GRWLockReaderLocker) locker = NULL;
 	if (physical_id == NULL)
 		return NULL;
+	fu_device_list_index_ensure (self);
+	key = fu_device_list_connection_key (physical_id, logical_id);
 	locker = g_rw_lock_reader_locker_new (&self->devices_mutex);
 	g_return_val_if_fail (locker != NULL, NULL);
-	for (guint i = 0; i < self->devices->len; i++) {
-		FuDeviceItem *item_tmp = g_ptr_array_index (self->devices, i);
-		FuDevice *device = item_tmp->device;
-		if (device != NULL &&
-		    g_strcmp0 (fu_device_get_physical_id (device), physical_id) == 0 &&
-		    g_strcmp0 (fu_device_get_logical_id (device), logical_id) == 0)
-			return item_tmp;
-	}
-	for (guint i = 0; i < self->devices->len; i++) {
-		FuDeviceItem *item_tmp = g_ptr_array_index (self->devices, i);
-		FuDevice *device = item_tmp->device_old;
-		if (device != NULL &&
-		    g_strcmp0 (fu_device_get_physical_id (device), physical_id) == 0 &&
-		    g_strcmp0 (fu_device_get_logical_id (device), logical_id) == 0)
-			return item_tmp;
-	}
-	return NULL;
+	item = fu_device_list_index_lookup (self, FU_DEVICE_LIST_INDEX_CONNECTION,
+					    key, FALSE, NULL);
+	if (item != NULL)
+		return item;
+	return fu_device_list_index_lookup (self, FU_DEVICE_LIST_INDEX_CONNECTION_OLD,
+					    key, FALSE, NULL);
 }
 
+/* used for abbreviated hashes, which cannot use the index */
 static FuDeviceItem *
-fu_device_list_find_by_id (FuDeviceList *self,
-			   const gchar *device_id,
-			   gboolean *multiple_matches)
+fu_device_list_find_by_id_prefix (FuDeviceList *self,
+				  const gchar *device_id,
+				  gboolean *multiple_matches)
 {
 	FuDeviceItem *item = NULL;
-	gsize device_id_len;
-
-	/* sanity check */
-	if (device_id == NULL) {
-		g_critical ("device ID was NULL");
-		return NULL;
-	}
+	gsize device_id_len = strlen (device_id);
 
-	/* support abbreviated hashes */
-	device_id_len = strlen (device_id);
 	g_rw_lock_reader_lock (&self->devices_mutex);
 	for (guint i = 0; i < self->devices->len; i++) {
 		FuDeviceItem *item_tmp = g_ptr_array_index (self->devices, i);
@@ -265,6 +423,46 @@ fu_device_list_find_by_id (FuDeviceList *self,
 	return item;
 }
 
+static FuDeviceItem *
+fu_device_list_find_by_id (FuDeviceList *self,
+			   const gchar *device_id,
+			   gboolean *multiple_matches)
+{
+	FuDeviceListIndex idxs[] = { FU_DEVICE_LIST_INDEX_ID,
+				     FU_DEVICE_LIST_INDEX_ID_OLD };
+	g_autoptr(GRWLockReaderLocker) locker = NULL;
+
+	/* sanity check */
+	if (device_id == NULL) {
+		g_critical ("device ID was NULL");
+		return NULL;
+	}
+
+	/* support abbreviated hashes */
+	if (!fwupd_device_id_is_valid (device_id))
+		return fu_device_list_find_by_id_prefix (self, device_id, multiple_matches);
+
+	/* only search old devices if we didn't find the active device */
+	fu_device_list_index_ensure (self);
+	locker = g_rw_lock_reader_locker_new (&self->devices_mutex);
+	g_return_val_if_fail (locker != NULL, NULL);
+	for (guint i = 0; i < G_N_ELEMENTS (idxs); i++) {
+		FuDeviceItem *item = NULL;
+		GPtrArray *items = g_hash_table_lookup (self->index[idxs[i]], device_id);
+		if (items == NULL)
+			continue;
+		if (items->len > 1 && multiple_matches != NULL)
+			*multiple_matches = TRUE;
+		for (guint j = 0; j < items->len; j++) {
+			FuDeviceItem *item_tmp = g_ptr_array_index (items, j);
+			if (item == NULL || item_tmp->seq > item->seq)
+				item = item_tmp;
+		}
+		return item;
+	}
+	return NULL;
+}
+
 /**
  * fu_device_list_get_old:
  * @self: A #FuDeviceList
@@ -288,59 +486,39 @@ fu_device_list_get_old (FuDeviceList *self, FuDevice *device)
 }
 
 static FuDeviceItem *
-fu_device_list_get_by_guids (FuDeviceList *self, GPtrArray *guids)
+fu_device_list_get_by_guids_full (FuDeviceList *self, GPtrArray *guids, gboolean only_removed)
 {
-	g_autoptr(GRWLockReaderLocker) locker = g_rw_lock_reader_locker_new (&self->devices_mutex);
+	FuDeviceItem *item = NULL;
+	g_autoptr(GRWLockReaderLocker) locker = NULL;
+
+	fu_device_list_index_ensure (self);
+	locker = g_rw_lock_reader_locker_new (&self->devices_mutex);
 	g_return_val_if_fail (locker != NULL, NULL);
-	for (guint i = 0; i < self->devices->len; i++) {
-		FuDeviceItem *item = g_ptr_array_index (self->devices, i);
-		for (guint j = 0; j < guids->len; j++) {
-			const gchar *guid = g_ptr_array_index (guids, j);
-			if (fu_device_has_guid (item->device, guid))
-				return item;
-		}
+	for (guint j = 0; j < guids->len; j++) {
+		const gchar *guid = g_ptr_array_index (guids, j);
+		item = fu_device_list_index_lookup_guid (self, FU_DEVICE_LIST_INDEX_GUID,
+							 guid, only_removed, item);
 	}
-	for (guint i = 0; i < self->devices->len; i++) {
-		FuDeviceItem *item = g_ptr_array_index (self->devices, i);
-		if (item->device_old == NULL)
-			continue;
-		for (guint j = 0; j < guids->len; j++) {
-			const gchar *guid = g_ptr_array_index (guids, j);
-			if (fu_device_has_guid (item->device_old, guid))
-				return item;
-		}
+	if (item != NULL)
+		return item;
+	for (guint j = 0; j < guids->len; j++) {
+		const gchar *guid = g_ptr_array_index (guids, j);
+		item = fu_device_list_index_lookup_guid (self, FU_DEVICE_LIST_INDEX_GUID_OLD,
+							 guid, only_removed, item);
 	}
-	return NULL;
+	return item;
+}
+
+static FuDeviceItem *
+fu_device_list_get_by_guids (FuDeviceList *self, GPtrArray *guids)
+{
+	return fu_device_list_get_by_guids_full (self, guids, FALSE);
 }
 
 static FuDeviceItem *
 fu_device_list_get_by_guids_removed (FuDeviceList *self, GPtrArray *guids)
 {
-	g_autoptr(GRWLockReaderLocker) locker = g_rw_lock_reader_locker_new (&self->devices_mutex);
-	g_return_val_if_fail (locker != NULL, NULL);
-	for (guint i = 0; i < self->devices->len; i++) {
-		FuDeviceItem *item = g_ptr_array_index (self->devices, i);
-		if (item->remove_id == 0)
-			continue;
-		for (guint j = 0; j < guids->len; j++) {
-			const gchar *guid = g_ptr_array_index (guids, j);
-			if (fu_device_has_guid (item->device, guid))
-				return item;
-		}
-	}
-	for (guint i = 0; i < self->devices->len; i++) {
-		FuDeviceItem *item = g_ptr_array_index (self->devices, i);
-		if (item->device_old == NULL)
-			continue;
-		if (item->remove_id == 0)
-			continue;
-		for (guint j = 0; j < guids->len; j++) {
-			const gchar *guid = g_ptr_array_index (guids, j);
-			if (fu_device_has_guid (item->device_old, guid))
-				return item;
-		}
-	}
-	return NULL;
+	return fu_device_list_get_by_guids_full (self, guids, TRUE);
 }
 
 static gboolean
@@ -496,6 +674,45 @@ fu_device_list_item_finalized_cb (gpointer data, GObject *where_the_object_was)
 	g_rw_lock_writer_unlock (&self->devices_mutex);
 }
 
+static void
+fu_device_list_item_notify_cb (FuDevice *device, GParamSpec *pspec, gpointer user_data)
+{
+	FuDeviceItem *item = (FuDeviceItem *) user_data;
+	if (g_strcmp0 (pspec->name, "id") == 0 ||
+	    g_strcmp0 (pspec->name, "equivalent-id") == 0 ||
+	    g_strcmp0 (pspec->name, "physical-id") == 0 ||
+	    g_strcmp0 (pspec->name, "logical-id") == 0 ||
+	    g_strcmp0 (pspec->name, "guids") == 0)
+		fu_device_list_item_invalidate (item);
+
+	/* remember which install thread is expecting the device to replug */
+	if (g_strcmp0 (pspec->name, "flags") == 0 && device == item->device) {
+		if (!fu_device_has_flag (device, FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG))
+			item->replug_thread = NULL;
+		else if (item->replug_thread == NULL)
+			item->replug_thread = g_thread_self ();
+	}
+}
+
+static void
+fu_device_list_item_watch (FuDeviceItem *item, FuDevice *device, gulong *notify_id)
+{
+	/* the handler has already been destroyed if the device was finalized */
+	if (*notify_id != 0) {
+		GObject *device_old = G_OBJECT (notify_id == &item->notify_id ?
+						item->device : item->device_old);
+		if (g_signal_handler_is_connected (device_old, *notify_id))
+			g_signal_handler_disconnect (device_old, *notify_id);
+		*notify_id = 0;
+	}
+	if (device != NULL) {
+		*notify_id = g_signal_connect (device, "notify",
+					       G_CALLBACK (fu_device_list_item_notify_cb),
+					       item);
+	}
+	fu_device_list_item_invalidate (item);
+}
+
 /* this should never be required, and yet here we are */
 static void
 fu_device_list_item_set_device (FuDeviceItem *item, FuDevice *device)
@@ -510,7 +727,19 @@ fu_device_list_item_set_device (FuDeviceItem *item, FuDevice *device)
 				   fu_device_list_item_finalized_cb,
 				   item);
 	}
+	fu_device_list_item_watch (item, device, &item->notify_id);
 	g_set_object (&item->device, device);
+	if (device != NULL && fu_device_has_flag (device, FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG))
+		item->replug_thread = g_thread_self ();
+	else
+		item->replug_thread = NULL;
+}
+
+static void
+fu_device_list_item_set_device_old (FuDeviceItem *item, FuDevice *device)
+{
+	fu_device_list_item_watch (item, device, &item->notify_old_id);
+	g_set_object (&item->device_old, device);
 }
 
 static void
@@ -574,16 +803,17 @@ fu_device_list_replace (FuDeviceList *self, FuDeviceItem *item, FuDevice *device
 	}
 
 	/* assign the new device */
-	g_set_object (&item->device_old, item->device);
+	fu_device_list_item_set_device_old (item, item->device);
 	fu_device_list_item_set_device (item, device);
 	fu_device_list_emit_device_changed (self, device);
 
 	/* we were waiting for this... */
 	if (fu_device_has_flag (item->device_old, FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG) &&
-	    g_main_loop_is_running (self->replug_loop)) {
+	    item->replug_loop != NULL &&
+	    g_main_loop_is_running (item->replug_loop)) {
 		g_debug ("quitting replug loop");
 		fu_device_remove_flag (item->device_old, FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG);
-		g_main_loop_quit (self->replug_loop);
+		g_main_loop_quit (item->replug_loop);
 	}
 }
 
@@ -705,7 +935,9 @@ fu_device_list_add (FuDeviceList *self, FuDevice *device)
 	item->self = self; /* no ref */
 	fu_device_list_item_set_device (item, device);
 	g_rw_lock_writer_lock (&self->devices_mutex);
+	item->seq = self->seq++;
 	g_ptr_array_add (self->devices, item);
+	fu_device_list_index_add_item (self, item);
 	g_rw_lock_writer_unlock (&self->devices_mutex);
 	fu_device_list_emit_device_added (self, device);
 }
@@ -743,14 +975,11 @@ fu_device_list_get_by_guid (FuDeviceList *self, const gchar *guid, GError **erro
 static gboolean
 fu_device_list_replug_cb (gpointer user_data)
 {
-	FuDeviceList *self = FU_DEVICE_LIST (user_data);
-
-	/* no longer valid */
-	self->replug_id = 0;
+	GMainLoop *loop = (GMainLoop *) user_data;
 
 	/* quit loop */
 	g_debug ("device did not replug");
-	g_main_loop_quit (self->replug_loop);
+	g_main_loop_quit (loop);
 	return FALSE;
 }
 
@@ -765,6 +994,9 @@ fu_device_list_replug_cb (gpointer user_data)
  *
  * If the device does not exist this function returns without an error.
  *
+ * The wait runs on the thread-default main context, and so different threads
+ * can each wait for a different device to replug at the same time.
+ *
  * Returns: %TRUE for success
  *
  * Since: 1.1.2
@@ -774,11 +1006,13 @@ fu_device_list_wait_for_replug (FuDeviceList *self, FuDevice *device, GError **e
 {
 	FuDeviceItem *item;
 	guint remove_delay;
+	g_autoptr(GMainContext) context = g_main_context_ref_thread_default ();
+	g_autoptr(GMainLoop) loop = NULL;
+	g_autoptr(GSource) source = NULL;
 
 	g_return_val_if_fail (FU_IS_DEVICE_LIST (self), FALSE);
 	g_return_val_if_fail (FU_IS_DEVICE (device), FALSE);
 	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
-	g_return_val_if_fail (self->replug_id == 0, FALSE);
 
 	/* not found */
 	item = fu_device_list_find_by_device (self, device);
@@ -791,10 +1025,13 @@ fu_device_list_wait_for_replug (FuDeviceList *self, FuDevice *device, GError **e
 		return TRUE;
 	}
 
-	/* check that no other devices are waiting for replug too */
+	/* check that no other devices are waiting for replug too, ignoring
+	 * any device that is being installed from a different thread */
 	for (guint i = 0; i < self->devices->len; i++) {
 		FuDeviceItem *item_tmp = g_ptr_array_index (self->devices, i);
 		if (item_tmp->device != device &&
+		    item_tmp->replug_loop == NULL &&
+		    item_tmp->replug_thread == g_thread_self () &&
 		    fu_device_has_flag (item_tmp->device, FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG)) {
 			g_warning ("%s is wait-for-replug when %s scheduled, unsetting",
 				   fu_device_get_id (item_tmp->device),
@@ -817,14 +1054,27 @@ fu_device_list_wait_for_replug (FuDeviceList *self, FuDevice *device, GError **e
 	}
 
 	/* time to unplug and then re-plug */
-	self->replug_id = g_timeout_add (remove_delay, fu_device_list_replug_cb, self);
-	g_main_loop_run (self->replug_loop);
+	loop = g_main_loop_new (context, FALSE);
+	source = g_timeout_source_new (remove_delay);
+	g_source_set_callback (source, fu_device_list_replug_cb, loop, NULL);
+	g_source_attach (source, context);
+	item->replug_loop = g_main_loop_ref (loop);
+	g_main_loop_run (loop);
 
 	/* cancel timeout if still pending */
-	if (self->replug_id != 0) {
-		g_source_remove (self->replug_id);
-		self->replug_id = 0;
+	g_source_destroy (source);
+
+	/* the item is freed if the device was removed while waiting */
+	item = fu_device_list_find_by_device (self, device);
+	if (item == NULL) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_FOUND,
+			     "device %s was removed",
+			     fu_device_get_id (device));
+		return FALSE;
 	}
+	g_clear_pointer (&item->replug_loop, g_main_loop_unref);
 
 	/* device was not added back to the device list */
 	if (fu_device_has_flag (item->device, FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG)) {
@@ -840,7 +1090,9 @@ fu_device_list_wait_for_replug (FuDeviceList *self, FuDevice *device, GError **e
 	/* check that no other devices are waiting for replug instead */
 	for (guint i = 0; i < self->devices->len; i++) {
 		FuDeviceItem *item_tmp = g_ptr_array_index (self->devices, i);
-		if (fu_device_has_flag (item_tmp->device, FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG)) {
+		if (item_tmp->replug_loop == NULL &&
+		    item_tmp->replug_thread == g_thread_self () &&
+		    fu_device_has_flag (item_tmp->device, FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG)) {
 			g_warning ("%s is wait-for-replug when %s performed",
 				   fu_device_get_id (item_tmp->device),
 				   fu_device_get_id (device));
@@ -900,13 +1152,18 @@ fu_device_list_get_by_id (FuDeviceList *self, const gchar *device_id, GError **e
 	return g_object_ref (item->device);
 }
 
+/* called with the writer lock held when removed from self->devices */
 static void
 fu_device_list_item_free (FuDeviceItem *item)
 {
 	if (item->remove_id != 0)
 		g_source_remove (item->remove_id);
-	if (item->device_old != NULL)
-		g_object_unref (item->device_old);
+	if (item->replug_loop != NULL) {
+		g_main_loop_quit (item->replug_loop);
+		g_main_loop_unref (item->replug_loop);
+	}
+	fu_device_list_index_remove_item (item->self, item);
+	fu_device_list_item_set_device_old (item, NULL);
 	fu_device_list_item_set_device (item, NULL);
 	g_free (item);
 }
@@ -938,7 +1195,10 @@ static void
 fu_device_list_init (FuDeviceList *self)
 {
 	self->devices = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_device_list_item_free);
-	self->replug_loop = g_main_loop_new (NULL, FALSE);
+	for (guint i = 0; i < FU_DEVICE_LIST_INDEX_LAST; i++) {
+		self->index[i] = g_hash_table_new_full (g_str_hash, g_str_equal,
+							g_free, (GDestroyNotify) g_ptr_array_unref);
+	}
 	g_rw_lock_init (&self->devices_mutex);
 }
 
@@ -949,10 +1209,9 @@ fu_device_list_finalize (GObject *obj)
 
 	g_rw_lock_clear (&self->devices_mutex);
 
-	if (self->replug_id != 0)
-		g_source_remove (self->replug_id);
 	g_ptr_array_unref (self->devices);
-	g_main_loop_unref (self->replug_loop);
+	for (guint i = 0; i < FU_DEVICE_LIST_INDEX_LAST; i++)
+		g_hash_table_unref (self->index[i]);
 
 	G_OBJECT_CLASS (fu_device_list_parent_class)->finalize (obj);
 }
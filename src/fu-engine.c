@@ -11,8 +11,10 @@
 #include <gio/gio.h>
 #ifdef HAVE_GIO_UNIX
 #include <gio/gunixinputstream.h>
+#include <gio/gunixoutputstream.h>
 #endif
 #include <glib-object.h>
+#include <glib/gstdio.h>
 #ifdef HAVE_GUDEV
 #include <gudev/gudev.h>
 #endif
@@ -34,13 +36,15 @@
 #include "fu-common.h"
 #include "fu-config.h"
 #include "fu-debug.h"
+#include "fu-device-cache.h"
 #include "fu-device-list.h"
 #include "fu-device-private.h"
 #include "fu-engine.h"
 #include "fu-engine-helper.h"
 #include "fu-engine-request.h"
-#include "fu-hwids.h"
+#include "fu-hwids-private.h"
 #include "fu-idle.h"
+#include "fu-profile.h"
 #include "fu-keyring-utils.h"
 #include "fu-hash.h"
 #include "fu-history.h"
@@ -70,6 +74,28 @@
 
 static void fu_engine_finalize	 (GObject *obj);
 static void fu_engine_ensure_security_attrs	(FuEngine *self);
+static void fu_engine_plugin_device_added_cb	(FuPlugin *plugin,
+						 FuDevice *device,
+						 gpointer user_data);
+static void fu_engine_plugin_device_removed_cb	(FuPlugin *plugin,
+						 FuDevice *device,
+						 gpointer user_data);
+static void fu_engine_plugin_device_register_cb	(FuPlugin *plugin,
+						 FuDevice *device,
+						 gpointer user_data);
+static void fu_engine_plugin_security_changed_cb (FuPlugin *plugin,
+						 gpointer user_data);
+static gboolean fu_engine_plugin_check_supported_cb (FuPlugin *plugin,
+						 const gchar *guid,
+						 FuEngine *self);
+static void fu_engine_plugin_set_coldplug_delay_cb (FuPlugin *plugin,
+						 guint duration,
+						 FuEngine *self);
+static void fu_engine_plugin_rules_changed_cb	(FuPlugin *plugin,
+						 gpointer user_data);
+static FuPlugin *fu_engine_get_plugin_by_name	(FuEngine *self,
+						 const gchar *name,
+						 GError **error);
 
 struct _FuEngine
 {
@@ -85,12 +111,25 @@ struct _FuEngine
 	FwupdStatus		 status;
 	gboolean		 tainted;
 	guint			 percentage;
+	GHashTable		*install_progress;	/* (nullable): device-id:percentage */
+	GCancellable		*install_cancellable;
+	GMutex			 install_mutex;	/* held by threads running a concurrent install */
 	FuHistory		*history;
 	FuIdle			*idle;
-	XbSilo			*silo;
+	FuProfile		*profile;
+	GHashTable		*plugins_lazy;	/* name:filename */
+	FuDeviceCache		*device_cache;
+	GPtrArray		*devices_cached;	/* of FuDevice, not yet probed */
+	guint			 device_cache_id;
+	GPtrArray		*silos;		/* of XbSilo, in remote order */
+	GHashTable		*silo_remotes;	/* remote-id:XbSilo */
+	GHashTable		*component_guids;	/* guid:GPtrArray of XbNode */
+	GHashTable		*component_order;	/* XbNode:position in remote order */
 	gboolean		 coldplug_running;
 	guint			 coldplug_id;
 	guint			 coldplug_delay;
+	GAsyncQueue		*coldplug_queue;	/* (nullable): of FuEngineColdplugEvent */
+	GThread			*coldplug_thread;	/* (nullable) */
 	FuPluginList		*plugin_list;
 	GPtrArray		*plugin_filter;
 	GPtrArray		*udev_subsystems;
@@ -220,12 +259,37 @@ fu_engine_set_percentage (FuEngine *self, guint percentage)
 	g_signal_emit (self, signals[SIGNAL_PERCENTAGE_CHANGED], 0, percentage);
 }
 
+/* when installing to several devices at the same time the percentage is the
+ * mean of the progress of every device, with finished devices at 100% */
+static void
+fu_engine_install_progress_update (FuEngine *self, FuDevice *device, guint percentage)
+{
+	GHashTableIter iter;
+	gpointer value;
+	guint total = 0;
+
+	if (!g_hash_table_contains (self->install_progress, fu_device_get_id (device)))
+		return;
+	g_hash_table_insert (self->install_progress,
+			     g_strdup (fu_device_get_id (device)),
+			     GUINT_TO_POINTER (percentage));
+	g_hash_table_iter_init (&iter, self->install_progress);
+	while (g_hash_table_iter_next (&iter, NULL, &value))
+		total += GPOINTER_TO_UINT (value);
+	fu_engine_set_percentage (self, total / g_hash_table_size (self->install_progress));
+}
+
 static void
 fu_engine_progress_notify_cb (FuDevice *device, GParamSpec *pspec, FuEngine *self)
 {
 	if (fu_device_get_status (device) == FWUPD_STATUS_UNKNOWN)
 		return;
-	fu_engine_set_percentage (self, fu_device_get_progress (device));
+	if (self->install_progress != NULL) {
+		fu_engine_install_progress_update (self, device,
+						   fu_device_get_progress (device));
+	} else {
+		fu_engine_set_percentage (self, fu_device_get_progress (device));
+	}
 	fu_engine_emit_device_changed (self, device);
 }
 
@@ -254,10 +318,37 @@ fu_engine_watch_device (FuEngine *self, FuDevice *device)
 			  G_CALLBACK (fu_engine_status_notify_cb), self);
 }
 
+static gboolean
+fu_engine_device_cache_save_cb (gpointer user_data)
+{
+	FuEngine *self = FU_ENGINE (user_data);
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) devices = fu_device_list_get_active (self->device_list);
+
+	self->device_cache_id = 0;
+	if (!fu_device_cache_save (self->device_cache, devices, &error))
+		g_debug ("failed to save device cache: %s", error->message);
+	return G_SOURCE_REMOVE;
+}
+
+/* save a snapshot once the device list has settled */
+static void
+fu_engine_device_cache_schedule_save (FuEngine *self)
+{
+	if (!self->loaded || self->device_cache_id != 0 || self->devices_cached->len > 0)
+		return;
+	if (self->app_flags & FU_APP_FLAGS_NO_IDLE_SOURCES)
+		return;
+	if (!fu_config_get_device_cache (self->config))
+		return;
+	self->device_cache_id = g_timeout_add_seconds (5, fu_engine_device_cache_save_cb, self);
+}
+
 static void
 fu_engine_device_added_cb (FuDeviceList *device_list, FuDevice *device, FuEngine *self)
 {
 	fu_engine_watch_device (self, device);
+	fu_engine_device_cache_schedule_save (self);
 	g_signal_emit (self, signals[SIGNAL_DEVICE_ADDED], 0, device);
 }
 
@@ -276,6 +367,7 @@ fu_engine_device_removed_cb (FuDeviceList *device_list, FuDevice *device, FuEngi
 {
 	fu_engine_device_runner_device_removed (self, device);
 	g_signal_handlers_disconnect_by_data (device, self);
+	fu_engine_device_cache_schedule_save (self);
 	g_signal_emit (self, signals[SIGNAL_DEVICE_REMOVED], 0, device);
 }
 
@@ -283,6 +375,7 @@ static void
 fu_engine_device_changed_cb (FuDeviceList *device_list, FuDevice *device, FuEngine *self)
 {
 	fu_engine_watch_device (self, device);
+	fu_engine_device_cache_schedule_save (self);
 	fu_engine_emit_device_changed (self, device);
 }
 
@@ -463,6 +556,113 @@ fu_engine_set_release_from_appstream (FuEngine *self,
 	return TRUE;
 }
 
+/* each remote is compiled into its own silo, so query them all in order */
+static XbNode *
+fu_engine_silo_query_first (FuEngine *self, const gchar *xpath)
+{
+	for (guint i = 0; i < self->silos->len; i++) {
+		XbSilo *silo = g_ptr_array_index (self->silos, i);
+		g_autoptr(XbNode) n = xb_silo_query_first (silo, xpath, NULL);
+		if (n != NULL)
+			return g_steal_pointer (&n);
+	}
+	return NULL;
+}
+
+static void
+fu_engine_component_guids_add (FuEngine *self,
+			       XbNode *component,
+			       guint order,
+			       const gchar *guid)
+{
+	GPtrArray *components = g_hash_table_lookup (self->component_guids, guid);
+
+	/* the node is kept alive by the GUID index */
+	g_hash_table_insert (self->component_order, component, GUINT_TO_POINTER (order));
+	if (components == NULL) {
+		components = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+		g_hash_table_insert (self->component_guids, g_strdup (guid), components);
+	}
+
+	/* the same GUID listed twice in one component */
+	if (components->len > 0 &&
+	    g_ptr_array_index (components, components->len - 1) == component)
+		return;
+	g_ptr_array_add (components, g_object_ref (component));
+}
+
+/* maps each flashed GUID to the components that provide it, so that devices
+ * do not each have to run an XPath query against every silo */
+static void
+fu_engine_index_component_guids (FuEngine *self)
+{
+	guint components_cnt = 0;
+
+	fu_profile_push (self->profile, "index-component-guids");
+	g_hash_table_remove_all (self->component_order);
+	g_hash_table_remove_all (self->component_guids);
+	for (guint i = 0; i < self->silos->len; i++) {
+		XbSilo *silo = g_ptr_array_index (self->silos, i);
+		g_autoptr(GPtrArray) components = NULL;
+
+		components = xb_silo_query (silo, "components/component", 0, NULL);
+		if (components == NULL)
+			continue;
+		for (guint j = 0; j < components->len; j++) {
+			XbNode *component = g_ptr_array_index (components, j);
+			g_autoptr(XbNode) provides = NULL;
+			g_autoptr(XbNode) n = NULL;
+
+			provides = xb_node_query_first (component, "provides", NULL);
+			if (provides == NULL)
+				continue;
+			n = xb_node_get_child (provides);
+			while (n != NULL) {
+				XbNode *n_next;
+				if (g_strcmp0 (xb_node_get_element (n), "firmware") == 0 &&
+				    g_strcmp0 (xb_node_get_attr (n, "type"), "flashed") == 0 &&
+				    xb_node_get_text (n) != NULL)
+					fu_engine_component_guids_add (self, component,
+								       components_cnt + j,
+								       xb_node_get_text (n));
+				n_next = xb_node_get_next (n);
+				g_object_unref (n);
+				n = n_next;
+			}
+		}
+		components_cnt += components->len;
+	}
+	fu_profile_pop (self->profile);
+	g_debug ("%u components with %u GUIDs now in %u silos",
+		 components_cnt,
+		 g_hash_table_size (self->component_guids),
+		 self->silos->len);
+}
+
+/* returns all the components that provide any of the device GUIDs */
+static GPtrArray *
+fu_engine_get_components_by_guids (FuEngine *self, FuDevice *device)
+{
+	GPtrArray *guids = fu_device_get_guids (device);
+	g_autoptr(GHashTable) components_set = g_hash_table_new (g_direct_hash, g_direct_equal);
+	GPtrArray *components = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+
+	for (guint i = 0; i < guids->len; i++) {
+		const gchar *guid = g_ptr_array_index (guids, i);
+		GPtrArray *tmp = g_hash_table_lookup (self->component_guids, guid);
+		if (tmp == NULL)
+			continue;
+		for (guint j = 0; j < tmp->len; j++) {
+			XbNode *component = g_ptr_array_index (tmp, j);
+			if (g_hash_table_contains (components_set, component))
+				continue;
+			g_hash_table_add (components_set, component);
+			g_ptr_array_add (components, g_object_ref (component));
+		}
+	}
+	return components;
+}
+
 /* finds the remote-id for the first firmware in the silo that matches this
  * container checksum */
 static const gchar *
@@ -473,7 +673,7 @@ fu_engine_get_remote_id_for_checksum (FuEngine *self, const gchar *csum)
 	xpath = g_strdup_printf ("components/component/releases/release/"
 				 "checksum[@target='container'][text()='%s']/../../"
 				 "../../custom/value[@key='fwupd::RemoteId']", csum);
-	key = xb_silo_query_first (self->silo, xpath, NULL);
+	key = fu_engine_silo_query_first (self, xpath);
 	if (key == NULL)
 		return NULL;
 	return xb_node_get_text (key);
@@ -532,6 +732,10 @@ fu_engine_modify_config (FuEngine *self, const gchar *key, const gchar *value, G
 		"VerboseDomains",
 		"UpdateMotd",
 		"EnumerateAllDevices",
+		"ConcurrentColdplug",
+		"LazyPlugins",
+		"DeviceCache",
+		"ConcurrentInstalls",
 		NULL };
 
 	g_return_val_if_fail (FU_IS_ENGINE (self), FALSE);
@@ -773,23 +977,32 @@ fu_engine_verify_update (FuEngine *self, const gchar *device_id, GError **error)
 	return TRUE;
 }
 
+/* returns the component for any of the device GUIDs that comes first in
+ * the highest priority remote, as each GUID only lists its own components */
 XbNode *
 fu_engine_get_component_by_guids (FuEngine *self, FuDevice *device)
 {
 	GPtrArray *guids = fu_device_get_guids (device);
-	g_autoptr(GString) xpath = g_string_new (NULL);
-	g_autoptr(XbNode) component = NULL;
+	XbNode *component_best = NULL;
+	guint order_best = G_MAXUINT;
+
 	for (guint i = 0; i < guids->len; i++) {
 		const gchar *guid = g_ptr_array_index (guids, i);
-		xb_string_append_union (xpath,
-					"components/component/"
-					"provides/firmware[@type='flashed'][text()='%s']/"
-					"../..", guid);
+		GPtrArray *components = g_hash_table_lookup (self->component_guids, guid);
+		XbNode *component;
+		guint order;
+		if (components == NULL)
+			continue;
+		component = g_ptr_array_index (components, 0);
+		order = GPOINTER_TO_UINT (g_hash_table_lookup (self->component_order, component));
+		if (order < order_best) {
+			component_best = component;
+			order_best = order;
+		}
 	}
-	component = xb_silo_query_first (self->silo, xpath->str, NULL);
-	if (component != NULL)
-		return g_steal_pointer (&component);
-	return NULL;
+	if (component_best == NULL)
+		return NULL;
+	return g_object_ref (component_best);
 }
 
 static XbNode *
@@ -849,47 +1062,54 @@ fu_engine_verify_from_system_metadata (FuEngine *self,
 {
 	FwupdVersionFormat fmt = fu_device_get_version_format (device);
 	GPtrArray *guids = fu_device_get_guids (device);
-	g_autoptr(XbQuery) query = NULL;
 
-	/* prepare query with bound GUID parameter */
-	query = xb_query_new_full (self->silo,
-				   "components/component/"
-				   "provides/firmware[@type='flashed'][text()=?]/"
-				   "../../releases/release",
-				   XB_QUERY_FLAG_OPTIMIZE |
-				   XB_QUERY_FLAG_USE_INDEXES,
-				   error);
-	if (query == NULL)
-		return NULL;
+	for (guint k = 0; k < self->silos->len; k++) {
+		XbSilo *silo = g_ptr_array_index (self->silos, k);
+		g_autoptr(GError) error_query = NULL;
+		g_autoptr(XbQuery) query = NULL;
+
+		/* prepare query with bound GUID parameter */
+		query = xb_query_new_full (silo,
+					   "components/component/"
+					   "provides/firmware[@type='flashed'][text()=?]/"
+					   "../../releases/release",
+					   XB_QUERY_FLAG_OPTIMIZE |
+					   XB_QUERY_FLAG_USE_INDEXES,
+					   &error_query);
+		if (query == NULL) {
+			g_debug ("ignoring silo: %s", error_query->message);
+			continue;
+		}
 
-	/* use prepared query for each GUID */
-	for (guint i = 0; i < guids->len; i++) {
-		const gchar *guid = g_ptr_array_index (guids, i);
-		g_autoptr(GError) error_local = NULL;
-		g_autoptr(GPtrArray) releases = NULL;
+		/* use prepared query for each GUID */
+		for (guint i = 0; i < guids->len; i++) {
+			const gchar *guid = g_ptr_array_index (guids, i);
+			g_autoptr(GError) error_local = NULL;
+			g_autoptr(GPtrArray) releases = NULL;
 
-		/* bind GUID and then query */
-		if (!xb_query_bind_str (query, 0, guid, error)) {
-			g_prefix_error (error, "failed to bind string: ");
-			return NULL;
-		}
-		releases = xb_silo_query_full (self->silo, query, &error_local);
-		if (releases == NULL) {
-			if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND) ||
-			    g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT)) {
-				g_debug ("could not find %s: %s",
-					 guid, error_local->message);
-				continue;
+			/* bind GUID and then query */
+			if (!xb_query_bind_str (query, 0, guid, error)) {
+				g_prefix_error (error, "failed to bind string: ");
+				return NULL;
+			}
+			releases = xb_silo_query_full (silo, query, &error_local);
+			if (releases == NULL) {
+				if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND) ||
+				    g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT)) {
+					g_debug ("could not find %s: %s",
+						 guid, error_local->message);
+					continue;
+				}
+				g_propagate_error (error, g_steal_pointer (&error_local));
+				return NULL;
+			}
+			for (guint j = 0; j < releases->len; j++) {
+				XbNode *rel = g_ptr_array_index (releases, j);
+				const gchar *rel_ver = xb_node_get_attr (rel, "version");
+				g_autofree gchar *tmp_ver = fu_common_version_parse_from_format (rel_ver, fmt);
+				if (fu_common_vercmp_full (tmp_ver, fu_device_get_version (device), fmt) == 0)
+					return g_object_ref (rel);
 			}
-			g_propagate_error (error, g_steal_pointer (&error_local));
-			return NULL;
-		}
-		for (guint j = 0; j < releases->len; j++) {
-			XbNode *rel = g_ptr_array_index (releases, j);
-			const gchar *rel_ver = xb_node_get_attr (rel, "version");
-			g_autofree gchar *tmp_ver = fu_common_version_parse_from_format (rel_ver, fmt);
-			if (fu_common_vercmp_full (tmp_ver, fu_device_get_version (device), fmt) == 0)
-				return g_object_ref (rel);
 		}
 	}
 
@@ -1725,6 +1945,213 @@ fu_engine_composite_cleanup (FuEngine *self, GPtrArray *devices, GError **error)
 	return TRUE;
 }
 
+/* the install lock of the engine, set on each thread taking part in a
+ * concurrent install as a GPollFunc has no user data */
+static GPrivate fu_engine_install_mutex_private;
+
+static gint
+fu_engine_install_poll_cb (GPollFD *ufds, guint nfsd, gint timeout_)
+{
+	GMutex *mutex = g_private_get (&fu_engine_install_mutex_private);
+	gint rc;
+	g_mutex_unlock (mutex);
+	rc = g_poll (ufds, nfsd, timeout_);
+	g_mutex_lock (mutex);
+	return rc;
+}
+
+typedef struct {
+	FuEngine		*self;
+	GBytes			*blob_cab;
+	FwupdInstallFlags	 flags;
+	GMainLoop		*loop;
+	guint			 todo;
+} FuEngineInstallHelper;
+
+typedef struct {
+	GPtrArray		*tasks;		/* of FuInstallTask */
+	GError			*error;
+} FuEngineInstallGroup;
+
+static void
+fu_engine_install_group_free (FuEngineInstallGroup *group)
+{
+	g_ptr_array_unref (group->tasks);
+	if (group->error != NULL)
+		g_error_free (group->error);
+	g_free (group);
+}
+
+/* runs with the lock held, each group using its own main context so that
+ * waiting for one device to replug does not block the other groups; the lock
+ * is only dropped while polling, so plugin code that blocks without a main
+ * loop serializes and only threaded-write devices are written in parallel */
+static void
+fu_engine_install_group_worker_cb (gpointer data, gpointer user_data)
+{
+	FuEngineInstallGroup *group = (FuEngineInstallGroup *) data;
+	FuEngineInstallHelper *helper = (FuEngineInstallHelper *) user_data;
+	g_autoptr(GMainContext) context = g_main_context_new ();
+
+	g_private_set (&fu_engine_install_mutex_private, &helper->self->install_mutex);
+	g_main_context_set_poll_func (context, fu_engine_install_poll_cb);
+	g_main_context_push_thread_default (context);
+	g_mutex_lock (&helper->self->install_mutex);
+	for (guint i = 0; i < group->tasks->len; i++) {
+		FuInstallTask *task = g_ptr_array_index (group->tasks, i);
+		FuDevice *device = fu_install_task_get_device (task);
+		if (!fu_engine_install (helper->self, task, helper->blob_cab,
+					helper->flags, &group->error))
+			break;
+		fu_engine_install_progress_update (helper->self, device, 100);
+	}
+	if (--helper->todo == 0)
+		g_main_loop_quit (helper->loop);
+	g_mutex_unlock (&helper->self->install_mutex);
+	g_main_context_pop_thread_default (context);
+	g_private_set (&fu_engine_install_mutex_private, NULL);
+}
+
+/* tasks on devices that share a physical root, parent or proxy are put in
+ * the same group, keeping the order they were sorted into */
+static GPtrArray *
+fu_engine_install_tasks_group (GPtrArray *install_tasks)
+{
+	GPtrArray *groups = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_engine_install_group_free);
+	g_autofree guint *parents = g_new0 (guint, install_tasks->len);
+	g_autofree FuEngineInstallGroup **group_for_task = g_new0 (FuEngineInstallGroup *, install_tasks->len);
+
+	/* union-find, always keeping the earliest task as the representative */
+	for (guint i = 0; i < install_tasks->len; i++) {
+		FuInstallTask *task1 = g_ptr_array_index (install_tasks, i);
+		parents[i] = i;
+		for (guint j = 0; j < i; j++) {
+			FuInstallTask *task2 = g_ptr_array_index (install_tasks, j);
+			guint root_i = i;
+			guint root_j = j;
+			if (!fu_install_task_is_related (task1, task2))
+				continue;
+			while (parents[root_i] != root_i)
+				root_i = parents[root_i];
+			while (parents[root_j] != root_j)
+				root_j = parents[root_j];
+			parents[MAX (root_i, root_j)] = MIN (root_i, root_j);
+		}
+	}
+	for (guint i = 0; i < install_tasks->len; i++) {
+		FuInstallTask *task = g_ptr_array_index (install_tasks, i);
+		guint root = i;
+		while (parents[root] != root)
+			root = parents[root];
+		if (group_for_task[root] == NULL) {
+			group_for_task[root] = g_new0 (FuEngineInstallGroup, 1);
+			group_for_task[root]->tasks = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+			g_ptr_array_add (groups, group_for_task[root]);
+		}
+		g_ptr_array_add (group_for_task[root]->tasks, g_object_ref (task));
+	}
+	return groups;
+}
+
+static gboolean
+fu_engine_install_tasks_concurrent (FuEngine *self,
+				    GPtrArray *groups,
+				    GBytes *blob_cab,
+				    FwupdInstallFlags flags,
+				    GError **error)
+{
+	GMainContext *context = g_main_context_default ();
+	GPollFunc poll_func_old;
+	GThreadPool *pool;
+	g_autoptr(GMainLoop) loop = g_main_loop_new (context, FALSE);
+	g_autoptr(GTimer) timer = g_timer_new ();
+	FuEngineInstallHelper helper = {
+		.self = self,
+		.blob_cab = blob_cab,
+		.flags = flags,
+		.loop = loop,
+		.todo = groups->len,
+	};
+
+	/* exclusive, so that every thread is created before starting */
+	pool = g_thread_pool_new (fu_engine_install_group_worker_cb,
+				  &helper,
+				  (gint) groups->len,
+				  TRUE, error);
+	if (pool == NULL)
+		return FALSE;
+
+	/* every device starts at zero */
+	self->install_progress = g_hash_table_new_full (g_str_hash, g_str_equal,
+							g_free, NULL);
+	for (guint i = 0; i < groups->len; i++) {
+		FuEngineInstallGroup *group = g_ptr_array_index (groups, i);
+		for (guint j = 0; j < group->tasks->len; j++) {
+			FuInstallTask *task = g_ptr_array_index (group->tasks, j);
+			FuDevice *device = fu_install_task_get_device (task);
+			g_hash_table_insert (self->install_progress,
+					     g_strdup (fu_device_get_id (device)),
+					     GUINT_TO_POINTER (0));
+		}
+	}
+
+	/* the workers only run while this thread is waiting for events */
+	g_private_set (&fu_engine_install_mutex_private, &self->install_mutex);
+	g_mutex_lock (&self->install_mutex);
+	poll_func_old = g_main_context_get_poll_func (context);
+	g_main_context_set_poll_func (context, fu_engine_install_poll_cb);
+	for (guint i = 0; i < groups->len; i++)
+		g_thread_pool_push (pool, g_ptr_array_index (groups, i), NULL);
+	g_main_loop_run (loop);
+	g_main_context_set_poll_func (context, poll_func_old);
+	g_mutex_unlock (&self->install_mutex);
+	g_private_set (&fu_engine_install_mutex_private, NULL);
+	g_thread_pool_free (pool, FALSE, TRUE);
+	g_clear_pointer (&self->install_progress, g_hash_table_unref);
+	g_debug ("concurrent install of %u groups took %.0fms",
+		 groups->len, g_timer_elapsed (timer, NULL) * 1000.f);
+
+	/* report the first failure, in the order the tasks were sorted */
+	for (guint i = 0; i < groups->len; i++) {
+		FuEngineInstallGroup *group = g_ptr_array_index (groups, i);
+		if (group->error != NULL) {
+			g_propagate_error (error, g_steal_pointer (&group->error));
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+static gboolean
+fu_engine_install_tasks_serial (FuEngine *self,
+				GPtrArray *install_tasks,
+				GBytes *blob_cab,
+				FwupdInstallFlags flags,
+				GError **error)
+{
+	for (guint i = 0; i < install_tasks->len; i++) {
+		FuInstallTask *task = g_ptr_array_index (install_tasks, i);
+		if (!fu_engine_install (self, task, blob_cab, flags, error))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * fu_engine_cancel_install:
+ * @self: A #FuEngine
+ *
+ * Requests that the install in progress is stopped. Only devices that write
+ * firmware in a worker thread can be cancelled, and only at points where the
+ * plugin knows the hardware is safe to leave.
+ **/
+void
+fu_engine_cancel_install (FuEngine *self)
+{
+	g_return_if_fail (FU_IS_ENGINE (self));
+	g_cancellable_cancel (self->install_cancellable);
+}
+
 /**
  * fu_engine_install_tasks:
  * @self: A #FuEngine
@@ -1740,6 +2167,9 @@ fu_engine_composite_cleanup (FuEngine *self, GPtrArray *devices, GError **error)
  * fu_engine_check_requirements() so this should not fail before running
  * the plugin loader.
  *
+ * If ConcurrentInstalls is enabled then tasks on devices that do not share a
+ * physical root, parent or proxy are installed at the same time.
+ *
  * Returns: %TRUE for success
  **/
 gboolean
@@ -1750,14 +2180,19 @@ fu_engine_install_tasks (FuEngine *self,
 			 FwupdInstallFlags flags,
 			 GError **error)
 {
+	gboolean ret;
 	g_autoptr(FuIdleLocker) locker = NULL;
 	g_autoptr(GPtrArray) devices = NULL;
 	g_autoptr(GPtrArray) devices_new = NULL;
+	g_autoptr(GPtrArray) groups = NULL;
 
 	/* do not allow auto-shutdown during this time */
 	locker = fu_idle_locker_new (self->idle, "performing update");
 	g_assert (locker != NULL);
 
+	/* only a request made during this install can cancel it */
+	g_cancellable_reset (self->install_cancellable);
+
 	/* notify the plugins about the composite action */
 	devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 	for (guint i = 0; i < install_tasks->len; i++) {
@@ -1772,16 +2207,22 @@ fu_engine_install_tasks (FuEngine *self,
 	}
 
 	/* all authenticated, so install all the things */
-	for (guint i = 0; i < install_tasks->len; i++) {
-		FuInstallTask *task = g_ptr_array_index (install_tasks, i);
-		if (!fu_engine_install (self, task, blob_cab, flags, error)) {
-			g_autoptr(GError) error_local = NULL;
-			if (!fu_engine_composite_cleanup (self, devices, &error_local)) {
-				g_warning ("failed to cleanup failed composite action: %s",
-					   error_local->message);
-			}
-			return FALSE;
+	if (fu_config_get_concurrent_installs (self->config))
+		groups = fu_engine_install_tasks_group (install_tasks);
+	if (groups != NULL && groups->len > 1) {
+		ret = fu_engine_install_tasks_concurrent (self, groups, blob_cab,
+							  flags, error);
+	} else {
+		ret = fu_engine_install_tasks_serial (self, install_tasks,
+						      blob_cab, flags, error);
+	}
+	if (!ret) {
+		g_autoptr(GError) error_local = NULL;
+		if (!fu_engine_composite_cleanup (self, devices, &error_local)) {
+			g_warning ("failed to cleanup failed composite action: %s",
+				   error_local->message);
 		}
+		return FALSE;
 	}
 
 	/* set all the device statuses back to unknown */
@@ -2898,7 +3339,10 @@ fu_engine_set_silo (FuEngine *self, XbSilo *silo)
 {
 	g_return_if_fail (FU_IS_ENGINE (self));
 	g_return_if_fail (XB_IS_SILO (silo));
-	g_set_object (&self->silo, silo);
+	g_hash_table_remove_all (self->silo_remotes);
+	g_ptr_array_set_size (self->silos, 0);
+	g_ptr_array_add (self->silos, g_object_ref (silo));
+	fu_engine_index_component_guids (self);
 }
 
 static gboolean
@@ -2941,19 +3385,10 @@ fu_engine_create_metadata_builder_source (FuEngine *self,
 	return g_steal_pointer (&source);
 }
 
-static gboolean
+static void
 fu_engine_create_metadata (FuEngine *self, XbBuilder *builder,
-			   FwupdRemote *remote, GError **error)
+			   FwupdRemote *remote, GPtrArray *files)
 {
-	g_autoptr(GPtrArray) files = NULL;
-	const gchar *path;
-
-	/* find all files in directory */
-	path = fwupd_remote_get_filename_cache (remote);
-	files = fu_common_get_files_recursive (path, error);
-	if (files == NULL)
-		return FALSE;
-
 	/* add each source */
 	for (guint i = 0; i < files->len; i++) {
 		g_autoptr(XbBuilderNode) custom = NULL;
@@ -2988,7 +3423,6 @@ fu_engine_create_metadata (FuEngine *self, XbBuilder *builder,
 		xb_builder_source_set_info (source, custom);
 		xb_builder_import_source (builder, source);
 	}
-	return TRUE;
 }
 
 static void
@@ -3183,19 +3617,82 @@ fu_engine_md_refresh_devices (FuEngine *self)
 	}
 }
 
-static gboolean
-fu_engine_load_metadata_store (FuEngine *self, FuEngineLoadFlags flags, GError **error)
+/* the CABs are only parsed again when a file is added, removed or modified */
+static gchar *
+fu_engine_get_metadata_directory_stamp (FwupdRemote *remote, GPtrArray *files)
 {
-	GPtrArray *remotes;
-	XbBuilderCompileFlags compile_flags = XB_BUILDER_COMPILE_FLAG_IGNORE_INVALID;
-	g_autofree gchar *cachedirpkg = NULL;
-	g_autofree gchar *xmlbfn = NULL;
-	g_autoptr(GFile) xmlb = NULL;
-	g_autoptr(GPtrArray) components = NULL;
+	g_autoptr(GString) str = g_string_new (fwupd_remote_get_id (remote));
+	for (guint i = 0; i < files->len; i++) {
+		const gchar *fn = g_ptr_array_index (files, i);
+		GStatBuf st;
+		if (g_stat (fn, &st) != 0)
+			continue;
+		g_string_append_printf (str, ";%s:%" G_GINT64_FORMAT ":%" G_GINT64_FORMAT,
+					fn, (gint64) st.st_size, (gint64) st.st_mtime);
+	}
+	return g_compute_checksum_for_string (G_CHECKSUM_SHA1, str->str, str->len);
+}
+
+static XbSilo *
+fu_engine_load_metadata_directory (FuEngine *self,
+				   FwupdRemote *remote,
+				   GFile *xmlb,
+				   XbBuilderCompileFlags compile_flags,
+				   GError **error)
+{
+	g_autofree gchar *stamp = NULL;
+	g_autofree gchar *xmlbfn = g_file_get_path (xmlb);
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GPtrArray) files = NULL;
 	g_autoptr(XbBuilder) builder = xb_builder_new ();
+	g_autoptr(XbBuilderNode) bn = NULL;
+	g_autoptr(XbNode) n = NULL;
+	g_autoptr(XbSilo) silo = xb_silo_new ();
+
+	/* find all files in directory */
+	files = fu_common_get_files_recursive (fwupd_remote_get_filename_cache (remote),
+					       error);
+	if (files == NULL)
+		return NULL;
+
+	/* nothing changed since the silo was saved */
+	stamp = fu_engine_get_metadata_directory_stamp (remote, files);
+	if (xb_silo_load_from_file (silo, xmlb, XB_SILO_LOAD_FLAG_NONE, NULL, NULL)) {
+		n = xb_silo_query_first (silo, "stamp", NULL);
+		if (n != NULL && g_strcmp0 (xb_node_get_text (n), stamp) == 0)
+			return g_steal_pointer (&silo);
+	}
+
+	/* generate all metadata on demand */
+	g_debug ("building metadata for remote '%s'",
+		 fwupd_remote_get_id (remote));
+	fu_engine_create_metadata (self, builder, remote, files);
+	bn = xb_builder_node_new ("stamp");
+	xb_builder_node_set_text (bn, stamp, -1);
+	xb_builder_import_node (builder, bn);
+	g_clear_object (&silo);
+	silo = xb_builder_compile (builder, compile_flags, NULL, error);
+	if (silo == NULL)
+		return NULL;
+	if (!fu_common_mkdir_parent (xmlbfn, &error_local) ||
+	    !xb_silo_save_to_file (silo, xmlb, NULL, &error_local))
+		g_debug ("failed to save silo: %s", error_local->message);
+	return g_steal_pointer (&silo);
+}
 
-	/* clear existing silo */
-	g_clear_object (&self->silo);
+static XbSilo *
+fu_engine_load_metadata_file (FuEngine *self,
+			      FwupdRemote *remote,
+			      GFile *xmlb,
+			      XbBuilderCompileFlags compile_flags,
+			      GError **error)
+{
+	const gchar *path = fwupd_remote_get_filename_cache (remote);
+	g_autoptr(GFile) file = g_file_new_for_path (path);
+	g_autoptr(XbBuilder) builder = xb_builder_new ();
+	g_autoptr(XbBuilderFixup) fixup = NULL;
+	g_autoptr(XbBuilderNode) custom = NULL;
+	g_autoptr(XbBuilderSource) source = xb_builder_source_new ();
 
 	/* verbose profiling */
 	if (g_getenv ("FWUPD_VERBOSE") != NULL) {
@@ -3203,101 +3700,152 @@ fu_engine_load_metadata_store (FuEngine *self, FuEngineLoadFlags flags, GError *
 					      XB_SILO_PROFILE_FLAG_XPATH |
 					      XB_SILO_PROFILE_FLAG_DEBUG);
 	}
+	if (!xb_builder_source_load_file (source, file,
+					  XB_BUILDER_SOURCE_FLAG_NONE,
+					  NULL, error))
+		return NULL;
 
-	/* load each enabled metadata file */
-	remotes = fu_remote_list_get_all (self->remote_list);
-	for (guint i = 0; i < remotes->len; i++) {
-		const gchar *path = NULL;
-		g_autoptr(GError) error_local = NULL;
-		g_autoptr(GFile) file = NULL;
-		g_autoptr(XbBuilderFixup) fixup = NULL;
-		g_autoptr(XbBuilderNode) custom = NULL;
-		g_autoptr(XbBuilderSource) source = xb_builder_source_new ();
-
-		FwupdRemote *remote = g_ptr_array_index (remotes, i);
-		if (!fwupd_remote_get_enabled (remote)) {
-			g_debug ("remote %s not enabled, so skipping",
-				 fwupd_remote_get_id (remote));
-			continue;
-		}
-		path = fwupd_remote_get_filename_cache (remote);
-		if (!g_file_test (path, G_FILE_TEST_EXISTS)) {
-			g_debug ("no %s, so skipping", path);
-			continue;
-		}
+	/* fix up any legacy installed files */
+	fixup = xb_builder_fixup_new ("AppStreamUpgrade",
+				      fu_engine_appstream_upgrade_cb,
+				      self, NULL);
+	xb_builder_fixup_set_max_depth (fixup, 3);
+	xb_builder_source_add_fixup (source, fixup);
+
+	/* save the remote-id in the custom metadata space */
+	custom = xb_builder_node_new ("custom");
+	xb_builder_node_insert_text (custom,
+				     "value", path,
+				     "key", "fwupd::FilenameCache",
+				     NULL);
+	xb_builder_node_insert_text (custom,
+				     "value", fwupd_remote_get_id (remote),
+				     "key", "fwupd::RemoteId",
+				     NULL);
+	xb_builder_source_set_info (source, custom);
+	xb_builder_import_source (builder, source);
 
-		/* generate all metadata on demand */
-		if (fwupd_remote_get_kind (remote) == FWUPD_REMOTE_KIND_DIRECTORY) {
-			g_debug ("building metadata for remote '%s'",
-				 fwupd_remote_get_id (remote));
-			if (!fu_engine_create_metadata (self, builder, remote, &error_local)) {
-				g_warning ("failed to generate remote %s: %s",
-					   fwupd_remote_get_id (remote),
-					   error_local->message);
-			}
-			continue;
-		}
+	/* only recompiled if the remote metadata has changed */
+	return xb_builder_ensure (builder, xmlb, compile_flags, NULL, error);
+}
 
-		/* save the remote-id in the custom metadata space */
-		file = g_file_new_for_path (path);
-		if (!xb_builder_source_load_file (source, file,
-						  XB_BUILDER_SOURCE_FLAG_NONE,
-						  NULL, &error_local)) {
-			g_warning ("failed to load remote %s: %s",
-				   fwupd_remote_get_id (remote),
-				   error_local->message);
-			continue;
-		}
+/* loads or rebuilds the compiled silo for just one remote */
+static gboolean
+fu_engine_load_metadata_remote (FuEngine *self,
+				FwupdRemote *remote,
+				XbBuilderCompileFlags compile_flags,
+				GError **error)
+{
+	const gchar *path = fwupd_remote_get_filename_cache (remote);
+	const gchar *remote_id = fwupd_remote_get_id (remote);
+	g_autofree gchar *basename = NULL;
+	g_autofree gchar *cachedirpkg = NULL;
+	g_autofree gchar *xmlbfn = NULL;
+	g_autoptr(GFile) xmlb = NULL;
+	g_autoptr(XbSilo) silo = NULL;
 
-		/* fix up any legacy installed files */
-		fixup = xb_builder_fixup_new ("AppStreamUpgrade",
-					      fu_engine_appstream_upgrade_cb,
-					      self, NULL);
-		xb_builder_fixup_set_max_depth (fixup, 3);
-		xb_builder_source_add_fixup (source, fixup);
+	/* not used */
+	g_hash_table_remove (self->silo_remotes, remote_id);
+	if (!fwupd_remote_get_enabled (remote)) {
+		g_debug ("remote %s not enabled, so skipping", remote_id);
+		return TRUE;
+	}
+	if (!g_file_test (path, G_FILE_TEST_EXISTS)) {
+		g_debug ("no %s, so skipping", path);
+		return TRUE;
+	}
 
-		/* add metadata */
-		custom = xb_builder_node_new ("custom");
-		xb_builder_node_insert_text (custom,
-					     "value", path,
-					     "key", "fwupd::FilenameCache",
-					     NULL);
-		xb_builder_node_insert_text (custom,
-					     "value", fwupd_remote_get_id (remote),
-					     "key", "fwupd::RemoteId",
-					     NULL);
-		xb_builder_source_set_info (source, custom);
-
-		/* we need to watch for changes? */
-		xb_builder_import_source (builder, source);
-	}
-
-	/* on a read-only filesystem don't care about the cache GUID */
-	if (flags & FU_ENGINE_LOAD_FLAG_READONLY_FS)
-		compile_flags |= XB_BUILDER_COMPILE_FLAG_IGNORE_GUID;
-
-	/* ensure silo is up to date */
+	/* each remote has its own cache */
 	cachedirpkg = fu_common_get_path (FU_PATH_KIND_CACHEDIR_PKG);
-	xmlbfn = g_build_filename (cachedirpkg, "metadata.xmlb", NULL);
+	basename = g_strdup_printf ("%s.xmlb", remote_id);
+	xmlbfn = g_build_filename (cachedirpkg, "metadata", basename, NULL);
 	xmlb = g_file_new_for_path (xmlbfn);
-	self->silo = xb_builder_ensure (builder, xmlb, compile_flags, NULL, error);
-	if (self->silo == NULL)
+	if (fwupd_remote_get_kind (remote) == FWUPD_REMOTE_KIND_DIRECTORY) {
+		silo = fu_engine_load_metadata_directory (self, remote, xmlb,
+							  compile_flags, error);
+	} else {
+		silo = fu_engine_load_metadata_file (self, remote, xmlb,
+						     compile_flags, error);
+	}
+	if (silo == NULL)
 		return FALSE;
 
-	/* print what we've got */
-	components = xb_silo_query (self->silo, "components/component", 0, NULL);
-	if (components != NULL)
-		g_debug ("%u components now in silo", components->len);
-
 	/* build the index */
-	if (!xb_silo_query_build_index (self->silo,
+	if (!xb_silo_query_build_index (silo,
 					"components/component/provides/firmware",
 					"type", error))
 		return FALSE;
-	if (!xb_silo_query_build_index (self->silo,
+	if (!xb_silo_query_build_index (silo,
 					"components/component/provides/firmware",
 					NULL, error))
 		return FALSE;
+	g_hash_table_insert (self->silo_remotes,
+			     g_strdup (remote_id),
+			     g_steal_pointer (&silo));
+	return TRUE;
+}
+
+/* sets the query order to be the same as the remote priority */
+static void
+fu_engine_rebuild_silos (FuEngine *self)
+{
+	GPtrArray *remotes = fu_remote_list_get_all (self->remote_list);
+
+	g_ptr_array_set_size (self->silos, 0);
+	for (guint i = 0; i < remotes->len; i++) {
+		FwupdRemote *remote = g_ptr_array_index (remotes, i);
+		XbSilo *silo = g_hash_table_lookup (self->silo_remotes,
+						    fwupd_remote_get_id (remote));
+		if (silo != NULL)
+			g_ptr_array_add (self->silos, g_object_ref (silo));
+	}
+
+	fu_engine_index_component_guids (self);
+}
+
+/* the metadata of all the remotes used to be compiled into one silo */
+static void
+fu_engine_remove_legacy_silo (FuEngine *self)
+{
+	g_autofree gchar *cachedirpkg = fu_common_get_path (FU_PATH_KIND_CACHEDIR_PKG);
+	g_autofree gchar *xmlbfn = g_build_filename (cachedirpkg, "metadata.xmlb", NULL);
+
+	if (!g_file_test (xmlbfn, G_FILE_TEST_EXISTS))
+		return;
+	g_debug ("removing legacy %s", xmlbfn);
+	if (g_unlink (xmlbfn) != 0)
+		g_warning ("failed to delete %s", xmlbfn);
+}
+
+static gboolean
+fu_engine_load_metadata_store (FuEngine *self, FuEngineLoadFlags flags, GError **error)
+{
+	GPtrArray *remotes;
+	XbBuilderCompileFlags compile_flags = XB_BUILDER_COMPILE_FLAG_IGNORE_INVALID;
+
+	/* on a read-only filesystem don't care about the cache GUID */
+	if (flags & FU_ENGINE_LOAD_FLAG_READONLY_FS)
+		compile_flags |= XB_BUILDER_COMPILE_FLAG_IGNORE_GUID;
+	else
+		fu_engine_remove_legacy_silo (self);
+
+	/* clear existing silos */
+	g_hash_table_remove_all (self->silo_remotes);
+
+	/* load each enabled metadata file */
+	remotes = fu_remote_list_get_all (self->remote_list);
+	for (guint i = 0; i < remotes->len; i++) {
+		FwupdRemote *remote = g_ptr_array_index (remotes, i);
+		g_autoptr(GError) error_local = NULL;
+		if (!fu_engine_load_metadata_remote (self, remote,
+						     compile_flags,
+						     &error_local)) {
+			g_warning ("failed to load remote %s: %s",
+				   fwupd_remote_get_id (remote),
+				   error_local->message);
+		}
+	}
+	fu_engine_rebuild_silos (self);
 
 	/* success */
 	return TRUE;
@@ -3550,8 +4098,13 @@ fu_engine_update_metadata_bytes (FuEngine *self, const gchar *remote_id,
 						   bytes_sig, error))
 			return FALSE;
 	}
-	if (!fu_engine_load_metadata_store (self, FU_ENGINE_LOAD_FLAG_NONE, error))
+
+	/* only the remote that changed needs to be recompiled */
+	if (!fu_engine_load_metadata_remote (self, remote,
+					     XB_BUILDER_COMPILE_FLAG_IGNORE_INVALID,
+					     error))
 		return FALSE;
+	fu_engine_rebuild_silos (self);
 
 	/* refresh SUPPORTED flag on devices */
 	fu_engine_md_refresh_devices (self);
@@ -3621,37 +4174,163 @@ fu_engine_update_metadata (FuEngine *self, const gchar *remote_id,
 #endif
 }
 
+/* the fd comes from an untrusted client which could truncate a file mapped
+ * by the daemon, so copy it with a bounded read to a private file in the
+ * cache directory, which also keeps large archives out of the heap */
+static gchar *
+fu_engine_copy_fd_private (FuEngine *self, gint fd, GError **error)
+{
+#ifdef HAVE_GIO_UNIX
+	gint fd_tmp;
+	guint64 size_max = fu_engine_get_archive_size_max (self);
+	guint64 size_total = 0;
+	g_autofree gchar *cachedir = fu_common_get_path (FU_PATH_KIND_CACHEDIR_PKG);
+	g_autofree gchar *fn = NULL;
+	g_autofree guint8 *buf = g_malloc (0x8000);
+	g_autoptr(GInputStream) istream = g_unix_input_stream_new (fd, TRUE);
+	g_autoptr(GOutputStream) ostream = NULL;
+
+	if (g_mkdir_with_parents (cachedir, 0700) != 0) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INTERNAL,
+			     "failed to create %s",
+			     cachedir);
+		return NULL;
+	}
+	fn = g_build_filename (cachedir, "archive-XXXXXX", NULL);
+	fd_tmp = g_mkstemp (fn);
+	if (fd_tmp < 0) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INTERNAL,
+			     "failed to create %s",
+			     fn);
+		return NULL;
+	}
+	ostream = g_unix_output_stream_new (fd_tmp, TRUE);
+	for (;;) {
+		g_autoptr(GError) error_local = NULL;
+		gssize sz = g_input_stream_read (istream, buf, 0x8000, NULL, &error_local);
+		if (sz < 0) {
+			g_set_error_literal (error,
+					     FWUPD_ERROR,
+					     FWUPD_ERROR_INVALID_FILE,
+					     error_local->message);
+			break;
+		}
+		if (sz == 0) {
+			if (!g_output_stream_close (ostream, NULL, error))
+				break;
+			return g_steal_pointer (&fn);
+		}
+		size_total += sz;
+		if (size_total > size_max) {
+			g_autofree gchar *sz_max = g_format_size (size_max);
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "archive too large (limit %s)",
+				     sz_max);
+			break;
+		}
+		if (!g_output_stream_write_all (ostream, buf, sz, NULL, NULL, error))
+			break;
+	}
+
+	/* failed */
+	if (g_unlink (fn) != 0)
+		g_debug ("failed to remove %s", fn);
+	return NULL;
+#else
+	g_set_error_literal (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_SUPPORTED,
+			     "Not supported as <glib-unix.h> is unavailable");
+	return NULL;
+#endif
+}
+
 /**
- * fu_engine_get_silo_from_blob:
+ * fu_engine_get_blob_from_fd:
  * @self: A #FuEngine
- * @blob_cab: A #GBytes
+ * @fd: A file descriptor
  * @error: A #GError, or %NULL
  *
- * Creates a silo from a .cab file blob.
+ * Copies the archive from a file descriptor passed by a client into a private
+ * file in the cache directory, limited to the maximum archive size, and maps
+ * the copy.
  *
- * Returns: (transfer container): a #XbSilo, or %NULL
+ * Note: this will close the fd when done
+ *
+ * Returns: (transfer full): a #GBytes, or %NULL
  **/
-XbSilo *
-fu_engine_get_silo_from_blob (FuEngine *self, GBytes *blob_cab, GError **error)
+GBytes *
+fu_engine_get_blob_from_fd (FuEngine *self, gint fd, GError **error)
 {
-	g_autoptr(FuCabinet) cabinet = fu_cabinet_new ();
-	g_autoptr(XbSilo) silo = NULL;
+	g_autofree gchar *fn = NULL;
+	g_autoptr(GMappedFile) mapped_file = NULL;
 
 	g_return_val_if_fail (FU_IS_ENGINE (self), NULL);
-	g_return_val_if_fail (blob_cab != NULL, NULL);
+	g_return_val_if_fail (fd > 0, NULL);
 	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
-	/* load file */
+	fn = fu_engine_copy_fd_private (self, fd, error);
+	if (fn == NULL)
+		return NULL;
+
+	/* the mapping stays valid after the file is unlinked */
+	mapped_file = g_mapped_file_new (fn, FALSE, error);
+	if (g_unlink (fn) != 0)
+		g_debug ("failed to remove %s", fn);
+	if (mapped_file == NULL)
+		return NULL;
+	return g_mapped_file_get_bytes (mapped_file);
+}
+
+/* only the metadata is decompressed into memory */
+static XbSilo *
+fu_engine_get_silo_from_stream (FuEngine *self, GInputStream *stream, GError **error)
+{
+	g_autoptr(FuCabinet) cabinet = fu_cabinet_new ();
+	g_autoptr(XbSilo) silo = NULL;
+
 	fu_engine_set_status (self, FWUPD_STATUS_DECOMPRESSING);
 	fu_cabinet_set_size_max (cabinet, fu_engine_get_archive_size_max (self));
 	fu_cabinet_set_jcat_context (cabinet, self->jcat_context);
-	if (!fu_cabinet_parse (cabinet, blob_cab, FU_CABINET_PARSE_FLAG_NONE, error))
+	if (!fu_cabinet_parse_stream (cabinet, stream, FU_CABINET_PARSE_FLAG_NONE, error)) {
+		fu_engine_set_status (self, FWUPD_STATUS_IDLE);
 		return NULL;
+	}
 	silo = fu_cabinet_get_silo (cabinet);
 	fu_engine_set_status (self, FWUPD_STATUS_IDLE);
 	return g_steal_pointer (&silo);
 }
 
+/**
+ * fu_engine_get_silo_from_blob:
+ * @self: A #FuEngine
+ * @blob_cab: A #GBytes
+ * @error: A #GError, or %NULL
+ *
+ * Creates a silo from a .cab file blob.
+ *
+ * Returns: (transfer container): a #XbSilo, or %NULL
+ **/
+XbSilo *
+fu_engine_get_silo_from_blob (FuEngine *self, GBytes *blob_cab, GError **error)
+{
+	g_autoptr(GInputStream) stream = NULL;
+
+	g_return_val_if_fail (FU_IS_ENGINE (self), NULL);
+	g_return_val_if_fail (blob_cab != NULL, NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	/* the stream does not copy the blob */
+	stream = g_memory_input_stream_new_from_bytes (blob_cab);
+	return fu_engine_get_silo_from_stream (self, stream, error);
+}
+
 static FuDevice *
 fu_engine_get_result_from_component (FuEngine *self,
 				     FuEngineRequest *request,
@@ -3803,25 +4482,31 @@ fu_engine_get_details_sort_cb (gconstpointer a, gconstpointer b)
 GPtrArray *
 fu_engine_get_details (FuEngine *self, FuEngineRequest *request, gint fd, GError **error)
 {
-	const gchar *remote_id;
-	g_autofree gchar *csum = NULL;
-	g_autoptr(GBytes) blob = NULL;
+	const gchar *remote_id = NULL;
+	g_autofree gchar *fn = NULL;
 	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GFile) file = NULL;
+	g_autoptr(GInputStream) stream = NULL;
 	g_autoptr(GPtrArray) components = NULL;
 	g_autoptr(GPtrArray) details = NULL;
+	g_autoptr(XbNode) csum = NULL;
 	g_autoptr(XbSilo) silo = NULL;
 
 	g_return_val_if_fail (FU_IS_ENGINE (self), NULL);
 	g_return_val_if_fail (fd > 0, NULL);
 	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
-	/* get all components */
-	blob = fu_common_get_contents_fd (fd,
-					  fu_engine_get_archive_size_max (self),
-					  error);
-	if (blob == NULL)
+	/* parse a private copy of the file, which is removed when closed */
+	fn = fu_engine_copy_fd_private (self, fd, error);
+	if (fn == NULL)
 		return NULL;
-	silo = fu_engine_get_silo_from_blob (self, blob, error);
+	file = g_file_new_for_path (fn);
+	stream = G_INPUT_STREAM (g_file_read (file, NULL, error));
+	if (g_unlink (fn) != 0)
+		g_debug ("failed to remove %s", fn);
+	if (stream == NULL)
+		return NULL;
+	silo = fu_engine_get_silo_from_stream (self, stream, error);
 	if (silo == NULL)
 		return NULL;
 	components = xb_silo_query (silo, "components/component", 0, &error_local);
@@ -3842,9 +4527,16 @@ fu_engine_get_details (FuEngine *self, FuEngineRequest *request, gint fd, GError
 					NULL, error))
 		return NULL;
 
-	/* does this exist in any enabled remote */
-	csum = g_compute_checksum_for_bytes (G_CHECKSUM_SHA1, blob);
-	remote_id = fu_engine_get_remote_id_for_checksum (self, csum);
+	/* does this exist in any enabled remote, using the container
+	 * checksum FuCabinet calculated when reading the stream */
+	csum = xb_silo_query_first (silo,
+				    "components/component/releases/release/"
+				    "checksum[@target='container']",
+				    NULL);
+	if (csum != NULL) {
+		remote_id = fu_engine_get_remote_id_for_checksum (self,
+								  xb_node_get_text (csum));
+	}
 
 	/* create results with all the metadata in */
 	details = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
@@ -3957,6 +4649,8 @@ fu_engine_get_device (FuEngine *self, const gchar *device_id, GError **error)
 {
 	FuDevice *device;
 
+	/* the cached devices cannot be used for anything other than display */
+	fu_engine_revalidate (self);
 	device = fu_device_list_get_by_id (self->device_list, device_id, error);
 	if (device == NULL)
 		return NULL;
@@ -4022,34 +4716,10 @@ fu_engine_get_history_set_hsi_attrs (FuEngine *self, FuDevice *device)
 	fu_device_set_metadata (device, "HSI", self->host_security_id);
 }
 
-/**
- * fu_engine_get_history:
- * @self: A #FuEngine
- * @error: A #GError, or %NULL
- *
- * Gets the list of history.
- *
- * Returns: (transfer container) (element-type FwupdDevice): results
- **/
-GPtrArray *
-fu_engine_get_history (FuEngine *self, GError **error)
+/* adds the HSI attrs and the remote ID to each history device */
+static void
+fu_engine_get_history_fixup (FuEngine *self, GPtrArray *devices)
 {
-	g_autoptr(GPtrArray) devices = NULL;
-
-	g_return_val_if_fail (FU_IS_ENGINE (self), NULL);
-	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
-
-	devices = fu_history_get_devices (self->history, error);
-	if (devices == NULL)
-		return NULL;
-	if (devices->len == 0) {
-		g_set_error_literal (error,
-				     FWUPD_ERROR,
-				     FWUPD_ERROR_NOTHING_TO_DO,
-				     "No history");
-		return NULL;
-	}
-
 	/* if this is the system firmware device, add the HSI attrs */
 	for (guint i = 0; i < devices->len; i++) {
 		FuDevice *dev = g_ptr_array_index (devices, i);
@@ -4080,7 +4750,90 @@ fu_engine_get_history (FuEngine *self, GError **error)
 			}
 		}
 	}
+}
+
+/**
+ * fu_engine_get_history:
+ * @self: A #FuEngine
+ * @error: A #GError, or %NULL
+ *
+ * Gets the list of history.
+ *
+ * Returns: (transfer container) (element-type FwupdDevice): results
+ **/
+GPtrArray *
+fu_engine_get_history (FuEngine *self, GError **error)
+{
+	g_autoptr(GPtrArray) devices = NULL;
+
+	g_return_val_if_fail (FU_IS_ENGINE (self), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	devices = fu_history_get_devices (self->history, error);
+	if (devices == NULL)
+		return NULL;
+	if (devices->len == 0) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_NOTHING_TO_DO,
+				     "No history");
+		return NULL;
+	}
+	fu_engine_get_history_fixup (self, devices);
+	return g_steal_pointer (&devices);
+}
+
+/**
+ * fu_engine_get_history_filtered:
+ * @self: A #FuEngine
+ * @device_id: (nullable): A device ID, or %NULL for any
+ * @plugin: (nullable): A plugin name, or %NULL for any
+ * @since: The earliest modification time in seconds since the epoch, or 0
+ * @until: The latest modification time in seconds since the epoch, or 0
+ * @update_state: A #FwupdUpdateState, or %FWUPD_UPDATE_STATE_UNKNOWN for any
+ * @limit: The maximum number of devices to return, or 0 for no limit
+ * @offset: The number of matching devices to skip
+ * @error: A #GError, or %NULL
+ *
+ * Gets one page of the history that matches all of the filters.
+ *
+ * Returns: (transfer container) (element-type FwupdDevice): results
+ **/
+GPtrArray *
+fu_engine_get_history_filtered (FuEngine *self,
+				const gchar *device_id,
+				const gchar *plugin,
+				guint64 since,
+				guint64 until,
+				FwupdUpdateState update_state,
+				guint limit,
+				guint offset,
+				GError **error)
+{
+	g_autoptr(GPtrArray) devices = NULL;
 
+	g_return_val_if_fail (FU_IS_ENGINE (self), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	devices = fu_history_get_devices_filtered (self->history,
+						   device_id,
+						   plugin,
+						   since,
+						   until,
+						   update_state,
+						   limit,
+						   offset,
+						   error);
+	if (devices == NULL)
+		return NULL;
+	if (devices->len == 0) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_NOTHING_TO_DO,
+				     "No history");
+		return NULL;
+	}
+	fu_engine_get_history_fixup (self, devices);
 	return g_steal_pointer (&devices);
 }
 
@@ -4286,13 +5039,10 @@ fu_engine_get_releases_for_device (FuEngine *self,
 				   FuDevice *device,
 				   GError **error)
 {
-	GPtrArray *device_guids;
 	GPtrArray *releases;
 	const gchar *version;
 	g_autoptr(GError) error_all = NULL;
-	g_autoptr(GError) error_local = NULL;
 	g_autoptr(GPtrArray) components = NULL;
-	g_autoptr(GString) xpath = g_string_new (NULL);
 
 	/* get device version */
 	version = fu_device_get_version (device);
@@ -4314,25 +5064,12 @@ fu_engine_get_releases_for_device (FuEngine *self,
 	}
 
 	/* get all the components that provide any of these GUIDs */
-	device_guids = fu_device_get_guids (device);
-	for (guint i = 0; i < device_guids->len; i++) {
-		const gchar *guid = g_ptr_array_index (device_guids, i);
-		xb_string_append_union (xpath,
-					"components/component/"
-					"provides/firmware[@type=$'flashed'][text()=$'%s']/"
-					"../..", guid);
-	}
-	components = xb_silo_query (self->silo, xpath->str, 0, &error_local);
-	if (components == NULL) {
-		if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND) ||
-		    g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT)) {
-			g_set_error_literal (error,
-					     FWUPD_ERROR,
-					     FWUPD_ERROR_NOTHING_TO_DO,
-					     "No releases found");
-			return NULL;
-		}
-		g_propagate_error (error, g_steal_pointer (&error_local));
+	components = fu_engine_get_components_by_guids (self, device);
+	if (components->len == 0) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_NOTHING_TO_DO,
+				     "No releases found");
 		return NULL;
 	}
 
@@ -4397,8 +5134,8 @@ fu_engine_get_releases (FuEngine *self,
 	g_return_val_if_fail (device_id != NULL, NULL);
 	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
-	/* find the device */
-	device = fu_device_list_get_by_id (self->device_list, device_id, error);
+	/* find the device, which cannot be one restored from the cache */
+	device = fu_engine_get_device (self, device_id, error);
 	if (device == NULL)
 		return NULL;
 
@@ -4443,8 +5180,8 @@ fu_engine_get_downgrades (FuEngine *self,
 	g_return_val_if_fail (device_id != NULL, NULL);
 	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
-	/* find the device */
-	device = fu_device_list_get_by_id (self->device_list, device_id, error);
+	/* find the device, which cannot be one restored from the cache */
+	device = fu_engine_get_device (self, device_id, error);
 	if (device == NULL)
 		return NULL;
 
@@ -4511,6 +5248,13 @@ fu_engine_get_downgrades (FuEngine *self,
 	return g_steal_pointer (&releases);
 }
 
+FuProfile *
+fu_engine_get_profile (FuEngine *self)
+{
+	g_return_val_if_fail (FU_IS_ENGINE (self), NULL);
+	return self->profile;
+}
+
 GPtrArray *
 fu_engine_get_approved_firmware (FuEngine *self)
 {
@@ -4566,37 +5310,16 @@ fu_engine_self_sign (FuEngine *self,
 	return jcat_blob_get_data_as_string (jcat_signature);
 }
 
-/**
- * fu_engine_get_upgrades:
- * @self: A #FuEngine
- * @request: A #FuEngineRequest
- * @device_id: A device ID
- * @error: A #GError, or %NULL
- *
- * Gets the upgrades available for a specific device.
- *
- * Returns: (transfer container) (element-type FwupdDevice): results
- **/
-GPtrArray *
-fu_engine_get_upgrades (FuEngine *self,
-			FuEngineRequest *request,
-			const gchar *device_id,
-			GError **error)
+static GPtrArray *
+fu_engine_get_upgrades_for_device (FuEngine *self,
+				   FuEngineRequest *request,
+				   FuDevice *device,
+				   GError **error)
 {
-	g_autoptr(FuDevice) device = NULL;
 	g_autoptr(GPtrArray) releases = NULL;
 	g_autoptr(GPtrArray) releases_tmp = NULL;
 	g_autoptr(GString) error_str = g_string_new (NULL);
 
-	g_return_val_if_fail (FU_IS_ENGINE (self), NULL);
-	g_return_val_if_fail (device_id != NULL, NULL);
-	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
-
-	/* find the device */
-	device = fu_device_list_get_by_id (self->device_list, device_id, error);
-	if (device == NULL)
-		return NULL;
-
 	/* don't show upgrades again until we reboot */
 	if (fu_device_get_update_state (device) == FWUPD_UPDATE_STATE_NEEDS_REBOOT) {
 		g_set_error_literal (error,
@@ -4670,6 +5393,98 @@ fu_engine_get_upgrades (FuEngine *self,
 	return g_steal_pointer (&releases);
 }
 
+/**
+ * fu_engine_get_upgrades:
+ * @self: A #FuEngine
+ * @request: A #FuEngineRequest
+ * @device_id: A device ID
+ * @error: A #GError, or %NULL
+ *
+ * Gets the upgrades available for a specific device.
+ *
+ * Returns: (transfer container) (element-type FwupdDevice): results
+ **/
+GPtrArray *
+fu_engine_get_upgrades (FuEngine *self,
+			FuEngineRequest *request,
+			const gchar *device_id,
+			GError **error)
+{
+	g_autoptr(FuDevice) device = NULL;
+
+	g_return_val_if_fail (FU_IS_ENGINE (self), NULL);
+	g_return_val_if_fail (device_id != NULL, NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	/* find the device, which cannot be one restored from the cache */
+	device = fu_engine_get_device (self, device_id, error);
+	if (device == NULL)
+		return NULL;
+	return fu_engine_get_upgrades_for_device (self, request, device, error);
+}
+
+/**
+ * fu_engine_get_upgrades_all:
+ * @self: A #FuEngine
+ * @request: A #FuEngineRequest
+ * @reasons: (out) (optional) (element-type utf8 utf8): device-id:message
+ * @error: A #GError, or %NULL
+ *
+ * Gets the upgrades available for all the devices in one call.
+ *
+ * Devices without any upgrades are not included, and the reason is added to
+ * @reasons instead. A failure for one device never fails the whole call.
+ *
+ * Returns: (transfer container) (element-type utf8 GPtrArray): device-id:releases
+ **/
+GHashTable *
+fu_engine_get_upgrades_all (FuEngine *self,
+			    FuEngineRequest *request,
+			    GHashTable **reasons,
+			    GError **error)
+{
+	g_autoptr(GHashTable) reasons_tmp = NULL;
+	g_autoptr(GHashTable) upgrades = NULL;
+	g_autoptr(GPtrArray) devices = NULL;
+
+	g_return_val_if_fail (FU_IS_ENGINE (self), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	upgrades = g_hash_table_new_full (g_str_hash, g_str_equal,
+					  g_free, (GDestroyNotify) g_ptr_array_unref);
+	reasons_tmp = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+	/* the cached devices cannot be used for anything other than display */
+	fu_engine_revalidate (self);
+	devices = fu_device_list_get_active (self->device_list);
+	for (guint i = 0; i < devices->len; i++) {
+		FuDevice *device = g_ptr_array_index (devices, i);
+		g_autoptr(GError) error_local = NULL;
+		g_autoptr(GPtrArray) releases = NULL;
+
+		/* not going to have results */
+		if (!fu_device_has_flag (device, FWUPD_DEVICE_FLAG_UPDATABLE))
+			continue;
+		releases = fu_engine_get_upgrades_for_device (self, request, device,
+							      &error_local);
+		if (releases == NULL) {
+			g_debug ("no upgrades for %s: %s",
+				 fu_device_get_id (device),
+				 error_local->message);
+			g_hash_table_insert (reasons_tmp,
+					     g_strdup (fu_device_get_id (device)),
+					     g_strdup (error_local->message));
+			continue;
+		}
+		g_hash_table_insert (upgrades,
+				     g_strdup (fu_device_get_id (device)),
+				     g_steal_pointer (&releases));
+	}
+	if (reasons != NULL)
+		*reasons = g_steal_pointer (&reasons_tmp);
+	return g_steal_pointer (&upgrades);
+}
+
 /**
  * fu_engine_clear_results:
  * @self: A #FuEngine
@@ -4757,18 +5572,332 @@ fu_engine_get_results (FuEngine *self, const gchar *device_id, GError **error)
 	return g_object_ref (FWUPD_DEVICE (device));
 }
 
-static void
-fu_engine_plugins_setup (FuEngine *self)
-{
-	GPtrArray *plugins = fu_plugin_list_get_all (self->plugin_list);
-	for (guint i = 0; i < plugins->len; i++) {
-		g_autoptr(GError) error = NULL;
-		FuPlugin *plugin = g_ptr_array_index (plugins, i);
-		if (!fu_plugin_runner_startup (plugin, &error)) {
-			fu_plugin_set_enabled (plugin, FALSE);
-			g_message ("disabling plugin because: %s", error->message);
+static void
+fu_engine_plugins_setup (FuEngine *self)
+{
+	GPtrArray *plugins = fu_plugin_list_get_all (self->plugin_list);
+	for (guint i = 0; i < plugins->len; i++) {
+		g_autoptr(GError) error = NULL;
+		FuPlugin *plugin = g_ptr_array_index (plugins, i);
+		fu_profile_push (self->profile, "startup:%s", fu_plugin_get_name (plugin));
+		if (!fu_plugin_runner_startup (plugin, &error)) {
+			fu_plugin_set_enabled (plugin, FALSE);
+			g_message ("disabling plugin because: %s", error->message);
+		}
+		fu_profile_pop (self->profile);
+	}
+}
+
+typedef enum {
+	FU_ENGINE_COLDPLUG_EVENT_KIND_DEVICE_ADDED,
+	FU_ENGINE_COLDPLUG_EVENT_KIND_DEVICE_REMOVED,
+	FU_ENGINE_COLDPLUG_EVENT_KIND_DEVICE_REGISTER,
+	FU_ENGINE_COLDPLUG_EVENT_KIND_SECURITY_CHANGED,
+	FU_ENGINE_COLDPLUG_EVENT_KIND_CHECK_SUPPORTED,
+	FU_ENGINE_COLDPLUG_EVENT_KIND_SET_COLDPLUG_DELAY,
+	FU_ENGINE_COLDPLUG_EVENT_KIND_RULES_CHANGED,
+	FU_ENGINE_COLDPLUG_EVENT_KIND_DONE,
+	FU_ENGINE_COLDPLUG_EVENT_KIND_LAST
+} FuEngineColdplugEventKind;
+
+typedef struct {
+	FuEngineColdplugEventKind kind;
+	FuPlugin		*plugin;
+	FuDevice		*device;	/* (nullable) */
+	gchar			*guid;		/* (nullable) */
+	guint			 duration;	/* ms */
+	GError			*error;		/* (nullable) */
+	gdouble			 elapsed;	/* ms */
+	/* only used for events the worker waits on */
+	GMutex			 mutex;
+	GCond			 cond;
+	gboolean		 replied;
+	gboolean		 retval;
+} FuEngineColdplugEvent;
+
+typedef struct {
+	FuEngine		*self;
+	gboolean		 is_recoldplug;
+	GQueue			 serial;	/* of FuPlugin, not thread safe */
+} FuEngineColdplugHelper;
+
+static FuEngineColdplugEvent *
+fu_engine_coldplug_event_new (FuEngineColdplugEventKind kind,
+			      FuPlugin *plugin,
+			      FuDevice *device)
+{
+	FuEngineColdplugEvent *event = g_new0 (FuEngineColdplugEvent, 1);
+	event->kind = kind;
+	event->plugin = g_object_ref (plugin);
+	if (device != NULL)
+		event->device = g_object_ref (device);
+	g_mutex_init (&event->mutex);
+	g_cond_init (&event->cond);
+	return event;
+}
+
+static void
+fu_engine_coldplug_event_free (FuEngineColdplugEvent *event)
+{
+	g_object_unref (event->plugin);
+	if (event->device != NULL)
+		g_object_unref (event->device);
+	if (event->error != NULL)
+		g_error_free (event->error);
+	g_free (event->guid);
+	g_mutex_clear (&event->mutex);
+	g_cond_clear (&event->cond);
+	g_free (event);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(FuEngineColdplugEvent, fu_engine_coldplug_event_free)
+
+/* plugin signals emitted from a coldplug worker have to be handled on the
+ * thread that owns the device list, so they get queued rather than run */
+static gboolean
+fu_engine_coldplug_is_worker (FuEngine *self)
+{
+	return self->coldplug_queue != NULL &&
+		g_thread_self () != self->coldplug_thread;
+}
+
+static void
+fu_engine_coldplug_queue_push (FuEngine *self,
+			       FuEngineColdplugEventKind kind,
+			       FuPlugin *plugin,
+			       FuDevice *device)
+{
+	g_async_queue_push (self->coldplug_queue,
+			    fu_engine_coldplug_event_new (kind, plugin, device));
+}
+
+/* blocks the worker until the main thread has processed the event */
+static gboolean
+fu_engine_coldplug_queue_push_sync (FuEngine *self, FuEngineColdplugEvent *event)
+{
+	g_mutex_lock (&event->mutex);
+	g_async_queue_push (self->coldplug_queue, event);
+	while (!event->replied)
+		g_cond_wait (&event->cond, &event->mutex);
+	g_mutex_unlock (&event->mutex);
+	return event->retval;
+}
+
+static void
+fu_engine_plugins_coldplug_worker_cb (gpointer data, gpointer user_data)
+{
+	FuEngineColdplugHelper *helper = (FuEngineColdplugHelper *) user_data;
+	FuPlugin *plugin = FU_PLUGIN (data);
+	FuEngineColdplugEvent *event;
+	g_autoptr(GTimer) timer = g_timer_new ();
+
+	event = fu_engine_coldplug_event_new (FU_ENGINE_COLDPLUG_EVENT_KIND_DONE,
+					      plugin, NULL);
+	fu_profile_push (helper->self->profile, "coldplug:%s", fu_plugin_get_name (plugin));
+	if (helper->is_recoldplug)
+		fu_plugin_runner_recoldplug (plugin, &event->error);
+	else
+		fu_plugin_runner_coldplug (plugin, &event->error);
+	fu_profile_pop (helper->self->profile);
+	event->elapsed = g_timer_elapsed (timer, NULL) * 1000.f;
+	g_async_queue_push (helper->self->coldplug_queue, event);
+}
+
+static void
+fu_engine_plugins_coldplug_schedule (FuEngineColdplugHelper *helper,
+				     GThreadPool *pool,
+				     FuPlugin *plugin)
+{
+	g_autoptr(GError) error = NULL;
+
+	/* plugins have to opt-in to being run in a worker */
+	if (!fu_plugin_get_coldplug_thread_safe (plugin)) {
+		g_queue_push_tail (&helper->serial, plugin);
+		return;
+	}
+	if (!g_thread_pool_push (pool, plugin, &error)) {
+		/* this can only fail when creating a new thread, so just run it here */
+		g_warning ("failed to schedule %s: %s",
+			   fu_plugin_get_name (plugin), error->message);
+		fu_engine_plugins_coldplug_worker_cb (plugin, helper);
+	}
+}
+
+static gint
+fu_engine_plugins_coldplug_elapsed_sort_cb (gconstpointer a, gconstpointer b)
+{
+	FuEngineColdplugEvent *event1 = *((FuEngineColdplugEvent **) a);
+	FuEngineColdplugEvent *event2 = *((FuEngineColdplugEvent **) b);
+	if (event1->elapsed > event2->elapsed)
+		return -1;
+	if (event1->elapsed < event2->elapsed)
+		return 1;
+	return 0;
+}
+
+/* runs the coldplug vfunc of each thread-safe plugin in a worker thread, and
+ * all the others on this thread one at a time, starting each plugin as soon as
+ * all the plugins it has to run after have completed */
+static gboolean
+fu_engine_plugins_coldplug_concurrent (FuEngine *self, gboolean is_recoldplug, GError **error)
+{
+	GPtrArray *plugins = fu_plugin_list_get_all (self->plugin_list);
+	FuEngineColdplugHelper helper = {
+		.self = self,
+		.is_recoldplug = is_recoldplug,
+		.serial = G_QUEUE_INIT,
+	};
+	GThreadPool *pool;
+	guint todo = 0;
+	g_autoptr(GHashTable) blockers = NULL;
+	g_autoptr(GHashTable) dependents = NULL;
+	g_autoptr(GPtrArray) results = NULL;
+	g_autoptr(GString) str = g_string_new (NULL);
+	g_autoptr(GTimer) timer = g_timer_new ();
+
+	pool = g_thread_pool_new (fu_engine_plugins_coldplug_worker_cb,
+				  &helper,
+				  (gint) g_get_num_processors (),
+				  FALSE, error);
+	if (pool == NULL)
+		return FALSE;
+
+	/* build the dependency graph: FuPlugin:count and FuPlugin:GPtrArray */
+	blockers = g_hash_table_new (g_direct_hash, g_direct_equal);
+	dependents = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+					    NULL, (GDestroyNotify) g_ptr_array_unref);
+	for (guint i = 0; i < plugins->len; i++) {
+		FuPlugin *plugin = g_ptr_array_index (plugins, i);
+		g_autoptr(GPtrArray) depends = NULL;
+		if (!fu_plugin_get_enabled (plugin))
+			continue;
+		depends = fu_plugin_list_get_depends (self->plugin_list, plugin);
+		g_hash_table_insert (blockers, plugin, GUINT_TO_POINTER (depends->len));
+		for (guint j = 0; j < depends->len; j++) {
+			FuPlugin *dep = g_ptr_array_index (depends, j);
+			GPtrArray *tmp = g_hash_table_lookup (dependents, dep);
+			if (tmp == NULL) {
+				tmp = g_ptr_array_new ();
+				g_hash_table_insert (dependents, dep, tmp);
+			}
+			g_ptr_array_add (tmp, plugin);
+		}
+		todo++;
+	}
+
+	/* start everything with no dependencies */
+	self->coldplug_thread = g_thread_self ();
+	self->coldplug_queue = g_async_queue_new ();
+	for (guint i = 0; i < plugins->len; i++) {
+		FuPlugin *plugin = g_ptr_array_index (plugins, i);
+		gpointer cnt;
+		if (!g_hash_table_lookup_extended (blockers, plugin, NULL, &cnt))
+			continue;
+		if (GPOINTER_TO_UINT (cnt) == 0)
+			fu_engine_plugins_coldplug_schedule (&helper, pool, plugin);
+	}
+
+	/* process the events from the workers until every plugin is done */
+	results = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_engine_coldplug_event_free);
+	while (todo > 0) {
+		FuEngineColdplugEvent *event;
+		FuPlugin *plugin_serial = g_queue_pop_head (&helper.serial);
+		GPtrArray *tmp;
+
+		/* this queues the done event, so just go round again */
+		if (plugin_serial != NULL) {
+			fu_engine_plugins_coldplug_worker_cb (plugin_serial, &helper);
+			continue;
+		}
+
+		event = g_async_queue_pop (self->coldplug_queue);
+		switch (event->kind) {
+		case FU_ENGINE_COLDPLUG_EVENT_KIND_DEVICE_ADDED:
+			fu_engine_plugin_device_added_cb (event->plugin, event->device, self);
+			fu_engine_coldplug_event_free (event);
+			break;
+		case FU_ENGINE_COLDPLUG_EVENT_KIND_DEVICE_REMOVED:
+			fu_engine_plugin_device_removed_cb (event->plugin, event->device, self);
+			fu_engine_coldplug_event_free (event);
+			break;
+		case FU_ENGINE_COLDPLUG_EVENT_KIND_DEVICE_REGISTER:
+			/* owned by the waiting worker */
+			g_mutex_lock (&event->mutex);
+			fu_engine_plugin_device_register_cb (event->plugin, event->device, self);
+			event->replied = TRUE;
+			g_cond_signal (&event->cond);
+			g_mutex_unlock (&event->mutex);
+			break;
+		case FU_ENGINE_COLDPLUG_EVENT_KIND_SET_COLDPLUG_DELAY:
+			fu_engine_plugin_set_coldplug_delay_cb (event->plugin,
+								event->duration,
+								self);
+			fu_engine_coldplug_event_free (event);
+			break;
+		case FU_ENGINE_COLDPLUG_EVENT_KIND_RULES_CHANGED:
+			fu_engine_plugin_rules_changed_cb (event->plugin, self);
+			fu_engine_coldplug_event_free (event);
+			break;
+		case FU_ENGINE_COLDPLUG_EVENT_KIND_SECURITY_CHANGED:
+			fu_engine_plugin_security_changed_cb (event->plugin, self);
+			fu_engine_coldplug_event_free (event);
+			break;
+		case FU_ENGINE_COLDPLUG_EVENT_KIND_CHECK_SUPPORTED:
+			/* owned by the waiting worker */
+			g_mutex_lock (&event->mutex);
+			event->retval = fu_engine_plugin_check_supported_cb (event->plugin,
+									     event->guid,
+									     self);
+			event->replied = TRUE;
+			g_cond_signal (&event->cond);
+			g_mutex_unlock (&event->mutex);
+			break;
+		case FU_ENGINE_COLDPLUG_EVENT_KIND_DONE:
+			if (event->error != NULL) {
+				if (is_recoldplug) {
+					g_message ("failed recoldplug: %s",
+						   event->error->message);
+				} else {
+					fu_plugin_set_enabled (event->plugin, FALSE);
+					g_message ("disabling plugin because: %s",
+						   event->error->message);
+				}
+			}
+
+			/* unblock anything waiting for this plugin */
+			tmp = g_hash_table_lookup (dependents, event->plugin);
+			for (guint i = 0; tmp != NULL && i < tmp->len; i++) {
+				FuPlugin *plugin = g_ptr_array_index (tmp, i);
+				guint cnt = GPOINTER_TO_UINT (g_hash_table_lookup (blockers, plugin));
+				g_hash_table_insert (blockers, plugin, GUINT_TO_POINTER (cnt - 1));
+				if (cnt == 1)
+					fu_engine_plugins_coldplug_schedule (&helper, pool, plugin);
+			}
+			g_ptr_array_add (results, event);
+			todo--;
+			break;
+		default:
+			g_assert_not_reached ();
 		}
 	}
+	g_thread_pool_free (pool, FALSE, TRUE);
+	g_clear_pointer (&self->coldplug_queue, g_async_queue_unref);
+	self->coldplug_thread = NULL;
+
+	/* report the slowest first */
+	g_ptr_array_sort (results, fu_engine_plugins_coldplug_elapsed_sort_cb);
+	for (guint i = 0; i < results->len; i++) {
+		FuEngineColdplugEvent *event = g_ptr_array_index (results, i);
+		g_string_append_printf (str, "%s:%.0fms, ",
+					fu_plugin_get_name (event->plugin),
+					event->elapsed);
+	}
+	if (str->len > 2) {
+		g_string_truncate (str, str->len - 2);
+		g_debug ("concurrent coldplug took %.0fms: %s",
+			 g_timer_elapsed (timer, NULL) * 1000.f, str->str);
+	}
+	return TRUE;
 }
 
 static void
@@ -4785,8 +5914,10 @@ fu_engine_plugins_coldplug (FuEngine *self, gboolean is_recoldplug)
 	for (guint i = 0; i < plugins->len; i++) {
 		g_autoptr(GError) error = NULL;
 		FuPlugin *plugin = g_ptr_array_index (plugins, i);
+		fu_profile_push (self->profile, "coldplug-prepare:%s", fu_plugin_get_name (plugin));
 		if (!fu_plugin_runner_coldplug_prepare (plugin, &error))
 			g_warning ("failed to prepare coldplug: %s", error->message);
+		fu_profile_pop (self->profile);
 	}
 
 	/* do this in one place */
@@ -4795,10 +5926,17 @@ fu_engine_plugins_coldplug (FuEngine *self, gboolean is_recoldplug)
 		g_usleep (self->coldplug_delay * 1000);
 	}
 
-	/* exec */
+	/* exec, in parallel if possible */
+	if (fu_config_get_concurrent_coldplug (self->config)) {
+		g_autoptr(GError) error = NULL;
+		if (fu_engine_plugins_coldplug_concurrent (self, is_recoldplug, &error))
+			goto cleanup;
+		g_warning ("failed to coldplug concurrently: %s", error->message);
+	}
 	for (guint i = 0; i < plugins->len; i++) {
 		g_autoptr(GError) error = NULL;
 		FuPlugin *plugin = g_ptr_array_index (plugins, i);
+		fu_profile_push (self->profile, "coldplug:%s", fu_plugin_get_name (plugin));
 		if (is_recoldplug) {
 			if (!fu_plugin_runner_recoldplug (plugin, &error))
 				g_message ("failed recoldplug: %s", error->message);
@@ -4809,14 +5947,18 @@ fu_engine_plugins_coldplug (FuEngine *self, gboolean is_recoldplug)
 					   error->message);
 			}
 		}
+		fu_profile_pop (self->profile);
 	}
 
 	/* cleanup */
+cleanup:
 	for (guint i = 0; i < plugins->len; i++) {
 		g_autoptr(GError) error = NULL;
 		FuPlugin *plugin = g_ptr_array_index (plugins, i);
+		fu_profile_push (self->profile, "coldplug-cleanup:%s", fu_plugin_get_name (plugin));
 		if (!fu_plugin_runner_coldplug_cleanup (plugin, &error))
 			g_warning ("failed to cleanup coldplug: %s", error->message);
+		fu_profile_pop (self->profile);
 	}
 
 	/* print what we do have */
@@ -4858,6 +6000,15 @@ fu_engine_plugin_device_register_cb (FuPlugin *plugin,
 				    gpointer user_data)
 {
 	FuEngine *self = FU_ENGINE (user_data);
+
+	/* the plugin expects the device to be changed when this returns */
+	if (fu_engine_coldplug_is_worker (self)) {
+		g_autoptr(FuEngineColdplugEvent) event = NULL;
+		event = fu_engine_coldplug_event_new (FU_ENGINE_COLDPLUG_EVENT_KIND_DEVICE_REGISTER,
+						      plugin, device);
+		fu_engine_coldplug_queue_push_sync (self, event);
+		return;
+	}
 	fu_engine_plugin_device_register (self, device);
 }
 
@@ -4868,6 +6019,14 @@ fu_engine_plugin_device_added_cb (FuPlugin *plugin,
 {
 	FuEngine *self = FU_ENGINE (user_data);
 
+	/* added from a coldplug worker thread */
+	if (fu_engine_coldplug_is_worker (self)) {
+		fu_engine_coldplug_queue_push (self,
+					       FU_ENGINE_COLDPLUG_EVENT_KIND_DEVICE_ADDED,
+					       plugin, device);
+		return;
+	}
+
 	/* plugin has prio and device not already set from quirk */
 	if (fu_plugin_get_priority (plugin) > 0 &&
 	    fu_device_get_priority (device) == 0) {
@@ -5141,7 +6300,17 @@ static void
 fu_engine_plugin_rules_changed_cb (FuPlugin *plugin, gpointer user_data)
 {
 	FuEngine *self = FU_ENGINE (user_data);
-	GPtrArray *rules = fu_plugin_get_rules (plugin, FU_PLUGIN_RULE_INHIBITS_IDLE);
+	GPtrArray *rules;
+
+	/* changed from a coldplug worker thread */
+	if (fu_engine_coldplug_is_worker (self)) {
+		fu_engine_coldplug_queue_push (self,
+					       FU_ENGINE_COLDPLUG_EVENT_KIND_RULES_CHANGED,
+					       plugin, NULL);
+		return;
+	}
+
+	rules = fu_plugin_get_rules (plugin, FU_PLUGIN_RULE_INHIBITS_IDLE);
 	if (rules == NULL)
 		return;
 	for (guint j = 0; j < rules->len; j++) {
@@ -5155,6 +6324,14 @@ fu_engine_plugin_security_changed_cb (FuPlugin *plugin, gpointer user_data)
 {
 	FuEngine *self = FU_ENGINE (user_data);
 
+	/* changed from a coldplug worker thread */
+	if (fu_engine_coldplug_is_worker (self)) {
+		fu_engine_coldplug_queue_push (self,
+					       FU_ENGINE_COLDPLUG_EVENT_KIND_SECURITY_CHANGED,
+					       plugin, NULL);
+		return;
+	}
+
 	/* invalidate host security attributes */
 	g_clear_pointer (&self->host_security_id, g_free);
 
@@ -5172,6 +6349,14 @@ fu_engine_plugin_device_removed_cb (FuPlugin *plugin,
 	g_autoptr(FuDevice) device_tmp = NULL;
 	g_autoptr(GError) error = NULL;
 
+	/* removed from a coldplug worker thread */
+	if (fu_engine_coldplug_is_worker (self)) {
+		fu_engine_coldplug_queue_push (self,
+					       FU_ENGINE_COLDPLUG_EVENT_KIND_DEVICE_REMOVED,
+					       plugin, device);
+		return;
+	}
+
 	device_tmp = fu_device_list_get_by_id (self->device_list,
 					       fu_device_get_id (device),
 					       &error);
@@ -5216,6 +6401,8 @@ fu_engine_recoldplug_delay_cb (gpointer user_data)
 static void
 fu_engine_udev_device_add (FuEngine *self, GUdevDevice *udev_device)
 {
+	const gchar *sysfs_path = g_udev_device_get_sysfs_path (udev_device);
+	gboolean ret;
 	g_autoptr(FuUdevDevice) device = fu_udev_device_new (udev_device);
 	g_autoptr(GError) error_local = NULL;
 	g_autoptr(GPtrArray) possible_plugins = NULL;
@@ -5228,10 +6415,12 @@ fu_engine_udev_device_add (FuEngine *self, GUdevDevice *udev_device)
 
 	/* add any extra quirks */
 	fu_device_set_quirks (FU_DEVICE (device), self->quirks);
-	if (!fu_device_probe (FU_DEVICE (device), &error_local)) {
+	fu_profile_push (self->profile, "probe:%s", sysfs_path);
+	ret = fu_device_probe (FU_DEVICE (device), &error_local);
+	fu_profile_pop (self->profile);
+	if (!ret) {
 		g_warning ("failed to probe device %s: %s",
-			   g_udev_device_get_sysfs_path (udev_device),
-			   error_local->message);
+			   sysfs_path, error_local->message);
 		return;
 	}
 
@@ -5242,14 +6431,17 @@ fu_engine_udev_device_add (FuEngine *self, GUdevDevice *udev_device)
 		const gchar *plugin_name = g_ptr_array_index (possible_plugins, i);
 		g_autoptr(GError) error = NULL;
 
-		plugin = fu_plugin_list_find_by_name (self->plugin_list,
-						      plugin_name, &error);
+		plugin = fu_engine_get_plugin_by_name (self, plugin_name, &error);
 		if (plugin == NULL) {
 			g_debug ("failed to find specified plugin %s: %s",
 				 plugin_name, error->message);
 			continue;
 		}
-		if (!fu_plugin_runner_udev_device_added (plugin, device, &error)) {
+		fu_profile_push (self->profile, "udev-device-added:%s:%s",
+				 fu_plugin_get_name (plugin), sysfs_path);
+		ret = fu_plugin_runner_udev_device_added (plugin, device, &error);
+		fu_profile_pop (self->profile);
+		if (!ret) {
 			if (g_error_matches (error, FWUPD_ERROR, FWUPD_ERROR_NOT_SUPPORTED)) {
 				if (g_getenv ("FWUPD_PROBE_VERBOSE") != NULL) {
 					g_debug ("%s ignoring: %s",
@@ -5259,8 +6451,7 @@ fu_engine_udev_device_add (FuEngine *self, GUdevDevice *udev_device)
 				continue;
 			}
 			g_warning ("failed to add udev device %s: %s",
-				   g_udev_device_get_sysfs_path (udev_device),
-				   error->message);
+				   sysfs_path, error->message);
 			continue;
 		}
 	}
@@ -5422,6 +6613,15 @@ fu_engine_plugin_recoldplug_cb (FuPlugin *plugin, FuEngine *self)
 static void
 fu_engine_plugin_set_coldplug_delay_cb (FuPlugin *plugin, guint duration, FuEngine *self)
 {
+	/* set from a coldplug worker thread */
+	if (fu_engine_coldplug_is_worker (self)) {
+		FuEngineColdplugEvent *event;
+		event = fu_engine_coldplug_event_new (FU_ENGINE_COLDPLUG_EVENT_KIND_SET_COLDPLUG_DELAY,
+						      plugin, NULL);
+		event->duration = duration;
+		g_async_queue_push (self->coldplug_queue, event);
+		return;
+	}
 	self->coldplug_delay = MAX (self->coldplug_delay, duration);
 	g_debug ("got coldplug delay of %ums, global maximum is now %ums",
 		 duration, self->coldplug_delay);
@@ -5489,17 +6689,19 @@ fu_engine_add_plugin_filter (FuEngine *self, const gchar *plugin_glob)
 static gboolean
 fu_engine_plugin_check_supported_cb (FuPlugin *plugin, const gchar *guid, FuEngine *self)
 {
-	g_autoptr(XbNode) n = NULL;
-	g_autofree gchar *xpath = NULL;
-
 	if (fu_config_get_enumerate_all_devices (self->config))
 		return TRUE;
 
-	xpath = g_strdup_printf ("components/component/"
-				 "provides/firmware[@type='flashed'][text()='%s']",
-				 guid);
-	n = xb_silo_query_first (self->silo, xpath, NULL);
-	return n != NULL;
+	/* the silo can only be queried from the main thread */
+	if (fu_engine_coldplug_is_worker (self)) {
+		g_autoptr(FuEngineColdplugEvent) event = NULL;
+		event = fu_engine_coldplug_event_new (FU_ENGINE_COLDPLUG_EVENT_KIND_CHECK_SUPPORTED,
+						      plugin, NULL);
+		event->guid = g_strdup (guid);
+		return fu_engine_coldplug_queue_push_sync (self, event);
+	}
+
+	return g_hash_table_contains (self->component_guids, guid);
 }
 
 gboolean
@@ -5697,11 +6899,173 @@ fu_engine_get_host_security_attrs (FuEngine *self)
 	return g_object_ref (self->host_security_attrs);
 }
 
+static FuPlugin *
+fu_engine_plugin_new (FuEngine *self, const gchar *name)
+{
+	FuPlugin *plugin = fu_plugin_new ();
+	fu_plugin_set_name (plugin, name);
+	fu_plugin_set_usb_context (plugin, self->usb_ctx);
+	fu_plugin_set_hwids (plugin, self->hwids);
+	fu_plugin_set_smbios (plugin, self->smbios);
+	fu_plugin_set_udev_subsystems (plugin, self->udev_subsystems);
+	fu_plugin_set_quirks (plugin, self->quirks);
+	fu_plugin_set_runtime_versions (plugin, self->runtime_versions);
+	fu_plugin_set_compile_versions (plugin, self->compile_versions);
+	fu_plugin_set_cancellable (plugin, self->install_cancellable);
+	g_signal_connect (plugin, "add-firmware-gtype",
+			  G_CALLBACK (fu_engine_plugin_add_firmware_gtype_cb),
+			  self);
+	return plugin;
+}
+
+static void
+fu_engine_plugin_watch (FuEngine *self, FuPlugin *plugin)
+{
+	g_signal_connect (plugin, "device-added",
+			  G_CALLBACK (fu_engine_plugin_device_added_cb),
+			  self);
+	g_signal_connect (plugin, "device-removed",
+			  G_CALLBACK (fu_engine_plugin_device_removed_cb),
+			  self);
+	g_signal_connect (plugin, "device-register",
+			  G_CALLBACK (fu_engine_plugin_device_register_cb),
+			  self);
+	g_signal_connect (plugin, "recoldplug",
+			  G_CALLBACK (fu_engine_plugin_recoldplug_cb),
+			  self);
+	g_signal_connect (plugin, "set-coldplug-delay",
+			  G_CALLBACK (fu_engine_plugin_set_coldplug_delay_cb),
+			  self);
+	g_signal_connect (plugin, "check-supported",
+			  G_CALLBACK (fu_engine_plugin_check_supported_cb),
+			  self);
+	g_signal_connect (plugin, "rules-changed",
+			  G_CALLBACK (fu_engine_plugin_rules_changed_cb),
+			  self);
+	g_signal_connect (plugin, "security-changed",
+			  G_CALLBACK (fu_engine_plugin_security_changed_cb),
+			  self);
+}
+
+/* the manifest is generated at build time by fu-plugin-manifest.py */
+static GKeyFile *
+fu_engine_load_plugin_manifest (FuEngine *self, const gchar *plugin_path)
+{
+	g_autofree gchar *filename = NULL;
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GKeyFile) manifest = g_key_file_new ();
+
+	if (!fu_config_get_lazy_plugins (self->config))
+		return NULL;
+	filename = g_build_filename (plugin_path, "plugins.manifest", NULL);
+	if (!g_key_file_load_from_file (manifest, filename,
+					G_KEY_FILE_NONE, &error_local)) {
+		g_debug ("not loading plugins lazily: %s", error_local->message);
+		return NULL;
+	}
+	return g_steal_pointer (&manifest);
+}
+
+/* returns TRUE if the plugin can be loaded when a device is matched */
+static gboolean
+fu_engine_plugin_defer (FuEngine *self,
+			GKeyFile *manifest,
+			const gchar *name,
+			const gchar *filename)
+{
+	g_auto(GStrv) hwids = NULL;
+	g_auto(GStrv) subsystems = NULL;
+
+	if (!g_key_file_get_boolean (manifest, name, "Lazy", NULL))
+		return FALSE;
+
+	/* the plugin is written for this machine, so the hardware is present */
+	hwids = g_key_file_get_string_list (manifest, name, "Hwids", NULL, NULL);
+	for (guint i = 0; hwids != NULL && hwids[i] != NULL; i++) {
+		if (fu_hwids_has_guid (self->hwids, hwids[i])) {
+			g_debug ("not deferring %s as %s matched", name, hwids[i]);
+			return FALSE;
+		}
+	}
+
+	/* the udev client has to watch these before any plugin is loaded */
+	subsystems = g_key_file_get_string_list (manifest, name,
+						 "UdevSubsystems", NULL, NULL);
+	for (guint i = 0; subsystems != NULL && subsystems[i] != NULL; i++) {
+		gboolean found = FALSE;
+		for (guint j = 0; j < self->udev_subsystems->len; j++) {
+			const gchar *tmp = g_ptr_array_index (self->udev_subsystems, j);
+			if (g_strcmp0 (tmp, subsystems[i]) == 0) {
+				found = TRUE;
+				break;
+			}
+		}
+		if (!found) {
+			g_debug ("added udev subsystem watch of %s", subsystems[i]);
+			g_ptr_array_add (self->udev_subsystems,
+					 g_strdup (subsystems[i]));
+		}
+	}
+	g_hash_table_insert (self->plugins_lazy,
+			     g_strdup (name),
+			     g_strdup (filename));
+	return TRUE;
+}
+
+/* opens a deferred plugin the first time a device asks for it */
+static FuPlugin *
+fu_engine_get_plugin_by_name (FuEngine *self, const gchar *name, GError **error)
+{
+	FuPlugin *plugin;
+	gboolean ret;
+	g_autofree gchar *filename = NULL;
+	g_autoptr(FuPlugin) plugin_new = NULL;
+
+	plugin = fu_plugin_list_find_by_name (self->plugin_list, name, NULL);
+	if (plugin != NULL)
+		return plugin;
+	filename = g_strdup (g_hash_table_lookup (self->plugins_lazy, name));
+	if (filename == NULL)
+		return fu_plugin_list_find_by_name (self->plugin_list, name, error);
+
+	/* only try once, even on failure */
+	g_hash_table_remove (self->plugins_lazy, name);
+	g_debug ("loading plugin %s on demand", filename);
+	plugin_new = fu_engine_plugin_new (self, name);
+	fu_profile_push (self->profile, "open:%s", name);
+	ret = fu_plugin_open (plugin_new, filename, error);
+	fu_profile_pop (self->profile);
+	if (!ret)
+		return NULL;
+	if (!fu_plugin_get_enabled (plugin_new)) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_SUPPORTED,
+			     "%s self disabled", name);
+		return NULL;
+	}
+	fu_profile_push (self->profile, "startup:%s", name);
+	ret = fu_plugin_runner_startup (plugin_new, error);
+	fu_profile_pop (self->profile);
+	if (!ret) {
+		g_prefix_error (error, "failed to start %s: ", name);
+		return NULL;
+	}
+
+	/* add, and reorder in case other plugins have rules */
+	fu_engine_plugin_watch (self, plugin_new);
+	fu_engine_add_plugin (self, plugin_new);
+	if (!fu_plugin_list_depsolve (self->plugin_list, error))
+		return NULL;
+	return plugin_new;
+}
+
 gboolean
 fu_engine_load_plugins (FuEngine *self, GError **error)
 {
 	const gchar *fn;
 	g_autoptr(GDir) dir = NULL;
+	g_autoptr(GKeyFile) manifest = NULL;
 	g_autofree gchar *plugin_path = NULL;
 	g_autofree gchar *suffix = g_strdup_printf (".%s", G_MODULE_SUFFIX);
 
@@ -5710,6 +7074,10 @@ fu_engine_load_plugins (FuEngine *self, GError **error)
 	dir = g_dir_open (plugin_path, 0, error);
 	if (dir == NULL)
 		return FALSE;
+
+	/* only defer when loaded from fu_engine_load() */
+	if (self->usb_ctx != NULL)
+		manifest = fu_engine_load_plugin_manifest (self, plugin_path);
 	while ((fn = g_dir_read_name (dir)) != NULL) {
 		g_autofree gchar *filename = NULL;
 		g_autofree gchar *name = NULL;
@@ -5733,20 +7101,16 @@ fu_engine_load_plugins (FuEngine *self, GError **error)
 			continue;
 		}
 
-		/* open module */
+		/* wait until matching hardware is found */
 		filename = g_build_filename (plugin_path, fn, NULL);
-		plugin = fu_plugin_new ();
-		fu_plugin_set_name (plugin, name);
-		fu_plugin_set_usb_context (plugin, self->usb_ctx);
-		fu_plugin_set_hwids (plugin, self->hwids);
-		fu_plugin_set_smbios (plugin, self->smbios);
-		fu_plugin_set_udev_subsystems (plugin, self->udev_subsystems);
-		fu_plugin_set_quirks (plugin, self->quirks);
-		fu_plugin_set_runtime_versions (plugin, self->runtime_versions);
-		fu_plugin_set_compile_versions (plugin, self->compile_versions);
-		g_signal_connect (plugin, "add-firmware-gtype",
-				  G_CALLBACK (fu_engine_plugin_add_firmware_gtype_cb),
-				  self);
+		if (manifest != NULL &&
+		    fu_engine_plugin_defer (self, manifest, name, filename)) {
+			g_debug ("deferring plugin %s", filename);
+			continue;
+		}
+
+		/* open module */
+		plugin = fu_engine_plugin_new (self, name);
 		g_debug ("adding plugin %s", filename);
 
 		/* if loaded from fu_engine_load() open the plugin */
@@ -5765,30 +7129,7 @@ fu_engine_load_plugins (FuEngine *self, GError **error)
 		}
 
 		/* watch for changes */
-		g_signal_connect (plugin, "device-added",
-				  G_CALLBACK (fu_engine_plugin_device_added_cb),
-				  self);
-		g_signal_connect (plugin, "device-removed",
-				  G_CALLBACK (fu_engine_plugin_device_removed_cb),
-				  self);
-		g_signal_connect (plugin, "device-register",
-				  G_CALLBACK (fu_engine_plugin_device_register_cb),
-				  self);
-		g_signal_connect (plugin, "recoldplug",
-				  G_CALLBACK (fu_engine_plugin_recoldplug_cb),
-				  self);
-		g_signal_connect (plugin, "set-coldplug-delay",
-				  G_CALLBACK (fu_engine_plugin_set_coldplug_delay_cb),
-				  self);
-		g_signal_connect (plugin, "check-supported",
-				  G_CALLBACK (fu_engine_plugin_check_supported_cb),
-				  self);
-		g_signal_connect (plugin, "rules-changed",
-				  G_CALLBACK (fu_engine_plugin_rules_changed_cb),
-				  self);
-		g_signal_connect (plugin, "security-changed",
-				  G_CALLBACK (fu_engine_plugin_security_changed_cb),
-				  self);
+		fu_engine_plugin_watch (self, plugin);
 
 		/* add */
 		fu_engine_add_plugin (self, plugin);
@@ -5858,6 +7199,7 @@ fu_engine_usb_device_added_cb (GUsbContext *ctx,
 			       GUsbDevice *usb_device,
 			       FuEngine *self)
 {
+	gboolean ret;
 	g_autoptr(FuUsbDevice) device = fu_usb_device_new (usb_device);
 	g_autoptr(GError) error_local = NULL;
 	g_autoptr(GPtrArray) possible_plugins = NULL;
@@ -5871,7 +7213,12 @@ fu_engine_usb_device_added_cb (GUsbContext *ctx,
 
 	/* add any extra quirks */
 	fu_device_set_quirks (FU_DEVICE (device), self->quirks);
-	if (!fu_device_probe (FU_DEVICE (device), &error_local)) {
+	fu_profile_push (self->profile, "probe:%04x:%04x",
+			 g_usb_device_get_vid (usb_device),
+			 g_usb_device_get_pid (usb_device));
+	ret = fu_device_probe (FU_DEVICE (device), &error_local);
+	fu_profile_pop (self->profile);
+	if (!ret) {
 		g_warning ("failed to probe device %s: %s",
 			   fu_device_get_physical_id (FU_DEVICE (device)),
 			   error_local->message);
@@ -5885,14 +7232,19 @@ fu_engine_usb_device_added_cb (GUsbContext *ctx,
 		const gchar *plugin_name = g_ptr_array_index (possible_plugins, i);
 		g_autoptr(GError) error = NULL;
 
-		plugin = fu_plugin_list_find_by_name (self->plugin_list,
-						      plugin_name, &error);
+		plugin = fu_engine_get_plugin_by_name (self, plugin_name, &error);
 		if (plugin == NULL) {
 			g_debug ("failed to find specified plugin %s: %s",
 				 plugin_name, error->message);
 			continue;
 		}
-		if (!fu_plugin_runner_usb_device_added (plugin, device, &error)) {
+		fu_profile_push (self->profile, "usb-device-added:%s:%04x:%04x",
+				 fu_plugin_get_name (plugin),
+				 g_usb_device_get_vid (usb_device),
+				 g_usb_device_get_pid (usb_device));
+		ret = fu_plugin_runner_usb_device_added (plugin, device, &error);
+		fu_profile_pop (self->profile);
+		if (!ret) {
 			if (g_error_matches (error, FWUPD_ERROR, FWUPD_ERROR_NOT_SUPPORTED)) {
 				if (g_getenv ("FWUPD_PROBE_VERBOSE") != NULL) {
 					g_debug ("%s ignoring: %s",
@@ -5918,20 +7270,150 @@ fu_engine_load_quirks (FuEngine *self, FuQuirksLoadFlags quirks_flags)
 		g_warning ("Failed to load quirks: %s", error->message);
 }
 
-static void
+#define FU_ENGINE_HWIDS_CACHE_FORMAT	"(s(sua(yqayas))(a{ss}a{ss}as))"
+
+/* the DMI tables cannot change without a reboot, but check them anyway; the
+ * daemon version is included as a new version may parse them differently */
+static gchar *
+fu_engine_get_hwids_cache_key (GError **error)
+{
+	gsize dmisz = 0;
+	g_autofree gchar *boot_id = NULL;
+	g_autofree gchar *dmi = NULL;
+	g_autofree gchar *fn_boot_id = NULL;
+	g_autofree gchar *fn_dmi = NULL;
+	g_autofree gchar *procfs = fu_common_get_path (FU_PATH_KIND_PROCFS);
+	g_autofree gchar *sysfsfwdir = fu_common_get_path (FU_PATH_KIND_SYSFSDIR_FW);
+	g_autoptr(GChecksum) csum = g_checksum_new (G_CHECKSUM_SHA1);
+
+	fn_boot_id = g_build_filename (procfs, "sys", "kernel", "random", "boot_id", NULL);
+	if (!g_file_get_contents (fn_boot_id, &boot_id, NULL, error))
+		return NULL;
+	fn_dmi = g_build_filename (sysfsfwdir, "dmi", "tables", "DMI", NULL);
+	if (!g_file_get_contents (fn_dmi, &dmi, &dmisz, error))
+		return NULL;
+	g_checksum_update (csum, (const guchar *) PACKAGE_VERSION, -1);
+	g_checksum_update (csum, (const guchar *) g_strstrip (boot_id), -1);
+	g_checksum_update (csum, (const guchar *) dmi, dmisz);
+	return g_strdup (g_checksum_get_string (csum));
+}
+
+static gboolean
+fu_engine_load_hwids_cache (FuEngine *self, const gchar *fn, const gchar *key, GError **error)
+{
+	const gchar *key_old = NULL;
+	gsize bufsz = 0;
+	g_autofree gchar *buf = NULL;
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GVariant) smbios = NULL;
+	g_autoptr(GVariant) hwids = NULL;
+	g_autoptr(GVariant) value = NULL;
+
+	if (!g_file_get_contents (fn, &buf, &bufsz, error))
+		return FALSE;
+	blob = g_bytes_new_take (g_steal_pointer (&buf), bufsz);
+	value = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (FU_ENGINE_HWIDS_CACHE_FORMAT),
+							      blob, FALSE));
+	if (!g_variant_is_normal_form (value)) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "%s is corrupt", fn);
+		return FALSE;
+	}
+	g_variant_get (value, "(&s@(sua(yqayas))@(a{ss}a{ss}as))",
+		       &key_old, &smbios, &hwids);
+	if (g_strcmp0 (key, key_old) != 0) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOTHING_TO_DO,
+			     "hardware may have changed, %s != %s",
+			     key_old, key);
+		return FALSE;
+	}
+	if (!fu_smbios_setup_from_variant (self->smbios, smbios, error))
+		return FALSE;
+	return fu_hwids_setup_from_variant (self->hwids, hwids, error);
+}
+
+static gboolean
+fu_engine_save_hwids_cache (FuEngine *self, const gchar *fn, const gchar *key, GError **error)
+{
+	g_autoptr(GVariant) value = NULL;
+	value = g_variant_ref_sink (g_variant_new ("(s@(sua(yqayas))@(a{ss}a{ss}as))",
+						   key,
+						   fu_smbios_to_variant (self->smbios),
+						   fu_hwids_to_variant (self->hwids)));
+	if (!fu_common_mkdir_parent (fn, error))
+		return FALSE;
+	return g_file_set_contents (fn,
+				    g_variant_get_data (value),
+				    g_variant_get_size (value),
+				    error);
+}
+
+static gboolean
 fu_engine_load_smbios (FuEngine *self)
 {
 	g_autoptr(GError) error = NULL;
-	if (!fu_smbios_setup (self->smbios, &error))
+	if (!fu_smbios_setup (self->smbios, &error)) {
 		g_warning ("Failed to load SMBIOS: %s", error->message);
+		return FALSE;
+	}
+	return TRUE;
 }
 
-static void
+static gboolean
 fu_engine_load_hwids (FuEngine *self)
 {
 	g_autoptr(GError) error = NULL;
-	if (!fu_hwids_setup (self->hwids, self->smbios, &error))
+	if (!fu_hwids_setup (self->hwids, self->smbios, &error)) {
 		g_warning ("Failed to load HWIDs: %s", error->message);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/* parsing the SMBIOS tables and computing the HWIDs is only done once per boot */
+static void
+fu_engine_load_smbios_hwids (FuEngine *self, FuEngineLoadFlags flags)
+{
+	gboolean ret;
+	g_autofree gchar *cachedirpkg = fu_common_get_path (FU_PATH_KIND_CACHEDIR_PKG);
+	g_autofree gchar *fn = g_build_filename (cachedirpkg, "hwids.cache", NULL);
+	g_autofree gchar *key = NULL;
+	g_autoptr(GError) error_local = NULL;
+
+	key = fu_engine_get_hwids_cache_key (&error_local);
+	if (key == NULL) {
+		g_debug ("not using HWID cache: %s", error_local->message);
+	} else {
+		fu_profile_push (self->profile, "hwids-cache");
+		if (fu_engine_load_hwids_cache (self, fn, key, &error_local)) {
+			fu_profile_pop (self->profile);
+			return;
+		}
+		fu_profile_pop (self->profile);
+		g_debug ("ignoring HWID cache: %s", error_local->message);
+		g_clear_error (&error_local);
+	}
+
+	/* slow path */
+	fu_profile_push (self->profile, "smbios");
+	ret = fu_engine_load_smbios (self);
+	fu_profile_pop (self->profile);
+	fu_profile_push (self->profile, "hwids");
+	if (!fu_engine_load_hwids (self))
+		ret = FALSE;
+	fu_profile_pop (self->profile);
+
+	/* do not cache a partial result as it would be used until the next boot */
+	if (!ret)
+		return;
+	if (key == NULL || (flags & FU_ENGINE_LOAD_FLAG_READONLY_FS) > 0)
+		return;
+	if (!fu_engine_save_hwids_cache (self, fn, key, &error_local))
+		g_debug ("failed to save HWID cache: %s", error_local->message);
 }
 
 static gboolean
@@ -6101,32 +7583,99 @@ fu_engine_ensure_client_certificate (FuEngine *self)
 }
 
 /**
- * fu_engine_load:
+ * fu_engine_revalidate:
  * @self: A #FuEngine
- * @flags: #FuEngineLoadFlags, e.g. %FU_ENGINE_LOAD_FLAG_READONLY_FS
- * @error: A #GError, or %NULL
- *
- * Load the firmware update engine so it is ready for use.
  *
- * Returns: %TRUE for success
+ * Probes the hardware now if the devices were restored from the cache and
+ * have not yet been replaced by the real devices.
  **/
-gboolean
-fu_engine_load (FuEngine *self, FuEngineLoadFlags flags, GError **error)
+void
+fu_engine_revalidate (FuEngine *self)
+{
+	g_return_if_fail (FU_IS_ENGINE (self));
+
+	if (self->devices_cached->len == 0)
+		return;
+
+	/* the real devices replace the cached devices with the same ID */
+	g_debug ("revalidating %u cached devices", self->devices_cached->len);
+	fu_engine_plugins_coldplug (self, FALSE);
+	g_usb_context_enumerate (self->usb_ctx);
+#ifdef HAVE_GUDEV
+	fu_engine_enumerate_udev (self);
+#endif
+	fu_engine_md_refresh_devices (self);
+
+	/* anything left over no longer exists */
+	for (guint i = 0; i < self->devices_cached->len; i++) {
+		FuDevice *device = g_ptr_array_index (self->devices_cached, i);
+		g_autoptr(FuDevice) device_tmp = NULL;
+		device_tmp = fu_device_list_get_by_id (self->device_list,
+						       fu_device_get_id (device),
+						       NULL);
+		if (device_tmp != device)
+			continue;
+		g_debug ("cached device %s no longer exists",
+			 fu_device_get_id (device));
+		fu_device_set_remove_delay (device, 0);
+		fu_device_list_remove (self->device_list, device);
+	}
+	g_ptr_array_set_size (self->devices_cached, 0);
+	fu_engine_device_cache_schedule_save (self);
+	fu_engine_emit_changed (self);
+}
+
+/* returns TRUE if enumeration has been deferred */
+static gboolean
+fu_engine_device_cache_restore (FuEngine *self)
+{
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GPtrArray) devices = NULL;
+
+	if (self->app_flags & FU_APP_FLAGS_NO_IDLE_SOURCES)
+		return FALSE;
+	if (!fu_config_get_device_cache (self->config))
+		return FALSE;
+	devices = fu_device_cache_load (self->device_cache, &error_local);
+	if (devices == NULL) {
+		g_debug ("not using device cache: %s", error_local->message);
+		return FALSE;
+	}
+	if (devices->len == 0) {
+		g_debug ("not using device cache: no devices");
+		return FALSE;
+	}
+	for (guint i = 0; i < devices->len; i++) {
+		FuDevice *device = g_ptr_array_index (devices, i);
+		gboolean updatable = fu_device_has_flag (device, FWUPD_DEVICE_FLAG_UPDATABLE);
+
+		/* mark as waiting for replug so the real device can replace it */
+		fu_device_set_remove_delay (device, FU_DEVICE_REMOVE_DELAY_USER_REPLUG);
+		fu_device_list_add (self->device_list, device);
+		fu_device_list_remove (self->device_list, device);
+		if (updatable)
+			fu_device_add_flag (device, FWUPD_DEVICE_FLAG_UPDATABLE);
+		g_ptr_array_add (self->devices_cached, g_object_ref (device));
+	}
+
+	/* the boot ID and uevent sequence number are unchanged so the hardware
+	 * is the same, and devices whose node has gone were not restored; the
+	 * hardware is only probed when a device is actually needed */
+	g_debug ("restored %u devices from cache", devices->len);
+	return TRUE;
+}
+
+static gboolean
+fu_engine_load_phases (FuEngine *self, FuEngineLoadFlags flags, GError **error)
 {
 	FuRemoteListLoadFlags remote_list_flags = FU_REMOTE_LIST_LOAD_FLAG_NONE;
 	FuQuirksLoadFlags quirks_flags = FU_QUIRKS_LOAD_FLAG_NONE;
+	gboolean ret;
 	g_autoptr(GPtrArray) checksums = NULL;
 #ifndef _WIN32
 	g_autoptr(GError) error_local = NULL;
 #endif
 
-	g_return_val_if_fail (FU_IS_ENGINE (self), FALSE);
-	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
-
-	/* avoid re-loading a second time if fu-tool or fu-util request to */
-	if (self->loaded)
-		return TRUE;
-
 /* TODO: Read registry key [HKEY_LOCAL_MACHINE\SOFTWARE\Microsoft\Cryptography] "MachineGuid" */
 #ifndef _WIN32
 	/* cache machine ID so we can use it from a sandboxed app */
@@ -6135,7 +7684,10 @@ fu_engine_load (FuEngine *self, FuEngineLoadFlags flags, GError **error)
 		g_debug ("%s", error_local->message);
 #endif
 	/* read config file */
-	if (!fu_config_load (self->config, error)) {
+	fu_profile_push (self->profile, "config");
+	ret = fu_config_load (self->config, error);
+	fu_profile_pop (self->profile);
+	if (!ret) {
 		g_prefix_error (error, "Failed to load config: ");
 		return FALSE;
 	}
@@ -6143,7 +7695,10 @@ fu_engine_load (FuEngine *self, FuEngineLoadFlags flags, GError **error)
 	/* read remotes */
 	if (flags & FU_ENGINE_LOAD_FLAG_READONLY_FS)
 		remote_list_flags |= FU_REMOTE_LIST_LOAD_FLAG_READONLY_FS;
-	if (!fu_remote_list_load (self->remote_list, remote_list_flags, error)) {
+	fu_profile_push (self->profile, "remotes");
+	ret = fu_remote_list_load (self->remote_list, remote_list_flags, error);
+	fu_profile_pop (self->profile);
+	if (!ret) {
 		g_prefix_error (error, "Failed to load remotes: ");
 		return FALSE;
 	}
@@ -6172,15 +7727,19 @@ fu_engine_load (FuEngine *self, FuEngineLoadFlags flags, GError **error)
 		fu_idle_set_timeout (self->idle, fu_config_get_idle_timeout (self->config));
 
 	/* load quirks, SMBIOS and the hwids */
-	fu_engine_load_smbios (self);
-	fu_engine_load_hwids (self);
+	fu_engine_load_smbios_hwids (self, flags);
 	/* on a read-only filesystem don't care about the cache GUID */
 	if (flags & FU_ENGINE_LOAD_FLAG_READONLY_FS)
 		quirks_flags |= FU_QUIRKS_LOAD_FLAG_READONLY_FS;
+	fu_profile_push (self->profile, "quirks");
 	fu_engine_load_quirks (self, quirks_flags);
+	fu_profile_pop (self->profile);
 
 	/* load AppStream metadata */
-	if (!fu_engine_load_metadata_store (self, flags, error)) {
+	fu_profile_push (self->profile, "metadata");
+	ret = fu_engine_load_metadata_store (self, flags, error);
+	fu_profile_pop (self->profile);
+	if (!ret) {
 		g_prefix_error (error, "Failed to load AppStream data: ");
 		return FALSE;
 	}
@@ -6206,7 +7765,10 @@ fu_engine_load (FuEngine *self, FuEngineLoadFlags flags, GError **error)
 	}
 
 	/* load plugin */
-	if (!fu_engine_load_plugins (self, error)) {
+	fu_profile_push (self->profile, "plugins");
+	ret = fu_engine_load_plugins (self, error);
+	fu_profile_pop (self->profile);
+	if (!ret) {
 		g_prefix_error (error, "Failed to load plugins: ");
 		return FALSE;
 	}
@@ -6239,9 +7801,17 @@ fu_engine_load (FuEngine *self, FuEngineLoadFlags flags, GError **error)
 	fu_engine_set_status (self, FWUPD_STATUS_LOADING);
 
 	/* add devices */
+	fu_profile_push (self->profile, "setup");
 	fu_engine_plugins_setup (self);
-	if ((flags & FU_ENGINE_LOAD_FLAG_NO_ENUMERATE) == 0)
+	fu_profile_pop (self->profile);
+	if ((flags & FU_ENGINE_LOAD_FLAG_NO_ENUMERATE) == 0 &&
+	    fu_engine_device_cache_restore (self))
+		flags |= FU_ENGINE_LOAD_FLAG_NO_ENUMERATE;
+	if ((flags & FU_ENGINE_LOAD_FLAG_NO_ENUMERATE) == 0) {
+		fu_profile_push (self->profile, "coldplug");
 		fu_engine_plugins_coldplug (self, FALSE);
+		fu_profile_pop (self->profile);
+	}
 
 	/* coldplug USB devices */
 	g_signal_connect (self->usb_ctx, "device-added",
@@ -6250,20 +7820,34 @@ fu_engine_load (FuEngine *self, FuEngineLoadFlags flags, GError **error)
 	g_signal_connect (self->usb_ctx, "device-removed",
 			  G_CALLBACK (fu_engine_usb_device_removed_cb),
 			  self);
-	if ((flags & FU_ENGINE_LOAD_FLAG_NO_ENUMERATE) == 0)
+	if ((flags & FU_ENGINE_LOAD_FLAG_NO_ENUMERATE) == 0) {
+		fu_profile_push (self->profile, "usb");
 		g_usb_context_enumerate (self->usb_ctx);
+		fu_profile_pop (self->profile);
+	}
 
 #ifdef HAVE_GUDEV
 	/* coldplug udev devices */
-	if ((flags & FU_ENGINE_LOAD_FLAG_NO_ENUMERATE) == 0)
+	if ((flags & FU_ENGINE_LOAD_FLAG_NO_ENUMERATE) == 0) {
+		fu_profile_push (self->profile, "udev");
 		fu_engine_enumerate_udev (self);
+		fu_profile_pop (self->profile);
+	}
 #endif
 
 	/* set device properties from the metadata */
+	fu_profile_push (self->profile, "md-refresh");
 	fu_engine_md_refresh_devices (self);
+	fu_profile_pop (self->profile);
+	g_debug ("quirk lookups: %u cached, %u queried",
+		 fu_quirks_get_cache_hits (self->quirks),
+		 fu_quirks_get_cache_misses (self->quirks));
 
 	/* update the db for devices that were updated during the reboot */
-	if (!fu_engine_update_history_database (self, error))
+	fu_profile_push (self->profile, "history");
+	ret = fu_engine_update_history_database (self, error);
+	fu_profile_pop (self->profile);
+	if (!ret)
 		return FALSE;
 
 	fu_engine_set_status (self, FWUPD_STATUS_IDLE);
@@ -6276,6 +7860,36 @@ fu_engine_load (FuEngine *self, FuEngineLoadFlags flags, GError **error)
 	return TRUE;
 }
 
+/**
+ * fu_engine_load:
+ * @self: A #FuEngine
+ * @flags: #FuEngineLoadFlags, e.g. %FU_ENGINE_LOAD_FLAG_READONLY_FS
+ * @error: A #GError, or %NULL
+ *
+ * Load the firmware update engine so it is ready for use.
+ *
+ * Returns: %TRUE for success
+ **/
+gboolean
+fu_engine_load (FuEngine *self, FuEngineLoadFlags flags, GError **error)
+{
+	gboolean ret;
+
+	g_return_val_if_fail (FU_IS_ENGINE (self), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	/* avoid re-loading a second time if fu-tool or fu-util request to */
+	if (self->loaded)
+		return TRUE;
+
+	/* only profile startup, not hotplug for the lifetime of the daemon */
+	fu_profile_push (self->profile, "load");
+	ret = fu_engine_load_phases (self, flags, error);
+	fu_profile_pop (self->profile);
+	fu_profile_set_enabled (self->profile, FALSE);
+	return ret;
+}
+
 static void
 fu_engine_class_init (FuEngineClass *klass)
 {
@@ -6356,7 +7970,19 @@ fu_engine_init (FuEngine *self)
 	self->device_list = fu_device_list_new ();
 	self->smbios = fu_smbios_new ();
 	self->hwids = fu_hwids_new ();
+	self->install_cancellable = g_cancellable_new ();
+	g_mutex_init (&self->install_mutex);
 	self->idle = fu_idle_new ();
+	self->profile = fu_profile_new ();
+	self->plugins_lazy = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	self->silos = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	self->silo_remotes = g_hash_table_new_full (g_str_hash, g_str_equal,
+						    g_free, (GDestroyNotify) g_object_unref);
+	self->component_guids = g_hash_table_new_full (g_str_hash, g_str_equal,
+						       g_free, (GDestroyNotify) g_ptr_array_unref);
+	self->component_order = g_hash_table_new (g_direct_hash, g_direct_equal);
+	self->device_cache = fu_device_cache_new ();
+	self->devices_cached = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 	self->quirks = fu_quirks_new ();
 	self->history = fu_history_new ();
 	self->plugin_list = fu_plugin_list_new ();
@@ -6428,14 +8054,14 @@ fu_engine_finalize (GObject *obj)
 
 	if (self->usb_ctx != NULL)
 		g_object_unref (self->usb_ctx);
-	if (self->silo != NULL)
-		g_object_unref (self->silo);
 #ifdef HAVE_GUDEV
 	if (self->gudev_client != NULL)
 		g_object_unref (self->gudev_client);
 #endif
 	if (self->coldplug_id != 0)
 		g_source_remove (self->coldplug_id);
+	if (self->device_cache_id != 0)
+		g_source_remove (self->device_cache_id);
 	if (self->approved_firmware != NULL)
 		g_hash_table_unref (self->approved_firmware);
 
@@ -6443,11 +8069,21 @@ fu_engine_finalize (GObject *obj)
 	g_free (self->host_security_id);
 	g_object_unref (self->host_security_attrs);
 	g_object_unref (self->idle);
+	g_object_unref (self->profile);
+	g_hash_table_unref (self->plugins_lazy);
+	g_hash_table_unref (self->component_order);
+	g_hash_table_unref (self->component_guids);
+	g_hash_table_unref (self->silo_remotes);
+	g_ptr_array_unref (self->silos);
+	g_object_unref (self->device_cache);
+	g_ptr_array_unref (self->devices_cached);
 	g_object_unref (self->config);
 	g_object_unref (self->remote_list);
 	g_object_unref (self->smbios);
 	g_object_unref (self->quirks);
 	g_object_unref (self->hwids);
+	g_object_unref (self->install_cancellable);
+	g_mutex_clear (&self->install_mutex);
 	g_object_unref (self->history);
 	g_object_unref (self->device_list);
 	g_object_unref (self->jcat_context);
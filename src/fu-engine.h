@@ -17,6 +17,7 @@
 #include "fu-engine-request.h"
 #include "fu-install-task.h"
 #include "fu-plugin.h"
+#include "fu-profile.h"
 #include "fu-security-attrs.h"
 
 #define FU_TYPE_ENGINE (fu_engine_get_type ())
@@ -57,6 +58,9 @@ XbSilo		*fu_engine_get_silo_from_blob		(FuEngine	*self,
 							 GBytes		*blob_cab,
 							 GError		**error);
 guint64		 fu_engine_get_archive_size_max		(FuEngine	*self);
+GBytes		*fu_engine_get_blob_from_fd		(FuEngine	*self,
+							 gint		 fd,
+							 GError		**error);
 GPtrArray	*fu_engine_get_plugins			(FuEngine	*self);
 GPtrArray	*fu_engine_get_devices			(FuEngine	*self,
 							 GError		**error);
@@ -68,6 +72,15 @@ GPtrArray	*fu_engine_get_devices_by_guid		(FuEngine	*self,
 							 GError		**error);
 GPtrArray	*fu_engine_get_history			(FuEngine	*self,
 							 GError		**error);
+GPtrArray	*fu_engine_get_history_filtered		(FuEngine	*self,
+							 const gchar	*device_id,
+							 const gchar	*plugin,
+							 guint64	 since,
+							 guint64	 until,
+							 FwupdUpdateState update_state,
+							 guint		 limit,
+							 guint		 offset,
+							 GError		**error);
 FwupdRemote 	*fu_engine_get_remote_by_id		(FuEngine	*self,
 							 const gchar	*remote_id,
 							 GError		**error);
@@ -85,6 +98,10 @@ GPtrArray	*fu_engine_get_upgrades			(FuEngine	*self,
 							 FuEngineRequest *request,
 							 const gchar	*device_id,
 							 GError		**error);
+GHashTable	*fu_engine_get_upgrades_all		(FuEngine	*self,
+							 FuEngineRequest *request,
+							 GHashTable	**reasons,
+							 GError		**error);
 FwupdDevice	*fu_engine_get_results			(FuEngine	*self,
 							 const gchar	*device_id,
 							 GError		**error);
@@ -143,6 +160,7 @@ gboolean	 fu_engine_install_blob			(FuEngine	*self,
 							 GBytes		*blob_fw,
 							 FwupdInstallFlags flags,
 							 GError		**error);
+void		 fu_engine_cancel_install		(FuEngine	*self);
 gboolean	 fu_engine_install_tasks		(FuEngine	*self,
 							 FuEngineRequest *request,
 							 GPtrArray	*install_tasks,
@@ -157,6 +175,8 @@ gboolean	 fu_engine_activate			(FuEngine	*self,
 							 const gchar	*device_id,
 							 GError		**error);
 GPtrArray	*fu_engine_get_approved_firmware	(FuEngine	*self);
+FuProfile	*fu_engine_get_profile			(FuEngine	*self);
+void		 fu_engine_revalidate			(FuEngine	*self);
 void		 fu_engine_add_approved_firmware	(FuEngine	*self,
 							 const gchar	*checksum);
 gchar		*fu_engine_self_sign			(FuEngine	*self,
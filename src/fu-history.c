@@ -20,7 +20,7 @@
 #include "fu-history.h"
 #include "fu-mutex.h"
 
-#define FU_HISTORY_CURRENT_SCHEMA_VERSION	5
+#define FU_HISTORY_CURRENT_SCHEMA_VERSION	6
 
 static void fu_history_finalize			 (GObject *object);
 
@@ -29,6 +29,7 @@ struct _FuHistory
 	GObject			 parent_instance;
 	sqlite3			*db;
 	GRWLock			 db_mutex;
+	GHashTable		*stmts;		/* SQL:sqlite3_stmt, only used with the writer lock */
 };
 
 G_DEFINE_TYPE (FuHistory, fu_history, G_TYPE_OBJECT)
@@ -147,11 +148,71 @@ fu_history_stmt_exec (FuHistory *self, sqlite3_stmt *stmt,
 		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_WRITE,
 			     "failed to execute prepared statement: %s",
 			     sqlite3_errmsg (self->db));
+		sqlite3_reset (stmt);
 		return FALSE;
 	}
+	sqlite3_reset (stmt);
 	return TRUE;
 }
 
+/* statements are prepared once and kept until the database is closed;
+ * @sql has to be a string literal as it is used as the key */
+static sqlite3_stmt *
+fu_history_stmt_get (FuHistory *self, const gchar *sql, GError **error)
+{
+	gint rc;
+	sqlite3_stmt *stmt = g_hash_table_lookup (self->stmts, sql);
+
+	if (stmt != NULL) {
+		sqlite3_reset (stmt);
+		sqlite3_clear_bindings (stmt);
+		return stmt;
+	}
+	rc = sqlite3_prepare_v2 (self->db, sql, -1, &stmt, NULL);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
+			     "Failed to prepare SQL: %s",
+			     sqlite3_errmsg (self->db));
+		return NULL;
+	}
+	g_hash_table_insert (self->stmts, (gpointer) sql, stmt);
+	return stmt;
+}
+
+/* readers can run at the same time, so each one needs its own statement */
+static sqlite3_stmt *
+fu_history_stmt_new (FuHistory *self, const gchar *sql, GError **error)
+{
+	gint rc;
+	sqlite3_stmt *stmt = NULL;
+
+	rc = sqlite3_prepare_v2 (self->db, sql, -1, &stmt, NULL);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
+			     "Failed to prepare SQL: %s",
+			     sqlite3_errmsg (self->db));
+		return NULL;
+	}
+	return stmt;
+}
+
+static gboolean
+fu_history_exec (FuHistory *self, const gchar *sql, GError **error)
+{
+	sqlite3_stmt *stmt = fu_history_stmt_get (self, sql, error);
+	if (stmt == NULL)
+		return FALSE;
+	return fu_history_stmt_exec (self, stmt, NULL, error);
+}
+
+static void
+fu_history_close (FuHistory *self)
+{
+	g_hash_table_remove_all (self->stmts);
+	sqlite3_close (self->db);
+	self->db = NULL;
+}
+
 static gboolean
 fu_history_create_database (FuHistory *self, GError **error)
 {
@@ -181,6 +242,9 @@ fu_history_create_database (FuHistory *self, GError **error)
 			 "protocol TEXT DEFAULT NULL);"
 			 "CREATE TABLE IF NOT EXISTS approved_firmware ("
 			 "checksum TEXT);"
+			 "CREATE INDEX IF NOT EXISTS history_device_id ON history (device_id);"
+			 "CREATE INDEX IF NOT EXISTS history_checksum ON history (checksum);"
+			 "CREATE INDEX IF NOT EXISTS history_device_modified ON history (device_modified);"
 			 "COMMIT;", NULL, NULL, NULL);
 	if (rc != SQLITE_OK) {
 		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
@@ -269,6 +333,24 @@ fu_history_migrate_database_v4 (FuHistory *self, GError **error)
 	return TRUE;
 }
 
+static gboolean
+fu_history_migrate_database_v5 (FuHistory *self, GError **error)
+{
+	gint rc;
+	rc = sqlite3_exec (self->db,
+			   "CREATE INDEX IF NOT EXISTS history_device_id ON history (device_id);"
+			   "CREATE INDEX IF NOT EXISTS history_checksum ON history (checksum);"
+			   "CREATE INDEX IF NOT EXISTS history_device_modified ON history (device_modified);",
+			   NULL, NULL, NULL);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
+			     "Failed to create index: %s",
+			     sqlite3_errmsg (self->db));
+		return FALSE;
+	}
+	return TRUE;
+}
+
 /* returns 0 if database is not initialised */
 static guint
 fu_history_get_schema_version (FuHistory *self)
@@ -315,16 +397,26 @@ fu_history_create_or_migrate (FuHistory *self, guint schema_ver, GError **error)
 			return FALSE;
 		if (!fu_history_migrate_database_v4 (self, error))
 			return FALSE;
+		if (!fu_history_migrate_database_v5 (self, error))
+			return FALSE;
 	} else if (schema_ver == 3) {
 		g_debug ("migrating v%u database by altering", schema_ver);
 		if (!fu_history_migrate_database_v3 (self, error))
 			return FALSE;
 		if (!fu_history_migrate_database_v4 (self, error))
 			return FALSE;
+		if (!fu_history_migrate_database_v5 (self, error))
+			return FALSE;
 	} else if (schema_ver == 4) {
 		g_debug ("migrating v%u database by altering", schema_ver);
 		if (!fu_history_migrate_database_v4 (self, error))
 			return FALSE;
+		if (!fu_history_migrate_database_v5 (self, error))
+			return FALSE;
+	} else if (schema_ver == 5) {
+		g_debug ("migrating v%u database by adding indexes", schema_ver);
+		if (!fu_history_migrate_database_v5 (self, error))
+			return FALSE;
 	} else {
 		/* this is probably okay, but return an error if we ever delete
 		 * or rename columns */
@@ -361,8 +453,10 @@ fu_history_open (FuHistory *self, const gchar *filename, GError **error)
 		return FALSE;
 	}
 
-	/* turn off the lookaside cache */
-	sqlite3_db_config (self->db, SQLITE_DBCONFIG_LOOKASIDE, NULL, 0, 0);
+	/* readers do not block the writer and each commit is one append */
+	rc = sqlite3_exec (self->db, "PRAGMA journal_mode=WAL;", NULL, NULL, NULL);
+	if (rc != SQLITE_OK)
+		g_debug ("failed to use WAL: %s", sqlite3_errmsg (self->db));
 	return TRUE;
 }
 
@@ -417,7 +511,7 @@ fu_history_load (FuHistory *self, GError **error)
 			 * and try again with something empty */
 			g_warning ("failed to migrate %s database: %s",
 				   filename, error_migrate->message);
-			sqlite3_close (self->db);
+			fu_history_close (self);
 			if (g_unlink (filename) != 0) {
 				g_set_error (error,
 					     FWUPD_ERROR,
@@ -475,8 +569,7 @@ fu_history_get_device_flags_filtered (FuDevice *device)
 gboolean
 fu_history_modify_device (FuHistory *self, FuDevice *device, GError **error)
 {
-	gint rc;
-	g_autoptr(sqlite3_stmt) stmt = NULL;
+	sqlite3_stmt *stmt;
 	g_autoptr(GRWLockWriterLocker) locker = NULL;
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
@@ -492,21 +585,17 @@ fu_history_modify_device (FuHistory *self, FuDevice *device, GError **error)
 	g_debug ("modifying device %s [%s]",
 		 fu_device_get_name (device),
 		 fu_device_get_id (device));
-	rc = sqlite3_prepare_v2 (self->db,
-				 "UPDATE history SET "
-				 "update_state = ?1, "
-				 "update_error = ?2, "
-				 "checksum_device = ?6, "
-				 "device_modified = ?7, "
-				 "flags = ?3 "
-				 "WHERE device_id = ?4;",
-				 -1, &stmt, NULL);
-	if (rc != SQLITE_OK) {
-		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
-			     "Failed to prepare SQL to update history: %s",
-			     sqlite3_errmsg (self->db));
+	stmt = fu_history_stmt_get (self,
+				    "UPDATE history SET "
+				    "update_state = ?1, "
+				    "update_error = ?2, "
+				    "checksum_device = ?6, "
+				    "device_modified = ?7, "
+				    "flags = ?3 "
+				    "WHERE device_id = ?4;",
+				    error);
+	if (stmt == NULL)
 		return FALSE;
-	}
 
 	sqlite3_bind_int (stmt, 1, fu_device_get_update_state (device));
 	sqlite3_bind_text (stmt, 2, fu_device_get_update_error (device), -1, SQLITE_STATIC);
@@ -539,10 +628,9 @@ fu_history_set_device_metadata (FuHistory *self,
 				GHashTable *metadata,
 				GError **error)
 {
-	gint rc;
 	g_autofree gchar *metadata_str = NULL;
 	g_autoptr(GRWLockWriterLocker) locker = NULL;
-	g_autoptr(sqlite3_stmt) stmt = NULL;
+	sqlite3_stmt *stmt;
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
 	g_return_val_if_fail (device_id != NULL, FALSE);
@@ -555,17 +643,13 @@ fu_history_set_device_metadata (FuHistory *self,
 	locker = g_rw_lock_writer_locker_new (&self->db_mutex);
 	g_return_val_if_fail (locker != NULL, FALSE);
 	g_debug ("modifying %s", device_id);
-	rc = sqlite3_prepare_v2 (self->db,
-				 "UPDATE history SET "
-				 "metadata = ?1 "
-				 "WHERE device_id = ?2;",
-				 -1, &stmt, NULL);
-	if (rc != SQLITE_OK) {
-		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
-			     "failed to prepare SQL to update history: %s",
-			     sqlite3_errmsg (self->db));
+	stmt = fu_history_stmt_get (self,
+				    "UPDATE history SET "
+				    "metadata = ?1 "
+				    "WHERE device_id = ?2;",
+				    error);
+	if (stmt == NULL)
 		return FALSE;
-	}
 
 
 	/* metadata is stored as a simple string */
@@ -576,43 +660,32 @@ fu_history_set_device_metadata (FuHistory *self,
 	return fu_history_stmt_exec (self, stmt, NULL, error);
 }
 
-/**
- * fu_history_add_device:
- * @self: A #FuHistory
- * @device: A #FuDevice
- * @release: A #FuRelease
- * @error: A #GError or NULL
- *
- * Adds a device to the history database
- *
- * Returns: @TRUE if successful, @FALSE for failure
- *
- * Since: 1.0.4
- **/
-gboolean
-fu_history_add_device (FuHistory *self, FuDevice *device, FwupdRelease *release, GError **error)
+/* db_mutex must be held */
+static gboolean
+fu_history_remove_device_id (FuHistory *self, const gchar *device_id, GError **error)
+{
+	sqlite3_stmt *stmt;
+	stmt = fu_history_stmt_get (self,
+				    "DELETE FROM history WHERE device_id = ?1;",
+				    error);
+	if (stmt == NULL)
+		return FALSE;
+	sqlite3_bind_text (stmt, 1, device_id, -1, SQLITE_STATIC);
+	return fu_history_stmt_exec (self, stmt, NULL, error);
+}
+
+/* db_mutex must be held */
+static gboolean
+fu_history_insert_device (FuHistory *self,
+			  FuDevice *device,
+			  FwupdRelease *release,
+			  GError **error)
 {
 	const gchar *checksum_device;
 	const gchar *checksum = NULL;
-	gint rc;
 	g_autofree gchar *metadata = NULL;
-	g_autoptr(sqlite3_stmt) stmt = NULL;
-	g_autoptr(GRWLockWriterLocker) locker = NULL;
+	sqlite3_stmt *stmt;
 
-	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
-	g_return_val_if_fail (FU_IS_DEVICE (device), FALSE);
-	g_return_val_if_fail (FWUPD_IS_RELEASE (release), FALSE);
-
-	/* lazy load */
-	if (!fu_history_load (self, error))
-		return FALSE;
-
-	/* ensure all old device(s) with this ID are removed */
-	if (!fu_history_remove_device (self, device, error))
-		return FALSE;
-	g_debug ("add device %s [%s]",
-		 fu_device_get_name (device),
-		 fu_device_get_id (device));
 	if (release != NULL) {
 		GPtrArray *checksums = fwupd_release_get_checksums (release);
 		checksum = fwupd_checksum_get_by_kind (checksums, G_CHECKSUM_SHA1);
@@ -624,33 +697,28 @@ fu_history_add_device (FuHistory *self, FuDevice *device, FwupdRelease *release,
 	metadata = _convert_hash_to_string (fwupd_release_get_metadata (release));
 
 	/* add */
-	locker = g_rw_lock_writer_locker_new (&self->db_mutex);
-	g_return_val_if_fail (locker != NULL, FALSE);
-	rc = sqlite3_prepare_v2 (self->db,
-				 "INSERT INTO history (device_id,"
-						      "update_state,"
-						      "update_error,"
-						      "flags,"
-						      "filename,"
-						      "checksum,"
-						      "display_name,"
-						      "plugin,"
-						      "guid_default,"
-						      "metadata,"
-						      "device_created,"
-						      "device_modified,"
-						      "version_old,"
-						      "version_new,"
-						      "checksum_device,"
-						      "protocol) "
-				 "VALUES (?1,?2,?3,?4,?5,?6,?7,?8,?9,?10,"
-					 "?11,?12,?13,?14,?15,?16)", -1, &stmt, NULL);
-	if (rc != SQLITE_OK) {
-		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
-			     "Failed to prepare SQL to insert history: %s",
-			     sqlite3_errmsg (self->db));
+	stmt = fu_history_stmt_get (self,
+				    "INSERT INTO history (device_id,"
+						         "update_state,"
+						         "update_error,"
+						         "flags,"
+						         "filename,"
+						         "checksum,"
+						         "display_name,"
+						         "plugin,"
+						         "guid_default,"
+						         "metadata,"
+						         "device_created,"
+						         "device_modified,"
+						         "version_old,"
+						         "version_new,"
+						         "checksum_device,"
+						         "protocol) "
+				    "VALUES (?1,?2,?3,?4,?5,?6,?7,?8,?9,?10,"
+					    "?11,?12,?13,?14,?15,?16)",
+				    error);
+	if (stmt == NULL)
 		return FALSE;
-	}
 	sqlite3_bind_text (stmt, 1, fu_device_get_id (device), -1, SQLITE_STATIC);
 	sqlite3_bind_int (stmt, 2, fu_device_get_update_state (device));
 	sqlite3_bind_text (stmt, 3, fu_device_get_update_error (device), -1, SQLITE_STATIC);
@@ -670,6 +738,52 @@ fu_history_add_device (FuHistory *self, FuDevice *device, FwupdRelease *release,
 	return fu_history_stmt_exec (self, stmt, NULL, error);
 }
 
+/**
+ * fu_history_add_device:
+ * @self: A #FuHistory
+ * @device: A #FuDevice
+ * @release: A #FuRelease
+ * @error: A #GError or NULL
+ *
+ * Adds a device to the history database
+ *
+ * Returns: @TRUE if successful, @FALSE for failure
+ *
+ * Since: 1.0.4
+ **/
+gboolean
+fu_history_add_device (FuHistory *self, FuDevice *device, FwupdRelease *release, GError **error)
+{
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
+
+	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
+	g_return_val_if_fail (FU_IS_DEVICE (device), FALSE);
+	g_return_val_if_fail (FWUPD_IS_RELEASE (release), FALSE);
+
+	/* lazy load */
+	if (!fu_history_load (self, error))
+		return FALSE;
+
+	/* ensure all old device(s) with this ID are replaced atomically */
+	locker = g_rw_lock_writer_locker_new (&self->db_mutex);
+	g_return_val_if_fail (locker != NULL, FALSE);
+	g_debug ("add device %s [%s]",
+		 fu_device_get_name (device),
+		 fu_device_get_id (device));
+	if (!fu_history_exec (self, "BEGIN IMMEDIATE TRANSACTION;", error))
+		return FALSE;
+	if (!fu_history_remove_device_id (self, fu_device_get_id (device), error) ||
+	    !fu_history_insert_device (self, device, release, error)) {
+		fu_history_exec (self, "ROLLBACK TRANSACTION;", NULL);
+		return FALSE;
+	}
+	if (!fu_history_exec (self, "COMMIT TRANSACTION;", error)) {
+		fu_history_exec (self, "ROLLBACK TRANSACTION;", NULL);
+		return FALSE;
+	}
+	return TRUE;
+}
+
 /**
  * fu_history_remove_all_with_state:
  * @self: A #FuHistory
@@ -688,8 +802,7 @@ fu_history_remove_all_with_state (FuHistory *self,
 				  FwupdUpdateState update_state,
 				  GError **error)
 {
-	gint rc;
-	g_autoptr(sqlite3_stmt) stmt = NULL;
+	sqlite3_stmt *stmt;
 	g_autoptr(GRWLockWriterLocker) locker = NULL;
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
@@ -703,15 +816,11 @@ fu_history_remove_all_with_state (FuHistory *self,
 	g_return_val_if_fail (locker != NULL, FALSE);
 	g_debug ("removing all devices with update_state %s",
 		 fwupd_update_state_to_string (update_state));
-	rc = sqlite3_prepare_v2 (self->db,
-				 "DELETE FROM history WHERE update_state = ?1",
-				 -1, &stmt, NULL);
-	if (rc != SQLITE_OK) {
-		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
-			     "Failed to prepare SQL to delete history: %s",
-			     sqlite3_errmsg (self->db));
+	stmt = fu_history_stmt_get (self,
+				    "DELETE FROM history WHERE update_state = ?1",
+				    error);
+	if (stmt == NULL)
 		return FALSE;
-	}
 	sqlite3_bind_int (stmt, 1, update_state);
 	return fu_history_stmt_exec (self, stmt, NULL, error);
 }
@@ -730,8 +839,7 @@ fu_history_remove_all_with_state (FuHistory *self,
 gboolean
 fu_history_remove_all (FuHistory *self, GError **error)
 {
-	gint rc;
-	g_autoptr(sqlite3_stmt) stmt = NULL;
+	sqlite3_stmt *stmt;
 	g_autoptr(GRWLockWriterLocker) locker = NULL;
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
@@ -744,13 +852,11 @@ fu_history_remove_all (FuHistory *self, GError **error)
 	locker = g_rw_lock_writer_locker_new (&self->db_mutex);
 	g_return_val_if_fail (locker != NULL, FALSE);
 	g_debug ("removing all devices");
-	rc = sqlite3_prepare_v2 (self->db, "DELETE FROM history;", -1, &stmt, NULL);
-	if (rc != SQLITE_OK) {
-		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
-			     "Failed to prepare SQL to delete history: %s",
-			     sqlite3_errmsg (self->db));
+	stmt = fu_history_stmt_get (self,
+				    "DELETE FROM history;",
+				    error);
+	if (stmt == NULL)
 		return FALSE;
-	}
 	return fu_history_stmt_exec (self, stmt, NULL, error);
 }
 
@@ -769,8 +875,6 @@ fu_history_remove_all (FuHistory *self, GError **error)
 gboolean
 fu_history_remove_device (FuHistory *self,  FuDevice *device, GError **error)
 {
-	gint rc;
-	g_autoptr(sqlite3_stmt) stmt = NULL;
 	g_autoptr(GRWLockWriterLocker) locker = NULL;
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
@@ -785,17 +889,7 @@ fu_history_remove_device (FuHistory *self,  FuDevice *device, GError **error)
 	g_debug ("remove device %s [%s]",
 		 fu_device_get_name (device),
 		 fu_device_get_id (device));
-	rc = sqlite3_prepare_v2 (self->db,
-				 "DELETE FROM history WHERE device_id = ?1;",
-				 -1, &stmt, NULL);
-	if (rc != SQLITE_OK) {
-		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
-			     "Failed to prepare SQL to delete history: %s",
-			     sqlite3_errmsg (self->db));
-		return FALSE;
-	}
-	sqlite3_bind_text (stmt, 1, fu_device_get_id (device), -1, SQLITE_STATIC);
-	return fu_history_stmt_exec (self, stmt, NULL, error);
+	return fu_history_remove_device_id (self, fu_device_get_id (device), error);
 }
 
 
@@ -814,10 +908,9 @@ fu_history_remove_device (FuHistory *self,  FuDevice *device, GError **error)
 FuDevice *
 fu_history_get_device_by_id (FuHistory *self, const gchar *device_id, GError **error)
 {
-	gint rc;
 	g_autoptr(GPtrArray) array_tmp = NULL;
-	g_autoptr(sqlite3_stmt) stmt = NULL;
 	g_autoptr(GRWLockReaderLocker) locker = NULL;
+	g_autoptr(sqlite3_stmt) stmt = NULL;
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), NULL);
 	g_return_val_if_fail (device_id != NULL, NULL);
@@ -830,31 +923,28 @@ fu_history_get_device_by_id (FuHistory *self, const gchar *device_id, GError **e
 	locker = g_rw_lock_reader_locker_new (&self->db_mutex);
 	g_return_val_if_fail (locker != NULL, NULL);
 	g_debug ("get device");
-	rc = sqlite3_prepare_v2 (self->db,
-				 "SELECT device_id, "
-					"checksum, "
-					"plugin, "
-					"device_created, "
-					"device_modified, "
-					"display_name, "
-					"filename, "
-					"flags, "
-					"metadata, "
-					"guid_default, "
-					"update_state, "
-					"update_error, "
-					"version_new, "
-					"version_old, "
-					"checksum_device, "
-					"protocol FROM history WHERE "
-				 "device_id = ?1 ORDER BY device_created DESC "
-				 "LIMIT 1", -1, &stmt, NULL);
-	if (rc != SQLITE_OK) {
-		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
-			     "Failed to prepare SQL to get history: %s",
-			     sqlite3_errmsg (self->db));
+	stmt = fu_history_stmt_new (self,
+				    "SELECT device_id, "
+					   "checksum, "
+					   "plugin, "
+					   "device_created, "
+					   "device_modified, "
+					   "display_name, "
+					   "filename, "
+					   "flags, "
+					   "metadata, "
+					   "guid_default, "
+					   "update_state, "
+					   "update_error, "
+					   "version_new, "
+					   "version_old, "
+					   "checksum_device, "
+					   "protocol FROM history WHERE "
+				    "device_id = ?1 ORDER BY device_created DESC "
+				    "LIMIT 1",
+				    error);
+	if (stmt == NULL)
 		return NULL;
-	}
 	sqlite3_bind_text (stmt, 1, device_id, -1, SQLITE_STATIC);
 	array_tmp = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 	if (!fu_history_stmt_exec (self, stmt, array_tmp, error))
@@ -883,10 +973,9 @@ GPtrArray *
 fu_history_get_devices (FuHistory *self, GError **error)
 {
 	GPtrArray *array = NULL;
+	g_autoptr(GRWLockReaderLocker) locker = NULL;
 	g_autoptr(sqlite3_stmt) stmt = NULL;
-	gint rc;
 	g_autoptr(GPtrArray) array_tmp = NULL;
-	g_autoptr(GRWLockReaderLocker) locker = NULL;
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), NULL);
 
@@ -899,31 +988,27 @@ fu_history_get_devices (FuHistory *self, GError **error)
 	/* get all the devices */
 	locker = g_rw_lock_reader_locker_new (&self->db_mutex);
 	g_return_val_if_fail (locker != NULL, NULL);
-	rc = sqlite3_prepare_v2 (self->db,
-				 "SELECT device_id, "
-					"checksum, "
-					"plugin, "
-					"device_created, "
-					"device_modified, "
-					"display_name, "
-					"filename, "
-					"flags, "
-					"metadata, "
-					"guid_default, "
-					"update_state, "
-					"update_error, "
-					"version_new, "
-					"version_old, "
-					"checksum_device, "
-					"protocol FROM history "
-					"ORDER BY device_modified ASC;",
-					-1, &stmt, NULL);
-	if (rc != SQLITE_OK) {
-		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
-			     "Failed to prepare SQL to get history: %s",
-			     sqlite3_errmsg (self->db));
+	stmt = fu_history_stmt_new (self,
+				    "SELECT device_id, "
+					   "checksum, "
+					   "plugin, "
+					   "device_created, "
+					   "device_modified, "
+					   "display_name, "
+					   "filename, "
+					   "flags, "
+					   "metadata, "
+					   "guid_default, "
+					   "update_state, "
+					   "update_error, "
+					   "version_new, "
+					   "version_old, "
+					   "checksum_device, "
+					   "protocol FROM history "
+					   "ORDER BY device_modified ASC;",
+				    error);
+	if (stmt == NULL)
 		return NULL;
-	}
 	array_tmp = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 	if (!fu_history_stmt_exec (self, stmt, array_tmp, error))
 		return NULL;
@@ -931,6 +1016,103 @@ fu_history_get_devices (FuHistory *self, GError **error)
 	return array;
 }
 
+/**
+ * fu_history_get_devices_filtered:
+ * @self: A #FuHistory
+ * @device_id: (nullable): A device ID, or %NULL for any
+ * @plugin: (nullable): A plugin name, or %NULL for any
+ * @since: The earliest modification time in seconds since the epoch, or 0
+ * @until: The latest modification time in seconds since the epoch, or 0
+ * @update_state: A #FwupdUpdateState, or %FWUPD_UPDATE_STATE_UNKNOWN for any
+ * @limit: The maximum number of devices to return, or 0 for no limit
+ * @offset: The number of matching devices to skip
+ * @error: A #GError or NULL
+ *
+ * Gets the devices in the history database that match all of the filters,
+ * ordered by the time they were last modified. The @limit and @offset count
+ * back from the most recently modified device, so that a limit of 5 returns
+ * the last five matching devices.
+ *
+ * Returns: (element-type #FuDevice) (transfer container): devices
+ *
+ * Since: 1.5.0
+ **/
+GPtrArray *
+fu_history_get_devices_filtered (FuHistory *self,
+				 const gchar *device_id,
+				 const gchar *plugin,
+				 guint64 since,
+				 guint64 until,
+				 FwupdUpdateState update_state,
+				 guint limit,
+				 guint offset,
+				 GError **error)
+{
+	g_autoptr(GRWLockReaderLocker) locker = NULL;
+	g_autoptr(sqlite3_stmt) stmt = NULL;
+	g_autoptr(GPtrArray) array = NULL;
+
+	g_return_val_if_fail (FU_IS_HISTORY (self), NULL);
+
+	/* lazy load */
+	if (!fu_history_load (self, error))
+		return NULL;
+
+	/* unset filters are bound as NULL so the SQL is always the same */
+	locker = g_rw_lock_reader_locker_new (&self->db_mutex);
+	g_return_val_if_fail (locker != NULL, NULL);
+	stmt = fu_history_stmt_new (self,
+				    "SELECT device_id, "
+					   "checksum, "
+					   "plugin, "
+					   "device_created, "
+					   "device_modified, "
+					   "display_name, "
+					   "filename, "
+					   "flags, "
+					   "metadata, "
+					   "guid_default, "
+					   "update_state, "
+					   "update_error, "
+					   "version_new, "
+					   "version_old, "
+					   "checksum_device, "
+					   "protocol FROM history WHERE "
+				    "(?1 IS NULL OR device_id = ?1) AND "
+				    "(?2 IS NULL OR plugin = ?2) AND "
+				    "(?3 IS NULL OR device_modified >= ?3) AND "
+				    "(?4 IS NULL OR device_modified <= ?4) AND "
+				    "(?5 IS NULL OR update_state = ?5) "
+				    "ORDER BY device_modified DESC "
+				    "LIMIT ?6 OFFSET ?7;",
+				    error);
+	if (stmt == NULL)
+		return NULL;
+	if (device_id != NULL)
+		sqlite3_bind_text (stmt, 1, device_id, -1, SQLITE_STATIC);
+	if (plugin != NULL)
+		sqlite3_bind_text (stmt, 2, plugin, -1, SQLITE_STATIC);
+	if (since > 0)
+		sqlite3_bind_int64 (stmt, 3, since);
+	if (until > 0)
+		sqlite3_bind_int64 (stmt, 4, until);
+	if (update_state != FWUPD_UPDATE_STATE_UNKNOWN)
+		sqlite3_bind_int (stmt, 5, update_state);
+	sqlite3_bind_int64 (stmt, 6, limit > 0 ? (gint64) limit : -1);
+	sqlite3_bind_int64 (stmt, 7, offset);
+	array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	if (!fu_history_stmt_exec (self, stmt, array, error))
+		return NULL;
+
+	/* show the oldest first */
+	for (guint i = 0; i < array->len / 2; i++) {
+		gpointer tmp = array->pdata[i];
+		array->pdata[i] = array->pdata[array->len - 1 - i];
+		array->pdata[array->len - 1 - i] = tmp;
+	}
+	return g_steal_pointer (&array);
+}
+
 /**
  * fu_history_get_approved_firmware:
  * @self: A #FuHistory
@@ -946,8 +1128,8 @@ GPtrArray *
 fu_history_get_approved_firmware (FuHistory *self, GError **error)
 {
 	gint rc;
-	g_autoptr(GRWLockReaderLocker) locker = NULL;
 	g_autoptr(GPtrArray) array = NULL;
+	g_autoptr(GRWLockReaderLocker) locker = NULL;
 	g_autoptr(sqlite3_stmt) stmt = NULL;
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), NULL);
@@ -961,20 +1143,17 @@ fu_history_get_approved_firmware (FuHistory *self, GError **error)
 	/* get all the approved firmware */
 	locker = g_rw_lock_reader_locker_new (&self->db_mutex);
 	g_return_val_if_fail (locker != NULL, NULL);
-	rc = sqlite3_prepare_v2 (self->db,
-				 "SELECT checksum FROM approved_firmware;",
-				 -1, &stmt, NULL);
-	if (rc != SQLITE_OK) {
-		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
-			     "Failed to prepare SQL to get checksum: %s",
-			     sqlite3_errmsg (self->db));
+	stmt = fu_history_stmt_new (self,
+				    "SELECT checksum FROM approved_firmware;",
+				    error);
+	if (stmt == NULL)
 		return NULL;
-	}
 	array = g_ptr_array_new_with_free_func (g_free);
 	while ((rc = sqlite3_step (stmt)) == SQLITE_ROW) {
 		const gchar *tmp = (const gchar *) sqlite3_column_text (stmt, 0);
 		g_ptr_array_add (array, g_strdup (tmp));
 	}
+	sqlite3_reset (stmt);
 	if (rc != SQLITE_DONE) {
 		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_WRITE,
 			     "failed to execute prepared statement: %s",
@@ -998,8 +1177,7 @@ fu_history_get_approved_firmware (FuHistory *self, GError **error)
 gboolean
 fu_history_clear_approved_firmware (FuHistory *self, GError **error)
 {
-	gint rc;
-	g_autoptr(sqlite3_stmt) stmt = NULL;
+	sqlite3_stmt *stmt;
 	g_autoptr(GRWLockWriterLocker) locker = NULL;
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
@@ -1011,15 +1189,11 @@ fu_history_clear_approved_firmware (FuHistory *self, GError **error)
 	/* remove entries */
 	locker = g_rw_lock_writer_locker_new (&self->db_mutex);
 	g_return_val_if_fail (locker != NULL, FALSE);
-	rc = sqlite3_prepare_v2 (self->db,
-				 "DELETE FROM approved_firmware;",
-				 -1, &stmt, NULL);
-	if (rc != SQLITE_OK) {
-		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
-			     "Failed to prepare SQL to delete approved firmware: %s",
-			     sqlite3_errmsg (self->db));
+	stmt = fu_history_stmt_get (self,
+				    "DELETE FROM approved_firmware;",
+				    error);
+	if (stmt == NULL)
 		return FALSE;
-	}
 	return fu_history_stmt_exec (self, stmt, NULL, error);
 }
 
@@ -1040,8 +1214,7 @@ fu_history_add_approved_firmware (FuHistory *self,
 				  const gchar *checksum,
 				  GError **error)
 {
-	gint rc;
-	g_autoptr(sqlite3_stmt) stmt = NULL;
+	sqlite3_stmt *stmt;
 	g_autoptr(GRWLockWriterLocker) locker = NULL;
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
@@ -1054,15 +1227,12 @@ fu_history_add_approved_firmware (FuHistory *self,
 	/* add */
 	locker = g_rw_lock_writer_locker_new (&self->db_mutex);
 	g_return_val_if_fail (locker != NULL, FALSE);
-	rc = sqlite3_prepare_v2 (self->db,
-				 "INSERT INTO approved_firmware (checksum) "
-				 "VALUES (?1)", -1, &stmt, NULL);
-	if (rc != SQLITE_OK) {
-		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
-			     "Failed to prepare SQL to insert checksum: %s",
-			     sqlite3_errmsg (self->db));
+	stmt = fu_history_stmt_get (self,
+				    "INSERT INTO approved_firmware (checksum) "
+				    "VALUES (?1)",
+				    error);
+	if (stmt == NULL)
 		return FALSE;
-	}
 	sqlite3_bind_text (stmt, 1, checksum, -1, SQLITE_STATIC);
 	return fu_history_stmt_exec (self, stmt, NULL, error);
 }
@@ -1078,6 +1248,8 @@ static void
 fu_history_init (FuHistory *self)
 {
 	g_rw_lock_init (&self->db_mutex);
+	self->stmts = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+					     (GDestroyNotify) sqlite3_finalize);
 }
 
 static void
@@ -1088,7 +1260,8 @@ fu_history_finalize (GObject *object)
 	g_rw_lock_clear (&self->db_mutex);
 
 	if (self->db != NULL)
-		sqlite3_close (self->db);
+		fu_history_close (self);
+	g_hash_table_unref (self->stmts);
 
 	G_OBJECT_CLASS (fu_history_parent_class)->finalize (object);
 }
@@ -39,6 +39,15 @@ FuDevice	*fu_history_get_device_by_id		(FuHistory	*self,
 							 GError		**error);
 GPtrArray	*fu_history_get_devices			(FuHistory	*self,
 							 GError		**error);
+GPtrArray	*fu_history_get_devices_filtered	(FuHistory	*self,
+							 const gchar	*device_id,
+							 const gchar	*plugin,
+							 guint64	 since,
+							 guint64	 until,
+							 FwupdUpdateState update_state,
+							 guint		 limit,
+							 guint		 offset,
+							 GError		**error);
 
 gboolean	 fu_history_clear_approved_firmware	(FuHistory	*self,
 							 GError		**error);
@@ -475,6 +475,50 @@ fu_install_task_compare (FuInstallTask *task1, FuInstallTask *task2)
 	return 0;
 }
 
+static void
+fu_install_task_add_roots (FuInstallTask *self, GPtrArray *roots)
+{
+	FuDevice *proxy = fu_device_get_proxy (self->device);
+	g_ptr_array_add (roots, fu_device_get_root (self->device));
+	if (proxy != NULL)
+		g_ptr_array_add (roots, fu_device_get_root (proxy));
+}
+
+/**
+ * fu_install_task_is_related:
+ * @task1: first #FuInstallTask to compare.
+ * @task2: second #FuInstallTask to compare.
+ *
+ * Checks if the devices of two install tasks share a physical root, either
+ * directly or through a parent or a proxy device. Tasks that are not related
+ * can be installed at the same time.
+ *
+ * Returns: %TRUE if the tasks have to be installed one after the other
+ **/
+gboolean
+fu_install_task_is_related (FuInstallTask *task1, FuInstallTask *task2)
+{
+	g_autoptr(GPtrArray) roots1 = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	g_autoptr(GPtrArray) roots2 = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+
+	g_return_val_if_fail (FU_IS_INSTALL_TASK (task1), TRUE);
+	g_return_val_if_fail (FU_IS_INSTALL_TASK (task2), TRUE);
+
+	/* be conservative */
+	if (task1->device == NULL || task2->device == NULL)
+		return TRUE;
+
+	fu_install_task_add_roots (task1, roots1);
+	fu_install_task_add_roots (task2, roots2);
+	for (guint i = 0; i < roots1->len; i++) {
+		for (guint j = 0; j < roots2->len; j++) {
+			if (g_ptr_array_index (roots1, i) == g_ptr_array_index (roots2, j))
+				return TRUE;
+		}
+	}
+	return FALSE;
+}
+
 /**
  * fu_install_task_new:
  * @device: A #FuDevice
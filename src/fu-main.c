@@ -27,6 +27,7 @@
 
 #include "fu-common.h"
 #include "fu-debug.h"
+#include "fu-device-deltas.h"
 #include "fu-device-private.h"
 #include "fu-engine.h"
 #include "fu-install-task.h"
@@ -47,6 +48,7 @@ typedef struct {
 	GMainLoop		*loop;
 	GFileMonitor		*argv0_monitor;
 	GHashTable		*sender_features;	/* sender:FwupdFeatureFlags */
+	FuDeviceDeltas		*device_deltas;
 #if GLIB_CHECK_VERSION(2,63,3)
 	GMemoryMonitor		*memory_monitor;
 #endif
@@ -65,7 +67,8 @@ fu_main_sigterm_cb (gpointer user_data)
 		g_main_loop_quit (priv->loop);
 		return G_SOURCE_REMOVE;
 	}
-	g_warning ("Received SIGTERM during a firmware update, ignoring");
+	g_warning ("Received SIGTERM during a firmware update, cancelling");
+	fu_engine_cancel_install (priv->engine);
 	priv->pending_sigterm = TRUE;
 	return G_SOURCE_CONTINUE;
 }
@@ -89,12 +92,15 @@ fu_main_engine_device_added_cb (FuEngine *engine,
 				FuDevice *device,
 				FuMainPrivate *priv)
 {
-	GVariant *val;
+	g_autoptr(GVariant) val = NULL;
+
+	fu_device_deltas_add (priv->device_deltas, device);
 
 	/* not yet connected */
 	if (priv->connection == NULL)
 		return;
-	val = fwupd_device_to_variant (FWUPD_DEVICE (device));
+	val = fwupd_device_to_variant_cached (FWUPD_DEVICE (device),
+					      FWUPD_DEVICE_FLAG_NONE);
 	g_dbus_connection_emit_signal (priv->connection,
 				       NULL,
 				       FWUPD_DBUS_PATH,
@@ -108,12 +114,15 @@ fu_main_engine_device_removed_cb (FuEngine *engine,
 				  FuDevice *device,
 				  FuMainPrivate *priv)
 {
-	GVariant *val;
+	g_autoptr(GVariant) val = NULL;
+
+	fu_device_deltas_remove (priv->device_deltas, device);
 
 	/* not yet connected */
 	if (priv->connection == NULL)
 		return;
-	val = fwupd_device_to_variant (FWUPD_DEVICE (device));
+	val = fwupd_device_to_variant_cached (FWUPD_DEVICE (device),
+					      FWUPD_DEVICE_FLAG_NONE);
 	g_dbus_connection_emit_signal (priv->connection,
 				       NULL,
 				       FWUPD_DBUS_PATH,
@@ -127,12 +136,43 @@ fu_main_engine_device_changed_cb (FuEngine *engine,
 				  FuDevice *device,
 				  FuMainPrivate *priv)
 {
-	GVariant *val;
+	fu_device_deltas_changed (priv->device_deltas, device);
+}
+
+/* only the keys that are different from the last notification are sent */
+static void
+fu_main_device_deltas_changed_delta_cb (FuDeviceDeltas *device_deltas,
+					FuDevice *device,
+					guint64 seq,
+					GVariant *changed,
+					GVariant *removed,
+					FuMainPrivate *priv)
+{
+	/* not yet connected */
+	if (priv->connection == NULL)
+		return;
+	g_dbus_connection_emit_signal (priv->connection,
+				       NULL,
+				       FWUPD_DBUS_PATH,
+				       FWUPD_DBUS_INTERFACE,
+				       "DeviceChangedDelta",
+				       g_variant_new ("(st@a{sv}@as)",
+						      fu_device_get_id (device),
+						      seq,
+						      changed,
+						      removed),
+				       NULL);
+}
 
+static void
+fu_main_device_deltas_changed_cb (FuDeviceDeltas *device_deltas,
+				  FuDevice *device,
+				  GVariant *val,
+				  FuMainPrivate *priv)
+{
 	/* not yet connected */
 	if (priv->connection == NULL)
 		return;
-	val = fwupd_device_to_variant (FWUPD_DEVICE (device));
 	g_dbus_connection_emit_signal (priv->connection,
 				       NULL,
 				       FWUPD_DBUS_PATH,
@@ -255,8 +295,9 @@ fu_main_device_array_to_variant (FuMainPrivate *priv, FuEngineRequest *request,
 
 	for (guint i = 0; i < devices->len; i++) {
 		FuDevice *device = g_ptr_array_index (devices, i);
-		GVariant *tmp = fwupd_device_to_variant_full (FWUPD_DEVICE (device),
-							      fu_engine_request_get_device_flags (request));
+		g_autoptr(GVariant) tmp = NULL;
+		tmp = fwupd_device_to_variant_cached (FWUPD_DEVICE (device),
+						      fu_engine_request_get_device_flags (request));
 		g_variant_builder_add_value (&builder, tmp);
 	}
 	return g_variant_new ("(aa{sv})", &builder);
@@ -608,6 +649,16 @@ fu_main_authorize_install_queue (FuMainAuthHelper *helper_ref)
 		return;
 	}
 
+	/* the main loop is still running when writing in a worker thread */
+	if (priv->update_in_progress) {
+		g_set_error_literal (&error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_ALREADY_PENDING,
+				     "an update is already in progress");
+		g_dbus_method_invocation_return_gerror (helper->invocation, error);
+		return;
+	}
+
 	/* all authenticated, so install all the things */
 	priv->update_in_progress = TRUE;
 	ret = fu_engine_install_tasks (helper->priv->engine,
@@ -704,6 +755,7 @@ fu_main_install_with_helper (FuMainAuthHelper *helper_ref, GError **error)
 	g_autoptr(GPtrArray) errors = NULL;
 
 	/* get a list of devices that in some way match the device_id */
+	fu_engine_revalidate (priv->engine);
 	if (g_strcmp0 (helper->device_id, FWUPD_DEVICE_ID_ANY) == 0) {
 		devices_possible = fu_engine_get_devices (priv->engine, error);
 		if (devices_possible == NULL)
@@ -810,6 +862,45 @@ fu_main_device_id_valid (const gchar *device_id, GError **error)
 	return FALSE;
 }
 
+/* firmware may be written from a worker thread while the main loop is
+ * running; the device state is only ever changed in the main thread so it can
+ * still be read, but nothing else may change the devices or metadata */
+static gboolean
+fu_main_method_modifies_devices (const gchar *method_name)
+{
+	const gchar *method_names[] = {
+		"Activate",
+		"ClearResults",
+		"Install",
+		"ModifyConfig",
+		"ModifyDevice",
+		"ModifyRemote",
+		"Unlock",
+		"UpdateMetadata",
+		"VerifyUpdate",
+		NULL };
+	return g_strv_contains (method_names, method_name);
+}
+
+/* the hardware cannot be read while firmware is being written to it */
+static gboolean
+fu_main_device_is_idle (FuMainPrivate *priv, const gchar *device_id, GError **error)
+{
+	g_autoptr(FuDevice) device = NULL;
+	device = fu_engine_get_device (priv->engine, device_id, error);
+	if (device == NULL)
+		return FALSE;
+	if (fu_device_get_status (device) != FWUPD_STATUS_IDLE) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_ALREADY_PENDING,
+			     "%s is being updated",
+			     fu_device_get_id (device));
+		return FALSE;
+	}
+	return TRUE;
+}
+
 static void
 fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 			    const gchar *object_path, const gchar *interface_name,
@@ -831,6 +922,17 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 	/* activity */
 	fu_engine_idle_reset (priv->engine);
 
+	/* not safe */
+	if (priv->update_in_progress && fu_main_method_modifies_devices (method_name)) {
+		g_set_error (&error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_ALREADY_PENDING,
+			     "cannot call %s() while an update is in progress",
+			     method_name);
+		g_dbus_method_invocation_return_gerror (invocation, error);
+		return;
+	}
+
 	if (g_strcmp0 (method_name, "GetDevices") == 0) {
 		g_autoptr(GPtrArray) devices = NULL;
 		g_debug ("Called %s()", method_name);
@@ -878,6 +980,19 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 						       g_variant_new_tuple (&val, 1));
 		return;
 	}
+	if (g_strcmp0 (method_name, "GetStartupProfile") == 0) {
+		FuProfile *profile = fu_engine_get_profile (priv->engine);
+		g_autofree gchar *json = NULL;
+		g_debug ("Called %s()", method_name);
+		json = fu_profile_to_json (profile, &error);
+		if (json == NULL) {
+			g_dbus_method_invocation_return_gerror (invocation, error);
+			return;
+		}
+		g_dbus_method_invocation_return_value (invocation,
+						       g_variant_new ("(s)", json));
+		return;
+	}
 	if (g_strcmp0 (method_name, "GetReportMetadata") == 0) {
 		GHashTableIter iter;
 		GVariantBuilder builder;
@@ -1008,6 +1123,47 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 		g_dbus_method_invocation_return_value (invocation, val);
 		return;
 	}
+	if (g_strcmp0 (method_name, "GetUpgradesAll") == 0) {
+		GHashTableIter iter;
+		GPtrArray *releases;
+		GVariantBuilder builder;
+		GVariantBuilder builder_reasons;
+		const gchar *device_id;
+		const gchar *reason;
+		g_autoptr(GHashTable) reasons = NULL;
+		g_autoptr(GHashTable) upgrades = NULL;
+
+		g_debug ("Called %s()", method_name);
+		upgrades = fu_engine_get_upgrades_all (priv->engine, request,
+						       &reasons, &error);
+		if (upgrades == NULL) {
+			g_dbus_method_invocation_return_gerror (invocation, error);
+			return;
+		}
+		g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{saa{sv}}"));
+		g_hash_table_iter_init (&iter, upgrades);
+		while (g_hash_table_iter_next (&iter,
+					       (gpointer *) &device_id,
+					       (gpointer *) &releases)) {
+			GVariantBuilder builder_rels;
+			g_variant_builder_init (&builder_rels, G_VARIANT_TYPE ("aa{sv}"));
+			for (guint i = 0; i < releases->len; i++) {
+				FwupdRelease *rel = g_ptr_array_index (releases, i);
+				g_variant_builder_add_value (&builder_rels,
+							     fwupd_release_to_variant (rel));
+			}
+			g_variant_builder_add (&builder, "{saa{sv}}", device_id, &builder_rels);
+		}
+		g_variant_builder_init (&builder_reasons, G_VARIANT_TYPE ("a{ss}"));
+		g_hash_table_iter_init (&iter, reasons);
+		while (g_hash_table_iter_next (&iter,
+					       (gpointer *) &device_id,
+					       (gpointer *) &reason))
+			g_variant_builder_add (&builder_reasons, "{ss}", device_id, reason);
+		val = g_variant_new ("(a{saa{sv}}a{ss})", &builder, &builder_reasons);
+		g_dbus_method_invocation_return_value (invocation, val);
+		return;
+	}
 	if (g_strcmp0 (method_name, "GetRemotes") == 0) {
 		g_autoptr(GPtrArray) remotes = NULL;
 		g_debug ("Called %s()", method_name);
@@ -1036,6 +1192,47 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 		g_dbus_method_invocation_return_value (invocation, val);
 		return;
 	}
+	if (g_strcmp0 (method_name, "GetHistoryFiltered") == 0) {
+		const gchar *device_id = NULL;
+		const gchar *plugin = NULL;
+		guint64 since = 0;
+		guint64 until = 0;
+		guint32 update_state = FWUPD_UPDATE_STATE_UNKNOWN;
+		guint32 limit = 0;
+		guint32 offset = 0;
+		g_autoptr(GPtrArray) devices = NULL;
+		g_autoptr(GVariant) options = NULL;
+
+		g_variant_get (parameters, "(@a{sv})", &options);
+		g_variant_lookup (options, "device-id", "&s", &device_id);
+		g_variant_lookup (options, "plugin", "&s", &plugin);
+		g_variant_lookup (options, "since", "t", &since);
+		g_variant_lookup (options, "until", "t", &until);
+		g_variant_lookup (options, "update-state", "u", &update_state);
+		g_variant_lookup (options, "limit", "u", &limit);
+		g_variant_lookup (options, "offset", "u", &offset);
+		g_debug ("Called %s(limit=%u,offset=%u)", method_name, limit, offset);
+		devices = fu_engine_get_history_filtered (priv->engine,
+							  device_id,
+							  plugin,
+							  since,
+							  until,
+							  update_state,
+							  limit,
+							  offset,
+							  &error);
+		if (devices == NULL) {
+			g_dbus_method_invocation_return_gerror (invocation, error);
+			return;
+		}
+		val = fu_main_device_array_to_variant (priv, request, devices, &error);
+		if (val == NULL) {
+			g_dbus_method_invocation_return_gerror (invocation, error);
+			return;
+		}
+		g_dbus_method_invocation_return_value (invocation, val);
+		return;
+	}
 	if (g_strcmp0 (method_name, "GetHostSecurityAttrs") == 0) {
 		g_autoptr(FuSecurityAttrs) attrs = NULL;
 		g_debug ("Called %s()", method_name);
@@ -1287,6 +1484,11 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 			g_dbus_method_invocation_return_gerror (invocation, error);
 			return;
 		}
+		if (priv->update_in_progress &&
+		    !fu_main_device_is_idle (priv, device_id, &error)) {
+			g_dbus_method_invocation_return_gerror (invocation, error);
+			return;
+		}
 		if (!fu_engine_verify (priv->engine, device_id, &error)) {
 			g_dbus_method_invocation_return_gerror (invocation, error);
 			return;
@@ -1312,7 +1514,6 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 		gchar *prop_key;
 		gint32 fd_handle = 0;
 		gint fd;
-		guint64 archive_size_max;
 		GDBusMessage *message;
 		GUnixFDList *fd_list;
 		g_autoptr(FuMainAuthHelper) helper = NULL;
@@ -1375,8 +1576,7 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 		/* parse the cab file before authenticating so we can work out
 		 * what action ID to use, for instance, if this is trusted --
 		 * this will also close the fd when done */
-		archive_size_max = fu_engine_get_archive_size_max (priv->engine);
-		helper->blob_cab = fu_common_get_contents_fd (fd, archive_size_max, &error);
+		helper->blob_cab = fu_engine_get_blob_from_fd (priv->engine, fd, &error);
 		if (helper->blob_cab == NULL) {
 			g_dbus_method_invocation_return_gerror (invocation, error);
 			return;
@@ -1600,6 +1800,7 @@ static void
 fu_main_private_free (FuMainPrivate *priv)
 {
 	g_hash_table_unref (priv->sender_features);
+	g_object_unref (priv->device_deltas);
 	if (priv->loop != NULL)
 		g_main_loop_unref (priv->loop);
 	if (priv->owner_id > 0)
@@ -1668,6 +1869,13 @@ main (int argc, char *argv[])
 	/* create new objects */
 	priv = g_new0 (FuMainPrivate, 1);
 	priv->sender_features = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	priv->device_deltas = fu_device_deltas_new ();
+	g_signal_connect (priv->device_deltas, "changed-delta",
+			  G_CALLBACK (fu_main_device_deltas_changed_delta_cb),
+			  priv);
+	g_signal_connect (priv->device_deltas, "changed",
+			  G_CALLBACK (fu_main_device_deltas_changed_cb),
+			  priv);
 	priv->loop = g_main_loop_new (NULL, FALSE);
 
 	/* load engine */
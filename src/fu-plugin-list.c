@@ -106,6 +106,72 @@ fu_plugin_list_find_by_name (FuPluginList *self, const gchar *name, GError **err
 	return NULL;
 }
 
+static void
+fu_plugin_list_add_depend (GPtrArray *depends, FuPlugin *plugin, FuPlugin *dep)
+{
+	if (dep == plugin)
+		return;
+	if (!fu_plugin_get_enabled (dep))
+		return;
+	if (fu_plugin_get_order (dep) >= fu_plugin_get_order (plugin))
+		return;
+	for (guint i = 0; i < depends->len; i++) {
+		if (g_ptr_array_index (depends, i) == dep)
+			return;
+	}
+	g_ptr_array_add (depends, g_object_ref (dep));
+}
+
+/**
+ * fu_plugin_list_get_depends:
+ * @self: A #FuPluginList
+ * @plugin: A #FuPlugin
+ *
+ * Gets the enabled plugins that have to be run before @plugin. This uses the
+ * run-after rules of @plugin and the run-before rules of every other plugin,
+ * and so fu_plugin_list_depsolve() should have been called first.
+ *
+ * Returns: (transfer container) (element-type FuPlugin): plugins
+ *
+ * Since: 1.5.0
+ **/
+GPtrArray *
+fu_plugin_list_get_depends (FuPluginList *self, FuPlugin *plugin)
+{
+	GPtrArray *deps;
+	GPtrArray *depends = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+
+	g_return_val_if_fail (FU_IS_PLUGIN_LIST (self), NULL);
+	g_return_val_if_fail (FU_IS_PLUGIN (plugin), NULL);
+
+	/* plugin has to run after these */
+	deps = fu_plugin_get_rules (plugin, FU_PLUGIN_RULE_RUN_AFTER);
+	if (deps != NULL) {
+		for (guint j = 0; j < deps->len; j++) {
+			const gchar *plugin_name = g_ptr_array_index (deps, j);
+			FuPlugin *dep = g_hash_table_lookup (self->plugins_hash, plugin_name);
+			if (dep != NULL)
+				fu_plugin_list_add_depend (depends, plugin, dep);
+		}
+	}
+
+	/* other plugins have to run before this one */
+	for (guint i = 0; i < self->plugins->len; i++) {
+		FuPlugin *dep = g_ptr_array_index (self->plugins, i);
+		deps = fu_plugin_get_rules (dep, FU_PLUGIN_RULE_RUN_BEFORE);
+		if (deps == NULL)
+			continue;
+		for (guint j = 0; j < deps->len; j++) {
+			const gchar *plugin_name = g_ptr_array_index (deps, j);
+			if (g_strcmp0 (plugin_name, fu_plugin_get_name (plugin)) == 0) {
+				fu_plugin_list_add_depend (depends, plugin, dep);
+				break;
+			}
+		}
+	}
+	return depends;
+}
+
 static gint
 fu_plugin_list_sort_cb (gconstpointer a, gconstpointer b)
 {
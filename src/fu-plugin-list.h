@@ -20,5 +20,7 @@ GPtrArray	*fu_plugin_list_get_all			(FuPluginList	*self);
 FuPlugin	*fu_plugin_list_find_by_name		(FuPluginList	*self,
 							 const gchar	*name,
 							 GError		**error);
+GPtrArray	*fu_plugin_list_get_depends		(FuPluginList	*self,
+							 FuPlugin	*plugin);
 gboolean	 fu_plugin_list_depsolve		(FuPluginList	*self,
 							 GError		**error);
@@ -0,0 +1,363 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#define G_LOG_DOMAIN				"FuProfile"
+
+#include "config.h"
+
+#include <json-glib/json-glib.h>
+#include <unistd.h>
+
+#include "fu-profile.h"
+
+/**
+ * SECTION:fu-profile
+ * @short_description: a hierarchical span profiler
+ *
+ * Records nested, named spans of wall-clock time so that slow startup phases
+ * can be identified. Spans are tracked per-thread so that plugins running
+ * concurrently do not corrupt each others nesting, and the result can be
+ * exported in the Chrome trace-event format for viewing in a trace viewer.
+ */
+
+static void fu_profile_finalize	 (GObject *obj);
+
+typedef struct {
+	gchar			*name;
+	gint64			 begin;		/* µs since the profile was created */
+	gint64			 end;		/* or -1 if still open */
+	guint			 tid;
+	guint			 depth;
+} FuProfileSpan;
+
+typedef struct {
+	guint			 tid;
+	GPtrArray		*stack;		/* of FuProfileSpan, not owned */
+} FuProfileThread;
+
+struct _FuProfile
+{
+	GObject			 parent_instance;
+	GPtrArray		*spans;		/* of FuProfileSpan, in push order */
+	GHashTable		*threads;	/* of GThread:FuProfileThread */
+	gint64			 epoch;
+	gboolean		 enabled;
+	GMutex			 mutex;
+};
+
+G_DEFINE_TYPE (FuProfile, fu_profile, G_TYPE_OBJECT)
+
+static void
+fu_profile_span_free (FuProfileSpan *span)
+{
+	g_free (span->name);
+	g_free (span);
+}
+
+static void
+fu_profile_thread_free (FuProfileThread *thread)
+{
+	g_ptr_array_unref (thread->stack);
+	g_free (thread);
+}
+
+/* called with the mutex held */
+static FuProfileThread *
+fu_profile_get_thread (FuProfile *self)
+{
+	GThread *key = g_thread_self ();
+	FuProfileThread *thread = g_hash_table_lookup (self->threads, key);
+	if (thread == NULL) {
+		thread = g_new0 (FuProfileThread, 1);
+		thread->tid = g_hash_table_size (self->threads) + 1;
+		thread->stack = g_ptr_array_new ();
+		g_hash_table_insert (self->threads, key, thread);
+	}
+	return thread;
+}
+
+/**
+ * fu_profile_set_enabled:
+ * @self: A #FuProfile
+ * @enabled: boolean
+ *
+ * Enables or disables recording new spans. Spans that are already open can
+ * still be closed when the profile is disabled.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_profile_set_enabled (FuProfile *self, gboolean enabled)
+{
+	g_return_if_fail (FU_IS_PROFILE (self));
+	self->enabled = enabled;
+}
+
+/**
+ * fu_profile_get_enabled:
+ * @self: A #FuProfile
+ *
+ * Gets if new spans are being recorded.
+ *
+ * Returns: boolean
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_profile_get_enabled (FuProfile *self)
+{
+	g_return_val_if_fail (FU_IS_PROFILE (self), FALSE);
+	return self->enabled;
+}
+
+/**
+ * fu_profile_push:
+ * @self: A #FuProfile
+ * @fmt: a printf-style span name
+ *
+ * Opens a new span as a child of the current span on this thread.
+ * Every call to this function must be balanced with fu_profile_pop().
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_profile_push (FuProfile *self, const gchar *fmt, ...)
+{
+	FuProfileSpan *span;
+	FuProfileThread *thread;
+	va_list args;
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_if_fail (FU_IS_PROFILE (self));
+	g_return_if_fail (fmt != NULL);
+
+	locker = g_mutex_locker_new (&self->mutex);
+	thread = fu_profile_get_thread (self);
+
+	/* still push a placeholder so that push and pop stay balanced */
+	if (!self->enabled) {
+		g_ptr_array_add (thread->stack, NULL);
+		return;
+	}
+
+	span = g_new0 (FuProfileSpan, 1);
+	va_start (args, fmt);
+	span->name = g_strdup_vprintf (fmt, args);
+	va_end (args);
+	span->begin = g_get_monotonic_time () - self->epoch;
+	span->end = -1;
+	span->tid = thread->tid;
+	span->depth = thread->stack->len;
+	g_ptr_array_add (self->spans, span);
+	g_ptr_array_add (thread->stack, span);
+}
+
+/**
+ * fu_profile_pop:
+ * @self: A #FuProfile
+ *
+ * Closes the most recently opened span on this thread.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_profile_pop (FuProfile *self)
+{
+	FuProfileSpan *span;
+	FuProfileThread *thread;
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_if_fail (FU_IS_PROFILE (self));
+
+	locker = g_mutex_locker_new (&self->mutex);
+	thread = fu_profile_get_thread (self);
+	if (thread->stack->len == 0) {
+		g_critical ("profile pop without matching push");
+		return;
+	}
+	span = g_ptr_array_index (thread->stack, thread->stack->len - 1);
+	g_ptr_array_remove_index (thread->stack, thread->stack->len - 1);
+	if (span != NULL)
+		span->end = g_get_monotonic_time () - self->epoch;
+}
+
+/**
+ * fu_profile_get_size:
+ * @self: A #FuProfile
+ *
+ * Gets the number of recorded spans.
+ *
+ * Returns: integer
+ *
+ * Since: 1.5.0
+ **/
+guint
+fu_profile_get_size (FuProfile *self)
+{
+	g_autoptr(GMutexLocker) locker = NULL;
+	g_return_val_if_fail (FU_IS_PROFILE (self), 0);
+	locker = g_mutex_locker_new (&self->mutex);
+	return self->spans->len;
+}
+
+static gint64
+fu_profile_span_get_duration (FuProfileSpan *span)
+{
+	if (span->end < 0)
+		return 0;
+	return span->end - span->begin;
+}
+
+/**
+ * fu_profile_to_string:
+ * @self: A #FuProfile
+ *
+ * Exports the spans as an indented tree suitable for debugging.
+ *
+ * Returns: (transfer full): string
+ *
+ * Since: 1.5.0
+ **/
+gchar *
+fu_profile_to_string (FuProfile *self)
+{
+	GString *str = g_string_new (NULL);
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_val_if_fail (FU_IS_PROFILE (self), NULL);
+
+	locker = g_mutex_locker_new (&self->mutex);
+	for (guint i = 0; i < self->spans->len; i++) {
+		FuProfileSpan *span = g_ptr_array_index (self->spans, i);
+		for (guint j = 0; j < span->depth; j++)
+			g_string_append (str, "  ");
+		g_string_append_printf (str, "%s", span->name);
+		if (span->tid > 1)
+			g_string_append_printf (str, " [%u]", span->tid);
+		if (span->end < 0) {
+			g_string_append (str, ": unfinished\n");
+			continue;
+		}
+		g_string_append_printf (str, ": %.1fms\n",
+					(gdouble) fu_profile_span_get_duration (span) / 1000.f);
+	}
+	return g_string_free (str, FALSE);
+}
+
+/**
+ * fu_profile_to_json:
+ * @self: A #FuProfile
+ * @error: A #GError, or %NULL
+ *
+ * Exports the spans in the Chrome trace-event format, which can be loaded
+ * into chrome://tracing or Perfetto.
+ *
+ * Returns: (transfer full): JSON data, or %NULL for error
+ *
+ * Since: 1.5.0
+ **/
+gchar *
+fu_profile_to_json (FuProfile *self, GError **error)
+{
+	gint64 pid = getpid ();
+	g_autofree gchar *data = NULL;
+	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(JsonBuilder) builder = json_builder_new ();
+	g_autoptr(JsonGenerator) json_generator = NULL;
+	g_autoptr(JsonNode) json_root = NULL;
+
+	g_return_val_if_fail (FU_IS_PROFILE (self), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	locker = g_mutex_locker_new (&self->mutex);
+	json_builder_begin_object (builder);
+	json_builder_set_member_name (builder, "displayTimeUnit");
+	json_builder_add_string_value (builder, "ms");
+	json_builder_set_member_name (builder, "traceEvents");
+	json_builder_begin_array (builder);
+	for (guint i = 0; i < self->spans->len; i++) {
+		FuProfileSpan *span = g_ptr_array_index (self->spans, i);
+		if (span->end < 0)
+			continue;
+		json_builder_begin_object (builder);
+		json_builder_set_member_name (builder, "name");
+		json_builder_add_string_value (builder, span->name);
+		json_builder_set_member_name (builder, "cat");
+		json_builder_add_string_value (builder, "fwupd");
+		json_builder_set_member_name (builder, "ph");
+		json_builder_add_string_value (builder, "X");
+		json_builder_set_member_name (builder, "ts");
+		json_builder_add_int_value (builder, span->begin);
+		json_builder_set_member_name (builder, "dur");
+		json_builder_add_int_value (builder, fu_profile_span_get_duration (span));
+		json_builder_set_member_name (builder, "pid");
+		json_builder_add_int_value (builder, pid);
+		json_builder_set_member_name (builder, "tid");
+		json_builder_add_int_value (builder, span->tid);
+		json_builder_end_object (builder);
+	}
+	json_builder_end_array (builder);
+	json_builder_end_object (builder);
+	g_clear_pointer (&locker, g_mutex_locker_free);
+
+	/* export as a string */
+	json_root = json_builder_get_root (builder);
+	json_generator = json_generator_new ();
+	json_generator_set_pretty (json_generator, TRUE);
+	json_generator_set_root (json_generator, json_root);
+	data = json_generator_to_data (json_generator, NULL);
+	if (data == NULL) {
+		g_set_error_literal (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_INVALID_DATA,
+				     "Failed to convert profile to JSON");
+		return NULL;
+	}
+	return g_steal_pointer (&data);
+}
+
+static void
+fu_profile_class_init (FuProfileClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = fu_profile_finalize;
+}
+
+static void
+fu_profile_init (FuProfile *self)
+{
+	self->enabled = TRUE;
+	self->epoch = g_get_monotonic_time ();
+	self->spans = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_profile_span_free);
+	self->threads = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+					       NULL, (GDestroyNotify) fu_profile_thread_free);
+	g_mutex_init (&self->mutex);
+}
+
+static void
+fu_profile_finalize (GObject *obj)
+{
+	FuProfile *self = FU_PROFILE (obj);
+	g_ptr_array_unref (self->spans);
+	g_hash_table_unref (self->threads);
+	g_mutex_clear (&self->mutex);
+	G_OBJECT_CLASS (fu_profile_parent_class)->finalize (obj);
+}
+
+/**
+ * fu_profile_new:
+ *
+ * Creates a new #FuProfile, using the current time as the epoch.
+ *
+ * Returns: (transfer full): a #FuProfile
+ *
+ * Since: 1.5.0
+ **/
+FuProfile *
+fu_profile_new (void)
+{
+	return FU_PROFILE (g_object_new (FU_TYPE_PROFILE, NULL));
+}
@@ -0,0 +1,26 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#pragma once
+
+#include <glib-object.h>
+
+#define FU_TYPE_PROFILE (fu_profile_get_type ())
+G_DECLARE_FINAL_TYPE (FuProfile, fu_profile, FU, PROFILE, GObject)
+
+FuProfile	*fu_profile_new			(void);
+void		 fu_profile_set_enabled		(FuProfile	*self,
+						 gboolean	 enabled);
+gboolean	 fu_profile_get_enabled		(FuProfile	*self);
+void		 fu_profile_push		(FuProfile	*self,
+						 const gchar	*fmt,
+						 ...)
+						 G_GNUC_PRINTF (2, 3);
+void		 fu_profile_pop			(FuProfile	*self);
+guint		 fu_profile_get_size		(FuProfile	*self);
+gchar		*fu_profile_to_string		(FuProfile	*self);
+gchar		*fu_profile_to_json		(FuProfile	*self,
+						 GError		**error);
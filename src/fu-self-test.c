@@ -16,6 +16,8 @@
 #include <string.h>
 
 #include "fu-config.h"
+#include "fu-device-cache.h"
+#include "fu-device-deltas.h"
 #include "fu-device-list.h"
 #include "fu-device-private.h"
 #include "fu-engine.h"
@@ -23,6 +25,7 @@
 #include "fu-install-task.h"
 #include "fu-plugin-private.h"
 #include "fu-plugin-list.h"
+#include "fu-profile.h"
 #include "fu-progressbar.h"
 #include "fu-hash.h"
 #include "fu-security-attr.h"
@@ -117,10 +120,12 @@ fu_engine_generate_md_func (gconstpointer user_data)
 	gboolean ret;
 	g_autofree gchar *filename = NULL;
 	g_autoptr(FuDevice) device = fu_device_new ();
+	g_autoptr(FuDevice) device2 = fu_device_new ();
 	g_autoptr(FuEngine) engine = fu_engine_new (FU_APP_FLAGS_NONE);
 	g_autoptr(GBytes) data = NULL;
 	g_autoptr(GError) error = NULL;
 	g_autoptr(XbNode) component = NULL;
+	g_autoptr(XbNode) component2 = NULL;
 
 	/* put cab file somewhere we can parse it */
 	filename = g_build_filename (TESTDATADIR_DST, "colorhug", "colorhug-als-3.0.2.cab", NULL);
@@ -151,6 +156,14 @@ fu_engine_generate_md_func (gconstpointer user_data)
 	g_assert_cmpstr (tmp, !=, NULL);
 	tmp = xb_node_query_text (component, "releases/release/checksum[@target='content']", NULL);
 	g_assert_cmpstr (tmp, ==, NULL);
+
+	/* any of the device GUIDs can match */
+	fu_device_add_guid (device2, "00000000-0000-0000-0000-000000000000");
+	component2 = fu_engine_get_component_by_guids (engine, device2);
+	g_assert_null (component2);
+	fu_device_add_guid (device2, "12345678-1234-1234-1234-123456789012");
+	component2 = fu_engine_get_component_by_guids (engine, device2);
+	g_assert_nonnull (component2);
 }
 
 static void
@@ -1198,6 +1211,53 @@ fu_engine_device_unlock_func (gconstpointer user_data)
 	g_assert_nonnull (fwupd_device_get_release_default (FWUPD_DEVICE (device)));
 }
 
+static void
+fu_engine_component_order_func (gconstpointer user_data)
+{
+	gboolean ret;
+	const gchar *xml =
+		"<components>"
+		"  <component type=\"firmware\">"
+		"    <id>com.acme.first.firmware</id>"
+		"    <provides>"
+		"      <firmware type=\"flashed\">aaaaaaaa-aaaa-aaaa-aaaa-aaaaaaaaaaaa</firmware>"
+		"    </provides>"
+		"  </component>"
+		"  <component type=\"firmware\">"
+		"    <id>com.acme.second.firmware</id>"
+		"    <provides>"
+		"      <firmware type=\"flashed\">bbbbbbbb-bbbb-bbbb-bbbb-bbbbbbbbbbbb</firmware>"
+		"    </provides>"
+		"  </component>"
+		"</components>";
+	g_autoptr(FuDevice) device = fu_device_new ();
+	g_autoptr(FuEngine) engine = fu_engine_new (FU_APP_FLAGS_NONE);
+	g_autoptr(GError) error = NULL;
+	g_autoptr(XbBuilder) builder = xb_builder_new ();
+	g_autoptr(XbBuilderSource) source = xb_builder_source_new ();
+	g_autoptr(XbNode) component = NULL;
+	g_autoptr(XbSilo) silo = NULL;
+
+	ret = xb_builder_source_load_xml (source, xml,
+					  XB_BUILDER_SOURCE_FLAG_NONE,
+					  &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	xb_builder_import_source (builder, source);
+	silo = xb_builder_compile (builder, XB_BUILDER_COMPILE_FLAG_NONE, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (silo);
+	fu_engine_set_silo (engine, silo);
+
+	/* the first component in the metadata wins, not the first device GUID */
+	fu_device_add_guid (device, "bbbbbbbb-bbbb-bbbb-bbbb-bbbbbbbbbbbb");
+	fu_device_add_guid (device, "aaaaaaaa-aaaa-aaaa-aaaa-aaaaaaaaaaaa");
+	component = fu_engine_get_component_by_guids (engine, device);
+	g_assert_nonnull (component);
+	g_assert_cmpstr (xb_node_query_text (component, "id", NULL), ==,
+			 "com.acme.first.firmware");
+}
+
 static void
 fu_engine_require_hwid_func (gconstpointer user_data)
 {
@@ -1267,11 +1327,14 @@ static void
 fu_engine_downgrade_func (gconstpointer user_data)
 {
 	FwupdRelease *rel;
+	GPtrArray *releases_all;
 	gboolean ret;
 	g_autoptr(FuDevice) device = fu_device_new ();
 	g_autoptr(FuEngine) engine = fu_engine_new (FU_APP_FLAGS_NONE);
 	g_autoptr(FuEngineRequest) request = fu_engine_request_new ();
 	g_autoptr(GError) error = NULL;
+	g_autoptr(GHashTable) reasons_all = NULL;
+	g_autoptr(GHashTable) upgrades_all = NULL;
 	g_autoptr(GPtrArray) devices = NULL;
 	g_autoptr(GPtrArray) devices_pre = NULL;
 	g_autoptr(GPtrArray) releases_dg = NULL;
@@ -1425,6 +1488,17 @@ fu_engine_downgrade_func (gconstpointer user_data)
 	rel = FWUPD_RELEASE (g_ptr_array_index (releases_up, 1));
 	g_assert_cmpstr (fwupd_release_get_version (rel), ==, "1.2.4");
 
+	/* upgrades for all devices */
+	upgrades_all = fu_engine_get_upgrades_all (engine, request, &reasons_all, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (upgrades_all);
+	g_assert_nonnull (reasons_all);
+	g_assert_null (g_hash_table_lookup (reasons_all, fu_device_get_id (device)));
+	g_assert_cmpint (g_hash_table_size (upgrades_all), ==, 1);
+	releases_all = g_hash_table_lookup (upgrades_all, fu_device_get_id (device));
+	g_assert_nonnull (releases_all);
+	g_assert_cmpint (releases_all->len, ==, 2);
+
 	/* downgrades */
 	releases_dg = fu_engine_get_downgrades (engine,
 						request,
@@ -1437,6 +1511,100 @@ fu_engine_downgrade_func (gconstpointer user_data)
 	g_assert_cmpstr (fwupd_release_get_version (rel), ==, "1.2.2");
 }
 
+static guint64
+_file_get_mtime_usec (const gchar *fn)
+{
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GFile) file = g_file_new_for_path (fn);
+	g_autoptr(GFileInfo) info = NULL;
+
+	info = g_file_query_info (file,
+				  G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+				  G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+				  G_FILE_QUERY_INFO_NONE,
+				  NULL, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (info);
+	return g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED) * G_USEC_PER_SEC +
+		g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+}
+
+static void
+_write_remote_metadata (const gchar *fn, const gchar *guid, const gchar *version)
+{
+	gboolean ret;
+	g_autofree gchar *xml = NULL;
+	g_autoptr(GError) error = NULL;
+
+	xml = g_strdup_printf ("<components>"
+			       "  <component type=\"firmware\">"
+			       "    <id>test</id>"
+			       "    <name>Test Device</name>"
+			       "    <provides>"
+			       "      <firmware type=\"flashed\">%s</firmware>"
+			       "    </provides>"
+			       "    <releases>"
+			       "      <release version=\"%s\"/>"
+			       "    </releases>"
+			       "  </component>"
+			       "</components>", guid, version);
+	ret = g_file_set_contents (fn, xml, -1, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+}
+
+static void
+fu_engine_metadata_silos_func (gconstpointer user_data)
+{
+	const gchar *legacyfn = "/tmp/fwupd-self-test/var/cache/fwupd/metadata.xmlb";
+	const gchar *stablefn = "/tmp/fwupd-self-test/var/cache/fwupd/metadata/stable.xmlb";
+	const gchar *testingfn = "/tmp/fwupd-self-test/var/cache/fwupd/metadata/testing.xmlb";
+	gboolean ret;
+	guint64 mtime_stable;
+	guint64 mtime_testing;
+	g_autoptr(FuDevice) device = fu_device_new ();
+	g_autoptr(FuEngine) engine1 = fu_engine_new (FU_APP_FLAGS_NONE);
+	g_autoptr(FuEngine) engine2 = fu_engine_new (FU_APP_FLAGS_NONE);
+	g_autoptr(GError) error = NULL;
+	g_autoptr(XbNode) component = NULL;
+
+	/* one component in each remote, and a silo from an older version */
+	fu_self_test_mkroot ();
+	g_assert_cmpint (g_mkdir_with_parents ("/tmp/fwupd-self-test/var/cache/fwupd", 0755), ==, 0);
+	ret = g_file_set_contents (legacyfn, "this is not a valid", -1, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	_write_remote_metadata ("/tmp/fwupd-self-test/stable.xml",
+				"aaaaaaaa-bbbb-cccc-dddd-eeeeeeeeeeee", "1.2.3");
+	_write_remote_metadata ("/tmp/fwupd-self-test/testing.xml",
+				"bbbbbbbb-bbbb-cccc-dddd-eeeeeeeeeeee", "1.2.4");
+	g_setenv ("CONFIGURATION_DIRECTORY", TESTDATADIR_SRC, TRUE);
+	ret = fu_engine_load (engine1, FU_ENGINE_LOAD_FLAG_NO_ENUMERATE, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+
+	/* each remote has its own silo, and the old one was deleted */
+	g_assert_false (g_file_test (legacyfn, G_FILE_TEST_EXISTS));
+	mtime_stable = _file_get_mtime_usec (stablefn);
+	mtime_testing = _file_get_mtime_usec (testingfn);
+
+	/* change just one remote */
+	g_usleep (G_USEC_PER_SEC / 10);
+	_write_remote_metadata ("/tmp/fwupd-self-test/testing.xml",
+				"bbbbbbbb-bbbb-cccc-dddd-eeeeeeeeeeee", "1.2.5");
+	ret = fu_engine_load (engine2, FU_ENGINE_LOAD_FLAG_NO_ENUMERATE, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+
+	/* only the silo of that remote was compiled again */
+	g_assert_cmpint (_file_get_mtime_usec (stablefn), ==, mtime_stable);
+	g_assert_cmpint (_file_get_mtime_usec (testingfn), >, mtime_testing);
+	fu_device_add_guid (device, "bbbbbbbb-bbbb-cccc-dddd-eeeeeeeeeeee");
+	component = fu_engine_get_component_by_guids (engine2, device);
+	g_assert_nonnull (component);
+	g_assert_cmpstr (xb_node_query_attr (component, "releases/release", "version", NULL), ==, "1.2.5");
+}
+
 static void
 fu_engine_install_duration_func (gconstpointer user_data)
 {
@@ -2333,6 +2501,332 @@ fu_device_list_func (gconstpointer user_data)
 			 "1a8d0d9a96ad3e67ba76cf3033623625dc6d6882");
 }
 
+static FuDevice *
+_device_list_find_by_guid_linear (GPtrArray *devices, const gchar *guid)
+{
+	for (guint i = 0; i < devices->len; i++) {
+		FuDevice *device = g_ptr_array_index (devices, i);
+		if (fu_device_has_guid (device, guid))
+			return device;
+	}
+	return NULL;
+}
+
+/* compare the indexed lookups against a linear scan of the active devices */
+static void
+_device_list_check_index (FuDeviceList *device_list)
+{
+	g_autoptr(GPtrArray) devices = fu_device_list_get_active (device_list);
+	for (guint i = 0; i < devices->len; i++) {
+		FuDevice *device = g_ptr_array_index (devices, i);
+		GPtrArray *guids = fu_device_get_guids (device);
+		g_autoptr(FuDevice) device_tmp = NULL;
+		g_autoptr(GError) error = NULL;
+
+		device_tmp = fu_device_list_get_by_id (device_list,
+						       fu_device_get_id (device),
+						       &error);
+		g_assert_no_error (error);
+		g_assert (device_tmp == device);
+		for (guint j = 0; j < guids->len; j++) {
+			const gchar *guid = g_ptr_array_index (guids, j);
+			g_autoptr(FuDevice) device_guid = NULL;
+			device_guid = fu_device_list_get_by_guid (device_list, guid, &error);
+			g_assert_no_error (error);
+			g_assert (device_guid == _device_list_find_by_guid_linear (devices, guid));
+		}
+	}
+}
+
+typedef struct {
+	guint		 cnt_delta;
+	guint		 cnt_changed;
+	guint64		 seq;
+	guint		 changed_len;
+} FuDeviceDeltasHelper;
+
+static void
+_device_deltas_changed_delta_cb (FuDeviceDeltas *device_deltas,
+				 FuDevice *device,
+				 guint64 seq,
+				 GVariant *changed,
+				 GVariant *removed,
+				 gpointer user_data)
+{
+	FuDeviceDeltasHelper *helper = (FuDeviceDeltasHelper *) user_data;
+	helper->cnt_delta++;
+	helper->seq = seq;
+	helper->changed_len = g_variant_n_children (changed) + g_variant_n_children (removed);
+	fu_test_loop_quit ();
+}
+
+static void
+_device_deltas_changed_cb (FuDeviceDeltas *device_deltas,
+			   FuDevice *device,
+			   GVariant *val,
+			   gpointer user_data)
+{
+	FuDeviceDeltasHelper *helper = (FuDeviceDeltasHelper *) user_data;
+	helper->cnt_changed++;
+	fu_test_loop_quit ();
+}
+
+static void
+fu_device_deltas_func (gconstpointer user_data)
+{
+	FuDeviceDeltasHelper helper = { 0 };
+	g_autoptr(FuDevice) device = fu_device_new ();
+	g_autoptr(FuDeviceDeltas) device_deltas = fu_device_deltas_new ();
+
+	fu_device_deltas_set_timeout (device_deltas, 50);
+	g_signal_connect (device_deltas, "changed-delta",
+			  G_CALLBACK (_device_deltas_changed_delta_cb), &helper);
+	g_signal_connect (device_deltas, "changed",
+			  G_CALLBACK (_device_deltas_changed_cb), &helper);
+	fu_device_set_id (device, "deltas");
+	fu_device_set_name (device, "Foo");
+	fu_device_deltas_add (device_deltas, device);
+
+	/* nothing changed */
+	fu_device_deltas_changed (device_deltas, device);
+	g_assert_cmpint (helper.cnt_delta, ==, 0);
+	g_assert_cmpint (helper.cnt_changed, ==, 0);
+
+	/* two status changes are merged, and the first change is sent in full */
+	fu_device_set_status (device, FWUPD_STATUS_DEVICE_WRITE);
+	fu_device_deltas_changed (device_deltas, device);
+	fu_device_set_status (device, FWUPD_STATUS_DEVICE_VERIFY);
+	fu_device_deltas_changed (device_deltas, device);
+	g_assert_cmpint (helper.cnt_delta, ==, 0);
+	g_assert_cmpint (helper.cnt_changed, ==, 0);
+	fu_test_loop_run_with_timeout (1000);
+	g_assert_cmpint (helper.cnt_delta, ==, 0);
+	g_assert_cmpint (helper.cnt_changed, ==, 1);
+
+	/* any other change is sent at once, including the pending status,
+	 * and only as a delta */
+	fu_device_set_status (device, FWUPD_STATUS_DEVICE_WRITE);
+	fu_device_deltas_changed (device_deltas, device);
+	fu_device_set_name (device, "Bar");
+	fu_device_deltas_changed (device_deltas, device);
+	g_assert_cmpint (helper.cnt_delta, ==, 1);
+	g_assert_cmpint (helper.cnt_changed, ==, 1);
+	g_assert_cmpint (helper.seq, ==, 2);
+	g_assert_cmpint (helper.changed_len, ==, 2);
+
+	/* and is not sent again when the timeout fires */
+	fu_test_loop_run_with_timeout (200);
+	fu_test_loop_quit ();
+	g_assert_cmpint (helper.cnt_delta, ==, 1);
+	g_assert_cmpint (helper.cnt_changed, ==, 1);
+}
+
+static void
+fu_device_cache_func (gconstpointer user_data)
+{
+	FuDevice *device_tmp;
+	FuDevice *child_tmp;
+	gboolean ret;
+	g_autofree gchar *filename = NULL;
+	g_autofree gchar *fn_boot_id = NULL;
+	g_autofree gchar *fn_seqnum = NULL;
+	g_autofree gchar *procfs = NULL;
+	g_autofree gchar *sysfs = NULL;
+	g_autoptr(FuDevice) device = fu_device_new ();
+	g_autoptr(FuDevice) child = fu_device_new ();
+	g_autoptr(FuDeviceCache) cache = fu_device_cache_new ();
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) devices = g_ptr_array_new ();
+	g_autoptr(GPtrArray) devices_new = NULL;
+
+	/* the key needs the kernel boot ID and uevent sequence number */
+	procfs = g_build_filename ("/tmp/fwupd-self-test", "proc", NULL);
+	sysfs = g_build_filename ("/tmp/fwupd-self-test", "sys", NULL);
+	fn_boot_id = g_build_filename (procfs, "sys", "kernel", "random", "boot_id", NULL);
+	fn_seqnum = g_build_filename (sysfs, "kernel", "uevent_seqnum", NULL);
+	ret = fu_common_mkdir_parent (fn_boot_id, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = fu_common_mkdir_parent (fn_seqnum, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = g_file_set_contents (fn_boot_id, "4c5f4e3a-8d54-4ff4-9e39-4f0c3f7e3c52\n", -1, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = g_file_set_contents (fn_seqnum, "1234\n", -1, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_setenv ("FWUPD_PROCFS", procfs, TRUE);
+	g_setenv ("FWUPD_SYSFSDIR", sysfs, TRUE);
+
+	filename = g_build_filename (g_get_tmp_dir (), "fwupd-self-test", "devices.cache", NULL);
+	fu_device_cache_set_filename (cache, filename);
+	fu_device_set_id (device, "dummy");
+	fu_device_set_physical_id (device, "/sys/devices/pci0000:00/0000:00:14.0/usb1/1-1");
+	fu_device_set_plugin (device, "test");
+	fu_device_set_name (device, "Dummy");
+	fu_device_set_version_format (device, FWUPD_VERSION_FORMAT_TRIPLET);
+	fu_device_set_version (device, "1.2.3");
+	fu_device_add_guid (device, "2d47f29b-83a2-4f31-a2e8-63474f4d4c2e");
+	fu_device_add_flag (device, FWUPD_DEVICE_FLAG_UPDATABLE);
+
+	/* save the child first to check the order does not matter */
+	fu_device_set_id (child, "child");
+	fu_device_set_physical_id (child, "/sys/devices/pci0000:00/0000:00:14.0/usb1/1-1");
+	fu_device_set_logical_id (child, "child");
+	fu_device_set_plugin (child, "test");
+	fu_device_add_child (device, child);
+	g_ptr_array_add (devices, child);
+	g_ptr_array_add (devices, device);
+	ret = fu_device_cache_save (cache, devices, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+
+	/* load back */
+	devices_new = fu_device_cache_load (cache, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (devices_new);
+	g_assert_cmpint (devices_new->len, ==, 2);
+	child_tmp = g_ptr_array_index (devices_new, 0);
+	device_tmp = g_ptr_array_index (devices_new, 1);
+	g_assert_cmpstr (fu_device_get_id (device_tmp), ==, fu_device_get_id (device));
+	g_assert_cmpstr (fu_device_get_physical_id (device_tmp), ==,
+			 "/sys/devices/pci0000:00/0000:00:14.0/usb1/1-1");
+	g_assert_cmpstr (fu_device_get_plugin (device_tmp), ==, "test");
+	g_assert_cmpstr (fu_device_get_version (device_tmp), ==, "1.2.3");
+	g_assert_true (fu_device_has_guid (device_tmp, "2d47f29b-83a2-4f31-a2e8-63474f4d4c2e"));
+	g_assert_true (fu_device_has_flag (device_tmp, FWUPD_DEVICE_FLAG_UPDATABLE));
+
+	/* the child is linked to the restored parent */
+	g_assert_cmpstr (fu_device_get_id (child_tmp), ==, fu_device_get_id (child));
+	g_assert_cmpstr (fu_device_get_logical_id (child_tmp), ==, "child");
+	g_assert (fu_device_get_parent (child_tmp) == device_tmp);
+	g_assert_cmpint (fu_device_get_children (device_tmp)->len, ==, 1);
+
+	/* not valid once there has been a uevent */
+	ret = g_file_set_contents (fn_seqnum, "1235\n", -1, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_clear_pointer (&devices_new, g_ptr_array_unref);
+	devices_new = fu_device_cache_load (cache, &error);
+	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_NOTHING_TO_DO);
+	g_assert_null (devices_new);
+	g_unsetenv ("FWUPD_PROCFS");
+	g_unsetenv ("FWUPD_SYSFSDIR");
+}
+
+static void
+fu_device_list_index_func (gconstpointer user_data)
+{
+	g_autoptr(FuDeviceList) device_list = fu_device_list_new ();
+	g_autoptr(FuDevice) device1 = fu_device_new ();
+	g_autoptr(FuDevice) device2 = fu_device_new ();
+	g_autoptr(FuDevice) device3 = fu_device_new ();
+	g_autoptr(FuDevice) device = NULL;
+	g_autoptr(GError) error = NULL;
+
+	fu_device_set_id (device1, "device1");
+	fu_device_add_instance_id (device1, "foobar");
+	fu_device_convert_instance_ids (device1);
+	fu_device_list_add (device_list, device1);
+	fu_device_set_id (device2, "device2");
+	fu_device_add_instance_id (device2, "baz");
+	fu_device_convert_instance_ids (device2);
+	fu_device_list_add (device_list, device2);
+	fu_device_set_id (device3, "device3");
+	fu_device_add_instance_id (device3, "bar");
+	fu_device_convert_instance_ids (device3);
+	fu_device_list_add (device_list, device3);
+	_device_list_check_index (device_list);
+
+	/* GUIDs added after the device was added to the list */
+	fu_device_add_counterpart_guid (device3, "foobar");
+	fu_device_add_counterpart_guid (device2, "bob");
+	_device_list_check_index (device_list);
+	device = fu_device_list_get_by_guid (device_list, "bob", &error);
+	g_assert_no_error (error);
+	g_assert (device == device2);
+	g_clear_object (&device);
+
+	/* abbreviated hash */
+	device = fu_device_list_get_by_id (device_list, "99249eb1", &error);
+	g_assert_no_error (error);
+	g_assert (device == device1);
+	g_clear_object (&device);
+
+	/* the shared GUID now only matches the remaining device */
+	fu_device_list_remove (device_list, device1);
+	_device_list_check_index (device_list);
+	device = fu_device_list_get_by_guid (device_list, "foobar", &error);
+	g_assert_no_error (error);
+	g_assert (device == device3);
+	g_clear_object (&device);
+	device = fu_device_list_get_by_id (device_list,
+					   "99249eb1bd9ef0b6e192b271a8cb6a3090cfec7a",
+					   &error);
+	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_NOT_FOUND);
+	g_assert (device == NULL);
+	g_clear_error (&error);
+
+	/* IDs changed after the device was added to the list */
+	fu_device_set_id (device2, "0123456789abcdef0123456789abcdef01234567");
+	fu_device_set_equivalent_id (device2, "fedcba9876543210fedcba9876543210fedcba98");
+	_device_list_check_index (device_list);
+	device = fu_device_list_get_by_id (device_list,
+					   "0123456789abcdef0123456789abcdef01234567",
+					   &error);
+	g_assert_no_error (error);
+	g_assert (device == device2);
+	g_clear_object (&device);
+	device = fu_device_list_get_by_id (device_list,
+					   "fedcba9876543210fedcba9876543210fedcba98",
+					   &error);
+	g_assert_no_error (error);
+	g_assert (device == device2);
+	g_clear_object (&device);
+	device = fu_device_list_get_by_id (device_list,
+					   "1a8d0d9a96ad3e67ba76cf3033623625dc6d6882",
+					   &error);
+	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_NOT_FOUND);
+	g_assert (device == NULL);
+}
+
+static void
+fu_profile_func (gconstpointer user_data)
+{
+	g_autofree gchar *json = NULL;
+	g_autofree gchar *str = NULL;
+	g_autoptr(FuProfile) profile = fu_profile_new ();
+	g_autoptr(GError) error = NULL;
+
+	/* nested spans */
+	fu_profile_push (profile, "load");
+	fu_profile_push (profile, "plugin:%s", "dell");
+	fu_profile_pop (profile);
+	fu_profile_push (profile, "plugin:%s", "uefi");
+	fu_profile_pop (profile);
+	fu_profile_pop (profile);
+	g_assert_cmpint (fu_profile_get_size (profile), ==, 3);
+	str = fu_profile_to_string (profile);
+	g_debug ("%s", str);
+	g_assert_true (g_str_has_prefix (str, "load: "));
+	g_assert_nonnull (g_strstr_len (str, -1, "\n  plugin:uefi: "));
+
+	/* nothing recorded when disabled, but still balanced */
+	fu_profile_set_enabled (profile, FALSE);
+	fu_profile_push (profile, "ignored");
+	fu_profile_pop (profile);
+	g_assert_cmpint (fu_profile_get_size (profile), ==, 3);
+
+	/* trace-event format */
+	json = fu_profile_to_json (profile, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (json);
+	g_assert_nonnull (g_strstr_len (json, -1, "\"traceEvents\""));
+	g_assert_nonnull (g_strstr_len (json, -1, "\"plugin:dell\""));
+	g_assert_null (g_strstr_len (json, -1, "\"ignored\""));
+}
+
 static void
 fu_plugin_list_func (gconstpointer user_data)
 {
@@ -2374,6 +2868,8 @@ fu_plugin_list_depsolve_func (gconstpointer user_data)
 	g_autoptr(FuPlugin) plugin1 = fu_plugin_new ();
 	g_autoptr(FuPlugin) plugin2 = fu_plugin_new ();
 	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) depends1 = NULL;
+	g_autoptr(GPtrArray) depends2 = NULL;
 
 	fu_plugin_set_name (plugin1, "plugin1");
 	fu_plugin_set_name (plugin2, "plugin2");
@@ -2392,6 +2888,13 @@ fu_plugin_list_depsolve_func (gconstpointer user_data)
 	g_assert_cmpint (fu_plugin_get_order (plugin), ==, 0);
 	g_assert (fu_plugin_get_enabled (plugin));
 
+	/* get the plugins that have to be run first */
+	depends1 = fu_plugin_list_get_depends (plugin_list, plugin1);
+	g_assert_cmpint (depends1->len, ==, 1);
+	g_assert (g_ptr_array_index (depends1, 0) == plugin2);
+	depends2 = fu_plugin_list_get_depends (plugin_list, plugin2);
+	g_assert_cmpint (depends2->len, ==, 0);
+
 	/* add another rule, then re-depsolve */
 	fu_plugin_add_rule (plugin1, FU_PLUGIN_RULE_CONFLICTS, "plugin2");
 	ret = fu_plugin_list_depsolve (plugin_list, &error);
@@ -2720,6 +3223,140 @@ fu_history_func (gconstpointer user_data)
 	g_assert_cmpstr (g_ptr_array_index (approved_firmware, 1), ==, "bar");
 }
 
+static void
+fu_history_filtered_func (gconstpointer user_data)
+{
+	gboolean ret;
+	g_autofree gchar *dirname = NULL;
+	g_autofree gchar *filename = NULL;
+	g_autoptr(FuHistory) history = fu_history_new ();
+	g_autoptr(FwupdRelease) release = fwupd_release_new ();
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) devices = NULL;
+
+	/* delete the database */
+	dirname = fu_common_get_path (FU_PATH_KIND_LOCALSTATEDIR_PKG);
+	if (!g_file_test (dirname, G_FILE_TEST_IS_DIR))
+		return;
+	filename = g_build_filename (dirname, "pending.db", NULL);
+	g_unlink (filename);
+
+	/* add some devices modified at different times */
+	for (guint i = 0; i < 10; i++) {
+		g_autofree gchar *device_id = g_strdup_printf ("filtered-%u", i);
+		g_autoptr(FuDevice) device = fu_device_new ();
+		fu_device_set_id (device, device_id);
+		fu_device_set_plugin (device, i % 2 == 0 ? "even" : "odd");
+		fu_device_set_update_state (device, FWUPD_UPDATE_STATE_SUCCESS);
+		fu_device_set_modified (device, 1000 + i);
+		ret = fu_history_add_device (history, device, release, &error);
+		g_assert_no_error (error);
+		g_assert (ret);
+	}
+
+	/* by plugin */
+	devices = fu_history_get_devices_filtered (history, NULL, "even", 0, 0,
+						   FWUPD_UPDATE_STATE_UNKNOWN,
+						   0, 0, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (devices);
+	g_assert_cmpint (devices->len, ==, 5);
+	g_clear_pointer (&devices, g_ptr_array_unref);
+
+	/* by time, paged */
+	devices = fu_history_get_devices_filtered (history, NULL, NULL, 1003, 1008,
+						   FWUPD_UPDATE_STATE_SUCCESS,
+						   2, 2, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (devices);
+	g_assert_cmpint (devices->len, ==, 2);
+	g_assert_cmpint (fu_device_get_modified (g_ptr_array_index (devices, 0)), ==, 1005);
+	g_assert_cmpint (fu_device_get_modified (g_ptr_array_index (devices, 1)), ==, 1006);
+	g_clear_pointer (&devices, g_ptr_array_unref);
+
+	/* the most recent, oldest first */
+	devices = fu_history_get_devices_filtered (history, NULL, NULL, 0, 0,
+						   FWUPD_UPDATE_STATE_UNKNOWN,
+						   3, 0, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (devices);
+	g_assert_cmpint (devices->len, ==, 3);
+	g_assert_cmpint (fu_device_get_modified (g_ptr_array_index (devices, 0)), ==, 1007);
+	g_assert_cmpint (fu_device_get_modified (g_ptr_array_index (devices, 2)), ==, 1009);
+	g_clear_pointer (&devices, g_ptr_array_unref);
+
+	/* nothing in this state */
+	devices = fu_history_get_devices_filtered (history, NULL, NULL, 0, 0,
+						   FWUPD_UPDATE_STATE_FAILED,
+						   0, 0, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (devices);
+	g_assert_cmpint (devices->len, ==, 0);
+}
+
+static void
+fu_history_perf_func (gconstpointer user_data)
+{
+	const guint n_devices = 100000;
+	gdouble elapsed;
+	g_autofree gchar *dirname = NULL;
+	g_autofree gchar *filename = NULL;
+	g_autoptr(FuHistory) history = fu_history_new ();
+	g_autoptr(FwupdRelease) release = fwupd_release_new ();
+	g_autoptr(GPtrArray) devices = NULL;
+
+	/* delete the database */
+	dirname = fu_common_get_path (FU_PATH_KIND_LOCALSTATEDIR_PKG);
+	if (!g_file_test (dirname, G_FILE_TEST_IS_DIR))
+		return;
+	filename = g_build_filename (dirname, "pending.db", NULL);
+	g_unlink (filename);
+
+	/* add lots of devices */
+	fwupd_release_add_checksum (release, "abcdef");
+	fwupd_release_set_version (release, "3.0.2");
+	g_test_timer_start ();
+	for (guint i = 0; i < n_devices; i++) {
+		gboolean ret;
+		g_autofree gchar *device_id = g_strdup_printf ("%08x", i);
+		g_autoptr(FuDevice) device = fu_device_new ();
+		g_autoptr(GError) error = NULL;
+		fu_device_set_id (device, device_id);
+		fu_device_set_name (device, "ColorHug");
+		fu_device_set_version_format (device, FWUPD_VERSION_FORMAT_TRIPLET);
+		fu_device_set_version (device, "3.0.1");
+		fu_device_set_modified (device, i);
+		ret = fu_history_add_device (history, device, release, &error);
+		g_assert_no_error (error);
+		g_assert (ret);
+	}
+	elapsed = g_test_timer_elapsed ();
+	g_test_minimized_result (elapsed, "added %u devices in %.3fs", n_devices, elapsed);
+
+	/* look up some of them */
+	g_test_timer_start ();
+	for (guint i = 0; i < n_devices; i += 100) {
+		g_autofree gchar *device_id = NULL;
+		g_autofree gchar *id = g_strdup_printf ("%08x", i);
+		g_autoptr(FuDevice) device = NULL;
+		g_autoptr(GError) error = NULL;
+		device_id = g_compute_checksum_for_string (G_CHECKSUM_SHA1, id, -1);
+		device = fu_history_get_device_by_id (history, device_id, &error);
+		g_assert_no_error (error);
+		g_assert_nonnull (device);
+	}
+	elapsed = g_test_timer_elapsed ();
+	g_test_minimized_result (elapsed, "found %u devices in %.3fs", n_devices / 100, elapsed);
+
+	/* get everything */
+	g_test_timer_start ();
+	devices = fu_history_get_devices (history, NULL);
+	g_assert_nonnull (devices);
+	g_assert_cmpint (devices->len, ==, n_devices);
+	elapsed = g_test_timer_elapsed ();
+	g_test_minimized_result (elapsed, "got all devices in %.3fs", elapsed);
+}
+
 static GBytes *
 _build_cab (GCabCompression compression, ...)
 {
@@ -2946,6 +3583,404 @@ fu_plugin_composite_func (gconstpointer user_data)
 	}
 }
 
+static void
+_engine_percentage_changed_cb (FuEngine *engine, guint percentage, gpointer user_data)
+{
+	guint *percentage_max = (guint *) user_data;
+	*percentage_max = MAX (*percentage_max, percentage);
+}
+
+static void
+fu_engine_install_concurrent_func (gconstpointer user_data)
+{
+	FuTest *self = (FuTest *) user_data;
+	gboolean ret;
+	guint percentage_max = 0;
+	g_autofree gchar *configdir = NULL;
+	g_autofree gchar *configfn = NULL;
+	g_autoptr(FuEngine) engine = fu_engine_new (FU_APP_FLAGS_NONE);
+	g_autoptr(FuEngineRequest) request = fu_engine_request_new ();
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	g_autoptr(GPtrArray) install_tasks = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	g_autoptr(XbNode) component = NULL;
+	g_autoptr(XbSilo) silo_empty = xb_silo_new ();
+	g_autoptr(XbSilo) silo = NULL;
+
+	/* opt in to concurrent installs */
+	fu_self_test_mkroot ();
+	configdir = g_build_filename ("/tmp/fwupd-self-test", "etc", NULL);
+	configfn = g_build_filename (configdir, "daemon.conf", NULL);
+	g_assert_cmpint (g_mkdir_with_parents (configdir, 0755), ==, 0);
+	ret = g_file_set_contents (configfn,
+				   "[fwupd]\n"
+				   "ConcurrentInstalls=true\n", -1, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_setenv ("CONFIGURATION_DIRECTORY", configdir, TRUE);
+	fu_engine_set_silo (engine, silo_empty);
+	fu_engine_add_plugin (engine, self->plugin);
+	ret = fu_engine_load (engine, FU_ENGINE_LOAD_FLAG_NO_ENUMERATE, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_setenv ("CONFIGURATION_DIRECTORY", TESTDATADIR_SRC, TRUE);
+
+	/* one firmware for every device */
+	blob = _build_cab (GCAB_COMPRESSION_NONE,
+			   "acme.metainfo.xml",
+	"<component type=\"firmware\">\n"
+	"  <id>com.acme.example.firmware</id>\n"
+	"  <provides>\n"
+	"    <firmware type=\"flashed\">b585990a-003e-5270-89d5-3705a17f9a43</firmware>\n"
+	"  </provides>\n"
+	"  <releases>\n"
+	"    <release version=\"1.2.3\"/>\n"
+	"  </releases>\n"
+	"</component>",
+			   "firmware.bin", "world",
+			   NULL);
+	silo = fu_common_cab_build_silo (blob, 10240, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (silo);
+	component = xb_silo_query_first (silo, "components/component", &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (component);
+
+	/* three devices on unrelated roots, with the first and last failing */
+	g_setenv ("FWUPD_PLUGIN_TEST", "composite", TRUE);
+	for (guint i = 0; i < 3; i++) {
+		g_autofree gchar *device_id = g_strdup_printf ("concurrent%u", i);
+		g_autoptr(FuDevice) device = fu_device_new ();
+		fu_device_set_id (device, device_id);
+		fu_device_set_physical_id (device, device_id);
+		fu_device_set_plugin (device, "test");
+		fu_device_set_name (device, "Test Device");
+		fu_device_set_version_format (device, FWUPD_VERSION_FORMAT_TRIPLET);
+		fu_device_set_version (device, "1.2.2");
+		fu_device_add_guid (device, "b585990a-003e-5270-89d5-3705a17f9a43");
+		fu_device_add_flag (device, FWUPD_DEVICE_FLAG_UPDATABLE);
+		if (i != 1) {
+			g_autofree gchar *msg = g_strdup_printf ("failed to write %u", i);
+			fu_device_set_metadata (device, "fail-update", msg);
+		}
+		fu_engine_add_device (engine, device);
+		g_ptr_array_add (install_tasks, fu_install_task_new (device, component));
+		g_ptr_array_add (devices, g_steal_pointer (&device));
+	}
+	for (guint i = 0; i < install_tasks->len; i++) {
+		for (guint j = 0; j < i; j++) {
+			g_assert_false (fu_install_task_is_related (g_ptr_array_index (install_tasks, i),
+								    g_ptr_array_index (install_tasks, j)));
+		}
+	}
+
+	/* install all three */
+	g_signal_connect (engine, "percentage-changed",
+			  G_CALLBACK (_engine_percentage_changed_cb),
+			  &percentage_max);
+	ret = fu_engine_install_tasks (engine,
+				       request,
+				       install_tasks,
+				       blob,
+				       FWUPD_DEVICE_FLAG_NONE,
+				       &error);
+	g_unsetenv ("FWUPD_PLUGIN_TEST");
+
+	/* the first error in task order is returned */
+	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_WRITE);
+	g_assert_cmpstr (error->message, ==, "failed to write 0");
+	g_assert_false (ret);
+
+	/* the group after the failed one still ran */
+	g_assert_cmpint (fu_device_get_metadata_integer (g_ptr_array_index (devices, 1), "nr-update"), ==, 1);
+	g_assert_cmpstr (fu_device_get_version (g_ptr_array_index (devices, 1)), ==, "1.2.3");
+	g_assert_cmpstr (fu_device_get_version (g_ptr_array_index (devices, 2)), ==, "1.2.2");
+
+	/* the percentage is the mean over all three devices */
+	g_assert_cmpint (percentage_max, ==, 33);
+
+	/* prepare and cleanup ran once on every device, even on failure */
+	for (guint i = 0; i < devices->len; i++) {
+		FuDevice *device = g_ptr_array_index (devices, i);
+		g_assert_cmpstr (fu_device_get_metadata (device, "frimbulator"), ==, "1");
+		g_assert_cmpstr (fu_device_get_metadata (device, "frombulator"), ==, "1");
+	}
+}
+
+static void
+fu_engine_install_concurrent_spawn_func (gconstpointer user_data)
+{
+	FuTest *self = (FuTest *) user_data;
+	gboolean ret;
+	g_autofree gchar *configdir = NULL;
+	g_autofree gchar *configfn = NULL;
+	g_autoptr(FuEngine) engine = fu_engine_new (FU_APP_FLAGS_NONE);
+	g_autoptr(FuEngineRequest) request = fu_engine_request_new ();
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	g_autoptr(GPtrArray) install_tasks = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	g_autoptr(XbNode) component = NULL;
+	g_autoptr(XbSilo) silo_empty = xb_silo_new ();
+	g_autoptr(XbSilo) silo = NULL;
+
+	/* opt in to concurrent installs */
+	fu_self_test_mkroot ();
+	configdir = g_build_filename ("/tmp/fwupd-self-test", "etc", NULL);
+	configfn = g_build_filename (configdir, "daemon.conf", NULL);
+	g_assert_cmpint (g_mkdir_with_parents (configdir, 0755), ==, 0);
+	ret = g_file_set_contents (configfn,
+				   "[fwupd]\n"
+				   "ConcurrentInstalls=true\n", -1, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_setenv ("CONFIGURATION_DIRECTORY", configdir, TRUE);
+	fu_engine_set_silo (engine, silo_empty);
+	fu_engine_add_plugin (engine, self->plugin);
+	ret = fu_engine_load (engine, FU_ENGINE_LOAD_FLAG_NO_ENUMERATE, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_setenv ("CONFIGURATION_DIRECTORY", TESTDATADIR_SRC, TRUE);
+
+	blob = _build_cab (GCAB_COMPRESSION_NONE,
+			   "acme.metainfo.xml",
+	"<component type=\"firmware\">\n"
+	"  <id>com.acme.example.firmware</id>\n"
+	"  <provides>\n"
+	"    <firmware type=\"flashed\">b585990a-003e-5270-89d5-3705a17f9a43</firmware>\n"
+	"  </provides>\n"
+	"  <releases>\n"
+	"    <release version=\"1.2.3\"/>\n"
+	"  </releases>\n"
+	"</component>",
+			   "firmware.bin", "world",
+			   NULL);
+	silo = fu_common_cab_build_silo (blob, 10240, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (silo);
+	component = xb_silo_query_first (silo, "components/component", &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (component);
+
+	/* two unrelated devices that both spawn a process from the
+	 * worker thread while the other write is in progress */
+	for (guint i = 0; i < 2; i++) {
+		g_autofree gchar *device_id = g_strdup_printf ("spawn%u", i);
+		g_autofree gchar *cmd = g_strdup_printf ("sleep 0.1; echo spawned%u", i);
+		g_autoptr(FuDevice) device = fu_device_new ();
+		fu_device_set_id (device, device_id);
+		fu_device_set_physical_id (device, device_id);
+		fu_device_set_plugin (device, "test");
+		fu_device_set_name (device, "Test Device");
+		fu_device_set_version_format (device, FWUPD_VERSION_FORMAT_TRIPLET);
+		fu_device_set_version (device, "1.2.2");
+		fu_device_add_guid (device, "b585990a-003e-5270-89d5-3705a17f9a43");
+		fu_device_add_flag (device, FWUPD_DEVICE_FLAG_UPDATABLE);
+		fu_device_set_metadata (device, "spawn-update", cmd);
+		fu_engine_add_device (engine, device);
+		g_ptr_array_add (install_tasks, fu_install_task_new (device, component));
+		g_ptr_array_add (devices, g_steal_pointer (&device));
+	}
+
+	/* this deadlocks if the helper waits on the global default context */
+	ret = fu_engine_install_tasks (engine,
+				       request,
+				       install_tasks,
+				       blob,
+				       FWUPD_DEVICE_FLAG_NONE,
+				       &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	for (guint i = 0; i < devices->len; i++) {
+		FuDevice *device = g_ptr_array_index (devices, i);
+		g_autofree gchar *output = g_strdup_printf ("spawned%u", i);
+		g_assert_cmpstr (fu_device_get_metadata (device, "spawn-output"), ==, output);
+		g_assert_cmpint (fu_device_get_metadata_integer (device, "nr-update"), ==, 1);
+		g_assert_cmpstr (fu_device_get_version (device), ==, "1.2.3");
+	}
+}
+
+/* returns TRUE if the test plugin was loaded at startup */
+static gboolean
+fu_engine_lazy_plugins_loaded (const gchar *hwid)
+{
+	GPtrArray *plugins;
+	gboolean ret;
+	g_autofree gchar *manifest = NULL;
+	g_autoptr(FuEngine) engine = fu_engine_new (FU_APP_FLAGS_NONE);
+	g_autoptr(GError) error = NULL;
+
+	manifest = g_strdup_printf ("[test]\n"
+				    "Lazy=true\n"
+				    "Hwids=%s;\n", hwid);
+	ret = g_file_set_contents ("/tmp/fwupd-self-test/plugins/plugins.manifest",
+				   manifest, -1, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = fu_engine_load (engine, FU_ENGINE_LOAD_FLAG_NO_ENUMERATE, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	plugins = fu_engine_get_plugins (engine);
+	for (guint i = 0; i < plugins->len; i++) {
+		FuPlugin *plugin = g_ptr_array_index (plugins, i);
+		if (g_strcmp0 (fu_plugin_get_name (plugin), "test") == 0)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+static void
+fu_engine_coldplug_concurrent_device_added_cb (FuEngine *engine,
+					       FuDevice *device,
+					       gpointer user_data)
+{
+	GPtrArray *names = (GPtrArray *) user_data;
+	g_ptr_array_add (names, g_strdup (fu_device_get_name (device)));
+}
+
+static GPtrArray *
+fu_engine_coldplug_concurrent_load (gboolean concurrent)
+{
+	gboolean ret;
+	g_autofree gchar *configdir = NULL;
+	g_autofree gchar *configfn = NULL;
+	g_autofree gchar *configstr = NULL;
+	g_autoptr(FuEngine) engine = fu_engine_new (FU_APP_FLAGS_NO_IDLE_SOURCES);
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) names = g_ptr_array_new_with_free_func (g_free);
+	g_autoptr(XbSilo) silo_empty = xb_silo_new ();
+
+	configdir = g_build_filename ("/tmp/fwupd-self-test", "etc", NULL);
+	configfn = g_build_filename (configdir, "daemon.conf", NULL);
+	configstr = g_strdup_printf ("[fwupd]\n"
+				     "ConcurrentColdplug=%s\n",
+				     concurrent ? "true" : "false");
+	g_assert_cmpint (g_mkdir_with_parents (configdir, 0755), ==, 0);
+	ret = g_file_set_contents (configfn, configstr, -1, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_setenv ("CONFIGURATION_DIRECTORY", configdir, TRUE);
+
+	g_signal_connect (engine, "device-added",
+			  G_CALLBACK (fu_engine_coldplug_concurrent_device_added_cb),
+			  names);
+	fu_engine_set_silo (engine, silo_empty);
+	ret = fu_engine_load (engine, FU_ENGINE_LOAD_FLAG_NONE, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	return g_steal_pointer (&names);
+}
+
+static void
+fu_engine_coldplug_concurrent_func (gconstpointer user_data)
+{
+	const gchar *plugin_names[] = { "test", "test2", NULL };
+	g_autofree gchar *pluginfn = NULL;
+	g_autoptr(GFile) file_src = NULL;
+	g_autoptr(GPtrArray) names_concurrent = NULL;
+	g_autoptr(GPtrArray) names_serial = NULL;
+
+	/* two opted-in copies of the test plugin, test2 running after test */
+	fu_self_test_mkroot ();
+	g_assert_cmpint (g_mkdir_with_parents ("/tmp/fwupd-self-test/plugins", 0755), ==, 0);
+	pluginfn = g_build_filename (PLUGINBUILDDIR,
+				     "libfu_plugin_test." G_MODULE_SUFFIX,
+				     NULL);
+	file_src = g_file_new_for_path (pluginfn);
+	for (guint i = 0; plugin_names[i] != NULL; i++) {
+		gboolean ret;
+		g_autofree gchar *fn = NULL;
+		g_autoptr(GError) error = NULL;
+		g_autoptr(GFile) file_dst = NULL;
+
+		fn = g_strdup_printf ("/tmp/fwupd-self-test/plugins/libfu_plugin_%s." G_MODULE_SUFFIX,
+				      plugin_names[i]);
+		file_dst = g_file_new_for_path (fn);
+		ret = g_file_copy (file_src, file_dst, G_FILE_COPY_OVERWRITE, NULL,
+				   NULL, NULL, &error);
+		g_assert_no_error (error);
+		g_assert_true (ret);
+	}
+	g_setenv ("FWUPD_PLUGINDIR", "/tmp/fwupd-self-test/plugins", TRUE);
+	g_setenv ("FWUPD_PLUGIN_TEST", "coldplug-concurrent", TRUE);
+
+	/* the worker threads add the same devices in the same order */
+	names_serial = fu_engine_coldplug_concurrent_load (FALSE);
+	names_concurrent = fu_engine_coldplug_concurrent_load (TRUE);
+	g_assert_cmpint (names_serial->len, ==, 6);
+	g_assert_cmpint (names_concurrent->len, ==, names_serial->len);
+	for (guint i = 0; i < names_serial->len; i++) {
+		const gchar *name_serial = g_ptr_array_index (names_serial, i);
+		const gchar *name_concurrent = g_ptr_array_index (names_concurrent, i);
+		g_assert_cmpstr (name_concurrent, ==, name_serial);
+	}
+	g_assert_cmpstr (g_ptr_array_index (names_serial, 0), ==, "test-0");
+	g_assert_cmpstr (g_ptr_array_index (names_serial, 5), ==, "test2-2");
+
+	g_unsetenv ("FWUPD_PLUGIN_TEST");
+	g_setenv ("CONFIGURATION_DIRECTORY", TESTDATADIR_SRC, TRUE);
+	g_setenv ("FWUPD_PLUGINDIR", TESTDATADIR_SRC, TRUE);
+}
+
+static void
+fu_engine_lazy_plugins_func (gconstpointer user_data)
+{
+	GPtrArray *guids;
+	gboolean ret;
+	g_autofree gchar *configdir = NULL;
+	g_autofree gchar *configfn = NULL;
+	g_autofree gchar *pluginfn = NULL;
+	g_autoptr(FuHwids) hwids = fu_hwids_new ();
+	g_autoptr(FuSmbios) smbios = fu_smbios_new ();
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GFile) file_dst = NULL;
+	g_autoptr(GFile) file_src = NULL;
+
+	/* get a HWID that matches this machine */
+	ret = fu_smbios_setup (smbios, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = fu_hwids_setup (hwids, smbios, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	guids = fu_hwids_get_guids (hwids);
+	g_assert_cmpint (guids->len, >, 0);
+
+	/* opt in to lazy plugins, with only the test plugin installed */
+	fu_self_test_mkroot ();
+	configdir = g_build_filename ("/tmp/fwupd-self-test", "etc", NULL);
+	configfn = g_build_filename (configdir, "daemon.conf", NULL);
+	g_assert_cmpint (g_mkdir_with_parents (configdir, 0755), ==, 0);
+	ret = g_file_set_contents (configfn,
+				   "[fwupd]\n"
+				   "LazyPlugins=true\n", -1, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_cmpint (g_mkdir_with_parents ("/tmp/fwupd-self-test/plugins", 0755), ==, 0);
+	pluginfn = g_build_filename (PLUGINBUILDDIR,
+				     "libfu_plugin_test." G_MODULE_SUFFIX,
+				     NULL);
+	file_src = g_file_new_for_path (pluginfn);
+	file_dst = g_file_new_for_path ("/tmp/fwupd-self-test/plugins/"
+					"libfu_plugin_test." G_MODULE_SUFFIX);
+	ret = g_file_copy (file_src, file_dst, G_FILE_COPY_OVERWRITE, NULL,
+			   NULL, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_setenv ("CONFIGURATION_DIRECTORY", configdir, TRUE);
+	g_setenv ("FWUPD_PLUGINDIR", "/tmp/fwupd-self-test/plugins", TRUE);
+
+	/* loaded straight away when the manifest matches */
+	g_assert_true (fu_engine_lazy_plugins_loaded (g_ptr_array_index (guids, 0)));
+
+	/* otherwise deferred until a device needs it */
+	g_assert_false (fu_engine_lazy_plugins_loaded ("00000000-0000-0000-0000-000000000000"));
+
+	g_setenv ("CONFIGURATION_DIRECTORY", TESTDATADIR_SRC, TRUE);
+	g_setenv ("FWUPD_PLUGINDIR", TESTDATADIR_SRC, TRUE);
+}
+
 static void
 fu_security_attr_func (gconstpointer user_data)
 {
@@ -3093,6 +4128,35 @@ fu_install_task_compare_func (gconstpointer user_data)
 	g_assert_cmpint (fu_device_get_order (device_tmp), ==, 99);
 }
 
+static void
+fu_install_task_related_func (gconstpointer user_data)
+{
+	g_autoptr(FuDevice) parent = fu_device_new ();
+	g_autoptr(FuDevice) child = fu_device_new ();
+	g_autoptr(FuDevice) proxied = fu_device_new ();
+	g_autoptr(FuDevice) other = fu_device_new ();
+	g_autoptr(FuInstallTask) task_parent = NULL;
+	g_autoptr(FuInstallTask) task_child = NULL;
+	g_autoptr(FuInstallTask) task_proxied = NULL;
+	g_autoptr(FuInstallTask) task_other = NULL;
+
+	/* a dock with a child, a device using the child as a proxy, and
+	 * something on an unrelated bus */
+	fu_device_add_child (parent, child);
+	fu_device_set_proxy (proxied, child);
+	task_parent = fu_install_task_new (parent, NULL);
+	task_child = fu_install_task_new (child, NULL);
+	task_proxied = fu_install_task_new (proxied, NULL);
+	task_other = fu_install_task_new (other, NULL);
+
+	g_assert_true (fu_install_task_is_related (task_parent, task_child));
+	g_assert_true (fu_install_task_is_related (task_child, task_parent));
+	g_assert_true (fu_install_task_is_related (task_parent, task_proxied));
+	g_assert_true (fu_install_task_is_related (task_proxied, task_child));
+	g_assert_false (fu_install_task_is_related (task_parent, task_other));
+	g_assert_false (fu_install_task_is_related (task_other, task_proxied));
+}
+
 int
 main (int argc, char **argv)
 {
@@ -3136,6 +4200,8 @@ main (int argc, char **argv)
 			      fu_plugin_module_func);
 	g_test_add_data_func ("/fwupd/memcpy", self,
 			      fu_memcpy_func);
+	g_test_add_data_func ("/fwupd/profile", self,
+			      fu_profile_func);
 	g_test_add_data_func ("/fwupd/security-attr", self,
 			      fu_security_attr_func);
 	g_test_add_data_func ("/fwupd/device-list", self,
@@ -3146,8 +4212,18 @@ main (int argc, char **argv)
 			      fu_device_list_compatible_func);
 	g_test_add_data_func ("/fwupd/device-list{remove-chain}", self,
 			      fu_device_list_remove_chain_func);
+	g_test_add_data_func ("/fwupd/device-list{index}", self,
+			      fu_device_list_index_func);
+	g_test_add_data_func ("/fwupd/device-cache", self,
+			      fu_device_cache_func);
+	g_test_add_data_func ("/fwupd/device-deltas", self,
+			      fu_device_deltas_func);
 	g_test_add_data_func ("/fwupd/install-task{compare}", self,
 			      fu_install_task_compare_func);
+	g_test_add_data_func ("/fwupd/install-task{related}", self,
+			      fu_install_task_related_func);
+	g_test_add_data_func ("/fwupd/engine{component-order}", self,
+			      fu_engine_component_order_func);
 	g_test_add_data_func ("/fwupd/engine{device-unlock}", self,
 			      fu_engine_device_unlock_func);
 	g_test_add_data_func ("/fwupd/engine{multiple-releases}", self,
@@ -3170,6 +4246,8 @@ main (int argc, char **argv)
 			      fu_engine_partial_hash_func);
 	g_test_add_data_func ("/fwupd/engine{downgrade}", self,
 			      fu_engine_downgrade_func);
+	g_test_add_data_func ("/fwupd/engine{metadata-silos}", self,
+			      fu_engine_metadata_silos_func);
 	g_test_add_data_func ("/fwupd/engine{requirements-success}", self,
 			      fu_engine_requirements_func);
 	g_test_add_data_func ("/fwupd/engine{requirements-missing}", self,
@@ -3210,10 +4288,24 @@ main (int argc, char **argv)
 			      fu_engine_requirements_other_device_func);
 	g_test_add_data_func ("/fwupd/plugin{composite}", self,
 			      fu_plugin_composite_func);
+	g_test_add_data_func ("/fwupd/engine{install-concurrent}", self,
+			      fu_engine_install_concurrent_func);
+	g_test_add_data_func ("/fwupd/engine{install-concurrent-spawn}", self,
+			      fu_engine_install_concurrent_spawn_func);
+	g_test_add_data_func ("/fwupd/engine{lazy-plugins}", self,
+			      fu_engine_lazy_plugins_func);
+	g_test_add_data_func ("/fwupd/engine{coldplug-concurrent}", self,
+			      fu_engine_coldplug_concurrent_func);
 	g_test_add_data_func ("/fwupd/history", self,
 			      fu_history_func);
 	g_test_add_data_func ("/fwupd/history{migrate}", self,
 			      fu_history_migrate_func);
+	g_test_add_data_func ("/fwupd/history{filtered}", self,
+			      fu_history_filtered_func);
+	if (g_test_perf ()) {
+		g_test_add_data_func ("/fwupd/history{perf}", self,
+				      fu_history_perf_func);
+	}
 	g_test_add_data_func ("/fwupd/plugin-list", self,
 			      fu_plugin_list_func);
 	g_test_add_data_func ("/fwupd/plugin-list{depsolve}", self,
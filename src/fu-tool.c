@@ -63,6 +63,7 @@ struct FuUtilPrivate {
 	FwupdInstallFlags	 flags;
 	gboolean		 show_all_devices;
 	gboolean		 disable_ssl_strict;
+	gchar			*profile_fn;
 	/* only valid in update and downgrade */
 	FuUtilOperation		 current_operation;
 	FwupdDevice		*current_device;
@@ -131,6 +132,14 @@ fu_util_start_engine (FuUtilPrivate *priv, FuEngineLoadFlags flags, GError **err
 #endif
 	if (!fu_engine_load (priv->engine, flags, error))
 		return FALSE;
+	if (priv->profile_fn != NULL) {
+		FuProfile *profile = fu_engine_get_profile (priv->engine);
+		g_autofree gchar *json = fu_profile_to_json (profile, error);
+		if (json == NULL)
+			return FALSE;
+		if (!g_file_set_contents (priv->profile_fn, json, -1, error))
+			return FALSE;
+	}
 	if (fu_engine_get_tainted (priv->engine)) {
 		g_printerr ("WARNING: This tool has loaded 3rd party code and "
 			    "is no longer supported by the upstream developers!\n");
@@ -207,6 +216,7 @@ fu_util_private_free (FuUtilPrivate *priv)
 	if (priv->context != NULL)
 		g_option_context_free (priv->context);
 	g_free (priv->current_message);
+	g_free (priv->profile_fn);
 	g_free (priv);
 }
 
@@ -2072,6 +2082,9 @@ main (int argc, char *argv[])
 		{ "disable-ssl-strict", '\0', 0, G_OPTION_ARG_NONE, &priv->disable_ssl_strict,
 			/* TRANSLATORS: command line option */
 			_("Ignore SSL strict checks when downloading files"), NULL },
+		{ "profile", '\0', 0, G_OPTION_ARG_FILENAME, &priv->profile_fn,
+			/* TRANSLATORS: command line option */
+			_("Save the startup profile as Chrome trace-event JSON"), "FILENAME" },
 		{ "filter", '\0', 0, G_OPTION_ARG_STRING, &filter,
 			/* TRANSLATORS: command line option */
 			_("Filter with a set of device flags using a ~ prefix to "
@@ -20,6 +20,7 @@
 #endif
 #include <json-glib/json-glib.h>
 #include <locale.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 
@@ -75,6 +76,8 @@ struct FuUtilPrivate {
 	FwupdDeviceFlags	 completion_flags;
 	FwupdDeviceFlags	 filter_include;
 	FwupdDeviceFlags	 filter_exclude;
+	guint64			 history_since;
+	guint			 history_limit;
 };
 
 static gboolean	fu_util_report_history (FuUtilPrivate *priv, gchar **values, GError **error);
@@ -850,8 +853,20 @@ fu_util_get_history (FuUtilPrivate *priv, gchar **values, GError **error)
 	g_autoptr(GNode) root = g_node_new (NULL);
 	g_autofree gchar *title = fu_util_get_tree_title (priv);
 
-	/* get all devices from the history database */
-	devices = fwupd_client_get_history (priv->client, NULL, error);
+	/* get all devices from the history database, or just some */
+	if (priv->history_since > 0 || priv->history_limit > 0) {
+		devices = fwupd_client_get_history_filtered (priv->client,
+							     NULL,	/* device-id */
+							     NULL,	/* plugin */
+							     priv->history_since,
+							     0,		/* until */
+							     FWUPD_UPDATE_STATE_UNKNOWN,
+							     priv->history_limit,
+							     0,		/* offset */
+							     NULL, error);
+	} else {
+		devices = fwupd_client_get_history (priv->client, NULL, error);
+	}
 	if (devices == NULL)
 		return FALSE;
 
@@ -917,6 +932,28 @@ fu_util_get_history (FuUtilPrivate *priv, gchar **values, GError **error)
 	return TRUE;
 }
 
+/* parses YYYY-MM-DD into seconds since the epoch */
+static gboolean
+fu_util_parse_date (const gchar *str, guint64 *value, GError **error)
+{
+	guint year = 0;
+	guint month = 0;
+	guint day = 0;
+	g_autoptr(GDateTime) dt = NULL;
+
+	if (sscanf (str, "%u-%u-%u", &year, &month, &day) == 3)
+		dt = g_date_time_new_utc (year, month, day, 0, 0, 0);
+	if (dt == NULL) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_ARGS,
+			     "Expected YYYY-MM-DD, got %s", str);
+		return FALSE;
+	}
+	*value = g_date_time_to_unix (dt);
+	return TRUE;
+}
+
 static FwupdDevice *
 fu_util_get_device_by_id (FuUtilPrivate *priv, const gchar *id, GError **error)
 {
@@ -1365,6 +1402,9 @@ fu_util_perhaps_refresh_remotes (FuUtilPrivate *priv, GError **error)
 static gboolean
 fu_util_get_updates (FuUtilPrivate *priv, gchar **values, GError **error)
 {
+	g_autoptr(GError) error_all = NULL;
+	g_autoptr(GHashTable) reasons = NULL;
+	g_autoptr(GHashTable) upgrades = NULL;
 	g_autoptr(GPtrArray) devices = NULL;
 	gboolean supported = FALSE;
 	g_autoptr(GNode) root = g_node_new (NULL);
@@ -1381,6 +1421,12 @@ fu_util_get_updates (FuUtilPrivate *priv, gchar **values, GError **error)
 	if (devices == NULL)
 		return FALSE;
 	g_ptr_array_sort (devices, fu_util_sort_devices_by_flags_cb);
+
+	/* get the upgrades for every device in one round-trip */
+	upgrades = fwupd_client_get_upgrades_all (priv->client, &reasons,
+						  NULL, &error_all);
+	if (upgrades == NULL)
+		g_debug ("using GetUpgrades for each device: %s", error_all->message);
 	for (guint i = 0; i < devices->len; i++) {
 		FwupdDevice *dev = g_ptr_array_index (devices, i);
 		g_autoptr(GPtrArray) rels = NULL;
@@ -1404,9 +1450,23 @@ fu_util_get_updates (FuUtilPrivate *priv, gchar **values, GError **error)
 		supported = TRUE;
 
 		/* get the releases for this device and filter for validity */
-		rels = fwupd_client_get_upgrades (priv->client,
-						  fwupd_device_get_id (dev),
-						  NULL, &error_local);
+		if (upgrades != NULL) {
+			rels = g_hash_table_lookup (upgrades, fwupd_device_get_id (dev));
+			if (rels != NULL) {
+				g_ptr_array_ref (rels);
+			} else {
+				const gchar *reason;
+				reason = g_hash_table_lookup (reasons, fwupd_device_get_id (dev));
+				g_set_error_literal (&error_local,
+						     FWUPD_ERROR,
+						     FWUPD_ERROR_NOTHING_TO_DO,
+						     reason != NULL ? reason : "No upgrades for device");
+			}
+		} else {
+			rels = fwupd_client_get_upgrades (priv->client,
+							  fwupd_device_get_id (dev),
+							  NULL, &error_local);
+		}
 		if (rels == NULL) {
 			if (!latest_header) {
 				/* TRANSLATORS: message letting the user know no device upgrade available */
@@ -2328,6 +2388,8 @@ main (int argc, char *argv[])
 	g_autoptr(GPtrArray) cmd_array = fu_util_cmd_array_new ();
 	g_autofree gchar *cmd_descriptions = NULL;
 	g_autofree gchar *filter = NULL;
+	g_autofree gchar *since = NULL;
+	gint limit = 0;
 	const GOptionEntry options[] = {
 		{ "verbose", 'v', 0, G_OPTION_ARG_NONE, &verbose,
 			/* TRANSLATORS: command line option */
@@ -2378,6 +2440,12 @@ main (int argc, char *argv[])
 			/* TRANSLATORS: command line option */
 			_("Filter with a set of device flags using a ~ prefix to "
 			  "exclude, e.g. 'internal,~needs-reboot'"), NULL },
+		{ "since", '\0', 0, G_OPTION_ARG_STRING, &since,
+			/* TRANSLATORS: command line option */
+			_("Only show history since a date, e.g. 2020-01-31"), NULL },
+		{ "limit", '\0', 0, G_OPTION_ARG_INT, &limit,
+			/* TRANSLATORS: command line option */
+			_("Only show this many history entries"), NULL },
 		{ NULL}
 	};
 
@@ -2621,6 +2689,22 @@ main (int argc, char *argv[])
 		}
 	}
 
+	/* parse history filters */
+	if (since != NULL) {
+		if (!fu_util_parse_date (since, &priv->history_since, &error)) {
+			/* TRANSLATORS: the user didn't read the man page */
+			g_print ("%s: %s\n", _("Failed to parse --since"),
+				 error->message);
+			return EXIT_FAILURE;
+		}
+	}
+	if (limit < 0) {
+		/* TRANSLATORS: the user didn't read the man page */
+		g_print ("%s: %i\n", _("Invalid --limit"), limit);
+		return EXIT_FAILURE;
+	}
+	priv->history_limit = limit;
+
 	/* set verbose? */
 	if (verbose) {
 		g_setenv ("G_MESSAGES_DEBUG", "all", FALSE);